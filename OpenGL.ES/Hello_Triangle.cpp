@@ -139,32 +139,46 @@ const std::string& get_gl_type_string(GLenum type)
 	return search->second;
 }
 
-void print_uniform_info(GLuint program)
+void print_uniform_info(const ESProgramInfo* info)
 {
 	std::cout << "* Uniform information:\n";
-	GLint num_active_uniforms = 0;
-	GLint max_length_active_uniform = 0;
-	glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &num_active_uniforms);
-	if (num_active_uniforms > 0) {
-		glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length_active_uniform);
-		std::vector<GLchar> uniform_name(max_length_active_uniform);
-
-		for (int i = 0; i < num_active_uniforms; ++i) {
-			GLsizei length = 0;
-			GLsizei size = 0;
-			GLenum type;
-			glGetActiveUniform(program, i, static_cast<GLsizei>(uniform_name.capacity()),
-				&length, &size, &type, uniform_name.data());
-			std::cout << "> uniform[" << i << "]\n";
-			std::cout << "  .name = " << uniform_name.data() << " .length(of name) = " << length << '\n';
-			std::cout << "  .type = " << get_gl_type_string(type) << "(0x" << std::hex << type
-				<< ")  .size = " << std::dec << size << '\n';
+	int num_active_uniforms = esProgramCount(info, ES_PROGRAM_UNIFORM);
+	for (int i = 0; i < num_active_uniforms; ++i) {
+		const ESProgramVariable* uniform = esProgramGet(info, ES_PROGRAM_UNIFORM, i);
+		std::cout << "> uniform[" << i << "]\n";
+		std::cout << "  .name = " << uniform->name << " .location = " << uniform->location << '\n';
+		std::cout << "  .type = " << get_gl_type_string(uniform->type) << "(0x" << std::hex << uniform->type
+			<< ")  .size = " << std::dec << uniform->size << '\n';
+		if (uniform->block >= 0) {
+			std::cout << "  .block = " << uniform->block << " .offset = " << uniform->offset << '\n';
 		}
 	}
+
+	int num_active_blocks = esProgramCount(info, ES_PROGRAM_UNIFORM_BLOCK);
+	for (int i = 0; i < num_active_blocks; ++i) {
+		const ESProgramVariable* block = esProgramGet(info, ES_PROGRAM_UNIFORM_BLOCK, i);
+		std::cout << "> uniform block[" << i << "]\n";
+		std::cout << "  .name = " << block->name << " .data size = " << block->dataSize
+			<< " .binding = " << block->binding << '\n';
+	}
 }
 
+//std140 layout of LightBlock
+struct light_block_data {
+	ES_STD140_VEC3(light_direction);
+	ES_STD140_VEC4(light_position);
+};
+
+ES_STD140_CHECK(light_block_data, light_position, 16);
+
 struct user_data {
 	GLuint program_object;
+	ESProgramInfo* program_info;
+	GLint rgb_location;
+	GLint alpha_location;
+	//Binding of LightBlock, -1 if the compiler found it unused
+	GLint light_block_binding;
+	ESUniformRing uniforms;
 };
 
 //Create a shader object, load the shader source, and compile the shader
@@ -278,6 +292,25 @@ bool init(ESContext* esContext)
 
 	userdata->program_object = program_object;
 
+	//Query the active variables once, rather than looking them up every frame
+	if ((userdata->program_info = esProgramReflect(program_object)) == nullptr) {
+		glDeleteProgram(program_object);
+		return false;
+	}
+
+	userdata->rgb_location = esProgramUniformLocation(userdata->program_info, "rgb");
+	//Array elements past the first are not in the table
+	userdata->alpha_location = glGetUniformLocation(program_object, "alpha[3]");
+
+	const ESProgramVariable* light_block = esProgramUniformBlock(userdata->program_info, "LightBlock");
+	userdata->light_block_binding = light_block != nullptr ? light_block->binding : -1;
+
+	if (!esUniformRingInit(&userdata->uniforms, sizeof(light_block_data))) {
+		esProgramInfoFree(userdata->program_info);
+		glDeleteProgram(program_object);
+		return false;
+	}
+
 	glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
 
 	return true;
@@ -291,10 +324,26 @@ void draw(ESContext* esContext)
 									-0.5f, -0.5f, 0.0f,
 									0.5f, -0.5f, 0.0f };
 
-	GLint loc = glGetUniformLocation(userdata->program_object, "rgb");
-	glUniform4f(loc, 1.0f, 0.0f, 0.0f, 1.0f);
-	loc = glGetUniformLocation(userdata->program_object, "alpha[3]");
-	glUniform1f(loc, 0.1f);
+	glUniform4f(userdata->rgb_location, 1.0f, 0.0f, 0.0f, 1.0f);
+	glUniform1f(userdata->alpha_location, 0.1f);
+
+	//Write LightBlock for this frame, then bind it once the buffer is unmapped
+	GLintptr light_offset = 0;
+	esUniformRingBegin(&userdata->uniforms);
+	light_block_data* light = static_cast<light_block_data*>(
+		esUniformRingAlloc(&userdata->uniforms, sizeof(light_block_data), &light_offset));
+	if (light != nullptr) {
+		const GLfloat direction[3]{ 0.0f, 0.0f, -1.0f };
+		const GLfloat position[4]{ 0.0f, 0.0f, 1.0f, 1.0f };
+		std::copy(std::begin(direction), std::end(direction), light->light_direction);
+		std::copy(std::begin(position), std::end(position), light->light_position);
+	}
+	esUniformRingEnd(&userdata->uniforms);
+
+	if (light != nullptr && userdata->light_block_binding >= 0) {
+		glBindBufferRange(GL_UNIFORM_BUFFER, userdata->light_block_binding, userdata->uniforms.ring.buffer,
+			light_offset, sizeof(light_block_data));
+	}
 
 	//Set the viewport
 	glViewport(0, 0, esContext->width, esContext->height);
@@ -310,11 +359,15 @@ void draw(ESContext* esContext)
 	glEnableVertexAttribArray(0);
 
 	glDrawArrays(GL_TRIANGLES, 0, 3);
+
+	esUniformRingFence(&userdata->uniforms);
 }
 
 void shutdown(ESContext* esContext)
 {
 	user_data* userdata = static_cast<user_data*>(esContext->userData);
+	esUniformRingDestroy(&userdata->uniforms);
+	esProgramInfoFree(userdata->program_info);
 	glDeleteProgram(userdata->program_object);
 }
 
@@ -336,7 +389,7 @@ int esMain(ESContext *esContext)
 
 	print_display_config(esContext->eglDisplay, esContext->eglConfig);
 	print_program_status(static_cast<user_data*>(esContext->userData)->program_object);
-	print_uniform_info(static_cast<user_data*>(esContext->userData)->program_object);
+	print_uniform_info(static_cast<user_data*>(esContext->userData)->program_info);
 	return GL_TRUE;
 }
 
@@ -0,0 +1,320 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// MipChain.c
+//
+//    Benchmarks building the mip chain of a 4096x4096 image with the
+//    GenMipMap2D function of the MipMap2D sample against esGenMipChain, in
+//    each format it supports.  Each frame builds every chain once, and the
+//    averages are printed at shutdown.  Run headless with
+//    ES_OFFSCREEN=1 ES_FRAMES=<iterations>, and ES_NUM_THREADS to change
+//    the number of threads.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esUtil.h"
+
+#define IMAGE_SIZE   4096
+#define NUM_PATHS    5
+
+typedef struct
+{
+   // Level 0 in RGB, RGBA and R
+   GLubyte *rgb;
+   GLubyte *rgba;
+   GLubyte *r;
+
+   // Accumulated seconds per path
+   double   time[NUM_PATHS];
+
+   int      iterations;
+} UserData;
+
+static const char *pathNames[NUM_PATHS] =
+{
+   "GenMipMap2D RGB8", "esGenMipChain RGB8", "esGenMipChain RGBA8", "esGenMipChain R8", "esGenMipChain SRGB8"
+};
+
+///
+//  From an RGB8 source image, generate the next level mipmap, as in the
+//  MipMap2D sample
+//
+static GLboolean GenMipMap2D ( GLubyte *src, GLubyte **dst, int srcWidth, int srcHeight, int *dstWidth, int *dstHeight )
+{
+   int x,
+       y;
+   int texelSize = 3;
+
+   *dstWidth = srcWidth / 2;
+
+   if ( *dstWidth <= 0 )
+   {
+      *dstWidth = 1;
+   }
+
+   *dstHeight = srcHeight / 2;
+
+   if ( *dstHeight <= 0 )
+   {
+      *dstHeight = 1;
+   }
+
+   *dst = malloc ( sizeof ( GLubyte ) * texelSize * ( *dstWidth ) * ( *dstHeight ) );
+
+   if ( *dst == NULL )
+   {
+      return GL_FALSE;
+   }
+
+   for ( y = 0; y < *dstHeight; y++ )
+   {
+      for ( x = 0; x < *dstWidth; x++ )
+      {
+         int srcIndex[4];
+         float r = 0.0f,
+               g = 0.0f,
+               b = 0.0f;
+         int sample;
+
+         srcIndex[0] =
+            ( ( ( y * 2 ) * srcWidth ) + ( x * 2 ) ) * texelSize;
+         srcIndex[1] =
+            ( ( ( y * 2 ) * srcWidth ) + ( x * 2 + 1 ) ) * texelSize;
+         srcIndex[2] =
+            ( ( ( ( y * 2 ) + 1 ) * srcWidth ) + ( x * 2 ) ) * texelSize;
+         srcIndex[3] =
+            ( ( ( ( y * 2 ) + 1 ) * srcWidth ) + ( x * 2 + 1 ) ) * texelSize;
+
+         for ( sample = 0; sample < 4; sample++ )
+         {
+            r += src[srcIndex[sample]];
+            g += src[srcIndex[sample] + 1];
+            b += src[srcIndex[sample] + 2];
+         }
+
+         r /= 4.0;
+         g /= 4.0;
+         b /= 4.0;
+
+         ( *dst ) [ ( y * ( *dstWidth ) + x ) * texelSize ] = ( GLubyte ) ( r );
+         ( *dst ) [ ( y * ( *dstWidth ) + x ) * texelSize + 1] = ( GLubyte ) ( g );
+         ( *dst ) [ ( y * ( *dstWidth ) + x ) * texelSize + 2] = ( GLubyte ) ( b );
+      }
+   }
+
+   return GL_TRUE;
+}
+
+///
+// LegacyMipChain()
+//
+//    Every level after the first with GenMipMap2D, as CreateMipMappedTexture2D
+//    did.  Returns level 1 when keepLevel1 is set, NULL otherwise.
+//
+static GLubyte *LegacyMipChain ( GLubyte *pixels, int width, int height, GLboolean keepLevel1 )
+{
+   GLubyte *prevImage = pixels;
+   GLubyte *newImage = NULL;
+   GLubyte *level1 = NULL;
+
+   while ( width > 1 && height > 1 )
+   {
+      int newWidth,
+          newHeight;
+
+      if ( !GenMipMap2D ( prevImage, &newImage, width, height, &newWidth, &newHeight ) )
+      {
+         break;
+      }
+
+      if ( prevImage == pixels && keepLevel1 )
+      {
+         level1 = newImage;
+      }
+      else if ( prevImage != pixels && prevImage != level1 )
+      {
+         free ( prevImage );
+      }
+
+      prevImage = newImage;
+      width = newWidth;
+      height = newHeight;
+   }
+
+   if ( prevImage != pixels && prevImage != level1 )
+   {
+      free ( prevImage );
+   }
+
+   return level1;
+}
+
+///
+// Initialize the images, and check esGenMipChain agrees with GenMipMap2D to
+// within rounding
+//
+int Init ( ESContext *esContext )
+{
+   UserData *userData = esContext->userData;
+   int count = IMAGE_SIZE * IMAGE_SIZE;
+   ESMipChain chain;
+   GLubyte *level1;
+   int maxError = 0;
+   int i;
+
+   memset ( userData, 0, sizeof ( UserData ) );
+
+   userData->rgb = ( GLubyte * ) malloc ( count * 3 );
+   userData->rgba = ( GLubyte * ) malloc ( count * 4 );
+   userData->r = ( GLubyte * ) malloc ( count );
+
+   if ( userData->rgb == NULL || userData->rgba == NULL || userData->r == NULL )
+   {
+      return FALSE;
+   }
+
+   srand ( 0 );
+
+   for ( i = 0; i < count; i++ )
+   {
+      userData->rgb[i * 3] = userData->rgba[i * 4] = userData->r[i] = ( GLubyte ) rand ( );
+      userData->rgb[i * 3 + 1] = userData->rgba[i * 4 + 1] = ( GLubyte ) rand ( );
+      userData->rgb[i * 3 + 2] = userData->rgba[i * 4 + 2] = ( GLubyte ) rand ( );
+      userData->rgba[i * 4 + 3] = 255;
+   }
+
+   level1 = LegacyMipChain ( userData->rgb, IMAGE_SIZE, IMAGE_SIZE, GL_TRUE );
+
+   if ( level1 == NULL || !esGenMipChain ( &chain, userData->rgb, IMAGE_SIZE, IMAGE_SIZE, 3, 0 ) )
+   {
+      free ( level1 );
+      return FALSE;
+   }
+
+   for ( i = 0; i < count / 4 * 3; i++ )
+   {
+      int error = abs ( level1[i] - chain.pixels[1][i] );
+
+      maxError = error > maxError ? error : maxError;
+   }
+
+   free ( level1 );
+   esFreeMipChain ( &chain );
+
+   if ( maxError > 1 )
+   {
+      esLogMessage ( "Mip chains disagree by up to %d.\n", maxError );
+      return FALSE;
+   }
+
+   return TRUE;
+}
+
+///
+// Build every chain once
+//
+void Draw ( ESContext *esContext )
+{
+   UserData *userData = esContext->userData;
+   ESMipChain chain;
+   double t[NUM_PATHS + 1];
+
+   t[0] = esGetTime ( );
+   LegacyMipChain ( userData->rgb, IMAGE_SIZE, IMAGE_SIZE, GL_FALSE );
+   t[1] = esGetTime ( );
+   esGenMipChain ( &chain, userData->rgb, IMAGE_SIZE, IMAGE_SIZE, 3, 0 );
+   esFreeMipChain ( &chain );
+   t[2] = esGetTime ( );
+   esGenMipChain ( &chain, userData->rgba, IMAGE_SIZE, IMAGE_SIZE, 4, 0 );
+   esFreeMipChain ( &chain );
+   t[3] = esGetTime ( );
+   esGenMipChain ( &chain, userData->r, IMAGE_SIZE, IMAGE_SIZE, 1, 0 );
+   esFreeMipChain ( &chain );
+   t[4] = esGetTime ( );
+   esGenMipChain ( &chain, userData->rgb, IMAGE_SIZE, IMAGE_SIZE, 3, ES_MIP_SRGB );
+   esFreeMipChain ( &chain );
+   t[5] = esGetTime ( );
+
+   userData->time[0] += t[1] - t[0];
+   userData->time[1] += t[2] - t[1];
+   userData->time[2] += t[3] - t[2];
+   userData->time[3] += t[4] - t[3];
+   userData->time[4] += t[5] - t[4];
+
+   userData->iterations++;
+}
+
+///
+// Print the average times and source throughput
+//
+void Shutdown ( ESContext *esContext )
+{
+   UserData *userData = esContext->userData;
+   static const int bytesPerPixel[NUM_PATHS] = { 3, 3, 4, 1, 3 };
+   int i;
+
+   if ( userData->iterations > 0 )
+   {
+      esLogMessage ( "%-22s %12s %12s\n", "path", "time (ms)", "MB/s" );
+
+      for ( i = 0; i < NUM_PATHS; i++ )
+      {
+         double time = userData->time[i] / userData->iterations;
+         double bytes = ( double ) IMAGE_SIZE * IMAGE_SIZE * bytesPerPixel[i];
+
+         esLogMessage ( "%-22s %12.3f %12.1f\n", pathNames[i], time * 1000.0, bytes / time / ( 1024.0 * 1024.0 ) );
+      }
+
+      esLogMessage ( "%dx%d, %d iterations\n", IMAGE_SIZE, IMAGE_SIZE, userData->iterations );
+   }
+
+   free ( userData->rgb );
+   free ( userData->rgba );
+   free ( userData->r );
+}
+
+int esMain ( ESContext *esContext )
+{
+   esContext->userData = malloc ( sizeof ( UserData ) );
+
+   esCreateWindow ( esContext, "MipChain", 320, 240, ES_WINDOW_RGB | ES_WINDOW_OFFSCREEN );
+
+   if ( !Init ( esContext ) )
+   {
+      return GL_FALSE;
+   }
+
+   esRegisterShutdownFunc ( esContext, Shutdown );
+   esRegisterDrawFunc ( esContext, Draw );
+
+   return GL_TRUE;
+}
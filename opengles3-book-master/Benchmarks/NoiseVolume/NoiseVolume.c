@@ -0,0 +1,368 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// NoiseVolume.c
+//
+//    Benchmarks generating 3D noise volumes with the original scalar
+//    two-pass generator of the Noise3D sample against esGenNoise3D, at
+//    several sizes.  Each frame generates every size once with both, and
+//    the average voxels per second are printed at shutdown.  Run headless
+//    with ES_OFFSCREEN=1 ES_FRAMES=<iterations>, and ES_NUM_THREADS to
+//    change the number of threads.
+//
+#define _USE_MATH_DEFINES
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "esUtil.h"
+
+#define NUM_SIZES          3
+#define NUM_PATHS          2
+#define FREQUENCY          5.0f
+
+#define NOISE_TABLE_MASK   255
+
+#define FLOOR(x)           ((int)(x) - ((x) < 0 && (x) != (int)(x)))
+#define smoothstep(t)      ( t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f ) )
+#define lerp(t, a, b)      ( a + t * (b - a) )
+#ifdef _WIN32
+   #define srandom srand
+   #define random rand
+#endif
+
+typedef struct
+{
+   // Accumulated seconds per size and path
+   double time[NUM_SIZES][NUM_PATHS];
+
+   int    iterations;
+} UserData;
+
+static const int sizes[NUM_SIZES] = { 64, 128, 256 };
+static const char *pathNames[NUM_PATHS] = { "scalar", "esGenNoise3D" };
+
+// lattice gradients 3D noise
+static float   gradientTable[256 * 3];
+
+// permTable describes a random permutatin of 8-bit values from 0 to 255.
+static unsigned char permTable[256] =
+{
+   0xE1, 0x9B, 0xD2, 0x6C, 0xAF, 0xC7, 0xDD, 0x90, 0xCB, 0x74, 0x46, 0xD5, 0x45, 0x9E, 0x21, 0xFC,
+   0x05, 0x52, 0xAD, 0x85, 0xDE, 0x8B, 0xAE, 0x1B, 0x09, 0x47, 0x5A, 0xF6, 0x4B, 0x82, 0x5B, 0xBF,
+   0xA9, 0x8A, 0x02, 0x97, 0xC2, 0xEB, 0x51, 0x07, 0x19, 0x71, 0xE4, 0x9F, 0xCD, 0xFD, 0x86, 0x8E,
+   0xF8, 0x41, 0xE0, 0xD9, 0x16, 0x79, 0xE5, 0x3F, 0x59, 0x67, 0x60, 0x68, 0x9C, 0x11, 0xC9, 0x81,
+   0x24, 0x08, 0xA5, 0x6E, 0xED, 0x75, 0xE7, 0x38, 0x84, 0xD3, 0x98, 0x14, 0xB5, 0x6F, 0xEF, 0xDA,
+   0xAA, 0xA3, 0x33, 0xAC, 0x9D, 0x2F, 0x50, 0xD4, 0xB0, 0xFA, 0x57, 0x31, 0x63, 0xF2, 0x88, 0xBD,
+   0xA2, 0x73, 0x2C, 0x2B, 0x7C, 0x5E, 0x96, 0x10, 0x8D, 0xF7, 0x20, 0x0A, 0xC6, 0xDF, 0xFF, 0x48,
+   0x35, 0x83, 0x54, 0x39, 0xDC, 0xC5, 0x3A, 0x32, 0xD0, 0x0B, 0xF1, 0x1C, 0x03, 0xC0, 0x3E, 0xCA,
+   0x12, 0xD7, 0x99, 0x18, 0x4C, 0x29, 0x0F, 0xB3, 0x27, 0x2E, 0x37, 0x06, 0x80, 0xA7, 0x17, 0xBC,
+   0x6A, 0x22, 0xBB, 0x8C, 0xA4, 0x49, 0x70, 0xB6, 0xF4, 0xC3, 0xE3, 0x0D, 0x23, 0x4D, 0xC4, 0xB9,
+   0x1A, 0xC8, 0xE2, 0x77, 0x1F, 0x7B, 0xA8, 0x7D, 0xF9, 0x44, 0xB7, 0xE6, 0xB1, 0x87, 0xA0, 0xB4,
+   0x0C, 0x01, 0xF3, 0x94, 0x66, 0xA6, 0x26, 0xEE, 0xFB, 0x25, 0xF0, 0x7E, 0x40, 0x4A, 0xA1, 0x28,
+   0xB8, 0x95, 0xAB, 0xB2, 0x65, 0x42, 0x1D, 0x3B, 0x92, 0x3D, 0xFE, 0x6B, 0x2A, 0x56, 0x9A, 0x04,
+   0xEC, 0xE8, 0x78, 0x15, 0xE9, 0xD1, 0x2D, 0x62, 0xC1, 0x72, 0x4E, 0x13, 0xCE, 0x0E, 0x76, 0x7F,
+   0x30, 0x4F, 0x93, 0x55, 0x1E, 0xCF, 0xDB, 0x36, 0x58, 0xEA, 0xBE, 0x7A, 0x5F, 0x43, 0x8F, 0x6D,
+   0x89, 0xD6, 0x91, 0x5D, 0x5C, 0x64, 0xF5, 0x00, 0xD8, 0xBA, 0x3C, 0x53, 0x69, 0x61, 0xCC, 0x34,
+};
+
+///
+// InitNoiseTable()
+//
+//    The original gradient table setup
+//
+static void InitNoiseTable ( void )
+{
+   int   i;
+   float a, x, y, z, r;
+   float gradients[256 * 3];
+
+   srandom ( 0 );
+
+   for ( i = 0; i < 256; i++ )
+   {
+      a = ( random() % 32768 ) / 32768.0f;
+      z = ( 1.0f - 2.0f * a );
+
+      r = sqrtf ( 1.0f - z * z );
+
+      a = ( random() % 32768 ) / 32768.0f;
+      x = ( r * cosf ( a ) );
+      y = ( r * sinf ( a ) );
+
+      gradients[i * 3] = x;
+      gradients[i * 3 + 1] = y;
+      gradients[i * 3 + 2] = z;
+   }
+
+   for ( i = 0; i < 256; i++ )
+   {
+      memcpy ( &gradientTable[i * 3], &gradients[permTable[i] * 3], 3 * sizeof ( float ) );
+   }
+}
+
+///
+// Glattice3D()
+//
+//    Gradient noise value of a lattice point
+//
+static float Glattice3D ( int ix, int iy, int iz, float fx, float fy, float fz )
+{
+   float *g;
+   int   indx, y, z;
+
+   z = permTable[iz & NOISE_TABLE_MASK];
+   y = permTable[ ( iy + z ) & NOISE_TABLE_MASK];
+   indx = ( ix + y ) & NOISE_TABLE_MASK;
+   g = &gradientTable[indx * 3];
+
+   return ( g[0] * fx + g[1] * fy + g[2] * fz );
+}
+
+///
+// Noise3D()
+//
+//    The original scalar noise, all eight lattice points of every voxel
+//
+static float Noise3D ( float *f )
+{
+   int   ix, iy, iz;
+   float fx0, fx1, fy0, fy1, fz0, fz1;
+   float wx, wy, wz;
+   float vx0, vx1, vy0, vy1, vz0, vz1;
+
+   ix = FLOOR ( f[0] );
+   fx0 = f[0] - ix;
+   fx1 = fx0 - 1;
+   wx = smoothstep ( fx0 );
+
+   iy = FLOOR ( f[1] );
+   fy0 = f[1] - iy;
+   fy1 = fy0 - 1;
+   wy = smoothstep ( fy0 );
+
+   iz = FLOOR ( f[2] );
+   fz0 = f[2] - iz;
+   fz1 = fz0 - 1;
+   wz = smoothstep ( fz0 );
+
+   vx0 = Glattice3D ( ix, iy, iz, fx0, fy0, fz0 );
+   vx1 = Glattice3D ( ix + 1, iy, iz, fx1, fy0, fz0 );
+   vy0 = lerp ( wx, vx0, vx1 );
+   vx0 = Glattice3D ( ix, iy + 1, iz, fx0, fy1, fz0 );
+   vx1 = Glattice3D ( ix + 1, iy + 1, iz, fx1, fy1, fz0 );
+   vy1 = lerp ( wx, vx0, vx1 );
+   vz0 = lerp ( wy, vy0, vy1 );
+
+   vx0 = Glattice3D ( ix, iy, iz + 1, fx0, fy0, fz1 );
+   vx1 = Glattice3D ( ix + 1, iy, iz + 1, fx1, fy0, fz1 );
+   vy0 = lerp ( wx, vx0, vx1 );
+   vx0 = Glattice3D ( ix, iy + 1, iz + 1, fx0, fy1, fz1 );
+   vx1 = Glattice3D ( ix + 1, iy + 1, iz + 1, fx1, fy1, fz1 );
+   vy1 = lerp ( wx, vx0, vx1 );
+   vz1 = lerp ( wy, vy0, vy1 );
+
+   return lerp ( wz, vz0, vz1 );
+}
+
+///
+// LegacyGenNoise3D()
+//
+//    The original generator: noise into a float volume, then a second pass
+//    to normalize it to bytes
+//
+static GLboolean LegacyGenNoise3D ( GLubyte *volume, int size, float frequency )
+{
+   float *values = ( float * ) malloc ( sizeof ( float ) * size * size * size );
+   float min = 1000;
+   float max = -1000;
+   int x, y, z;
+   int index = 0;
+
+   if ( values == NULL )
+   {
+      return GL_FALSE;
+   }
+
+   InitNoiseTable ( );
+
+   for ( z = 0; z < size; z++ )
+   {
+      for ( y = 0; y < size; y++ )
+      {
+         for ( x = 0; x < size; x++ )
+         {
+            float pos[3] = { ( float ) x / ( float ) size, ( float ) y / ( float ) size, ( float ) z / ( float ) size };
+            float noiseVal;
+
+            pos[0] *= frequency;
+            pos[1] *= frequency;
+            pos[2] *= frequency;
+            noiseVal = Noise3D ( pos );
+
+            min = noiseVal < min ? noiseVal : min;
+            max = noiseVal > max ? noiseVal : max;
+
+            values[index++] = noiseVal;
+         }
+      }
+   }
+
+   for ( index = 0; index < size * size * size; index++ )
+   {
+      volume[index] = ( GLubyte ) ( ( values[index] - min ) / ( max - min ) * 255.0f );
+   }
+
+   free ( values );
+
+   return GL_TRUE;
+}
+
+///
+// Initialize, and check both generators agree to within rounding
+//
+int Init ( ESContext *esContext )
+{
+   UserData *userData = esContext->userData;
+   int size = sizes[0];
+   int count = size * size * size;
+   GLubyte *legacy = ( GLubyte * ) malloc ( count );
+   GLubyte *volume = ( GLubyte * ) malloc ( count );
+   int maxError = 0;
+   int i;
+
+   memset ( userData, 0, sizeof ( UserData ) );
+
+   if ( legacy == NULL || volume == NULL ||
+        !LegacyGenNoise3D ( legacy, size, FREQUENCY ) || !esGenNoise3D ( volume, size, FREQUENCY ) )
+   {
+      free ( legacy );
+      free ( volume );
+      return FALSE;
+   }
+
+   for ( i = 0; i < count; i++ )
+   {
+      int error = abs ( legacy[i] - volume[i] );
+
+      maxError = error > maxError ? error : maxError;
+   }
+
+   free ( legacy );
+   free ( volume );
+
+   if ( maxError > 1 )
+   {
+      esLogMessage ( "Generators disagree by up to %d.\n", maxError );
+      return FALSE;
+   }
+
+   return TRUE;
+}
+
+///
+// Generate every size once with each path
+//
+void Draw ( ESContext *esContext )
+{
+   UserData *userData = esContext->userData;
+   int i;
+
+   for ( i = 0; i < NUM_SIZES; i++ )
+   {
+      GLubyte *volume = ( GLubyte * ) malloc ( ( size_t ) sizes[i] * sizes[i] * sizes[i] );
+      double t0, t1, t2;
+
+      if ( volume == NULL )
+      {
+         continue;
+      }
+
+      t0 = esGetTime ( );
+      LegacyGenNoise3D ( volume, sizes[i], FREQUENCY );
+      t1 = esGetTime ( );
+      esGenNoise3D ( volume, sizes[i], FREQUENCY );
+      t2 = esGetTime ( );
+
+      userData->time[i][0] += t1 - t0;
+      userData->time[i][1] += t2 - t1;
+
+      free ( volume );
+   }
+
+   userData->iterations++;
+}
+
+///
+// Print the average times and voxels per second
+//
+void Shutdown ( ESContext *esContext )
+{
+   UserData *userData = esContext->userData;
+   int i, j;
+
+   if ( userData->iterations == 0 )
+   {
+      return;
+   }
+
+   esLogMessage ( "%-8s %-14s %12s %16s\n", "size", "path", "time (ms)", "Mvoxels/s" );
+
+   for ( i = 0; i < NUM_SIZES; i++ )
+   {
+      for ( j = 0; j < NUM_PATHS; j++ )
+      {
+         double time = userData->time[i][j] / userData->iterations;
+         double voxels = ( double ) sizes[i] * sizes[i] * sizes[i];
+
+         esLogMessage ( "%-8d %-14s %12.3f %16.2f\n", sizes[i], pathNames[j], time * 1000.0, voxels / time * 1e-6 );
+      }
+   }
+
+   esLogMessage ( "%d iterations, %d CPUs\n", userData->iterations, esGetCPUCount ( ) );
+}
+
+int esMain ( ESContext *esContext )
+{
+   esContext->userData = malloc ( sizeof ( UserData ) );
+
+   esCreateWindow ( esContext, "NoiseVolume", 320, 240, ES_WINDOW_RGB | ES_WINDOW_OFFSCREEN );
+
+   if ( !Init ( esContext ) )
+   {
+      return GL_FALSE;
+   }
+
+   esRegisterShutdownFunc ( esContext, Shutdown );
+   esRegisterDrawFunc ( esContext, Draw );
+
+   return GL_TRUE;
+}
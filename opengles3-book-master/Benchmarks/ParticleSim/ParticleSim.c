@@ -0,0 +1,265 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// ParticleSim.c
+//
+//    Benchmarks simulating a particle emitter on the CPU with interleaved
+//    particles, rand() and a scalar loop, as the ParticleSystem sample
+//    stored them, against an ESParticleSystem.  Each frame tops the emitter
+//    back up to its particle count, takes one time step and writes the
+//    vertices, and the average times of each part are printed at shutdown.
+//    The particle count can be given on the command line (default 1000000).
+//    Run headless with ES_OFFSCREEN=1 ES_FRAMES=<iterations>, and
+//    ES_NUM_THREADS to change the number of threads.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esUtil.h"
+
+#define NUM_PARTICLES   1000000
+#define PARTICLE_SIZE   8
+#define TIME_STEP       ( 1.0f / 60.0f )
+
+#define NUM_PATHS       2
+#define NUM_PARTS       3
+
+typedef struct
+{
+   int      numParticles;
+
+   // Interleaved particles: position, velocity, age and lifetime
+   GLfloat *particleData;
+   int      count;
+
+   ESParticleSystem *particles;
+
+   // Vertices written by both paths
+   GLfloat *vertices;
+
+   // Accumulated seconds per path and part
+   double   time[NUM_PATHS][NUM_PARTS];
+
+   int      iterations;
+} UserData;
+
+static const char *pathNames[NUM_PATHS] = { "interleaved", "ESParticleSystem" };
+static const char *partNames[NUM_PARTS] = { "emit", "update", "write" };
+
+static const ESParticleEmitter emitter = { { 0.0f, 0.0f, 0.0f }, 0.125f, 1.0f, 1.0f };
+
+///
+// LegacyEmit()
+//
+//    Spawn particles up to the particle count with rand()
+//
+static void LegacyEmit ( UserData *userData )
+{
+   for ( ; userData->count < userData->numParticles; userData->count++ )
+   {
+      float *particleData = &userData->particleData[userData->count * PARTICLE_SIZE];
+
+      ( *particleData++ ) = ( ( float ) ( rand() % 10000 ) / 40000.0f ) - 0.125f;
+      ( *particleData++ ) = ( ( float ) ( rand() % 10000 ) / 40000.0f ) - 0.125f;
+      ( *particleData++ ) = ( ( float ) ( rand() % 10000 ) / 40000.0f ) - 0.125f;
+
+      ( *particleData++ ) = ( ( float ) ( rand() % 10000 ) / 5000.0f ) - 1.0f;
+      ( *particleData++ ) = ( ( float ) ( rand() % 10000 ) / 5000.0f ) - 1.0f;
+      ( *particleData++ ) = ( ( float ) ( rand() % 10000 ) / 5000.0f ) - 1.0f;
+
+      ( *particleData++ ) = 0.0f;
+      ( *particleData++ ) = ( ( float ) ( rand() % 10000 + 1 ) / 10001.0f );
+   }
+}
+
+///
+// LegacyUpdate()
+//
+//    Integrate one particle at a time, replacing dead ones with the last
+//
+static void LegacyUpdate ( UserData *userData, float deltaTime )
+{
+   int i = 0;
+
+   while ( i < userData->count )
+   {
+      float *p = &userData->particleData[i * PARTICLE_SIZE];
+
+      p[0] += p[3] * deltaTime;
+      p[1] += p[4] * deltaTime;
+      p[2] += p[5] * deltaTime;
+      p[6] += deltaTime;
+
+      if ( p[6] >= p[7] )
+      {
+         userData->count--;
+         memcpy ( p, &userData->particleData[userData->count * PARTICLE_SIZE], PARTICLE_SIZE * sizeof ( float ) );
+         continue;
+      }
+
+      i++;
+   }
+}
+
+///
+// LegacyWrite()
+//
+static void LegacyWrite ( UserData *userData )
+{
+   int i;
+
+   for ( i = 0; i < userData->count; i++ )
+   {
+      const float *p = &userData->particleData[i * PARTICLE_SIZE];
+      GLfloat *v = &userData->vertices[i * 4];
+
+      v[0] = p[0];
+      v[1] = p[1];
+      v[2] = p[2];
+      v[3] = 1.0f - p[6] / p[7];
+   }
+}
+
+///
+// Allocate both emitters
+//
+int Init ( ESContext *esContext )
+{
+   UserData *userData = esContext->userData;
+
+   userData->particleData = ( GLfloat * ) malloc ( sizeof ( GLfloat ) * PARTICLE_SIZE * userData->numParticles );
+   userData->vertices = ( GLfloat * ) malloc ( sizeof ( GLfloat ) * 4 * userData->numParticles );
+   userData->particles = esParticleSystemCreate ( userData->numParticles );
+
+   if ( userData->particleData == NULL || userData->vertices == NULL || userData->particles == NULL )
+   {
+      return FALSE;
+   }
+
+   srand ( 0 );
+
+   return TRUE;
+}
+
+///
+// One time step of both emitters
+//
+void Draw ( ESContext *esContext )
+{
+   UserData *userData = esContext->userData;
+   ESParticleSystem *particles = userData->particles;
+   double t[NUM_PATHS * NUM_PARTS + 1];
+
+   t[0] = esGetTime ( );
+   LegacyEmit ( userData );
+   t[1] = esGetTime ( );
+   LegacyUpdate ( userData, TIME_STEP );
+   t[2] = esGetTime ( );
+   LegacyWrite ( userData );
+   t[3] = esGetTime ( );
+   esParticleSystemEmit ( particles, &emitter, userData->numParticles - esParticleSystemCount ( particles ) );
+   t[4] = esGetTime ( );
+   esParticleSystemUpdate ( particles, TIME_STEP, NULL );
+   t[5] = esGetTime ( );
+   esParticleSystemWrite ( particles, userData->vertices, 0.0f );
+   t[6] = esGetTime ( );
+
+   userData->time[0][0] += t[1] - t[0];
+   userData->time[0][1] += t[2] - t[1];
+   userData->time[0][2] += t[3] - t[2];
+   userData->time[1][0] += t[4] - t[3];
+   userData->time[1][1] += t[5] - t[4];
+   userData->time[1][2] += t[6] - t[5];
+
+   userData->iterations++;
+}
+
+///
+// Print the average times per step and the update throughput
+//
+void Shutdown ( ESContext *esContext )
+{
+   UserData *userData = esContext->userData;
+   int path, part;
+
+   if ( userData->iterations > 0 )
+   {
+      esLogMessage ( "%-18s %10s %10s %10s %14s\n", "path", partNames[0], partNames[1], partNames[2], "Mparticles/s" );
+
+      for ( path = 0; path < NUM_PATHS; path++ )
+      {
+         double update = userData->time[path][1] / userData->iterations;
+
+         esLogMessage ( "%-18s", pathNames[path] );
+
+         for ( part = 0; part < NUM_PARTS; part++ )
+         {
+            esLogMessage ( " %10.3f", userData->time[path][part] / userData->iterations * 1000.0 );
+         }
+
+         esLogMessage ( " %14.1f\n", userData->numParticles / update / 1.0e6 );
+      }
+
+      esLogMessage ( "%d particles, times in ms per step, %d steps\n", userData->numParticles, userData->iterations );
+   }
+
+   esParticleSystemDestroy ( userData->particles );
+   free ( userData->particleData );
+   free ( userData->vertices );
+}
+
+int esMain ( ESContext *esContext )
+{
+   UserData *userData;
+
+   esContext->userData = malloc ( sizeof ( UserData ) );
+   userData = esContext->userData;
+   memset ( userData, 0, sizeof ( UserData ) );
+
+   userData->numParticles = NUM_PARTICLES;
+
+   if ( esContext->argc > 1 && atoi ( esContext->argv[1] ) > 0 )
+   {
+      userData->numParticles = atoi ( esContext->argv[1] );
+   }
+
+   esCreateWindow ( esContext, "ParticleSim", 320, 240, ES_WINDOW_RGB | ES_WINDOW_OFFSCREEN );
+
+   if ( !Init ( esContext ) )
+   {
+      return GL_FALSE;
+   }
+
+   esRegisterShutdownFunc ( esContext, Shutdown );
+   esRegisterDrawFunc ( esContext, Draw );
+
+   return GL_TRUE;
+}
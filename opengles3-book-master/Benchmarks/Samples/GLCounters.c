@@ -0,0 +1,289 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// GLCounters.c
+//
+//    Counts draw calls and bytes uploaded from the CPU for the benchmark
+//    targets.  These are linked with -Wl,--wrap=<function> for every
+//    function below, so calls from the sample and from Common land here
+//    first and are passed on to the real entry points.  Texture uploads
+//    from a pixel unpack buffer are not counted again, the bytes were
+//    counted when the buffer was filled.
+//
+#include "esUtil.h"
+#include "esUtil_win.h"
+
+void GL_APIENTRY __real_glDrawArrays ( GLenum mode, GLint first, GLsizei count );
+void GL_APIENTRY __real_glDrawElements ( GLenum mode, GLsizei count, GLenum type, const void *indices );
+void GL_APIENTRY __real_glDrawRangeElements ( GLenum mode, GLuint start, GLuint end, GLsizei count, GLenum type,
+                                              const void *indices );
+void GL_APIENTRY __real_glDrawArraysInstanced ( GLenum mode, GLint first, GLsizei count, GLsizei instanceCount );
+void GL_APIENTRY __real_glDrawElementsInstanced ( GLenum mode, GLsizei count, GLenum type, const void *indices,
+                                                  GLsizei instanceCount );
+void GL_APIENTRY __real_glBufferData ( GLenum target, GLsizeiptr size, const void *data, GLenum usage );
+void GL_APIENTRY __real_glBufferSubData ( GLenum target, GLintptr offset, GLsizeiptr size, const void *data );
+void *GL_APIENTRY __real_glMapBufferRange ( GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access );
+void GL_APIENTRY __real_glTexImage2D ( GLenum target, GLint level, GLint internalformat, GLsizei width,
+                                       GLsizei height, GLint border, GLenum format, GLenum type,
+                                       const void *pixels );
+void GL_APIENTRY __real_glTexSubImage2D ( GLenum target, GLint level, GLint xoffset, GLint yoffset,
+                                          GLsizei width, GLsizei height, GLenum format, GLenum type,
+                                          const void *pixels );
+void GL_APIENTRY __real_glTexImage3D ( GLenum target, GLint level, GLint internalformat, GLsizei width,
+                                       GLsizei height, GLsizei depth, GLint border, GLenum format,
+                                       GLenum type, const void *pixels );
+void GL_APIENTRY __real_glTexSubImage3D ( GLenum target, GLint level, GLint xoffset, GLint yoffset,
+                                          GLint zoffset, GLsizei width, GLsizei height, GLsizei depth,
+                                          GLenum format, GLenum type, const void *pixels );
+void GL_APIENTRY __real_glCompressedTexImage2D ( GLenum target, GLint level, GLenum internalformat,
+                                                 GLsizei width, GLsizei height, GLint border,
+                                                 GLsizei imageSize, const void *data );
+void GL_APIENTRY __real_glCompressedTexSubImage2D ( GLenum target, GLint level, GLint xoffset, GLint yoffset,
+                                                    GLsizei width, GLsizei height, GLenum format,
+                                                    GLsizei imageSize, const void *data );
+void GL_APIENTRY __real_glCompressedTexImage3D ( GLenum target, GLint level, GLenum internalformat,
+                                                 GLsizei width, GLsizei height, GLsizei depth, GLint border,
+                                                 GLsizei imageSize, const void *data );
+void GL_APIENTRY __real_glCompressedTexSubImage3D ( GLenum target, GLint level, GLint xoffset, GLint yoffset,
+                                                    GLint zoffset, GLsizei width, GLsizei height, GLsizei depth,
+                                                    GLenum format, GLsizei imageSize, const void *data );
+
+///
+// PixelSize()
+//
+//    Bytes per pixel of a client pixel format and type
+//
+static int PixelSize ( GLenum format, GLenum type )
+{
+   int components;
+
+   switch ( type )
+   {
+      case GL_UNSIGNED_SHORT_5_6_5:
+      case GL_UNSIGNED_SHORT_4_4_4_4:
+      case GL_UNSIGNED_SHORT_5_5_5_1:
+         return 2;
+
+      case GL_UNSIGNED_INT_2_10_10_10_REV:
+      case GL_UNSIGNED_INT_10F_11F_11F_REV:
+      case GL_UNSIGNED_INT_5_9_9_9_REV:
+      case GL_UNSIGNED_INT_24_8:
+         return 4;
+
+      case GL_FLOAT_32_UNSIGNED_INT_24_8_REV:
+         return 8;
+   }
+
+   switch ( format )
+   {
+      case GL_RG:
+      case GL_RG_INTEGER:
+      case GL_LUMINANCE_ALPHA:
+         components = 2;
+         break;
+
+      case GL_RGB:
+      case GL_RGB_INTEGER:
+         components = 3;
+         break;
+
+      case GL_RGBA:
+      case GL_RGBA_INTEGER:
+         components = 4;
+         break;
+
+      default:
+         components = 1;
+         break;
+   }
+
+   switch ( type )
+   {
+      case GL_UNSIGNED_SHORT:
+      case GL_SHORT:
+      case GL_HALF_FLOAT:
+         return components * 2;
+
+      case GL_UNSIGNED_INT:
+      case GL_INT:
+      case GL_FLOAT:
+         return components * 4;
+
+      default:
+         return components;
+   }
+}
+
+///
+// CountTexture()
+//
+//    Count a texture upload from client memory
+//
+static void CountTexture ( const void *pixels, double bytes )
+{
+   GLint unpackBuffer = 0;
+
+   if ( pixels == NULL && bytes == 0.0 )
+   {
+      return;
+   }
+
+   glGetIntegerv ( GL_PIXEL_UNPACK_BUFFER_BINDING, &unpackBuffer );
+
+   if ( unpackBuffer == 0 && pixels != NULL )
+   {
+      BenchmarkCountUpload ( bytes );
+   }
+}
+
+void GL_APIENTRY __wrap_glDrawArrays ( GLenum mode, GLint first, GLsizei count )
+{
+   BenchmarkCountDraws ( 1 );
+   __real_glDrawArrays ( mode, first, count );
+}
+
+void GL_APIENTRY __wrap_glDrawElements ( GLenum mode, GLsizei count, GLenum type, const void *indices )
+{
+   BenchmarkCountDraws ( 1 );
+   __real_glDrawElements ( mode, count, type, indices );
+}
+
+void GL_APIENTRY __wrap_glDrawRangeElements ( GLenum mode, GLuint start, GLuint end, GLsizei count, GLenum type,
+                                              const void *indices )
+{
+   BenchmarkCountDraws ( 1 );
+   __real_glDrawRangeElements ( mode, start, end, count, type, indices );
+}
+
+void GL_APIENTRY __wrap_glDrawArraysInstanced ( GLenum mode, GLint first, GLsizei count, GLsizei instanceCount )
+{
+   BenchmarkCountDraws ( 1 );
+   __real_glDrawArraysInstanced ( mode, first, count, instanceCount );
+}
+
+void GL_APIENTRY __wrap_glDrawElementsInstanced ( GLenum mode, GLsizei count, GLenum type, const void *indices,
+                                                  GLsizei instanceCount )
+{
+   BenchmarkCountDraws ( 1 );
+   __real_glDrawElementsInstanced ( mode, count, type, indices, instanceCount );
+}
+
+void GL_APIENTRY __wrap_glBufferData ( GLenum target, GLsizeiptr size, const void *data, GLenum usage )
+{
+   if ( data != NULL )
+   {
+      BenchmarkCountUpload ( ( double ) size );
+   }
+
+   __real_glBufferData ( target, size, data, usage );
+}
+
+void GL_APIENTRY __wrap_glBufferSubData ( GLenum target, GLintptr offset, GLsizeiptr size, const void *data )
+{
+   BenchmarkCountUpload ( ( double ) size );
+   __real_glBufferSubData ( target, offset, size, data );
+}
+
+// A mapping for writing counts as fully written
+void *GL_APIENTRY __wrap_glMapBufferRange ( GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access )
+{
+   if ( access & GL_MAP_WRITE_BIT )
+   {
+      BenchmarkCountUpload ( ( double ) length );
+   }
+
+   return __real_glMapBufferRange ( target, offset, length, access );
+}
+
+void GL_APIENTRY __wrap_glTexImage2D ( GLenum target, GLint level, GLint internalformat, GLsizei width,
+                                       GLsizei height, GLint border, GLenum format, GLenum type,
+                                       const void *pixels )
+{
+   CountTexture ( pixels, ( double ) width * height * PixelSize ( format, type ) );
+   __real_glTexImage2D ( target, level, internalformat, width, height, border, format, type, pixels );
+}
+
+void GL_APIENTRY __wrap_glTexSubImage2D ( GLenum target, GLint level, GLint xoffset, GLint yoffset,
+                                          GLsizei width, GLsizei height, GLenum format, GLenum type,
+                                          const void *pixels )
+{
+   CountTexture ( pixels, ( double ) width * height * PixelSize ( format, type ) );
+   __real_glTexSubImage2D ( target, level, xoffset, yoffset, width, height, format, type, pixels );
+}
+
+void GL_APIENTRY __wrap_glTexImage3D ( GLenum target, GLint level, GLint internalformat, GLsizei width,
+                                       GLsizei height, GLsizei depth, GLint border, GLenum format,
+                                       GLenum type, const void *pixels )
+{
+   CountTexture ( pixels, ( double ) width * height * depth * PixelSize ( format, type ) );
+   __real_glTexImage3D ( target, level, internalformat, width, height, depth, border, format, type, pixels );
+}
+
+void GL_APIENTRY __wrap_glTexSubImage3D ( GLenum target, GLint level, GLint xoffset, GLint yoffset,
+                                          GLint zoffset, GLsizei width, GLsizei height, GLsizei depth,
+                                          GLenum format, GLenum type, const void *pixels )
+{
+   CountTexture ( pixels, ( double ) width * height * depth * PixelSize ( format, type ) );
+   __real_glTexSubImage3D ( target, level, xoffset, yoffset, zoffset, width, height, depth, format, type, pixels );
+}
+
+void GL_APIENTRY __wrap_glCompressedTexImage2D ( GLenum target, GLint level, GLenum internalformat,
+                                                 GLsizei width, GLsizei height, GLint border,
+                                                 GLsizei imageSize, const void *data )
+{
+   CountTexture ( data, imageSize );
+   __real_glCompressedTexImage2D ( target, level, internalformat, width, height, border, imageSize, data );
+}
+
+void GL_APIENTRY __wrap_glCompressedTexSubImage2D ( GLenum target, GLint level, GLint xoffset, GLint yoffset,
+                                                    GLsizei width, GLsizei height, GLenum format,
+                                                    GLsizei imageSize, const void *data )
+{
+   CountTexture ( data, imageSize );
+   __real_glCompressedTexSubImage2D ( target, level, xoffset, yoffset, width, height, format, imageSize, data );
+}
+
+void GL_APIENTRY __wrap_glCompressedTexImage3D ( GLenum target, GLint level, GLenum internalformat,
+                                                 GLsizei width, GLsizei height, GLsizei depth, GLint border,
+                                                 GLsizei imageSize, const void *data )
+{
+   CountTexture ( data, imageSize );
+   __real_glCompressedTexImage3D ( target, level, internalformat, width, height, depth, border, imageSize, data );
+}
+
+void GL_APIENTRY __wrap_glCompressedTexSubImage3D ( GLenum target, GLint level, GLint xoffset, GLint yoffset,
+                                                    GLint zoffset, GLsizei width, GLsizei height, GLsizei depth,
+                                                    GLenum format, GLsizei imageSize, const void *data )
+{
+   CountTexture ( data, imageSize );
+   __real_glCompressedTexSubImage3D ( target, level, xoffset, yoffset, zoffset, width, height, depth, format,
+                                      imageSize, data );
+}
@@ -0,0 +1,283 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// TGALoad.c
+//
+//    Benchmarks loading and uploading TGA textures with the old
+//    fread-and-copy path against the memory-mapped esLoadTGAImage path.
+//    Each frame loads and uploads every file once with both paths, and the
+//    averages are printed at shutdown.  Run headless with
+//    ES_OFFSCREEN=1 ES_FRAMES=<iterations>.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esUtil.h"
+
+#define NUM_FILES    2
+#define NUM_PATHS    2
+
+typedef struct
+{
+   // Texture each file is uploaded to
+   GLuint textureId[NUM_FILES];
+
+   // Accumulated seconds per file and path
+   double loadTime[NUM_FILES][NUM_PATHS];
+   double uploadTime[NUM_FILES][NUM_PATHS];
+
+   int    iterations;
+
+   // Iterations where a path failed to load a file, left out of the averages
+   int    failures;
+} UserData;
+
+static const char *fileNames[NUM_FILES] = { "heightmap.tga", "smoke.tga" };
+static const char *pathNames[NUM_PATHS] = { "fread+copy", "mmap" };
+
+///
+// LegacyLoadTGA()
+//
+//    The original esLoadTGA: read the header, then read the pixels into
+//    a new buffer
+//
+static char *LegacyLoadTGA ( const char *fileName, int *width, int *height, int *bytesPerPixel )
+{
+   unsigned char header[18];
+   char *buffer = NULL;
+   FILE *fp = fopen ( fileName, "rb" );
+
+   if ( fp == NULL )
+   {
+      return NULL;
+   }
+
+   if ( fread ( header, sizeof ( header ), 1, fp ) == 1 )
+   {
+      int bytesToRead;
+
+      *width = header[12] | ( header[13] << 8 );
+      *height = header[14] | ( header[15] << 8 );
+      *bytesPerPixel = header[16] / 8;
+
+      bytesToRead = ( *width ) * ( *height ) * ( *bytesPerPixel );
+      buffer = ( char * ) malloc ( bytesToRead );
+
+      if ( buffer != NULL && fread ( buffer, bytesToRead, 1, fp ) != 1 )
+      {
+         free ( buffer );
+         buffer = NULL;
+      }
+   }
+
+   fclose ( fp );
+
+   return buffer;
+}
+
+///
+// Upload()
+//
+//    Upload pixels to a texture and wait for the driver to finish with them
+//
+static void Upload ( GLuint textureId, int width, int height, int bytesPerPixel, const void *pixels )
+{
+   GLenum format = bytesPerPixel == 1 ? GL_ALPHA : GL_RGB;
+
+   glBindTexture ( GL_TEXTURE_2D, textureId );
+   glTexImage2D ( GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, pixels );
+   glFinish ( );
+}
+
+///
+// Initialize the textures and check both paths load the same pixels
+//
+int Init ( ESContext *esContext )
+{
+   UserData *userData = esContext->userData;
+   int i;
+
+   memset ( userData, 0, sizeof ( UserData ) );
+
+   glGenTextures ( NUM_FILES, userData->textureId );
+   glPixelStorei ( GL_UNPACK_ALIGNMENT, 1 );
+
+   for ( i = 0; i < NUM_FILES; i++ )
+   {
+      ESImage image;
+      int width, height, bytesPerPixel;
+      char *buffer = LegacyLoadTGA ( fileNames[i], &width, &height, &bytesPerPixel );
+      int match;
+
+      if ( buffer == NULL || !esLoadTGAImage ( esContext->platformData, fileNames[i], &image ) )
+      {
+         esLogMessage ( "Error loading (%s) image.\n", fileNames[i] );
+         free ( buffer );
+         return FALSE;
+      }
+
+      match = image.width == width && image.height == height && image.bytesPerPixel == bytesPerPixel &&
+              memcmp ( image.pixels, buffer, width * height * bytesPerPixel ) == 0;
+
+      esFreeImage ( &image );
+      free ( buffer );
+
+      if ( !match )
+      {
+         esLogMessage ( "Loaders disagree on (%s).\n", fileNames[i] );
+         return FALSE;
+      }
+   }
+
+   return TRUE;
+}
+
+///
+// Load and upload every file once with each path
+//
+void Draw ( ESContext *esContext )
+{
+   UserData *userData = esContext->userData;
+   double loadTime[NUM_FILES][NUM_PATHS];
+   double uploadTime[NUM_FILES][NUM_PATHS];
+   int i, j;
+
+   for ( i = 0; i < NUM_FILES; i++ )
+   {
+      ESImage image;
+      int width, height, bytesPerPixel;
+      char *buffer;
+      double t0, t1, t2;
+
+      // Original path
+      t0 = esGetTime ( );
+      buffer = LegacyLoadTGA ( fileNames[i], &width, &height, &bytesPerPixel );
+      t1 = esGetTime ( );
+
+      if ( buffer == NULL )
+      {
+         esLogMessage ( "Error loading (%s) image with %s.\n", fileNames[i], pathNames[0] );
+         userData->failures++;
+         return;
+      }
+
+      Upload ( userData->textureId[i], width, height, bytesPerPixel, buffer );
+      free ( buffer );
+      t2 = esGetTime ( );
+
+      loadTime[i][0] = t1 - t0;
+      uploadTime[i][0] = t2 - t1;
+
+      // Memory-mapped path, the release of the mapping counts as upload
+      t0 = esGetTime ( );
+
+      if ( !esLoadTGAImage ( esContext->platformData, fileNames[i], &image ) )
+      {
+         esLogMessage ( "Error loading (%s) image with %s.\n", fileNames[i], pathNames[1] );
+         userData->failures++;
+         return;
+      }
+
+      t1 = esGetTime ( );
+      Upload ( userData->textureId[i], image.width, image.height, image.bytesPerPixel, image.pixels );
+      esFreeImage ( &image );
+      t2 = esGetTime ( );
+
+      loadTime[i][1] = t1 - t0;
+      uploadTime[i][1] = t2 - t1;
+   }
+
+   // Only iterations where every load succeeded count
+   for ( i = 0; i < NUM_FILES; i++ )
+   {
+      for ( j = 0; j < NUM_PATHS; j++ )
+      {
+         userData->loadTime[i][j] += loadTime[i][j];
+         userData->uploadTime[i][j] += uploadTime[i][j];
+      }
+   }
+
+   userData->iterations++;
+}
+
+///
+// Print the average times
+//
+void Shutdown ( ESContext *esContext )
+{
+   UserData *userData = esContext->userData;
+   int i, j;
+
+   if ( userData->failures > 0 )
+   {
+      esLogMessage ( "%d iterations failed to load a file\n", userData->failures );
+   }
+
+   if ( userData->iterations == 0 )
+   {
+      glDeleteTextures ( NUM_FILES, userData->textureId );
+      return;
+   }
+
+   esLogMessage ( "%-16s %-12s %12s %12s %12s\n", "file", "path", "load (ms)", "upload (ms)", "total (ms)" );
+
+   for ( i = 0; i < NUM_FILES; i++ )
+   {
+      for ( j = 0; j < NUM_PATHS; j++ )
+      {
+         double load = userData->loadTime[i][j] * 1000.0 / userData->iterations;
+         double upload = userData->uploadTime[i][j] * 1000.0 / userData->iterations;
+
+         esLogMessage ( "%-16s %-12s %12.4f %12.4f %12.4f\n", fileNames[i], pathNames[j], load, upload, load + upload );
+      }
+   }
+
+   esLogMessage ( "%d iterations\n", userData->iterations );
+
+   glDeleteTextures ( NUM_FILES, userData->textureId );
+}
+
+int esMain ( ESContext *esContext )
+{
+   esContext->userData = malloc ( sizeof ( UserData ) );
+
+   esCreateWindow ( esContext, "TGALoad", 320, 240, ES_WINDOW_RGB | ES_WINDOW_OFFSCREEN );
+
+   if ( !Init ( esContext ) )
+   {
+      return GL_FALSE;
+   }
+
+   esRegisterShutdownFunc ( esContext, Shutdown );
+   esRegisterDrawFunc ( esContext, Draw );
+
+   return GL_TRUE;
+}
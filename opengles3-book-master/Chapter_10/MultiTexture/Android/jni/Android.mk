@@ -14,6 +14,26 @@ LOCAL_SRC_FILES := $(COMMON_SRC_PATH)/esShader.c \
 				   $(COMMON_SRC_PATH)/esShapes.c \
 				   $(COMMON_SRC_PATH)/esTransform.c \
 				   $(COMMON_SRC_PATH)/esUtil.c \
+				   $(COMMON_SRC_PATH)/esThread.c \
+				   $(COMMON_SRC_PATH)/esBufferRing.c \
+				   $(COMMON_SRC_PATH)/esInstance.c \
+				   $(COMMON_SRC_PATH)/esImage.c \
+				   $(COMMON_SRC_PATH)/esTexture.c \
+				   $(COMMON_SRC_PATH)/esModel.c \
+				   $(COMMON_SRC_PATH)/esFrameStats.c \
+				   $(COMMON_SRC_PATH)/esProfiler.c \
+				   $(COMMON_SRC_PATH)/esBenchmark.c \
+				   $(COMMON_SRC_PATH)/esPipeline.c \
+				   $(COMMON_SRC_PATH)/esLoader.c \
+				   $(COMMON_SRC_PATH)/esLog.c \
+				   $(COMMON_SRC_PATH)/esNoise.c \
+				   $(COMMON_SRC_PATH)/esCache.c \
+				   $(COMMON_SRC_PATH)/esMipMap.c \
+				   $(COMMON_SRC_PATH)/esParticles.c \
+				   $(COMMON_SRC_PATH)/esParticleFeedback.c \
+				   $(COMMON_SRC_PATH)/esState.c \
+				   $(COMMON_SRC_PATH)/esProgramInfo.c \
+				   $(COMMON_SRC_PATH)/esUniformRing.c \
 				   $(COMMON_SRC_PATH)/Android/esUtil_Android.c \
 				   $(SRC_PATH)/MultiTexture.c
 				   
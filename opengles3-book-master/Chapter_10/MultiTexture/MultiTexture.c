@@ -37,6 +37,9 @@
 #include <stdlib.h>
 #include "esUtil.h"
 
+// Most texture bytes uploaded per frame
+#define TEXTURE_UPLOAD_BUDGET   ( 256 * 1024 )
+
 typedef struct
 {
    // Handle to a program object
@@ -50,36 +53,30 @@ typedef struct
    GLuint baseMapTexId;
    GLuint lightMapTexId;
 
+   // Decodes and uploads textures in the background
+   ESTextureStream *textureStream;
 } UserData;
 
 ///
-// Load texture from disk
+// Queue a texture to be loaded in the background
 //
-GLuint LoadTexture ( void *ioContext, char *fileName )
+GLuint LoadTexture ( ESTextureStream *textureStream, char *fileName )
 {
-   int width,
-       height;
-
-   char *buffer = esLoadTGA ( ioContext, fileName, &width, &height );
-   GLuint texId;
+   GLuint texId = esTextureStreamLoad ( textureStream, fileName, GL_RGB );
 
-   if ( buffer == NULL )
+   if ( texId == 0 )
    {
       esLogMessage ( "Error loading (%s) image.\n", fileName );
       return 0;
    }
 
-   glGenTextures ( 1, &texId );
+   // The texture samples as black until esTextureStreamUpdate has uploaded it
    glBindTexture ( GL_TEXTURE_2D, texId );
-
-   glTexImage2D ( GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, buffer );
    glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
    glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
    glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
    glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
 
-   free ( buffer );
-
    return texId;
 }
 
@@ -127,8 +124,15 @@ int Init ( ESContext *esContext )
    userData->lightMapLoc = glGetUniformLocation ( userData->programObject, "s_lightMap" );
 
    // Load the textures
-   userData->baseMapTexId = LoadTexture ( esContext->platformData, "basemap.tga" );
-   userData->lightMapTexId = LoadTexture ( esContext->platformData, "lightmap.tga" );
+   userData->textureStream = esTextureStreamCreate ( esContext->platformData, TEXTURE_UPLOAD_BUDGET, 0 );
+
+   if ( userData->textureStream == NULL )
+   {
+      return FALSE;
+   }
+
+   userData->baseMapTexId = LoadTexture ( userData->textureStream, "basemap.tga" );
+   userData->lightMapTexId = LoadTexture ( userData->textureStream, "lightmap.tga" );
 
    if ( userData->baseMapTexId == 0 || userData->lightMapTexId == 0 )
    {
@@ -156,6 +160,9 @@ void Draw ( ESContext *esContext )
                          };
    GLushort indices[] = { 0, 1, 2, 0, 2, 3 };
 
+   // Upload any texture rows decoded since the last frame
+   esTextureStreamUpdate ( userData->textureStream );
+
    // Set the viewport
    glViewport ( 0, 0, esContext->width, esContext->height );
 
@@ -199,6 +206,8 @@ void ShutDown ( ESContext *esContext )
 {
    UserData *userData = esContext->userData;
 
+   esTextureStreamDestroy ( userData->textureStream );
+
    // Delete texture object
    glDeleteTextures ( 1, &userData->baseMapTexId );
    glDeleteTextures ( 1, &userData->lightMapTexId );
@@ -0,0 +1,323 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// PODScene.c
+//
+//    This example loads a POD scene with esLoadPOD and draws the meshes
+//    of its nodes with per-fragment diffuse lighting.  The camera is
+//    placed from the bounds of the scene, read back from the vertex
+//    buffers, and orbits around it.
+//
+#include <stdlib.h>
+#include <math.h>
+#include "esUtil.h"
+
+typedef struct
+{
+   // Handle to a program object
+   GLuint programObject;
+
+   // Uniform locations
+   GLint  mvpLoc;
+   GLint  modelLoc;
+   GLint  colorLoc;
+   GLint  lightDirLoc;
+
+   // Scene and the sphere around it
+   ESPODScene scene;
+   GLfloat    center[3];
+   GLfloat    radius;
+
+   // Camera angle around the scene
+   GLfloat    angle;
+
+   // View projection matrix
+   ESMatrix   viewProjMatrix;
+} UserData;
+
+///
+// Grow the bounding box with the vertex positions of a mesh placed by model
+//
+static void GrowBounds ( const ESPODMesh *mesh, const ESMatrix *model, GLfloat boundsMin[3], GLfloat boundsMax[3] )
+{
+   const ESPODAttrib *position = &mesh->attribs[ES_POD_ATTRIB_POSITION];
+   const GLubyte *vertices;
+   int v, i;
+
+   if ( position->size < 3 || position->type != GL_FLOAT )
+   {
+      return;
+   }
+
+   glBindBuffer ( GL_ARRAY_BUFFER, mesh->vertexBuffer );
+   vertices = glMapBufferRange ( GL_ARRAY_BUFFER, 0, ( GLsizeiptr ) mesh->numVertices * mesh->stride, GL_MAP_READ_BIT );
+
+   if ( vertices == NULL )
+   {
+      glBindBuffer ( GL_ARRAY_BUFFER, 0 );
+      return;
+   }
+
+   for ( v = 0; v < mesh->numVertices; v++ )
+   {
+      const GLfloat *p = ( const GLfloat * ) ( vertices + v * mesh->stride + position->offset );
+
+      for ( i = 0; i < 3; i++ )
+      {
+         GLfloat world = p[0] * model->m[0][i] + p[1] * model->m[1][i] + p[2] * model->m[2][i] + model->m[3][i];
+
+         boundsMin[i] = world < boundsMin[i] ? world : boundsMin[i];
+         boundsMax[i] = world > boundsMax[i] ? world : boundsMax[i];
+      }
+   }
+
+   glUnmapBuffer ( GL_ARRAY_BUFFER );
+   glBindBuffer ( GL_ARRAY_BUFFER, 0 );
+}
+
+///
+// Initialize the shader and program object, and load the scene
+//
+int Init ( ESContext *esContext )
+{
+   UserData *userData = esContext->userData;
+   const char vShaderStr[] =
+      "#version 300 es                                          \n"
+      "uniform mat4 u_mvpMatrix;                                \n"
+      "uniform mat4 u_modelMatrix;                              \n"
+      "layout(location = 0) in vec4 a_position;                 \n"
+      "layout(location = 1) in vec3 a_normal;                   \n"
+      "out vec3 v_normal;                                       \n"
+      "void main()                                              \n"
+      "{                                                        \n"
+      "   v_normal = mat3(u_modelMatrix) * a_normal;            \n"
+      "   gl_Position = u_mvpMatrix * a_position;               \n"
+      "}                                                        \n";
+
+   const char fShaderStr[] =
+      "#version 300 es                                          \n"
+      "precision mediump float;                                 \n"
+      "uniform vec3 u_color;                                    \n"
+      "uniform vec3 u_lightDir;                                 \n"
+      "in vec3 v_normal;                                        \n"
+      "layout(location = 0) out vec4 outColor;                  \n"
+      "void main()                                              \n"
+      "{                                                        \n"
+      "   vec3 n = normalize(v_normal);                         \n"
+      "   float diffuse = max(dot(n, u_lightDir), 0.0);         \n"
+      "   outColor = vec4(u_color * (0.2 + 0.8 * diffuse), 1.0);\n"
+      "}                                                        \n";
+   GLfloat boundsMin[3] = { 1e30f, 1e30f, 1e30f };
+   GLfloat boundsMax[3] = { -1e30f, -1e30f, -1e30f };
+   double  start = esGetTime ( );
+   int     i;
+
+   // Load the scene, every mesh is uploaded once here
+   if ( !esLoadPOD ( esContext->platformData, "PerFragmentLighting.pod", &userData->scene ) )
+   {
+      esLogMessage ( "Error loading (%s) scene.\n", "PerFragmentLighting.pod" );
+      return FALSE;
+   }
+
+   esLogMessage ( "Loaded %d meshes and %d nodes in %.2f ms\n", userData->scene.numMeshes,
+                  userData->scene.numNodes, ( esGetTime ( ) - start ) * 1000.0 );
+
+   // Load the shaders and get a linked program object
+   userData->programObject = esLoadProgram ( vShaderStr, fShaderStr );
+
+   if ( userData->programObject == 0 )
+   {
+      esFreePOD ( &userData->scene );
+      return FALSE;
+   }
+
+   // Get the uniform locations
+   userData->mvpLoc = glGetUniformLocation ( userData->programObject, "u_mvpMatrix" );
+   userData->modelLoc = glGetUniformLocation ( userData->programObject, "u_modelMatrix" );
+   userData->colorLoc = glGetUniformLocation ( userData->programObject, "u_color" );
+   userData->lightDirLoc = glGetUniformLocation ( userData->programObject, "u_lightDir" );
+
+   // Bound the mesh nodes at the first frame
+   for ( i = 0; i < userData->scene.numMeshNodes; i++ )
+   {
+      const ESPODNode *node = &userData->scene.nodes[i];
+      ESMatrix model;
+
+      if ( node->object < 0 || node->object >= userData->scene.numMeshes )
+      {
+         continue;
+      }
+
+      esPODNodeMatrix ( &userData->scene, i, 0.0f, &model );
+      GrowBounds ( &userData->scene.meshes[node->object], &model, boundsMin, boundsMax );
+   }
+
+   userData->radius = 1.0f;
+
+   if ( boundsMin[0] <= boundsMax[0] )
+   {
+      GLfloat size[3];
+
+      for ( i = 0; i < 3; i++ )
+      {
+         userData->center[i] = ( boundsMin[i] + boundsMax[i] ) * 0.5f;
+         size[i] = boundsMax[i] - boundsMin[i];
+      }
+
+      userData->radius = 0.5f * sqrtf ( size[0] * size[0] + size[1] * size[1] + size[2] * size[2] );
+   }
+
+   userData->angle = 0.0f;
+
+   glClearColor ( userData->scene.backgroundColor[0], userData->scene.backgroundColor[1],
+                  userData->scene.backgroundColor[2], 1.0f );
+   glEnable ( GL_DEPTH_TEST );
+   glEnable ( GL_CULL_FACE );
+   return TRUE;
+}
+
+///
+// Orbit the camera around the scene
+//
+void Update ( ESContext *esContext, float deltaTime )
+{
+   UserData *userData = esContext->userData;
+   ESMatrix perspective;
+   ESMatrix view;
+   float    aspect;
+   float    distance = userData->radius * 2.5f;
+
+   userData->angle += deltaTime * 30.0f;
+
+   if ( userData->angle >= 360.0f )
+   {
+      userData->angle -= 360.0f;
+   }
+
+   aspect = ( GLfloat ) esContext->width / ( GLfloat ) esContext->height;
+
+   esMatrixLoadIdentity ( &perspective );
+   esPerspective ( &perspective, 60.0f, aspect, distance * 0.1f, distance * 4.0f );
+
+   // Look at the center of the scene from a little above it
+   esMatrixLoadIdentity ( &view );
+   esTranslate ( &view, 0.0f, 0.0f, -distance );
+   esRotate ( &view, 20.0f, 1.0f, 0.0f, 0.0f );
+   esRotate ( &view, userData->angle, 0.0f, 1.0f, 0.0f );
+   esTranslate ( &view, -userData->center[0], -userData->center[1], -userData->center[2] );
+
+   esMatrixMultiply ( &userData->viewProjMatrix, &view, &perspective );
+}
+
+///
+// Draw the mesh of every mesh node
+//
+void Draw ( ESContext *esContext )
+{
+   UserData *userData = esContext->userData;
+   const ESPODScene *scene = &userData->scene;
+   float frame = scene->numFrames > 1 ? ( float ) fmod ( esGetTime ( ) * scene->fps, scene->numFrames - 1 ) : 0.0f;
+   int i;
+
+   glViewport ( 0, 0, esContext->width, esContext->height );
+   glClear ( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+
+   glUseProgram ( userData->programObject );
+   glUniform3f ( userData->lightDirLoc, 0.0f, 0.6f, 0.8f );
+
+   for ( i = 0; i < scene->numMeshNodes; i++ )
+   {
+      const ESPODNode *node = &scene->nodes[i];
+      const ESPODMesh *mesh;
+      ESMatrix model;
+      ESMatrix mvp;
+
+      if ( node->object < 0 || node->object >= scene->numMeshes )
+      {
+         continue;
+      }
+
+      mesh = &scene->meshes[node->object];
+
+      esPODNodeMatrix ( scene, i, frame, &model );
+      esMatrixMultiply ( &mvp, &model, &userData->viewProjMatrix );
+
+      glUniformMatrix4fv ( userData->mvpLoc, 1, GL_FALSE, ( GLfloat * ) &mvp.m[0][0] );
+      glUniformMatrix4fv ( userData->modelLoc, 1, GL_FALSE, ( GLfloat * ) &model.m[0][0] );
+
+      if ( node->material >= 0 && node->material < scene->numMaterials )
+      {
+         glUniform3fv ( userData->colorLoc, 1, scene->materials[node->material].diffuse );
+      }
+      else
+      {
+         glUniform3f ( userData->colorLoc, 0.8f, 0.8f, 0.8f );
+      }
+
+      // The vertex array holds the whole attribute layout of the mesh
+      glBindVertexArray ( mesh->vertexArray );
+      glDrawElements ( GL_TRIANGLES, mesh->numIndices, GL_UNSIGNED_SHORT, ( const void * ) 0 );
+   }
+
+   glBindVertexArray ( 0 );
+}
+
+///
+// Cleanup
+//
+void Shutdown ( ESContext *esContext )
+{
+   UserData *userData = esContext->userData;
+
+   esFreePOD ( &userData->scene );
+
+   // Delete program object
+   glDeleteProgram ( userData->programObject );
+}
+
+
+int esMain ( ESContext *esContext )
+{
+   esContext->userData = malloc ( sizeof ( UserData ) );
+
+   esCreateWindow ( esContext, "PODScene", 320, 240, ES_WINDOW_RGB | ES_WINDOW_DEPTH );
+
+   if ( !Init ( esContext ) )
+   {
+      return GL_FALSE;
+   }
+
+   esRegisterShutdownFunc ( esContext, Shutdown );
+   esRegisterUpdateFunc ( esContext, Update );
+   esRegisterDrawFunc ( esContext, Draw );
+
+   return GL_TRUE;
+}
@@ -32,18 +32,26 @@
 // ParticleSystem.c
 //
 //    This is an example that demonstrates rendering a particle system
-//    using a vertex shader and point sprites.
+//    using point sprites.  The particles are simulated on the CPU by an
+//    ESParticleSystem, and the live ones are streamed into a vertex buffer
+//    ring every frame.  The number of particles per burst can be given on
+//    the command line, e.g. "ParticleSystem 1000000".
 //
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include "esUtil.h"
 
+// Most texture bytes uploaded per frame
+#define TEXTURE_UPLOAD_BUDGET   ( 256 * 1024 )
+
 #define NUM_PARTICLES   1000
-#define PARTICLE_SIZE   7
 
-#define ATTRIBUTE_LIFETIME_LOCATION       0
-#define ATTRIBUTE_STARTPOSITION_LOCATION  1
-#define ATTRIBUTE_ENDPOSITION_LOCATION    2
+// Simulation time step in seconds
+#define TIME_STEP       ( 1.0f / 60.0f )
+
+#define ATTRIBUTE_POSITION_LOCATION       0
+#define ATTRIBUTE_LIFETIME_LOCATION       1
 
 typedef struct
 {
@@ -51,49 +59,49 @@ typedef struct
    GLuint programObject;
 
    // Uniform location
-   GLint timeLoc;
    GLint colorLoc;
-   GLint centerPositionLoc;
    GLint samplerLoc;
 
    // Texture handle
    GLuint textureId;
 
-   // Particle vertex data
-   float particleData[ NUM_PARTICLES * PARTICLE_SIZE ];
+   // Particles spawned by each burst
+   int numParticles;
+
+   // Particle simulation
+   ESParticleSystem *particles;
 
-   // Current time
+   // Triple-buffered vertices of the live particles
+   ESBufferRing particleRing;
+   GLintptr particleOffset;
+
+   // Time since the last burst
    float time;
 
+   // Decodes and uploads textures in the background
+   ESTextureStream *textureStream;
 } UserData;
 
 ///
-// Load texture from disk
+// Queue a texture to be loaded in the background
 //
-GLuint LoadTexture ( void *ioContext, char *fileName )
+GLuint LoadTexture ( ESTextureStream *textureStream, char *fileName )
 {
-   int width,
-       height;
-   char *buffer = esLoadTGA ( ioContext, fileName, &width, &height );
-   GLuint texId;
+   GLuint texId = esTextureStreamLoad ( textureStream, fileName, GL_RGB );
 
-   if ( buffer == NULL )
+   if ( texId == 0 )
    {
       esLogMessage ( "Error loading (%s) image.\n", fileName );
       return 0;
    }
 
-   glGenTextures ( 1, &texId );
+   // The texture samples as black until esTextureStreamUpdate has uploaded it
    glBindTexture ( GL_TEXTURE_2D, texId );
-
-   glTexImage2D ( GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, buffer );
    glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
    glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
    glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
    glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
 
-   free ( buffer );
-
    return texId;
 }
 
@@ -104,31 +112,16 @@ GLuint LoadTexture ( void *ioContext, char *fileName )
 int Init ( ESContext *esContext )
 {
    UserData *userData = esContext->userData;
-   int i;
 
    char vShaderStr[] =
       "#version 300 es                                      \n"
-      "uniform float u_time;                                \n"
-      "uniform vec3 u_centerPosition;                       \n"
-      "layout(location = 0) in float a_lifetime;            \n"
-      "layout(location = 1) in vec3 a_startPosition;        \n"
-      "layout(location = 2) in vec3 a_endPosition;          \n"
+      "layout(location = 0) in vec3 a_position;             \n"
+      "layout(location = 1) in float a_lifetime;            \n"
       "out float v_lifetime;                                \n"
       "void main()                                          \n"
       "{                                                    \n"
-      "  if ( u_time <= a_lifetime )                        \n"
-      "  {                                                  \n"
-      "    gl_Position.xyz = a_startPosition +              \n"
-      "                      (u_time * a_endPosition);      \n"
-      "    gl_Position.xyz += u_centerPosition;             \n"
-      "    gl_Position.w = 1.0;                             \n"
-      "  }                                                  \n"
-      "  else                                               \n"
-      "  {                                                  \n"
-      "     gl_Position = vec4( -1000, -1000, 0, 0 );       \n"
-      "  }                                                  \n"
-      "  v_lifetime = 1.0 - ( u_time / a_lifetime );        \n"
-      "  v_lifetime = clamp ( v_lifetime, 0.0, 1.0 );       \n"
+      "  gl_Position = vec4 ( a_position, 1.0 );            \n"
+      "  v_lifetime = a_lifetime;                           \n"
       "  gl_PointSize = ( v_lifetime * v_lifetime ) * 40.0; \n"
       "}";
 
@@ -151,39 +144,38 @@ int Init ( ESContext *esContext )
    userData->programObject = esLoadProgram ( vShaderStr, fShaderStr );
 
    // Get the uniform locations
-   userData->timeLoc = glGetUniformLocation ( userData->programObject, "u_time" );
-   userData->centerPositionLoc = glGetUniformLocation ( userData->programObject, "u_centerPosition" );
    userData->colorLoc = glGetUniformLocation ( userData->programObject, "u_color" );
    userData->samplerLoc = glGetUniformLocation ( userData->programObject, "s_texture" );
 
    glClearColor ( 0.0f, 0.0f, 0.0f, 0.0f );
 
-   // Fill in particle data array
-   srand ( 0 );
+   // Room for one burst, each particle dies before the next one
+   userData->particles = esParticleSystemCreate ( userData->numParticles );
 
-   for ( i = 0; i < NUM_PARTICLES; i++ )
+   if ( userData->particles == NULL )
    {
-      float *particleData = &userData->particleData[i * PARTICLE_SIZE];
-
-      // Lifetime of particle
-      ( *particleData++ ) = ( ( float ) ( rand() % 10000 ) / 10000.0f );
-
-      // End position of particle
-      ( *particleData++ ) = ( ( float ) ( rand() % 10000 ) / 5000.0f ) - 1.0f;
-      ( *particleData++ ) = ( ( float ) ( rand() % 10000 ) / 5000.0f ) - 1.0f;
-      ( *particleData++ ) = ( ( float ) ( rand() % 10000 ) / 5000.0f ) - 1.0f;
-
-      // Start position of particle
-      ( *particleData++ ) = ( ( float ) ( rand() % 10000 ) / 40000.0f ) - 0.125f;
-      ( *particleData++ ) = ( ( float ) ( rand() % 10000 ) / 40000.0f ) - 0.125f;
-      ( *particleData++ ) = ( ( float ) ( rand() % 10000 ) / 40000.0f ) - 0.125f;
+      return FALSE;
+   }
 
+   if ( !esBufferRingInit ( &userData->particleRing, GL_ARRAY_BUFFER,
+                            userData->numParticles * 4 * sizeof ( GLfloat ), GL_STREAM_DRAW ) )
+   {
+      return FALSE;
    }
 
+   glBindBuffer ( GL_ARRAY_BUFFER, 0 );
+
    // Initialize time to cause reset on first update
    userData->time = 1.0f;
 
-   userData->textureId = LoadTexture ( esContext->platformData, "smoke.tga" );
+   userData->textureStream = esTextureStreamCreate ( esContext->platformData, TEXTURE_UPLOAD_BUDGET, 0 );
+
+   if ( userData->textureStream == NULL )
+   {
+      return FALSE;
+   }
+
+   userData->textureId = LoadTexture ( userData->textureStream, "smoke.tga" );
 
    if ( userData->textureId <= 0 )
    {
@@ -202,21 +194,30 @@ void Update ( ESContext *esContext, float deltaTime )
 
    userData->time += deltaTime;
 
-   glUseProgram ( userData->programObject );
+   // Move the particles and drop the ones past their lifetime
+   esParticleSystemUpdate ( userData->particles, deltaTime, NULL );
+
+   esStateUseProgram ( userData->programObject );
 
    if ( userData->time >= 1.0f )
    {
-      float centerPos[3];
+      ESParticleEmitter emitter;
       float color[4];
 
       userData->time = 0.0f;
 
       // Pick a new start location and color
-      centerPos[0] = ( ( float ) ( rand() % 10000 ) / 10000.0f ) - 0.5f;
-      centerPos[1] = ( ( float ) ( rand() % 10000 ) / 10000.0f ) - 0.5f;
-      centerPos[2] = ( ( float ) ( rand() % 10000 ) / 10000.0f ) - 0.5f;
+      emitter.position[0] = ( ( float ) ( rand() % 10000 ) / 10000.0f ) - 0.5f;
+      emitter.position[1] = ( ( float ) ( rand() % 10000 ) / 10000.0f ) - 0.5f;
+      emitter.position[2] = ( ( float ) ( rand() % 10000 ) / 10000.0f ) - 0.5f;
 
-      glUniform3fv ( userData->centerPositionLoc, 1, &centerPos[0] );
+      // Particles start within 0.125 of it, fly out at up to 1 unit per
+      // second along each axis and live up to a second
+      emitter.spread = 0.125f;
+      emitter.speed = 1.0f;
+      emitter.maxLifetime = 1.0f;
+
+      esParticleSystemEmit ( userData->particles, &emitter, userData->numParticles );
 
       // Random color
       color[0] = ( ( float ) ( rand() % 10000 ) / 20000.0f ) + 0.5f;
@@ -226,9 +227,6 @@ void Update ( ESContext *esContext, float deltaTime )
 
       glUniform4fv ( userData->colorLoc, 1, &color[0] );
    }
-
-   // Load uniform time variable
-   glUniform1f ( userData->timeLoc, userData->time );
 }
 
 ///
@@ -237,46 +235,62 @@ void Update ( ESContext *esContext, float deltaTime )
 void Draw ( ESContext *esContext )
 {
    UserData *userData = esContext->userData;
+   GLfloat *vertices;
+   int count;
+
+   // Upload any texture rows decoded since the last frame
+   esTextureStreamUpdate ( userData->textureStream );
+
+   // Map the next vertex buffer in the ring without waiting for the GPU, and
+   // write the live particles, moved on to between the last update and the next
+   vertices = ( GLfloat * ) esBufferRingMap ( &userData->particleRing, &userData->particleOffset );
+
+   if ( vertices == NULL )
+   {
+      return;
+   }
+
+   count = esParticleSystemWrite ( userData->particles, vertices, esContext->interpolation * TIME_STEP );
+   esBufferRingUnmap ( &userData->particleRing );
 
    // Set the viewport
-   glViewport ( 0, 0, esContext->width, esContext->height );
+   esStateViewport ( 0, 0, esContext->width, esContext->height );
 
    // Clear the color buffer
    glClear ( GL_COLOR_BUFFER_BIT );
 
-   // Use the program object
-   glUseProgram ( userData->programObject );
-
-   // Load the vertex attributes
-   glVertexAttribPointer ( ATTRIBUTE_LIFETIME_LOCATION, 1, GL_FLOAT,
-                           GL_FALSE, PARTICLE_SIZE * sizeof ( GLfloat ),
-                           userData->particleData );
+   // Use the program object, current already when an update ran this frame
+   esStateUseProgram ( userData->programObject );
 
-   glVertexAttribPointer ( ATTRIBUTE_ENDPOSITION_LOCATION, 3, GL_FLOAT,
-                           GL_FALSE, PARTICLE_SIZE * sizeof ( GLfloat ),
-                           &userData->particleData[1] );
+   // Load the vertex attributes from the region of the ring written this frame
+   esStateBindBuffer ( GL_ARRAY_BUFFER, userData->particleRing.buffer );
 
-   glVertexAttribPointer ( ATTRIBUTE_STARTPOSITION_LOCATION, 3, GL_FLOAT,
-                           GL_FALSE, PARTICLE_SIZE * sizeof ( GLfloat ),
-                           &userData->particleData[4] );
+   glVertexAttribPointer ( ATTRIBUTE_POSITION_LOCATION, 3, GL_FLOAT,
+                           GL_FALSE, 4 * sizeof ( GLfloat ),
+                           ( const void * ) ( userData->particleOffset ) );
 
+   glVertexAttribPointer ( ATTRIBUTE_LIFETIME_LOCATION, 1, GL_FLOAT,
+                           GL_FALSE, 4 * sizeof ( GLfloat ),
+                           ( const void * ) ( userData->particleOffset + 3 * sizeof ( GLfloat ) ) );
 
-   glEnableVertexAttribArray ( ATTRIBUTE_LIFETIME_LOCATION );
-   glEnableVertexAttribArray ( ATTRIBUTE_ENDPOSITION_LOCATION );
-   glEnableVertexAttribArray ( ATTRIBUTE_STARTPOSITION_LOCATION );
+   esStateEnableVertexAttribArray ( ATTRIBUTE_POSITION_LOCATION );
+   esStateEnableVertexAttribArray ( ATTRIBUTE_LIFETIME_LOCATION );
 
    // Blend particles
-   glEnable ( GL_BLEND );
-   glBlendFunc ( GL_SRC_ALPHA, GL_ONE );
+   esStateEnable ( GL_BLEND );
+   esStateBlendFunc ( GL_SRC_ALPHA, GL_ONE );
 
    // Bind the texture
-   glActiveTexture ( GL_TEXTURE0 );
-   glBindTexture ( GL_TEXTURE_2D, userData->textureId );
+   esStateActiveTexture ( GL_TEXTURE0 );
+   esStateBindTexture ( GL_TEXTURE_2D, userData->textureId );
 
    // Set the sampler texture unit to 0
    glUniform1i ( userData->samplerLoc, 0 );
 
-   glDrawArrays ( GL_POINTS, 0, NUM_PARTICLES );
+   glDrawArrays ( GL_POINTS, 0, count );
+
+   // The GPU reads this frame's vertices until here
+   esBufferRingFence ( &userData->particleRing );
 }
 
 ///
@@ -286,6 +300,11 @@ void ShutDown ( ESContext *esContext )
 {
    UserData *userData = esContext->userData;
 
+   esTextureStreamDestroy ( userData->textureStream );
+
+   esBufferRingDestroy ( &userData->particleRing );
+   esParticleSystemDestroy ( userData->particles );
+
    // Delete texture object
    glDeleteTextures ( 1, &userData->textureId );
 
@@ -296,7 +315,19 @@ void ShutDown ( ESContext *esContext )
 
 int esMain ( ESContext *esContext )
 {
+   UserData *userData;
+
    esContext->userData = malloc ( sizeof ( UserData ) );
+   userData = esContext->userData;
+   memset ( userData, 0, sizeof ( UserData ) );
+
+   // Optional particle count on the command line, e.g. "ParticleSystem 1000000"
+   userData->numParticles = NUM_PARTICLES;
+
+   if ( esContext->argc > 1 && atoi ( esContext->argv[1] ) > 0 )
+   {
+      userData->numParticles = atoi ( esContext->argv[1] );
+   }
 
    esCreateWindow ( esContext, "ParticleSystem", 640, 480, ES_WINDOW_RGB );
 
@@ -307,6 +338,7 @@ int esMain ( ESContext *esContext )
 
    esRegisterDrawFunc ( esContext, Draw );
    esRegisterUpdateFunc ( esContext, Update );
+   esSetFixedTimestep ( esContext, TIME_STEP, 0 );
    esRegisterShutdownFunc ( esContext, ShutDown );
 
    return GL_TRUE;
@@ -32,18 +32,27 @@
 // ParticleSystemTransformFeedback.c
 //
 //    This is an example that demonstrates a particle system
-//    using transform feedback.
+//    using transform feedback.  The particles live in the buffers of an
+//    ESParticleFeedback, and only the ones that may still be alive are
+//    updated and drawn.  The number of particles can be given on the
+//    command line, e.g. "ParticleSystemTransformFeedback 100000".
 //
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <stddef.h>
 #include "esUtil.h"
-#include "Noise3D.h"
+
+// Most texture bytes uploaded per frame
+#define TEXTURE_UPLOAD_BUDGET   ( 256 * 1024 )
 
 #define NUM_PARTICLES   200
-#define EMISSION_RATE   0.3f
+#define LIFETIME        2.0f
 #define ACCELERATION   -1.0f
 
+// Simulation time step in seconds
+#define TIME_STEP       ( 1.0f / 60.0f )
+
 #define ATTRIBUTE_POSITION      0
 #define ATTRIBUTE_VELOCITY      1
 #define ATTRIBUTE_SIZE          2
@@ -67,7 +76,8 @@ typedef struct
 
    // Emit shader uniform locations
    GLint emitTimeLoc;
-   GLint emitEmissionRateLoc;
+   GLint emitEmitLoc;
+   GLint emitCountLoc;
    GLint emitNoiseSamplerLoc;
 
    // Draw shader uniform location
@@ -80,68 +90,57 @@ typedef struct
    GLuint textureId;
    GLuint noiseTextureId;
 
-   // Particle vertex data
-   Particle particleData[ NUM_PARTICLES ];
+   // Most particles alive at once
+   int numParticles;
 
-   // Particle VBOs
-   GLuint particleVBOs[2];
+   // Particle VBOs, updated with transform feedback
+   ESParticleFeedback *particles;
 
-   // Index into particleVBOs (0 or 1) as to which is the source.
-   // Ping-pong between the two VBOs
-   GLuint curSrcIndex;
+   // Particles due to be emitted, the fraction left over from the last update
+   float emitAccumulator;
 
    // Current time
    float time;
 
-   // synch object to synchronize the transform feedback results and the draw
-   GLsync emitSync;
-
+   // Decodes and uploads textures in the background
+   ESTextureStream *textureStream;
 } UserData;
 
 ///
-// Load texture from disk
+// Queue a texture to be loaded in the background
 //
-GLuint LoadTexture ( void *ioContext, char *fileName )
+GLuint LoadTexture ( ESTextureStream *textureStream, char *fileName )
 {
-   int width,
-       height;
-   char *buffer = esLoadTGA ( ioContext, fileName, &width, &height );
-   GLuint texId;
+   GLuint texId = esTextureStreamLoad ( textureStream, fileName, GL_RGB );
 
-   if ( buffer == NULL )
+   if ( texId == 0 )
    {
       esLogMessage ( "Error loading (%s) image.\n", fileName );
       return 0;
    }
 
-   glGenTextures ( 1, &texId );
+   // The texture samples as black until esTextureStreamUpdate has uploaded it
    glBindTexture ( GL_TEXTURE_2D, texId );
-
-   glTexImage2D ( GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, buffer );
    glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
    glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
    glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
    glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
 
-   free ( buffer );
-
    return texId;
 }
 
-void InitEmitParticles ( ESContext *esContext )
+ESAsyncProgram *InitEmitParticles ( void )
 {
-   UserData *userData = esContext->userData;
-
    char vShaderStr[] =
       "#version 300 es                                                     \n"
-      "#define NUM_PARTICLES           200                                 \n"
       "#define ATTRIBUTE_POSITION      0                                   \n"
       "#define ATTRIBUTE_VELOCITY      1                                   \n"
       "#define ATTRIBUTE_SIZE          2                                   \n"
       "#define ATTRIBUTE_CURTIME       3                                   \n"
       "#define ATTRIBUTE_LIFETIME      4                                   \n"
       "uniform float u_time;                                               \n"
-      "uniform float u_emissionRate;                                       \n"
+      "uniform int u_emit;                                                 \n"
+      "uniform float u_emitCount;                                          \n"
       "uniform mediump sampler3D s_noiseTex;                               \n"
       "                                                                    \n"
       "layout(location = ATTRIBUTE_POSITION) in vec2 a_position;           \n"
@@ -158,7 +157,7 @@ void InitEmitParticles ( ESContext *esContext )
       "                                                                    \n"
       "float randomValue( inout float seed )                               \n"
       "{                                                                   \n"
-      "   float vertexId = float( gl_VertexID ) / float( NUM_PARTICLES );  \n"
+      "   float vertexId = float( gl_VertexID ) / u_emitCount;             \n"
       "   vec3 texCoord = vec3( u_time, vertexId, seed );                  \n"
       "   seed += 0.1;                                                     \n"
       "   return texture( s_noiseTex, texCoord ).r;                        \n"
@@ -166,8 +165,7 @@ void InitEmitParticles ( ESContext *esContext )
       "void main()                                                         \n"
       "{                                                                   \n"
       "  float seed = u_time;                                              \n"
-      "  float lifetime = a_curtime - u_time;                              \n"
-      "  if( lifetime <= 0.0 && randomValue(seed) < u_emissionRate )       \n"
+      "  if( u_emit == 1 )                                                 \n"
       "  {                                                                 \n"
       "     v_position = vec2( 0.0, -1.0 );                                \n"
       "     v_velocity = vec2( randomValue(seed) * 2.0 - 1.00,             \n"
@@ -196,30 +194,19 @@ void InitEmitParticles ( ESContext *esContext )
       "  fragColor = vec4(1.0);                             \n"
       "}                                                    \n";
 
-   userData->emitProgramObject = esLoadProgram ( vShaderStr, fShaderStr );
-
+   const char *feedbackVaryings[5] =
    {
-      const char *feedbackVaryings[5] =
-      {
-         "v_position",
-         "v_velocity",
-         "v_size",
-         "v_curtime",
-         "v_lifetime"
-      };
-
-      // Set the vertex shader outputs as transform feedback varyings
-      glTransformFeedbackVaryings ( userData->emitProgramObject, 5, feedbackVaryings, GL_INTERLEAVED_ATTRIBS );
-
-      // Link program must occur after calling glTransformFeedbackVaryings
-      glLinkProgram ( userData->emitProgramObject );
-
-      // Get the uniform locations - this also needs to happen after glLinkProgram is called again so
-      // that the uniforms that output to varyings are active
-      userData->emitTimeLoc = glGetUniformLocation ( userData->emitProgramObject, "u_time" );
-      userData->emitEmissionRateLoc = glGetUniformLocation ( userData->emitProgramObject, "u_emissionRate" );
-      userData->emitNoiseSamplerLoc = glGetUniformLocation ( userData->emitProgramObject, "s_noiseTex" );
-   }
+      "v_position",
+      "v_velocity",
+      "v_size",
+      "v_curtime",
+      "v_lifetime"
+   };
+
+   // Set the vertex shader outputs as transform feedback varyings.  They are
+   // applied before the one and only link, and the link is not waited on here
+   // so that the draw program can compile alongside it.
+   return esLoadProgramFeedbackAsync ( vShaderStr, fShaderStr, 5, feedbackVaryings, GL_INTERLEAVED_ATTRIBS );
 }
 
 ///
@@ -227,9 +214,11 @@ void InitEmitParticles ( ESContext *esContext )
 //
 int Init ( ESContext *esContext )
 {
-   Particle particleData[ NUM_PARTICLES ];
    UserData *userData = ( UserData * ) esContext->userData;
-   int i;
+   ESAsyncProgram *emitProgram;
+   ESAsyncProgram *drawProgram;
+   ESProgramInfo *emitInfo;
+   ESProgramInfo *drawInfo;
 
    char vShaderStr[] =
       "#version 300 es                                                     \n"
@@ -278,61 +267,80 @@ int Init ( ESContext *esContext )
       "  fragColor = texColor * u_color;                    \n"
       "}                                                    \n";
 
-   InitEmitParticles ( esContext );
+   // Issue both programs before waiting on either
+   emitProgram = InitEmitParticles ( );
+   drawProgram = esLoadProgramAsync ( vShaderStr, fShaderStr );
+
+   // Get the linked programs along with their reflection, which comes with
+   // the binary when the program cache has them
+   emitInfo = esProgramWaitInfo ( emitProgram );
+   drawInfo = esProgramWaitInfo ( drawProgram );
 
-   // Load the shaders and get a linked program object
-   userData->drawProgramObject = esLoadProgram ( vShaderStr, fShaderStr );
+   if ( emitInfo == NULL || drawInfo == NULL )
+   {
+      esProgramInfoFree ( emitInfo );
+      esProgramInfoFree ( drawInfo );
+      return FALSE;
+   }
+
+   userData->emitProgramObject = esProgramInfoProgram ( emitInfo );
+   userData->drawProgramObject = esProgramInfoProgram ( drawInfo );
+
+   // Get the emit uniform locations
+   userData->emitTimeLoc = esProgramUniformLocation ( emitInfo, "u_time" );
+   userData->emitEmitLoc = esProgramUniformLocation ( emitInfo, "u_emit" );
+   userData->emitCountLoc = esProgramUniformLocation ( emitInfo, "u_emitCount" );
+   userData->emitNoiseSamplerLoc = esProgramUniformLocation ( emitInfo, "s_noiseTex" );
 
    // Get the uniform locations
-   userData->drawTimeLoc = glGetUniformLocation ( userData->drawProgramObject, "u_time" );
-   userData->drawColorLoc = glGetUniformLocation ( userData->drawProgramObject, "u_color" );
-   userData->drawAccelerationLoc = glGetUniformLocation ( userData->drawProgramObject, "u_acceleration" );
-   userData->samplerLoc = glGetUniformLocation ( userData->drawProgramObject, "s_texture" );
+   userData->drawTimeLoc = esProgramUniformLocation ( drawInfo, "u_time" );
+   userData->drawColorLoc = esProgramUniformLocation ( drawInfo, "u_color" );
+   userData->drawAccelerationLoc = esProgramUniformLocation ( drawInfo, "u_acceleration" );
+   userData->samplerLoc = esProgramUniformLocation ( drawInfo, "s_texture" );
+
+   esProgramInfoFree ( emitInfo );
+   esProgramInfoFree ( drawInfo );
 
    userData->time = 0.0f;
-   userData->curSrcIndex = 0;
+   userData->emitAccumulator = 0.0f;
 
    glClearColor ( 0.0f, 0.0f, 0.0f, 0.0f );
 
-   userData->textureId = LoadTexture ( esContext->platformData, "smoke.tga" );
+   userData->textureStream = esTextureStreamCreate ( esContext->platformData, TEXTURE_UPLOAD_BUDGET, 0 );
 
-   if ( userData->textureId <= 0 )
+   if ( userData->textureStream == NULL )
    {
       return FALSE;
    }
 
-   // Create a 3D noise texture for random values
-   userData->noiseTextureId = Create3DNoiseTexture ( 128, 50.0 );
+   userData->textureId = LoadTexture ( userData->textureStream, "smoke.tga" );
 
-   // Initialize particle data
-   for ( i = 0; i < NUM_PARTICLES; i++ )
+   if ( userData->textureId <= 0 )
    {
-      Particle *particle = &particleData[i];
-      particle->position[0] = 0.0f;
-      particle->position[1] = 0.0f;
-      particle->velocity[0] = 0.0f;
-      particle->velocity[1] = 0.0f;
-      particle->size = 0.0f;
-      particle->curtime = 0.0f;
-      particle->lifetime = 0.0f;
+      return FALSE;
    }
 
+   // Create a 3D noise texture for random values
+   userData->noiseTextureId = esCreateNoise3DTexture ( 128, 50.0f );
 
-   // Create the particle VBOs
-   glGenBuffers ( 2, &userData->particleVBOs[0] );
+   // Create the particle VBOs, empty until the first update
+   userData->particles = esParticleFeedbackCreate ( userData->numParticles, sizeof ( Particle ), LIFETIME );
 
-   for ( i = 0; i < 2; i++ )
+   if ( userData->particles == NULL )
    {
-      glBindBuffer ( GL_ARRAY_BUFFER, userData->particleVBOs[i] );
-      glBufferData ( GL_ARRAY_BUFFER, sizeof ( Particle ) * NUM_PARTICLES, particleData, GL_DYNAMIC_COPY );
+      return FALSE;
    }
 
    return TRUE;
 }
 
-void SetupVertexAttributes ( ESContext *esContext, GLuint vboID )
+///
+// Set the particle attributes from the bound VBO
+//
+void ESCALLBACK SetupVertexAttributes ( void *userData )
 {
-   glBindBuffer ( GL_ARRAY_BUFFER, vboID );
+   ( void ) userData;
+
    glVertexAttribPointer ( ATTRIBUTE_POSITION, 2, GL_FLOAT,
                            GL_FALSE, sizeof ( Particle ),
                            ( const void * ) NULL );
@@ -353,56 +361,40 @@ void SetupVertexAttributes ( ESContext *esContext, GLuint vboID )
                            GL_FALSE, sizeof ( Particle ),
                            ( const void * ) offsetof ( Particle, lifetime ) );
 
-   glEnableVertexAttribArray ( ATTRIBUTE_POSITION );
-   glEnableVertexAttribArray ( ATTRIBUTE_VELOCITY );
-   glEnableVertexAttribArray ( ATTRIBUTE_SIZE );
-   glEnableVertexAttribArray ( ATTRIBUTE_CURTIME );
-   glEnableVertexAttribArray ( ATTRIBUTE_LIFETIME );
+   esStateEnableVertexAttribArray ( ATTRIBUTE_POSITION );
+   esStateEnableVertexAttribArray ( ATTRIBUTE_VELOCITY );
+   esStateEnableVertexAttribArray ( ATTRIBUTE_SIZE );
+   esStateEnableVertexAttribArray ( ATTRIBUTE_CURTIME );
+   esStateEnableVertexAttribArray ( ATTRIBUTE_LIFETIME );
 }
 
 void EmitParticles ( ESContext *esContext, float deltaTime )
 {
    UserData *userData = esContext->userData;
-   GLuint srcVBO = userData->particleVBOs[ userData->curSrcIndex ];
-   GLuint dstVBO = userData->particleVBOs[ ( userData->curSrcIndex + 1 ) % 2 ];
+   int emitCount;
 
-   glUseProgram ( userData->emitProgramObject );
+   // Emit at the rate that keeps the buffers full
+   userData->emitAccumulator += deltaTime * userData->numParticles / LIFETIME;
+   emitCount = ( int ) userData->emitAccumulator;
+   userData->emitAccumulator -= emitCount;
 
-   SetupVertexAttributes ( esContext, srcVBO );
-
-   // Set transform feedback buffer
-   glBindBuffer ( GL_TRANSFORM_FEEDBACK_BUFFER, dstVBO );
-   glBindBufferBase ( GL_TRANSFORM_FEEDBACK_BUFFER, 0, dstVBO );
-
-   // Turn off rasterization - we are not drawing
-   glEnable ( GL_RASTERIZER_DISCARD );
+   esStateUseProgram ( userData->emitProgramObject );
 
    // Set uniforms
    glUniform1f ( userData->emitTimeLoc, userData->time );
-   glUniform1f ( userData->emitEmissionRateLoc, EMISSION_RATE );
+
+   // Spread this step's particles across the noise texture so that each
+   // one samples its own texels, however many are emitted
+   glUniform1f ( userData->emitCountLoc, ( GLfloat ) ( emitCount > 0 ? emitCount : 1 ) );
 
    // Bind the 3D noise texture
-   glActiveTexture ( GL_TEXTURE0 );
-   glBindTexture ( GL_TEXTURE_3D, userData->noiseTextureId );
+   esStateActiveTexture ( GL_TEXTURE0 );
+   esStateBindTexture ( GL_TEXTURE_3D, userData->noiseTextureId );
    glUniform1i ( userData->emitNoiseSamplerLoc, 0 );
 
-   // Emit particles using transform feedback
-   glBeginTransformFeedback ( GL_POINTS );
-   glDrawArrays ( GL_POINTS, 0, NUM_PARTICLES );
-   glEndTransformFeedback();
-
-   // Create a sync object to ensure transform feedback results are completed before the draw that uses them.
-   userData->emitSync = glFenceSync ( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
-
-   // Restore state
-   glDisable ( GL_RASTERIZER_DISCARD );
-   glUseProgram ( 0 );
-   glBindBufferBase ( GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0 );
-   glBindBuffer ( GL_ARRAY_BUFFER, 0 );
-   glBindTexture ( GL_TEXTURE_3D, 0 );
-
-   // Ping pong the buffers
-   userData->curSrcIndex = ( userData->curSrcIndex + 1 ) % 2;
+   // Copy the live particles and emit new ones using transform feedback
+   esParticleFeedbackUpdate ( userData->particles, userData->time, emitCount,
+                              userData->emitEmitLoc, SetupVertexAttributes, NULL );
 }
 
 
@@ -415,7 +407,9 @@ void Update ( ESContext *esContext, float deltaTime )
 
    userData->time += deltaTime;
 
+   esProfilerBegin ( esContext, "Emit" );
    EmitParticles ( esContext, deltaTime );
+   esProfilerEnd ( esContext );
 }
 
 ///
@@ -424,40 +418,43 @@ void Update ( ESContext *esContext, float deltaTime )
 void Draw ( ESContext *esContext )
 {
    UserData *userData = esContext->userData;
+   float drawTime = userData->time + esContext->interpolation * TIME_STEP;
+
+   esProfilerBegin ( esContext, "Draw" );
 
-   // Block the GL server until transform feedback results are completed
-   glWaitSync ( userData->emitSync, 0, GL_TIMEOUT_IGNORED );
-   glDeleteSync ( userData->emitSync );
+   // Upload any texture rows decoded since the last frame
+   esTextureStreamUpdate ( userData->textureStream );
 
    // Set the viewport
-   glViewport ( 0, 0, esContext->width, esContext->height );
+   esStateViewport ( 0, 0, esContext->width, esContext->height );
 
    // Clear the color buffer
    glClear ( GL_COLOR_BUFFER_BIT );
 
    // Use the program object
-   glUseProgram ( userData->drawProgramObject );
-
-   // Load the VBO and vertex attributes
-   SetupVertexAttributes ( esContext, userData->particleVBOs[ userData->curSrcIndex ] );
+   esStateUseProgram ( userData->drawProgramObject );
 
    // Set uniforms
-   glUniform1f ( userData->drawTimeLoc, userData->time );
+   // Draw the particles where they are between the last update and the next
+   glUniform1f ( userData->drawTimeLoc, drawTime );
    glUniform4f ( userData->drawColorLoc, 1.0f, 1.0f, 1.0f, 1.0f );
    glUniform2f ( userData->drawAccelerationLoc, 0.0f, ACCELERATION );
 
    // Blend particles
-   glEnable ( GL_BLEND );
-   glBlendFunc ( GL_SRC_ALPHA, GL_ONE );
+   esStateEnable ( GL_BLEND );
+   esStateBlendFunc ( GL_SRC_ALPHA, GL_ONE );
 
    // Bind the texture
-   glActiveTexture ( GL_TEXTURE0 );
-   glBindTexture ( GL_TEXTURE_2D, userData->textureId );
+   esStateActiveTexture ( GL_TEXTURE0 );
+   esStateBindTexture ( GL_TEXTURE_2D, userData->textureId );
 
    // Set the sampler texture unit to 0
    glUniform1i ( userData->samplerLoc, 0 );
 
-   glDrawArrays ( GL_POINTS, 0, NUM_PARTICLES );
+   // Load the VBO and vertex attributes, and draw the particles that may be alive
+   esParticleFeedbackDraw ( userData->particles, drawTime, SetupVertexAttributes, NULL );
+
+   esProfilerEnd ( esContext );
 }
 
 ///
@@ -467,6 +464,8 @@ void ShutDown ( ESContext *esContext )
 {
    UserData *userData = esContext->userData;
 
+   esTextureStreamDestroy ( userData->textureStream );
+
    // Delete texture object
    glDeleteTextures ( 1, &userData->textureId );
 
@@ -474,13 +473,25 @@ void ShutDown ( ESContext *esContext )
    glDeleteProgram ( userData->drawProgramObject );
    glDeleteProgram ( userData->emitProgramObject );
 
-   glDeleteBuffers ( 2, &userData->particleVBOs[0] );
+   esParticleFeedbackDestroy ( userData->particles );
 }
 
 
 int esMain ( ESContext *esContext )
 {
+   UserData *userData;
+
    esContext->userData = malloc ( sizeof ( UserData ) );
+   userData = esContext->userData;
+   memset ( userData, 0, sizeof ( UserData ) );
+
+   // Optional particle count on the command line, e.g. "ParticleSystemTransformFeedback 100000"
+   userData->numParticles = NUM_PARTICLES;
+
+   if ( esContext->argc > 1 && atoi ( esContext->argv[1] ) > 0 )
+   {
+      userData->numParticles = atoi ( esContext->argv[1] );
+   }
 
    esCreateWindow ( esContext, "ParticleSystemTransformFeedback", 640, 480, ES_WINDOW_RGB );
 
@@ -491,6 +502,7 @@ int esMain ( ESContext *esContext )
 
    esRegisterDrawFunc ( esContext, Draw );
    esRegisterUpdateFunc ( esContext, Update );
+   esSetFixedTimestep ( esContext, TIME_STEP, 0 );
    esRegisterShutdownFunc ( esContext, ShutDown );
 
    return GL_TRUE;
@@ -34,23 +34,37 @@
 //    Demonstrates shadow rendering with depth texture and 6x6 PCF
 //
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include "esUtil.h"
 
 #define POSITION_LOC    0
 #define COLOR_LOC       1
 
+// std140 layout of the Transform block, one per model
+typedef struct
+{
+   ES_STD140_MAT4 ( mvpMatrix );
+   ES_STD140_MAT4 ( mvpLightMatrix );
+} Transform;
+
+ES_STD140_CHECK ( Transform, mvpLightMatrix, 64 );
+
 typedef struct
 {
    // Handle to a program object
    GLuint sceneProgramObject;
    GLuint shadowMapProgramObject;
 
-   // Uniform locations
-   GLint  sceneMvpLoc;
-   GLint  shadowMapMvpLoc;
-   GLint  sceneMvpLightLoc;
-   GLint  shadowMapMvpLightLoc;
+   // Transform block bindings
+   GLuint sceneTransformBinding;
+   GLuint shadowMapTransformBinding;
+
+   // Uniform buffer, written every frame, and where the transforms of each
+   // model are in it
+   ESUniformRing uniforms;
+   GLintptr  groundTransformOffset;
+   GLintptr  cubeTransformOffset;
 
    // Sampler location
    GLint shadowMapSamplerLoc;
@@ -231,11 +245,19 @@ int Init ( ESContext *esContext )
 {
    GLfloat *positions;
    GLuint *indices;
+   ESAsyncProgram *shadowMapProgram;
+   ESAsyncProgram *sceneProgram;
+   ESProgramInfo *shadowMapInfo;
+   ESProgramInfo *sceneInfo;
 
    UserData *userData = esContext->userData;
    const char vShadowMapShaderStr[] =  
       "#version 300 es                                  \n"
-      "uniform mat4 u_mvpLightMatrix;                   \n"
+      "layout(std140) uniform Transform                 \n"
+      "{                                                \n"
+      "   mat4 u_mvpMatrix;                             \n"
+      "   mat4 u_mvpLightMatrix;                        \n"
+      "};                                               \n"
       "layout(location = 0) in vec4 a_position;         \n"
       "out vec4 v_color;                                \n"
       "void main()                                      \n"
@@ -252,8 +274,11 @@ int Init ( ESContext *esContext )
 
     const char vSceneShaderStr[] =  
       "#version 300 es                                   \n"
-      "uniform mat4 u_mvpMatrix;                         \n"
-      "uniform mat4 u_mvpLightMatrix;                    \n"
+      "layout(std140) uniform Transform                  \n"
+      "{                                                 \n"
+      "   mat4 u_mvpMatrix;                              \n"
+      "   mat4 u_mvpLightMatrix;                         \n"
+      "};                                                \n"
       "layout(location = 0) in vec4 a_position;          \n"
       "layout(location = 1) in vec4 a_color;             \n"
       "out vec4 v_color;                                 \n"
@@ -299,18 +324,41 @@ int Init ( ESContext *esContext )
       "   outColor = v_color * sum;                                   \n"
       "}                                                              \n";
 
-   // Load the shaders and get a linked program object
-   userData->shadowMapProgramObject = esLoadProgram ( vShadowMapShaderStr, fShadowMapShaderStr );
-   userData->sceneProgramObject = esLoadProgram ( vSceneShaderStr, fSceneShaderStr );
+   // Issue both programs before waiting on either so they can compile in parallel
+   shadowMapProgram = esLoadProgramAsync ( vShadowMapShaderStr, fShadowMapShaderStr );
+   sceneProgram = esLoadProgramAsync ( vSceneShaderStr, fSceneShaderStr );
+
+   // Get the linked programs, with the binding point given to each uniform block
+   shadowMapInfo = esProgramWaitInfo ( shadowMapProgram );
+   sceneInfo = esProgramWaitInfo ( sceneProgram );
+
+   if ( shadowMapInfo == NULL || sceneInfo == NULL ||
+         esProgramUniformBlock ( shadowMapInfo, "Transform" ) == NULL ||
+         esProgramUniformBlock ( sceneInfo, "Transform" ) == NULL )
+   {
+      esProgramInfoFree ( shadowMapInfo );
+      esProgramInfoFree ( sceneInfo );
+      return FALSE;
+   }
 
-   // Get the uniform locations
-   userData->sceneMvpLoc = glGetUniformLocation ( userData->sceneProgramObject, "u_mvpMatrix" );
-   userData->shadowMapMvpLoc = glGetUniformLocation ( userData->shadowMapProgramObject, "u_mvpMatrix" );
-   userData->sceneMvpLightLoc = glGetUniformLocation ( userData->sceneProgramObject, "u_mvpLightMatrix" );
-   userData->shadowMapMvpLightLoc = glGetUniformLocation ( userData->shadowMapProgramObject, "u_mvpLightMatrix" );
+   userData->shadowMapProgramObject = esProgramInfoProgram ( shadowMapInfo );
+   userData->sceneProgramObject = esProgramInfoProgram ( sceneInfo );
+
+   // Get the Transform block bindings
+   userData->shadowMapTransformBinding = esProgramUniformBlock ( shadowMapInfo, "Transform" )->binding;
+   userData->sceneTransformBinding = esProgramUniformBlock ( sceneInfo, "Transform" )->binding;
 
    // Get the sampler location
-   userData->shadowMapSamplerLoc = glGetUniformLocation ( userData->sceneProgramObject, "s_shadowMap" );
+   userData->shadowMapSamplerLoc = esProgramUniformLocation ( sceneInfo, "s_shadowMap" );
+
+   esProgramInfoFree ( shadowMapInfo );
+   esProgramInfoFree ( sceneInfo );
+
+   // Room for the transforms of both models, each starting on the offset alignment
+   if ( !esUniformRingInit ( &userData->uniforms, 4096 ) )
+   {
+      return FALSE;
+   }
 
    // Generate the vertex and index data for the ground
    userData->groundGridSize = 3;
@@ -372,12 +420,30 @@ int Init ( ESContext *esContext )
    return TRUE;
 }
 
+///
+// Write the transforms of a model to the uniform ring
+//
+GLboolean WriteTransform ( UserData *userData, const ESMatrix *mvpMatrix, const ESMatrix *mvpLightMatrix,
+                           GLintptr *offset )
+{
+   Transform *transform = esUniformRingAlloc ( &userData->uniforms, sizeof ( Transform ), offset );
+
+   if ( transform == NULL )
+   {
+      return GL_FALSE;
+   }
+
+   memcpy ( transform->mvpMatrix, mvpMatrix->m, sizeof ( transform->mvpMatrix ) );
+   memcpy ( transform->mvpLightMatrix, mvpLightMatrix->m, sizeof ( transform->mvpLightMatrix ) );
+
+   return GL_TRUE;
+}
+
 ///
 // Draw the model
 //
 void DrawScene ( ESContext *esContext, 
-                 GLint mvpLoc, 
-                 GLint mvpLightLoc )
+                 GLuint transformBinding )
 {
    UserData *userData = esContext->userData;
  
@@ -391,9 +457,9 @@ void DrawScene ( ESContext *esContext,
    // Bind the index buffer
    glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, userData->groundIndicesIBO );
 
-   // Load the MVP matrix for the ground model
-   glUniformMatrix4fv ( mvpLoc, 1, GL_FALSE, (GLfloat*) &userData->groundMvpMatrix.m[0][0] );
-   glUniformMatrix4fv ( mvpLightLoc, 1, GL_FALSE, (GLfloat*) &userData->groundMvpLightMatrix.m[0][0] );
+   // Bind the MVP matrices for the ground model
+   esStateBindBufferRange ( GL_UNIFORM_BUFFER, transformBinding, userData->uniforms.ring.buffer,
+                            userData->groundTransformOffset, sizeof ( Transform ) );
 
    // Set the ground color to light gray
    glVertexAttrib4f ( COLOR_LOC, 0.9f, 0.9f, 0.9f, 1.0f );
@@ -410,9 +476,9 @@ void DrawScene ( ESContext *esContext,
    // Bind the index buffer
    glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, userData->cubeIndicesIBO );
 
-   // Load the MVP matrix for the cube model
-   glUniformMatrix4fv ( mvpLoc, 1, GL_FALSE, (GLfloat*) &userData->cubeMvpMatrix.m[0][0] );
-   glUniformMatrix4fv ( mvpLightLoc, 1, GL_FALSE, (GLfloat*) &userData->cubeMvpLightMatrix.m[0][0] );
+   // Bind the MVP matrices for the cube model
+   esStateBindBufferRange ( GL_UNIFORM_BUFFER, transformBinding, userData->uniforms.ring.buffer,
+                            userData->cubeTransformOffset, sizeof ( Transform ) );
 
    // Set the cube color to red
    glVertexAttrib4f ( COLOR_LOC, 1.0f, 0.0f, 0.0f, 1.0f );
@@ -424,13 +490,29 @@ void Draw ( ESContext *esContext )
 {
    UserData *userData = esContext->userData;
    GLint defaultFramebuffer = 0;
+   GLboolean written;
 
    // Initialize matrices
    InitMVP ( esContext );
 
+   // Write the transforms of both passes up front, as the buffer cannot be
+   // read while it is mapped
+   esUniformRingBegin ( &userData->uniforms );
+   written = WriteTransform ( userData, &userData->groundMvpMatrix, &userData->groundMvpLightMatrix,
+                              &userData->groundTransformOffset ) &&
+             WriteTransform ( userData, &userData->cubeMvpMatrix, &userData->cubeMvpLightMatrix,
+                              &userData->cubeTransformOffset );
+   esUniformRingEnd ( &userData->uniforms );
+
+   if ( !written )
+   {
+      return;
+   }
+
    glGetIntegerv ( GL_FRAMEBUFFER_BINDING, &defaultFramebuffer );
 
    // FIRST PASS: Render the scene from light position to generate the shadow map texture
+   esProfilerBegin ( esContext, "Shadow map" );
    glBindFramebuffer ( GL_FRAMEBUFFER, userData->shadowMapBufferId );
 
    // Set the viewport
@@ -447,11 +529,13 @@ void Draw ( ESContext *esContext )
    glPolygonOffset( 5.0f, 100.0f );
 
    glUseProgram ( userData->shadowMapProgramObject );
-   DrawScene ( esContext, userData->shadowMapMvpLoc, userData->shadowMapMvpLightLoc );
+   DrawScene ( esContext, userData->shadowMapTransformBinding );
 
    glDisable( GL_POLYGON_OFFSET_FILL );
+   esProfilerEnd ( esContext );
 
    // SECOND PASS: Render the scene from eye location using the shadow map texture created in the first pass
+   esProfilerBegin ( esContext, "Scene" );
    glBindFramebuffer ( GL_FRAMEBUFFER, defaultFramebuffer );
    glColorMask ( GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE );
 
@@ -472,7 +556,11 @@ void Draw ( ESContext *esContext )
    // Set the sampler texture unit to 0
    glUniform1i ( userData->shadowMapSamplerLoc, 0 );
 
-   DrawScene ( esContext, userData->sceneMvpLoc, userData->sceneMvpLightLoc );
+   DrawScene ( esContext, userData->sceneTransformBinding );
+   esProfilerEnd ( esContext );
+
+   // The region is reused once the GPU is past this fence
+   esUniformRingFence ( &userData->uniforms );
 }
 
 ///
@@ -495,6 +583,8 @@ void Shutdown ( ESContext *esContext )
    glDeleteFramebuffers ( 1, &userData->shadowMapBufferId );
    glDeleteTextures ( 1, &userData->shadowMapTextureId );
 
+   esUniformRingDestroy ( &userData->uniforms );
+
    // Delete program object
    glDeleteProgram ( userData->sceneProgramObject );
    glDeleteProgram ( userData->shadowMapProgramObject );
@@ -37,6 +37,9 @@
 #include <math.h>
 #include "esUtil.h"
 
+// Most texture bytes uploaded per frame
+#define TEXTURE_UPLOAD_BUDGET   ( 256 * 1024 )
+
 #define POSITION_LOC    0
 
 typedef struct
@@ -66,36 +69,31 @@ typedef struct
 
    // MVP matrix
    ESMatrix  mvpMatrix;
+
+   // Decodes and uploads textures in the background
+   ESTextureStream *textureStream;
 } UserData;
 
 ///
-// Load texture from disk
+// Queue a texture to be loaded in the background
 //
-GLuint LoadTexture (  void *ioContext, char *fileName )
+GLuint LoadTexture ( ESTextureStream *textureStream, char *fileName )
 {
-   int width,
-       height;
-
-   char *buffer = esLoadTGA ( ioContext, fileName, &width, &height );
-   GLuint texId;
+   GLuint texId = esTextureStreamLoad ( textureStream, fileName, GL_ALPHA );
 
-   if ( buffer == NULL )
+   if ( texId == 0 )
    {
       esLogMessage ( "Error loading (%s) image.\n", fileName );
       return 0;
    }
 
-   glGenTextures ( 1, &texId );
+   // The texture samples as black until esTextureStreamUpdate has uploaded it
    glBindTexture ( GL_TEXTURE_2D, texId );
-
-   glTexImage2D ( GL_TEXTURE_2D, 0, GL_ALPHA, width, height, 0, GL_ALPHA, GL_UNSIGNED_BYTE, buffer );
    glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
    glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
    glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
    glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
 
-   free ( buffer );
-
    return texId;
 }
 
@@ -197,7 +195,14 @@ int Init ( ESContext *esContext )
    userData->samplerLoc = glGetUniformLocation ( userData->programObject, "s_texture" );
 
    // Load the heightmap
-   userData->textureId = LoadTexture ( esContext->platformData, "heightmap.tga" );
+   userData->textureStream = esTextureStreamCreate ( esContext->platformData, TEXTURE_UPLOAD_BUDGET, 0 );
+
+   if ( userData->textureStream == NULL )
+   {
+      return FALSE;
+   }
+
+   userData->textureId = LoadTexture ( userData->textureStream, "heightmap.tga" );
 
    if ( userData->textureId == 0 )
    {
@@ -238,6 +243,9 @@ void Draw ( ESContext *esContext )
 
    InitMVP ( esContext );
 
+   // Upload any texture rows decoded since the last frame
+   esTextureStreamUpdate ( userData->textureStream );
+
    // Set the viewport
    glViewport ( 0, 0, esContext->width, esContext->height );
 
@@ -280,6 +288,8 @@ void Shutdown ( ESContext *esContext )
 {
    UserData *userData = esContext->userData;
 
+   esTextureStreamDestroy ( userData->textureStream );
+
    glDeleteBuffers ( 1, &userData->positionVBO );
    glDeleteBuffers ( 1, &userData->indicesIBO );
 
@@ -35,6 +35,7 @@
 //    geometry instancing
 //
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include "esUtil.h"
 
@@ -44,6 +45,7 @@
 #endif
 
 
+// Default number of instances, can be overridden on the command line
 #define NUM_INSTANCES   100
 #define POSITION_LOC    0
 #define COLOR_LOC       1
@@ -57,14 +59,20 @@ typedef struct
    // VBOs
    GLuint positionVBO;
    GLuint colorVBO;
-   GLuint mvpVBO;
    GLuint indicesIBO;
 
+   // Ring of per-frame MVP buffers, and the offset of this frame's MVPs
+   ESBufferRing mvpRing;
+   GLintptr     mvpOffset;
+
    // Number of indices
    int       numIndices;
 
-   // Rotation angle
-   GLfloat   angle[NUM_INSTANCES];
+   // Number of instances
+   int       numInstances;
+
+   // Per-instance translation, rotation angle and scale
+   ESInstanceData instances;
 
 } UserData;
 
@@ -121,38 +129,70 @@ int Init ( ESContext *esContext )
 
    // Random color for each instance
    {
-      GLubyte colors[NUM_INSTANCES][4];
+      GLubyte *colors = malloc ( userData->numInstances * 4 );
       int instance;
 
+      if ( colors == NULL )
+      {
+         return GL_FALSE;
+      }
+
       srandom ( 0 );
 
-      for ( instance = 0; instance < NUM_INSTANCES; instance++ )
+      for ( instance = 0; instance < userData->numInstances; instance++ )
       {
-         colors[instance][0] = random() % 255;
-         colors[instance][1] = random() % 255;
-         colors[instance][2] = random() % 255;
-         colors[instance][3] = 0;
+         colors[instance * 4 + 0] = random() % 255;
+         colors[instance * 4 + 1] = random() % 255;
+         colors[instance * 4 + 2] = random() % 255;
+         colors[instance * 4 + 3] = 0;
       }
 
       glGenBuffers ( 1, &userData->colorVBO );
       glBindBuffer ( GL_ARRAY_BUFFER, userData->colorVBO );
-      glBufferData ( GL_ARRAY_BUFFER, NUM_INSTANCES * 4, colors, GL_STATIC_DRAW );
+      glBufferData ( GL_ARRAY_BUFFER, userData->numInstances * 4, colors, GL_STATIC_DRAW );
+      free ( colors );
    }
 
-   // Allocate storage to store MVP per instance
+   // Per-instance transforms, the MVPs are computed later
    {
+      ESInstanceData *instances = &userData->instances;
       int instance;
+      int numRows;
+      float scale;
+
+      if ( !esInstanceDataInit ( instances, userData->numInstances ) )
+      {
+         return GL_FALSE;
+      }
+
+      // Lay the instances out on a square grid, shrinking the cubes so
+      // that large grids do not overlap
+      numRows = ( int ) sqrtf ( ( float ) userData->numInstances );
+      numRows = numRows > 0 ? numRows : 1;
+      scale = numRows > 10 ? 10.0f / ( float ) numRows : 1.0f;
 
-      // Random angle for each instance, compute the MVP later
-      for ( instance = 0; instance < NUM_INSTANCES; instance++ )
+      for ( instance = 0; instance < userData->numInstances; instance++ )
       {
-         userData->angle[instance] = ( float ) ( random() % 32768 ) / 32767.0f * 360.0f;
+         instances->posX[instance] = ( ( float ) ( instance % numRows ) / ( float ) numRows ) * 2.0f - 1.0f;
+         instances->posY[instance] = ( ( float ) ( instance / numRows ) / ( float ) numRows ) * 2.0f - 1.0f;
+         instances->posZ[instance] = -2.0f;
+
+         // Rotate about ( 1, 0, 1 ), starting at a random angle
+         instances->axisX[instance] = 0.70710678f;
+         instances->axisY[instance] = 0.0f;
+         instances->axisZ[instance] = 0.70710678f;
+         instances->angle[instance] = ( float ) ( random() % 32768 ) / 32767.0f * 360.0f;
+         instances->scale[instance] = scale;
       }
+   }
 
-      glGenBuffers ( 1, &userData->mvpVBO );
-      glBindBuffer ( GL_ARRAY_BUFFER, userData->mvpVBO );
-      glBufferData ( GL_ARRAY_BUFFER, NUM_INSTANCES * sizeof ( ESMatrix ), NULL, GL_DYNAMIC_DRAW );
+   // Triple-buffered storage for the per-instance MVPs
+   if ( !esBufferRingInit ( &userData->mvpRing, GL_ARRAY_BUFFER,
+                            userData->numInstances * sizeof ( ESMatrix ), GL_DYNAMIC_DRAW ) )
+   {
+      return GL_FALSE;
    }
+
    glBindBuffer ( GL_ARRAY_BUFFER, 0 );
 
    glClearColor ( 1.0f, 1.0f, 1.0f, 0.0f );
@@ -161,62 +201,28 @@ int Init ( ESContext *esContext )
 
 
 ///
-// Update MVP matrix based on time
+// Update the rotation angles based on time.  This runs on the update thread
+// of the pipeline and only the angles go to the frame state; Draw builds the
+// MVPs from them straight into the mapped buffer.
 //
 void Update ( ESContext *esContext, float deltaTime )
 {
    UserData *userData = ( UserData * ) esContext->userData;
-   ESMatrix *matrixBuf;
-   ESMatrix perspective;
-   float    aspect;
-   int      instance = 0;
-   int      numRows;
-   int      numColumns;
-
-
-   // Compute the window aspect ratio
-   aspect = ( GLfloat ) esContext->width / ( GLfloat ) esContext->height;
-
-   // Generate a perspective matrix with a 60 degree FOV
-   esMatrixLoadIdentity ( &perspective );
-   esPerspective ( &perspective, 60.0f, aspect, 1.0f, 20.0f );
-
-   glBindBuffer ( GL_ARRAY_BUFFER, userData->mvpVBO );
-   matrixBuf = ( ESMatrix * ) glMapBufferRange ( GL_ARRAY_BUFFER, 0, sizeof ( ESMatrix ) * NUM_INSTANCES, GL_MAP_WRITE_BIT );
+   ESInstanceData *instances = &userData->instances;
+   int      instance;
 
-   // Compute a per-instance MVP that translates and rotates each instance differnetly
-   numRows = ( int ) sqrtf ( NUM_INSTANCES );
-   numColumns = numRows;
-
-   for ( instance = 0; instance < NUM_INSTANCES; instance++ )
+   // Compute a rotation angle based on time to rotate each cube
+   for ( instance = 0; instance < userData->numInstances; instance++ )
    {
-      ESMatrix modelview;
-      float translateX = ( ( float ) ( instance % numRows ) / ( float ) numRows ) * 2.0f - 1.0f;
-      float translateY = ( ( float ) ( instance / numColumns ) / ( float ) numColumns ) * 2.0f - 1.0f;
-
-      // Generate a model view matrix to rotate/translate the cube
-      esMatrixLoadIdentity ( &modelview );
-
-      // Per-instance translation
-      esTranslate ( &modelview, translateX, translateY, -2.0f );
+      instances->angle[instance] += ( deltaTime * 40.0f );
 
-      // Compute a rotation angle based on time to rotate the cube
-      userData->angle[instance] += ( deltaTime * 40.0f );
-
-      if ( userData->angle[instance] >= 360.0f )
+      if ( instances->angle[instance] >= 360.0f )
       {
-         userData->angle[instance] -= 360.0f;
+         instances->angle[instance] -= 360.0f;
       }
-
-      // Rotate the cube
-      esRotate ( &modelview, userData->angle[instance], 1.0, 0.0, 1.0 );
-
-      // Compute the final MVP by multiplying the
-      // modevleiw and perspective matrices together
-      esMatrixMultiply ( &matrixBuf[instance], &modelview, &perspective );
    }
 
-   glUnmapBuffer ( GL_ARRAY_BUFFER );
+   memcpy ( esPipelineUpdateState ( esContext ), instances->angle, userData->numInstances * sizeof ( GLfloat ) );
 }
 
 ///
@@ -225,6 +231,33 @@ void Update ( ESContext *esContext, float deltaTime )
 void Draw ( ESContext *esContext )
 {
    UserData *userData = esContext->userData;
+   ESInstanceData drawInstances = userData->instances;
+   ESMatrix *matrixBuf;
+   ESMatrix perspective;
+   float    aspect;
+
+   // Compute the window aspect ratio
+   aspect = ( GLfloat ) esContext->width / ( GLfloat ) esContext->height;
+
+   // Generate a perspective matrix with a 60 degree FOV
+   esMatrixLoadIdentity ( &perspective );
+   esPerspective ( &perspective, 60.0f, aspect, 1.0f, 20.0f );
+
+   // Map the next MVP buffer in the ring without waiting for the GPU
+   matrixBuf = ( ESMatrix * ) esBufferRingMap ( &userData->mvpRing, &userData->mvpOffset );
+
+   if ( matrixBuf == NULL )
+   {
+      return;
+   }
+
+   // Compute a per-instance MVP that translates and rotates each instance
+   // differently, split across worker threads.  The angles are the ones the
+   // last update left in the frame state, the rest of the transforms never
+   // change after Init.
+   drawInstances.angle = ( GLfloat * ) esPipelineDrawState ( esContext );
+   esInstanceBuildMVP ( matrixBuf, &drawInstances, &perspective );
+   esBufferRingUnmap ( &userData->mvpRing );
 
    // Set the viewport
    glViewport ( 0, 0, esContext->width, esContext->height );
@@ -249,14 +282,14 @@ void Draw ( ESContext *esContext )
    glVertexAttribDivisor ( COLOR_LOC, 1 ); // One color per instance
 
 
-   // Load the instance MVP buffer
-   glBindBuffer ( GL_ARRAY_BUFFER, userData->mvpVBO );
+   // Load the instance MVP buffer, using the region of the ring written this frame
+   glBindBuffer ( GL_ARRAY_BUFFER, userData->mvpRing.buffer );
 
    // Load each matrix row of the MVP.  Each row gets an increasing attribute location.
-   glVertexAttribPointer ( MVP_LOC + 0, 4, GL_FLOAT, GL_FALSE, sizeof ( ESMatrix ), ( const void * ) NULL );
-   glVertexAttribPointer ( MVP_LOC + 1, 4, GL_FLOAT, GL_FALSE, sizeof ( ESMatrix ), ( const void * ) ( sizeof ( GLfloat ) * 4 ) );
-   glVertexAttribPointer ( MVP_LOC + 2, 4, GL_FLOAT, GL_FALSE, sizeof ( ESMatrix ), ( const void * ) ( sizeof ( GLfloat ) * 8 ) );
-   glVertexAttribPointer ( MVP_LOC + 3, 4, GL_FLOAT, GL_FALSE, sizeof ( ESMatrix ), ( const void * ) ( sizeof ( GLfloat ) * 12 ) );
+   glVertexAttribPointer ( MVP_LOC + 0, 4, GL_FLOAT, GL_FALSE, sizeof ( ESMatrix ), ( const void * ) ( userData->mvpOffset ) );
+   glVertexAttribPointer ( MVP_LOC + 1, 4, GL_FLOAT, GL_FALSE, sizeof ( ESMatrix ), ( const void * ) ( userData->mvpOffset + sizeof ( GLfloat ) * 4 ) );
+   glVertexAttribPointer ( MVP_LOC + 2, 4, GL_FLOAT, GL_FALSE, sizeof ( ESMatrix ), ( const void * ) ( userData->mvpOffset + sizeof ( GLfloat ) * 8 ) );
+   glVertexAttribPointer ( MVP_LOC + 3, 4, GL_FLOAT, GL_FALSE, sizeof ( ESMatrix ), ( const void * ) ( userData->mvpOffset + sizeof ( GLfloat ) * 12 ) );
    glEnableVertexAttribArray ( MVP_LOC + 0 );
    glEnableVertexAttribArray ( MVP_LOC + 1 );
    glEnableVertexAttribArray ( MVP_LOC + 2 );
@@ -272,7 +305,10 @@ void Draw ( ESContext *esContext )
    glBindBuffer ( GL_ELEMENT_ARRAY_BUFFER, userData->indicesIBO );
 
    // Draw the cubes
-   glDrawElementsInstanced ( GL_TRIANGLES, userData->numIndices, GL_UNSIGNED_INT, ( const void * ) NULL, NUM_INSTANCES );
+   glDrawElementsInstanced ( GL_TRIANGLES, userData->numIndices, GL_UNSIGNED_INT, ( const void * ) NULL, userData->numInstances );
+
+   // The GPU reads this frame's MVPs until here
+   esBufferRingFence ( &userData->mvpRing );
 }
 
 ///
@@ -284,8 +320,9 @@ void Shutdown ( ESContext *esContext )
 
    glDeleteBuffers ( 1, &userData->positionVBO );
    glDeleteBuffers ( 1, &userData->colorVBO );
-   glDeleteBuffers ( 1, &userData->mvpVBO );
    glDeleteBuffers ( 1, &userData->indicesIBO );
+   esBufferRingDestroy ( &userData->mvpRing );
+   esInstanceDataFree ( &userData->instances );
 
    // Delete program object
    glDeleteProgram ( userData->programObject );
@@ -294,7 +331,19 @@ void Shutdown ( ESContext *esContext )
 
 int esMain ( ESContext *esContext )
 {
+   UserData *userData;
+
    esContext->userData = malloc ( sizeof ( UserData ) );
+   userData = esContext->userData;
+   memset ( userData, 0, sizeof ( UserData ) );
+
+   // Optional instance count on the command line, e.g. "Instancing 100000"
+   userData->numInstances = NUM_INSTANCES;
+
+   if ( esContext->argc > 1 && atoi ( esContext->argv[1] ) > 0 )
+   {
+      userData->numInstances = atoi ( esContext->argv[1] );
+   }
 
    esCreateWindow ( esContext, "Instancing", 640, 480, ES_WINDOW_RGB | ES_WINDOW_DEPTH );
 
@@ -303,6 +352,12 @@ int esMain ( ESContext *esContext )
       return GL_FALSE;
    }
 
+   // Update the angles of the next frame while this one is drawn
+   if ( !esPipelineEnable ( esContext, userData->numInstances * sizeof ( GLfloat ) ) )
+   {
+      return GL_FALSE;
+   }
+
    esRegisterShutdownFunc ( esContext, Shutdown );
    esRegisterUpdateFunc ( esContext, Update );
    esRegisterDrawFunc ( esContext, Draw );
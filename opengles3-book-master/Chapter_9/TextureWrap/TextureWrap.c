@@ -51,6 +51,13 @@ typedef struct
    // Texture handle
    GLuint textureId;
 
+   // Samplers with the repeat, clamp to edge and mirrored repeat wrap modes
+   GLuint samplers[3];
+
+   // Quad vertex and index buffers, and the vertex array using them
+   GLuint vboIds[2];
+   GLuint vaoId;
+
 } UserData;
 
 ///
@@ -135,6 +142,18 @@ GLuint CreateTexture2D( )
 int Init ( ESContext *esContext )
 {
    UserData *userData = esContext->userData;
+   GLfloat vVertices[] = { -0.3f,  0.3f, 0.0f, 1.0f,  // Position 0
+                           -1.0f,  -1.0f,              // TexCoord 0
+                           -0.3f, -0.3f, 0.0f, 1.0f, // Position 1
+                           -1.0f,  2.0f,              // TexCoord 1
+                           0.3f, -0.3f, 0.0f, 1.0f, // Position 2
+                           2.0f,  2.0f,              // TexCoord 2
+                           0.3f,  0.3f, 0.0f, 1.0f,  // Position 3
+                           2.0f,  -1.0f               // TexCoord 3
+                         };
+   GLushort indices[] = { 0, 1, 2, 0, 2, 3 };
+   GLenum wrapModes[3] = { GL_REPEAT, GL_CLAMP_TO_EDGE, GL_MIRRORED_REPEAT };
+   int i;
    char vShaderStr[] =
       "#version 300 es                            \n"
       "uniform float u_offset;                    \n"
@@ -171,6 +190,40 @@ int Init ( ESContext *esContext )
    // Load the texture
    userData->textureId = CreateTexture2D ();
 
+   // One sampler per wrap mode, so that drawing never changes the texture parameters
+   glGenSamplers ( 3, userData->samplers );
+
+   for ( i = 0; i < 3; i++ )
+   {
+      glSamplerParameteri ( userData->samplers[i], GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+      glSamplerParameteri ( userData->samplers[i], GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+      glSamplerParameteri ( userData->samplers[i], GL_TEXTURE_WRAP_S, wrapModes[i] );
+      glSamplerParameteri ( userData->samplers[i], GL_TEXTURE_WRAP_T, wrapModes[i] );
+   }
+
+   // Store the quad in buffers and record its attributes in a vertex array
+   glGenBuffers ( 2, userData->vboIds );
+   glGenVertexArrays ( 1, &userData->vaoId );
+
+   esStateBindVertexArray ( userData->vaoId );
+
+   esStateBindBuffer ( GL_ARRAY_BUFFER, userData->vboIds[0] );
+   glBufferData ( GL_ARRAY_BUFFER, sizeof ( vVertices ), vVertices, GL_STATIC_DRAW );
+   esStateBindBuffer ( GL_ELEMENT_ARRAY_BUFFER, userData->vboIds[1] );
+   glBufferData ( GL_ELEMENT_ARRAY_BUFFER, sizeof ( indices ), indices, GL_STATIC_DRAW );
+
+   // Load the vertex position
+   glVertexAttribPointer ( 0, 4, GL_FLOAT,
+                           GL_FALSE, 6 * sizeof ( GLfloat ), ( const void * ) 0 );
+   // Load the texture coordinate
+   glVertexAttribPointer ( 1, 2, GL_FLOAT,
+                           GL_FALSE, 6 * sizeof ( GLfloat ), ( const void * ) ( 4 * sizeof ( GLfloat ) ) );
+
+   esStateEnableVertexAttribArray ( 0 );
+   esStateEnableVertexAttribArray ( 1 );
+
+   esStateBindVertexArray ( 0 );
+
    glClearColor ( 1.0f, 1.0f, 1.0f, 0.0f );
    return TRUE;
 }
@@ -181,60 +234,35 @@ int Init ( ESContext *esContext )
 void Draw ( ESContext *esContext )
 {
    UserData *userData = esContext->userData;
-   GLfloat vVertices[] = { -0.3f,  0.3f, 0.0f, 1.0f,  // Position 0
-                           -1.0f,  -1.0f,              // TexCoord 0
-                           -0.3f, -0.3f, 0.0f, 1.0f, // Position 1
-                           -1.0f,  2.0f,              // TexCoord 1
-                           0.3f, -0.3f, 0.0f, 1.0f, // Position 2
-                           2.0f,  2.0f,              // TexCoord 2
-                           0.3f,  0.3f, 0.0f, 1.0f,  // Position 3
-                           2.0f,  -1.0f               // TexCoord 3
-                         };
-   GLushort indices[] = { 0, 1, 2, 0, 2, 3 };
+   GLfloat offsets[3] = { -0.7f, 0.0f, 0.7f };
+   int i;
 
    // Set the viewport
-   glViewport ( 0, 0, esContext->width, esContext->height );
+   esStateViewport ( 0, 0, esContext->width, esContext->height );
 
    // Clear the color buffer
    glClear ( GL_COLOR_BUFFER_BIT );
 
    // Use the program object
-   glUseProgram ( userData->programObject );
+   esStateUseProgram ( userData->programObject );
 
-   // Load the vertex position
-   glVertexAttribPointer ( 0, 4, GL_FLOAT,
-                           GL_FALSE, 6 * sizeof ( GLfloat ), vVertices );
-   // Load the texture coordinate
-   glVertexAttribPointer ( 1, 2, GL_FLOAT,
-                           GL_FALSE, 6 * sizeof ( GLfloat ), &vVertices[4] );
-
-   glEnableVertexAttribArray ( 0 );
-   glEnableVertexAttribArray ( 1 );
+   // Load the quad
+   esStateBindVertexArray ( userData->vaoId );
 
    // Bind the texture
-   glActiveTexture ( GL_TEXTURE0 );
-   glBindTexture ( GL_TEXTURE_2D, userData->textureId );
+   esStateActiveTexture ( GL_TEXTURE0 );
+   esStateBindTexture ( GL_TEXTURE_2D, userData->textureId );
 
    // Set the sampler texture unit to 0
    glUniform1i ( userData->samplerLoc, 0 );
 
-   // Draw quad with repeat wrap mode
-   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT );
-   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT );
-   glUniform1f ( userData->offsetLoc, -0.7f );
-   glDrawElements ( GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, indices );
-
-   // Draw quad with clamp to edge wrap mode
-   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
-   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
-   glUniform1f ( userData->offsetLoc, 0.0f );
-   glDrawElements ( GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, indices );
-
-   // Draw quad with mirrored repeat
-   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT );
-   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT );
-   glUniform1f ( userData->offsetLoc, 0.7f );
-   glDrawElements ( GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, indices );
+   // Draw quads with repeat, clamp to edge and mirrored repeat wrap modes
+   for ( i = 0; i < 3; i++ )
+   {
+      esStateBindSampler ( 0, userData->samplers[i] );
+      glUniform1f ( userData->offsetLoc, offsets[i] );
+      glDrawElements ( GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, ( const void * ) 0 );
+   }
 }
 
 ///
@@ -244,8 +272,13 @@ void ShutDown ( ESContext *esContext )
 {
    UserData *userData = esContext->userData;
 
-   // Delete texture object
+   // Delete texture and sampler objects
    glDeleteTextures ( 1, &userData->textureId );
+   glDeleteSamplers ( 3, userData->samplers );
+
+   // Delete the quad
+   glDeleteBuffers ( 2, userData->vboIds );
+   glDeleteVertexArrays ( 1, &userData->vaoId );
 
    // Delete program object
    glDeleteProgram ( userData->programObject );
@@ -42,6 +42,7 @@
 //  Includes
 //
 #include <stdlib.h>
+#include <stddef.h>
 
 #ifdef __APPLE__
 #include <OpenGLES/ES3/gl.h>
@@ -67,6 +68,12 @@ extern "C" {
 #define ESCALLBACK
 #endif
 
+#ifdef _MSC_VER
+#define ES_ALIGN(n)   __declspec ( align ( n ) )
+#else
+#define ES_ALIGN(n)   __attribute__ ( ( aligned ( n ) ) )
+#endif
+
 
 /// esCreateWindow flag - RGB color buffer
 #define ES_WINDOW_RGB           0
@@ -78,6 +85,51 @@ extern "C" {
 #define ES_WINDOW_STENCIL       4
 /// esCreateWindow flat - multi-sample buffer
 #define ES_WINDOW_MULTISAMPLE   8
+/// esCreateWindow flag - render offscreen without a native window
+#define ES_WINDOW_OFFSCREEN     16
+/// esContext flag - set by command line tools whose esMain does all the work without a window
+#define ES_WINDOW_NONE          32
+
+/// esLog level - detail for debugging
+#define ES_LOG_DEBUG            0
+/// esLog level - progress, the level of esLogMessage
+#define ES_LOG_INFO             1
+/// esLog level - something is off but the sample carries on
+#define ES_LOG_WARNING          2
+/// esLog level - something failed
+#define ES_LOG_ERROR            3
+/// esLogSetLevel level - no messages
+#define ES_LOG_NONE             4
+
+/// Least severe level compiled in, the esLogDebug to esLogError calls below it compile to nothing
+#ifndef ES_LOG_LEVEL
+#ifdef NDEBUG
+#define ES_LOG_LEVEL            ES_LOG_INFO
+#else
+#define ES_LOG_LEVEL            ES_LOG_DEBUG
+#endif
+#endif
+
+#if ES_LOG_LEVEL <= ES_LOG_DEBUG
+#define esLogDebug(...)         esLog ( ES_LOG_DEBUG, __VA_ARGS__ )
+#else
+#define esLogDebug(...)         ( ( void ) 0 )
+#endif
+#if ES_LOG_LEVEL <= ES_LOG_INFO
+#define esLogInfo(...)          esLog ( ES_LOG_INFO, __VA_ARGS__ )
+#else
+#define esLogInfo(...)          ( ( void ) 0 )
+#endif
+#if ES_LOG_LEVEL <= ES_LOG_WARNING
+#define esLogWarning(...)       esLog ( ES_LOG_WARNING, __VA_ARGS__ )
+#else
+#define esLogWarning(...)       ( ( void ) 0 )
+#endif
+#if ES_LOG_LEVEL <= ES_LOG_ERROR
+#define esLogError(...)         esLog ( ES_LOG_ERROR, __VA_ARGS__ )
+#else
+#define esLogError(...)         ( ( void ) 0 )
+#endif
 
 
 ///
@@ -95,6 +147,440 @@ typedef struct
    GLfloat   m[4][4];
 } ESMatrix;
 
+/// Same layout as ESMatrix but 16-byte aligned so that SIMD loads and stores
+/// never split a cache line.  Can be passed to any ESMatrix function with a cast.
+typedef struct
+{
+   ES_ALIGN ( 16 ) GLfloat m[4][4];
+} ESMatrixAligned;
+
+/// Number of regions in an ESBufferRing, one per frame the GPU may still be reading
+#define ES_BUFFER_RING_REGIONS  3
+
+/// A buffer object split into ES_BUFFER_RING_REGIONS regions, written round-robin
+typedef struct
+{
+   /// Buffer object and the target it is bound to for mapping
+   GLuint      buffer;
+   GLenum      target;
+
+   /// Size in bytes of each region
+   GLsizeiptr  regionSize;
+
+   /// Index and byte offset of the region mapped last
+   int         region;
+   GLintptr    offset;
+
+   /// Fence after the last GPU use of each region
+   GLsync      fences[ES_BUFFER_RING_REGIONS];
+
+   /// Number of times esBufferRingMap had to wait for the GPU
+   int         stalls;
+} ESBufferRing;
+
+/// Members of a C struct mirroring a GLSL std140 uniform block.  Declared in
+/// the order of the block, they get the std140 offsets at compile time: vec2
+/// is 8-byte aligned, vec3, vec4 and matrices 16-byte aligned, and array
+/// elements and matrix columns are padded to 16 bytes.  A float may still
+/// follow a vec3 in its last 4 bytes, as in std140.  A nested struct starts on
+/// 16 bytes and takes a multiple of 16, through an anonymous union with padding.
+#define ES_STD140_FLOAT(name)           GLfloat name
+#define ES_STD140_INT(name)             GLint name
+#define ES_STD140_UINT(name)            GLuint name
+#define ES_STD140_VEC2(name)            ES_ALIGN ( 8 ) GLfloat name[2]
+#define ES_STD140_VEC3(name)            ES_ALIGN ( 16 ) GLfloat name[3]
+#define ES_STD140_VEC4(name)            ES_ALIGN ( 16 ) GLfloat name[4]
+#define ES_STD140_IVEC4(name)           ES_ALIGN ( 16 ) GLint name[4]
+#define ES_STD140_MAT3(name)            ES_ALIGN ( 16 ) GLfloat name[3][4]
+#define ES_STD140_MAT4(name)            ES_ALIGN ( 16 ) GLfloat name[4][4]
+#define ES_STD140_FLOAT_ARRAY(name, n)  ES_ALIGN ( 16 ) GLfloat name[n][4]
+#define ES_STD140_VEC4_ARRAY(name, n)   ES_ALIGN ( 16 ) GLfloat name[n][4]
+#define ES_STD140_MAT4_ARRAY(name, n)   ES_ALIGN ( 16 ) GLfloat name[n][4][4]
+#define ES_STD140_STRUCT(type, name)    union { ES_ALIGN ( 16 ) type name; \
+                                                GLubyte name##Padding[( sizeof ( type ) + 15 ) & ~15]; }
+
+/// Fail to compile unless member of the std140 struct type is at offset, the
+/// offset GL reports for it (GL_UNIFORM_OFFSET)
+#define ES_STD140_CHECK(type, member, offset) \
+   typedef char ES_STD140_CHECK_##type##_##member[( offsetof ( type, member ) == ( offset ) ) ? 1 : -1]
+
+/// Uniform buffer ring, sub-allocated every frame for the uniform blocks of each draw
+typedef struct
+{
+   /// Buffer ring with one region per frame, bound to GL_UNIFORM_BUFFER
+   ESBufferRing ring;
+
+   /// GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, which every allocation starts on
+   GLint        alignment;
+
+   /// Region mapped by esUniformRingBegin and the bytes allocated from it
+   GLubyte     *mapped;
+   GLsizeiptr   used;
+
+   /// Number of allocations that did not fit in a region
+   int          overflows;
+} ESUniformRing;
+
+/// Per-instance transforms stored as structure-of-arrays
+typedef struct
+{
+   /// Number of instances
+   int         count;
+
+   /// Translation
+   GLfloat    *posX;
+   GLfloat    *posY;
+   GLfloat    *posZ;
+
+   /// Unit-length rotation axis
+   GLfloat    *axisX;
+   GLfloat    *axisY;
+   GLfloat    *axisZ;
+
+   /// Rotation angle in degrees
+   GLfloat    *angle;
+
+   /// Uniform scale
+   GLfloat    *scale;
+} ESInstanceData;
+
+/// Where and how fast an ESParticleSystem spawns particles
+typedef struct
+{
+   /// Center of the box new particles start in, and half its size
+   GLfloat     position[3];
+   GLfloat     spread;
+
+   /// Each velocity component is picked in [-speed, speed]
+   GLfloat     speed;
+
+   /// Lifetimes are picked in (0, maxLifetime) seconds
+   GLfloat     maxLifetime;
+} ESParticleEmitter;
+
+/// Read-only view of a whole file, see esMapFile
+typedef struct
+{
+   /// File contents
+   const unsigned char *data;
+   size_t               size;
+
+   /// Platform specific mapping handle
+   void                *handle;
+} ESMappedFile;
+
+/// Image loaded by esLoadTGAImage
+typedef struct
+{
+   int         width;
+   int         height;
+
+   /// 1, 3 or 4.  Channels are in file order, so BGR(A) for TGA.
+   int         bytesPerPixel;
+
+   /// GL_TRUE if the first row is the top of the image, GL_FALSE if it is the
+   /// bottom (the order glTexImage2D expects)
+   GLboolean   topDown;
+
+   /// Pixel rows, tightly packed.  Points into file when the image is stored
+   /// uncompressed, otherwise into decoded.
+   const void *pixels;
+
+   /// Private, released by esFreeImage
+   ESMappedFile file;
+   void       *decoded;
+} ESImage;
+
+/// Most levels in an ESMipChain, enough for 65535 texels across
+#define ES_MAX_MIP_LEVELS          16
+
+/// esGenMipChain flag - the color channels are sRGB encoded and are averaged in linear space
+#define ES_MIP_SRGB                1
+
+/// Mip chain built by esGenMipChain
+typedef struct
+{
+   int            levels;
+   int            width[ES_MAX_MIP_LEVELS];
+   int            height[ES_MAX_MIP_LEVELS];
+
+   /// Tightly packed rows of each level.  Level 0 is the source image, the others
+   /// point into data.
+   const GLubyte *pixels[ES_MAX_MIP_LEVELS];
+
+   /// 1, 3 or 4
+   int            bytesPerPixel;
+   GLboolean      srgb;
+
+   /// Private, released by esFreeMipChain
+   GLubyte       *data;
+} ESMipChain;
+
+/// Vertex attribute locations enabled in the vertex array of an ESPODMesh
+#define ES_POD_ATTRIB_POSITION     0
+#define ES_POD_ATTRIB_NORMAL       1
+#define ES_POD_ATTRIB_TANGENT      2
+#define ES_POD_ATTRIB_BINORMAL     3
+#define ES_POD_ATTRIB_TEXCOORD0    4
+#define ES_POD_ATTRIB_TEXCOORD1    5
+#define ES_POD_ATTRIB_COLOR        6
+#define ES_POD_ATTRIB_BONE_INDEX   7
+#define ES_POD_ATTRIB_BONE_WEIGHT  8
+#define ES_POD_NUM_ATTRIBS         9
+
+/// ESPODNode animFlags, set for each track that has a key per frame
+#define ES_POD_ANIM_POSITION       1
+#define ES_POD_ANIM_ROTATION       2
+#define ES_POD_ANIM_SCALE          4
+#define ES_POD_ANIM_MATRIX         8
+
+/// Layout of one vertex attribute in an ESPODMesh vertex buffer
+typedef struct
+{
+   /// Number of components, 0 if the mesh does not have the attribute
+   GLint       size;
+   GLenum      type;
+   GLboolean   normalized;
+
+   /// Byte offset within a vertex
+   GLsizei     offset;
+} ESPODAttrib;
+
+/// Mesh of a POD scene, drawn with glDrawElements ( GL_TRIANGLES, numIndices, GL_UNSIGNED_SHORT, 0 )
+/// while vertexArray is bound
+typedef struct
+{
+   GLuint      vertexArray;
+   GLuint      vertexBuffer;
+   GLuint      indexBuffer;
+
+   GLsizei     numVertices;
+   GLsizei     numIndices;
+
+   /// Interleaved vertex layout, attribute i is at location i
+   GLsizei     stride;
+   ESPODAttrib attribs[ES_POD_NUM_ATTRIBS];
+} ESPODMesh;
+
+/// Animation keys of a node, one per frame or a single one if not animated
+typedef struct
+{
+   const GLfloat *keys;
+   int            numKeys;
+} ESPODTrack;
+
+/// Node of a POD scene hierarchy
+typedef struct
+{
+   char       *name;
+
+   /// Mesh, light or camera index, depending on where the node sits in
+   /// ESPODScene nodes
+   int         object;
+
+   /// Material index, -1 if none
+   int         material;
+
+   /// Parent node index, -1 for root nodes
+   int         parent;
+
+   /// ES_POD_ANIM_* flags
+   int         animFlags;
+
+   /// Translation (3 floats per key), rotation quaternion (4), scale (3) and,
+   /// for ES_POD_ANIM_MATRIX nodes, the whole matrix (16)
+   ESPODTrack  position;
+   ESPODTrack  rotation;
+   ESPODTrack  scale;
+   ESPODTrack  matrix;
+} ESPODNode;
+
+/// Material of a POD scene
+typedef struct
+{
+   char       *name;
+
+   /// Indices into ESPODScene textures, -1 if none
+   int         diffuseTexture;
+   int         bumpTexture;
+
+   GLfloat     opacity;
+   GLfloat     ambient[3];
+   GLfloat     diffuse[3];
+   GLfloat     specular[3];
+   GLfloat     shininess;
+} ESPODMaterial;
+
+/// Scene loaded by esLoadPOD
+typedef struct
+{
+   GLfloat        backgroundColor[3];
+   GLfloat        ambientColor[3];
+
+   int            numFrames;
+   int            fps;
+
+   int            numMeshes;
+   ESPODMesh     *meshes;
+
+   /// The first numMeshNodes nodes instance meshes, the next numLights
+   /// lights and the next numCameras cameras.  Lights and cameras themselves
+   /// are not loaded.
+   int            numNodes;
+   int            numMeshNodes;
+   int            numLights;
+   int            numCameras;
+   ESPODNode     *nodes;
+
+   int            numMaterials;
+   ESPODMaterial *materials;
+
+   /// Texture file names
+   int            numTextures;
+   char         **textures;
+
+   /// Keys of every node track
+   GLfloat       *animation;
+   size_t         animationSize;
+} ESPODScene;
+
+/// Opaque threading primitives, see esThreadCreate, esMutexCreate and esConditionCreate
+typedef struct ESThread ESThread;
+typedef struct ESMutex ESMutex;
+typedef struct ESCondition ESCondition;
+
+/// Textures streamed in the background, see esTextureStreamCreate
+typedef struct ESTextureStream ESTextureStream;
+
+/// Program being compiled and linked asynchronously, see esLoadProgramAsync
+typedef struct ESAsyncProgram ESAsyncProgram;
+
+/// Active variables of a linked program, see esProgramReflect
+typedef struct ESProgramInfo ESProgramInfo;
+
+/// Kinds of program variables
+#define ES_PROGRAM_UNIFORM          0
+#define ES_PROGRAM_UNIFORM_BLOCK    1
+#define ES_PROGRAM_ATTRIB           2
+#define ES_PROGRAM_VARYING          3
+
+/// An active uniform, uniform block, attribute or transform feedback varying of a program
+typedef struct
+{
+   /// Name, without the [0] the GL gives arrays, and its hash
+   const char *name;
+   GLuint      hash;
+
+   /// One of the ES_PROGRAM_ kinds
+   GLenum      kind;
+
+   /// Type and number of array elements, type 0 for uniform blocks
+   GLenum      type;
+   GLint       size;
+
+   /// Location of uniforms outside blocks and of attributes, -1 for uniforms in blocks,
+   /// index of uniform blocks and varyings
+   GLint       location;
+
+   /// Uniforms in blocks: index of the block, byte offset, array and matrix strides, -1 otherwise
+   GLint       block;
+   GLint       offset;
+   GLint       arrayStride;
+   GLint       matrixStride;
+
+   /// Uniform blocks: size of the data in bytes and the binding point given to it, -1 otherwise
+   GLint       dataSize;
+   GLint       binding;
+} ESProgramVariable;
+
+/// Resource loading thread with a shared context, see esLoaderCreate
+typedef struct ESLoader ESLoader;
+
+/// CPU particle simulation, see esParticleSystemCreate
+typedef struct ESParticleSystem ESParticleSystem;
+
+/// GPU particles updated with transform feedback, see esParticleFeedbackCreate
+typedef struct ESParticleFeedback ESParticleFeedback;
+
+/// Time spent on one frame of the main loop, in milliseconds
+typedef struct
+{
+   /// In updateFunc, drawFunc and eglSwapBuffers
+   GLfloat     update;
+   GLfloat     draw;
+   GLfloat     swap;
+
+   /// Since the end of the previous frame, including event handling
+   GLfloat     total;
+
+   /// GPU time of the profiler scopes, negative until known, see esProfilerEnable
+   GLfloat     gpu;
+} ESFrameTime;
+
+/// Frame time statistics over the most recent frames, see esGetFrameStats
+typedef struct
+{
+   /// Frames the statistics cover, and frames recorded since the loop started
+   int          numFrames;
+   unsigned int totalFrames;
+
+   /// Percentiles and maximum of the total frame time, in milliseconds
+   GLfloat      p50;
+   GLfloat      p95;
+   GLfloat      p99;
+   GLfloat      max;
+
+   /// Mean time spent in updateFunc, drawFunc and eglSwapBuffers, in milliseconds
+   GLfloat      update;
+   GLfloat      draw;
+   GLfloat      swap;
+
+   /// Mean GPU time of the frames the profiler timed, 0 without GPU timing
+   GLfloat      gpu;
+} ESFrameStats;
+
+/// Frame times recorded by the main loop, see esGetFrameStats
+typedef struct ESFrameHistory ESFrameHistory;
+
+/// GL calls made through the state cache, see esStateUseProgram
+typedef struct
+{
+   /// Calls passed on to the GL, and dropped as redundant, in the last frame
+   unsigned int issued;
+   unsigned int elided;
+
+   /// The same since the start, and the frames they cover
+   double       totalIssued;
+   double       totalElided;
+   unsigned int frames;
+} ESStateStats;
+
+/// Timing of a profiler scope, see esProfilerGetScope
+typedef struct
+{
+   const char  *name;
+
+   /// Scopes open around the first instance of this one
+   int          depth;
+
+   /// Instances timed on the CPU, and on the GPU
+   int          count;
+   int          gpuCount;
+
+   /// Last and running average times in milliseconds, GPU times are
+   /// negative while there is none
+   GLfloat      cpuLast;
+   GLfloat      gpuLast;
+   GLfloat      cpuAverage;
+   GLfloat      gpuAverage;
+} ESProfilerScope;
+
+/// Scope profiler, see esProfilerEnable
+typedef struct ESProfiler ESProfiler;
+
+/// Update thread and double-buffered frame state, see esPipelineEnable
+typedef struct ESPipeline ESPipeline;
+
 typedef struct ESContext ESContext;
 
 struct ESContext
@@ -111,6 +597,13 @@ struct ESContext
    /// Window height
    GLint       height;
 
+   /// Window creation flags passed to esCreateWindow
+   GLuint      flags;
+
+   /// Command line arguments, argc is 0 on platforms without a command line
+   int         argc;
+   char      **argv;
+
 #ifndef __APPLE__
    /// Display handle
    EGLNativeDisplayType eglNativeDisplay;
@@ -129,8 +622,30 @@ struct ESContext
 
    /// EGL config
    EGLConfig eglConfig;
+
+   /// Framebuffer object standing in for the window surface when rendering
+   /// offscreen on a surfaceless context, 0 otherwise
+   GLuint      offscreenFramebuffer;
 #endif
 
+   /// Frame times recorded by the main loop, see esGetFrameStats
+   ESFrameHistory *frameHistory;
+
+   /// Scope profiler, NULL until esProfilerEnable
+   ESProfiler *profiler;
+
+   /// Time step of updateFunc in seconds, 0 to update once per frame, see esSetFixedTimestep
+   GLfloat     fixedTimestep;
+   int         maxUpdateSteps;
+
+   /// Time left over after the fixed updates of the frame, and the same as a fraction of
+   /// fixedTimestep: drawFunc can draw that far between the last update and the next
+   GLfloat     updateAccumulator;
+   GLfloat     interpolation;
+
+   /// Update running one frame ahead on another thread, NULL until esPipelineEnable
+   ESPipeline *pipeline;
+
    /// Callbacks
    void ( ESCALLBACK *drawFunc ) ( ESContext * );
    void ( ESCALLBACK *shutdownFunc ) ( ESContext * );
@@ -155,6 +670,11 @@ struct ESContext
 ///         ES_WINDOW_DEPTH   - specifies that a depth buffer should be created
 ///         ES_WINDOW_STENCIL - specifies that a stencil buffer should be created
 ///         ES_WINDOW_MULTISAMPLE - specifies that a multi-sample buffer should be created
+///         ES_WINDOW_OFFSCREEN - specifies that rendering goes to a pbuffer (or, failing that,
+///                               a framebuffer object on a surfaceless context) instead of a
+///                               window.  Also enabled by setting the ES_OFFSCREEN environment variable,
+///                               or ES_BENCHMARK, which runs the loop with a fixed time step
+///                               and appends JSON results to the file it names.
 /// \return GL_TRUE if window creation is succesful, GL_FALSE otherwise
 GLboolean ESUTIL_API esCreateWindow ( ESContext *esContext, const char *title, GLint width, GLint height, GLuint flags );
 
@@ -179,6 +699,46 @@ void ESUTIL_API esRegisterShutdownFunc ( ESContext *esContext, void ( ESCALLBACK
 //
 void ESUTIL_API esRegisterUpdateFunc ( ESContext *esContext, void ( ESCALLBACK *updateFunc ) ( ESContext *, float ) );
 
+//
+/// \brief Call the update function in fixed time steps rather than once per frame.  The main loop
+///        accumulates frame time and runs as many steps as it covers, at most maxSteps, then sets
+///        esContext->interpolation for the draw function.  Also enabled by setting ES_UPDATE_RATE
+///        to a number of updates per second.
+/// \param esContext Application context
+/// \param timestep Time step in seconds, 0 to go back to one update per frame
+/// \param maxSteps Most updates per frame, 0 for the default of 8.  Time past that is dropped,
+///        so a slow frame cannot fall further behind.
+//
+void ESUTIL_API esSetFixedTimestep ( ESContext *esContext, GLfloat timestep, int maxSteps );
+
+//
+/// \brief Run the update function on its own thread, one frame ahead of the draw function.  While
+///        frame N is drawn, the update for frame N + 1 writes the other half of a double-buffered
+///        frame state, which the draw function gets at the next frame.  The update function must
+///        then not call GL or the profiler, and should hand everything the draw function needs
+///        through the frame state.  Setting ES_PIPELINE=0 keeps the double buffering but runs the
+///        updates on the main thread, to compare the two.
+/// \param esContext Application context
+/// \param stateSize Size in bytes of one frame state, zeroed at first
+/// \return GL_FALSE if out of memory
+//
+GLboolean ESUTIL_API esPipelineEnable ( ESContext *esContext, size_t stateSize );
+
+//
+/// \brief Frame state for the update function to write.  It still holds the state of two updates
+///        ago, anything that must carry over between updates belongs in userData.
+/// \param esContext Application context
+/// \return Frame state, NULL unless esPipelineEnable was called
+//
+void *ESUTIL_API esPipelineUpdateState ( ESContext *esContext );
+
+//
+/// \brief Frame state the last finished update wrote, for the draw function to read
+/// \param esContext Application context
+/// \return Frame state, NULL unless esPipelineEnable was called
+//
+const void *ESUTIL_API esPipelineDrawState ( ESContext *esContext );
+
 //
 /// \brief Register a keyboard input processing callback function
 /// \param esContext Application context
@@ -187,124 +747,537 @@ void ESUTIL_API esRegisterUpdateFunc ( ESContext *esContext, void ( ESCALLBACK *
 void ESUTIL_API esRegisterKeyFunc ( ESContext *esContext,
                                     void ( ESCALLBACK *drawFunc ) ( ESContext *, unsigned char, int, int ) );
 //
-/// \brief Log a message to the debug output for the platform
-/// \param formatStr Format string for error log.
+/// \brief Return a monotonic, high-resolution time in seconds
 //
-void ESUTIL_API esLogMessage ( const char *formatStr, ... );
+double ESUTIL_API esGetTime ( void );
 
 //
-///
-/// \brief Load a shader, check for compile errors, print error messages to output log
-/// \param type Type of shader (GL_VERTEX_SHADER or GL_FRAGMENT_SHADER)
-/// \param shaderSrc Shader source string
-/// \return A new shader object on success, 0 on failure
+/// \brief Compute frame time statistics over the last frames of the main loop (up to 1024).  The
+///        main loop records every frame without locking, so this can be called from any thread.
+/// \param esContext Application context
+/// \param stats Returned statistics
+/// \return GL_FALSE if no frame has been recorded yet
 //
-GLuint ESUTIL_API esLoadShader ( GLenum type, const char *shaderSrc );
+GLboolean ESUTIL_API esGetFrameStats ( ESContext *esContext, ESFrameStats *stats );
 
 //
-///
-/// \brief Load a vertex and fragment shader, create a program object, link program.
-///        Errors output to log.
-/// \param vertShaderSrc Vertex shader source code
-/// \param fragShaderSrc Fragment shader source code
-/// \return A new program object linked with the vertex/fragment shader pair, 0 on failure
+/// \brief Write frame time statistics every interval frames and when the main loop ends.  The
+///        ES_FRAME_STATS and ES_FRAME_STATS_INTERVAL environment variables set the same thing.
+/// \param esContext Application context
+/// \param fileName File to write, JSON lines if it ends in .json and CSV otherwise.  "-" sends
+///        the statistics to esLogMessage, NULL stops the output.
+/// \param interval Frames between two writes, 0 for the default of 300
+/// \return GL_FALSE if the file cannot be opened
 //
-GLuint ESUTIL_API esLoadProgram ( const char *vertShaderSrc, const char *fragShaderSrc );
-
+GLboolean ESUTIL_API esFrameStatsOutput ( ESContext *esContext, const char *fileName, int interval );
 
 //
-/// \brief Generates geometry for a sphere.  Allocates memory for the vertex data and stores
-///        the results in the arrays.  Generate index list for a TRIANGLE_STRIP
-/// \param numSlices The number of slices in the sphere
-/// \param vertices If not NULL, will contain array of float3 positions
-/// \param normals If not NULL, will contain array of float3 normals
-/// \param texCoords If not NULL, will contain array of float2 texCoords
-/// \param indices If not NULL, will contain the array of indices for the triangle strip
-/// \return The number of indices required for rendering the buffers (the number of indices stored in the indices array
-///         if it is not NULL ) as a GL_TRIANGLE_STRIP
+/// \brief Start timing the scopes between esProfilerBegin and esProfilerEnd on the CPU, and on
+///        the GPU with GL_EXT_disjoint_timer_query.  GPU times are read back a few frames late
+///        without waiting, and their sum per frame goes into the frame statistics.  Setting the
+///        ES_PROFILE environment variable to a file name enables it in esCreateWindow.
+/// \param esContext Application context
+/// \param traceFile Chrome trace (chrome://tracing, Perfetto) written when the main loop ends,
+///        or NULL
+/// \return GL_FALSE if out of memory
 //
-int ESUTIL_API esGenSphere ( int numSlices, float radius, GLfloat **vertices, GLfloat **normals,
-                             GLfloat **texCoords, GLuint **indices );
+GLboolean ESUTIL_API esProfilerEnable ( ESContext *esContext, const char *traceFile );
 
 //
-/// \brief Generates geometry for a cube.  Allocates memory for the vertex data and stores
-///        the results in the arrays.  Generate index list for a TRIANGLES
-/// \param scale The size of the cube, use 1.0 for a unit cube.
-/// \param vertices If not NULL, will contain array of float3 positions
-/// \param normals If not NULL, will contain array of float3 normals
-/// \param texCoords If not NULL, will contain array of float2 texCoords
-/// \param indices If not NULL, will contain the array of indices for the triangle strip
-/// \return The number of indices required for rendering the buffers (the number of indices stored in the indices array
-///         if it is not NULL ) as a GL_TRIANGLES
+/// \brief Open a profiler scope, does nothing unless the profiler is enabled.  Scopes nest, and
+///        the ones still open at the end of the frame are closed there.
+/// \param esContext Application context
+/// \param name Name of the scope, must stay valid as long as the profiler
 //
-int ESUTIL_API esGenCube ( float scale, GLfloat **vertices, GLfloat **normals,
-                           GLfloat **texCoords, GLuint **indices );
+void ESUTIL_API esProfilerBegin ( ESContext *esContext, const char *name );
 
 //
-/// \brief Generates a square grid consisting of triangles.  Allocates memory for the vertex data and stores
-///        the results in the arrays.  Generate index list as TRIANGLES.
-/// \param size create a grid of size by size (number of triangles = (size-1)*(size-1)*2)
-/// \param vertices If not NULL, will contain array of float3 positions
-/// \param indices If not NULL, will contain the array of indices for the triangle strip
-/// \return The number of indices required for rendering the buffers (the number of indices stored in the indices array
-///         if it is not NULL ) as a GL_TRIANGLES
+/// \brief Close the profiler scope opened last
+/// \param esContext Application context
 //
-int ESUTIL_API esGenSquareGrid ( int size, GLfloat **vertices, GLuint **indices );
+void ESUTIL_API esProfilerEnd ( ESContext *esContext );
 
 //
-/// \brief Loads a 8-bit, 24-bit or 32-bit TGA image from a file
-/// \param ioContext Context related to IO facility on the platform
-/// \param fileName Name of the file on disk
-/// \param width Width of loaded image in pixels
-/// \param height Height of loaded image in pixels
-///  \return Pointer to loaded image.  NULL on failure.
+/// \brief Get the timing of a profiler scope
+/// \param esContext Application context
+/// \param name Name of the scope
+/// \param scope Returned timing
+/// \return GL_FALSE if no such scope has been timed yet
 //
-char *ESUTIL_API esLoadTGA ( void *ioContext, const char *fileName, int *width, int *height );
+GLboolean ESUTIL_API esProfilerGetScope ( ESContext *esContext, const char *name, ESProfilerScope *scope );
 
+//
+/// \brief Write the latest profiler scopes and frames as a Chrome trace, CPU and GPU on two tracks
+/// \param esContext Application context
+/// \param fileName File to write
+/// \return GL_FALSE if no trace file was given to esProfilerEnable, or fileName cannot be opened
+//
+GLboolean ESUTIL_API esProfilerWriteTrace ( ESContext *esContext, const char *fileName );
 
 //
-/// \brief Multiply matrix specified by result with a scaling matrix and return new matrix in result
-/// \param result Specifies the input matrix.  Scaled matrix is returned in result.
-/// \param sx, sy, sz Scale factors along the x, y and z axes respectively
+/// \brief Log a message to the debug output for the platform, at ES_LOG_INFO.  Messages are
+///        queued without locking and written out by a flusher thread, in the order they were
+///        logged across threads.  A thread whose queue is full writes the queued messages out
+///        itself, so none are lost.
+/// \param formatStr Format string for error log.
 //
-void ESUTIL_API esScale ( ESMatrix *result, GLfloat sx, GLfloat sy, GLfloat sz );
+void ESUTIL_API esLogMessage ( const char *formatStr, ... );
 
 //
-/// \brief Multiply matrix specified by result with a translation matrix and return new matrix in result
-/// \param result Specifies the input matrix.  Translated matrix is returned in result.
-/// \param tx, ty, tz Scale factors along the x, y and z axes respectively
+/// \brief Log a message at a severity level, see also the esLogDebug, esLogInfo, esLogWarning
+///        and esLogError macros which compile to nothing below ES_LOG_LEVEL
+/// \param level ES_LOG_DEBUG, ES_LOG_INFO, ES_LOG_WARNING or ES_LOG_ERROR
+/// \param formatStr Format string for the message
 //
-void ESUTIL_API esTranslate ( ESMatrix *result, GLfloat tx, GLfloat ty, GLfloat tz );
+void ESUTIL_API esLog ( int level, const char *formatStr, ... );
 
 //
-/// \brief Multiply matrix specified by result with a rotation matrix and return new matrix in result
-/// \param result Specifies the input matrix.  Rotated matrix is returned in result.
-/// \param angle Specifies the angle of rotation, in degrees.
-/// \param x, y, z Specify the x, y and z coordinates of a vector, respectively
+/// \brief Set the least severe level written at run time.  Also set by the ES_LOG_LEVEL
+///        environment variable, to debug, info, warning, error or none.
+/// \param level ES_LOG_DEBUG to ES_LOG_ERROR, or ES_LOG_NONE to write no messages
 //
-void ESUTIL_API esRotate ( ESMatrix *result, GLfloat angle, GLfloat x, GLfloat y, GLfloat z );
+void ESUTIL_API esLogSetLevel ( int level );
 
 //
-/// \brief Multiply matrix specified by result with a perspective matrix and return new matrix in result
-/// \param result Specifies the input matrix.  New matrix is returned in result.
-/// \param left, right Coordinates for the left and right vertical clipping planes
-/// \param bottom, top Coordinates for the bottom and top horizontal clipping planes
-/// \param nearZ, farZ Distances to the near and far depth clipping planes.  Both distances must be positive.
+/// \brief Hold each thread to a number of messages per second, and as many at once after a quiet
+///        second.  Messages over the limit are dropped and counted, errors are never held back.
+///        Off unless called or the ES_LOG_RATE_LIMIT environment variable is set.
+/// \param messagesPerSecond Messages a thread can log per second, 0 for no limit
 //
-void ESUTIL_API esFrustum ( ESMatrix *result, float left, float right, float bottom, float top, float nearZ, float farZ );
+void ESUTIL_API esLogSetRateLimit ( int messagesPerSecond );
 
 //
-/// \brief Multiply matrix specified by result with a perspective matrix and return new matrix in result
-/// \param result Specifies the input matrix.  New matrix is returned in result.
-/// \param fovy Field of view y angle in degrees
-/// \param aspect Aspect ratio of screen
-/// \param nearZ Near plane distance
-/// \param farZ Far plane distance
+/// \brief Write out the messages logged so far, before returning
 //
-void ESUTIL_API esPerspective ( ESMatrix *result, float fovy, float aspect, float nearZ, float farZ );
+void ESUTIL_API esLogFlush ( void );
 
 //
-/// \brief Multiply matrix specified by result with a perspective matrix and return new matrix in result
+///
+/// \brief Load a shader, check for compile errors, print error messages to output log
+/// \param type Type of shader (GL_VERTEX_SHADER or GL_FRAGMENT_SHADER)
+/// \param shaderSrc Shader source string
+/// \return A new shader object on success, 0 on failure
+//
+GLuint ESUTIL_API esLoadShader ( GLenum type, const char *shaderSrc );
+
+//
+///
+/// \brief Load a vertex and fragment shader, create a program object, link program.
+///        Errors output to log.
+/// \param vertShaderSrc Vertex shader source code
+/// \param fragShaderSrc Fragment shader source code
+/// \return A new program object linked with the vertex/fragment shader pair, 0 on failure
+//
+GLuint ESUTIL_API esLoadProgram ( const char *vertShaderSrc, const char *fragShaderSrc );
+
+//
+///
+/// \brief Start compiling and linking a program without checking the result, so that the driver
+///        can compile in the background (in parallel with KHR_parallel_shader_compile).  Issue
+///        every program first, then call esProgramWait on each.
+/// \param vertShaderSrc Vertex shader source code
+/// \param fragShaderSrc Fragment shader source code
+/// \return Handle to pass to esProgramReady and esProgramWait, NULL on failure
+//
+ESAsyncProgram *ESUTIL_API esLoadProgramAsync ( const char *vertShaderSrc, const char *fragShaderSrc );
+
+//
+///
+/// \brief Same as esLoadProgramAsync, with transform feedback varyings set before linking
+/// \param numVaryings Number of transform feedback varyings
+/// \param varyings Names of the varyings
+/// \param bufferMode GL_INTERLEAVED_ATTRIBS or GL_SEPARATE_ATTRIBS
+//
+ESAsyncProgram *ESUTIL_API esLoadProgramFeedbackAsync ( const char *vertShaderSrc, const char *fragShaderSrc,
+                                                        GLsizei numVaryings, const char *const *varyings,
+                                                        GLenum bufferMode );
+
+//
+///
+/// \brief Check without blocking whether an asynchronous program has finished linking.  Always
+///        GL_TRUE without KHR_parallel_shader_compile, since the status cannot be polled.
+/// \param program Handle returned by esLoadProgramAsync
+/// \return GL_TRUE if esProgramWait will not block on the compiler
+//
+GLboolean ESUTIL_API esProgramReady ( ESAsyncProgram *program );
+
+//
+///
+/// \brief Wait for an asynchronous program, log any compile or link errors and free the handle
+/// \param program Handle returned by esLoadProgramAsync
+/// \return The linked program object, 0 on failure
+//
+GLuint ESUTIL_API esProgramWait ( ESAsyncProgram *program );
+
+//
+///
+/// \brief Enable the on-disk program binary cache used by esLoadProgram.  Linked programs are saved
+///        with glGetProgramBinary, keyed by a hash of the shader sources, GL_RENDERER and GL_VERSION,
+///        and reloaded with glProgramBinary on later runs.  The entries are kept like those of
+///        esAssetCacheInit.  If this is never called, the ES_PROGRAM_CACHE_DIR environment
+///        variable is used instead.  Not available on Android and iOS.
+/// \param directory Directory for the cache files, created if missing.  NULL disables the cache.
+//
+void ESUTIL_API esProgramCacheInit ( const char *directory );
+
+//
+///
+/// \brief Get the program binary cache counters
+/// \param hits If not NULL, returns the number of programs loaded from the cache
+/// \param misses If not NULL, returns the number of programs compiled from source while the cache was enabled
+//
+void ESUTIL_API esProgramCacheGetStats ( int *hits, int *misses );
+
+//
+/// \brief Same as esProgramWait, also returning the active variables of the program.  Programs
+///        loaded from the program binary cache are described by the table stored with them,
+///        without any query.  Uniform blocks are bound as by esProgramReflect.
+/// \param program Handle returned by esLoadProgramAsync
+/// \return Table to free with esProgramInfoFree, holding the program object (see esProgramInfoProgram),
+///         NULL on failure
+//
+ESProgramInfo *ESUTIL_API esProgramWaitInfo ( ESAsyncProgram *program );
+
+//
+/// \brief Query the active uniforms, uniform blocks, attributes and transform feedback varyings of a
+///        linked program into a flat table with hashed names.  Uniform block i is bound to binding
+///        point i.
+/// \param programObject Linked program
+/// \return Table to free with esProgramInfoFree, NULL on failure
+//
+ESProgramInfo *ESUTIL_API esProgramReflect ( GLuint programObject );
+
+//
+/// \brief Return the program object a table describes
+//
+GLuint ESUTIL_API esProgramInfoProgram ( const ESProgramInfo *info );
+
+//
+/// \brief Find an active variable by name, in constant time
+/// \param info Program table
+/// \param kind ES_PROGRAM_UNIFORM, ES_PROGRAM_UNIFORM_BLOCK, ES_PROGRAM_ATTRIB or ES_PROGRAM_VARYING
+/// \param name Name of the variable, with or without [0] for arrays
+/// \return The variable, valid until the table is freed, NULL if it is not active
+//
+const ESProgramVariable *ESUTIL_API esProgramFind ( const ESProgramInfo *info, GLenum kind, const char *name );
+
+//
+/// \brief Find an active uniform, see esProgramFind
+//
+const ESProgramVariable *ESUTIL_API esProgramUniform ( const ESProgramInfo *info, const char *name );
+
+//
+/// \brief Find an active uniform block, see esProgramFind
+//
+const ESProgramVariable *ESUTIL_API esProgramUniformBlock ( const ESProgramInfo *info, const char *name );
+
+//
+/// \brief Find an active attribute, see esProgramFind
+//
+const ESProgramVariable *ESUTIL_API esProgramAttrib ( const ESProgramInfo *info, const char *name );
+
+//
+/// \brief Find a transform feedback varying, see esProgramFind
+//
+const ESProgramVariable *ESUTIL_API esProgramVarying ( const ESProgramInfo *info, const char *name );
+
+//
+/// \brief Return the location of a uniform outside any block, -1 if it is not active, like
+///        glGetUniformLocation without the query
+//
+GLint ESUTIL_API esProgramUniformLocation ( const ESProgramInfo *info, const char *name );
+
+//
+/// \brief Return the number of variables of a kind
+//
+int ESUTIL_API esProgramCount ( const ESProgramInfo *info, GLenum kind );
+
+//
+/// \brief Return a variable of a kind by index, from 0 to esProgramCount - 1, in the order the GL
+///        lists them
+//
+const ESProgramVariable *ESUTIL_API esProgramGet ( const ESProgramInfo *info, GLenum kind, int index );
+
+//
+/// \brief Free a table, the program object is left alone
+//
+void ESUTIL_API esProgramInfoFree ( ESProgramInfo *info );
+
+//
+///
+/// \brief Enable the on-disk cache of generated assets, such as esCreateNoise3DTexture volumes.
+///        Entries are keyed by a hash of the inputs that determine them and memory-mapped on
+///        later runs.  If this is never called, the ES_ASSET_CACHE_DIR environment variable is
+///        used instead.  Not available on Android and iOS.
+/// \param directory Directory for the cache files, created if missing.  NULL disables the cache.
+//
+void ESUTIL_API esAssetCacheInit ( const char *directory );
+
+//
+///
+/// \brief Hash the inputs of an asset into a cache key, 64-bit FNV-1a
+/// \param hash Key to continue from, 0 to start a new one
+/// \param data Input bytes
+/// \param size Number of bytes
+/// \return The key
+//
+unsigned long long ESUTIL_API esAssetCacheKey ( unsigned long long hash, const void *data, size_t size );
+
+//
+///
+/// \brief Map an asset from the cache
+/// \param key Key from esAssetCacheKey
+/// \param size Size the data must have
+/// \param file Receives the mapping, release it with esUnmapFile once the data is used
+/// \return The cached data inside the mapping, NULL if the cache is disabled or has no such entry
+//
+const void *ESUTIL_API esAssetCacheMap ( unsigned long long key, size_t size, ESMappedFile *file );
+
+//
+///
+/// \brief Store an asset in the cache, replacing any entry with the same key
+/// \param key Key from esAssetCacheKey
+/// \param data Data to store
+/// \param size Number of bytes
+/// \return GL_FALSE if the cache is disabled or the file cannot be written
+//
+GLboolean ESUTIL_API esAssetCacheStore ( unsigned long long key, const void *data, size_t size );
+
+//
+///
+/// \brief Get the asset cache counters
+/// \param hits If not NULL, returns the number of assets mapped from the cache
+/// \param misses If not NULL, returns the number of assets looked up and not found while the cache was enabled
+//
+void ESUTIL_API esAssetCacheGetStats ( int *hits, int *misses );
+
+
+//
+/// \brief Generates geometry for a sphere.  Allocates memory for the vertex data and stores
+///        the results in the arrays.  Generate index list for a TRIANGLE_STRIP
+/// \param numSlices The number of slices in the sphere
+/// \param vertices If not NULL, will contain array of float3 positions
+/// \param normals If not NULL, will contain array of float3 normals
+/// \param texCoords If not NULL, will contain array of float2 texCoords
+/// \param indices If not NULL, will contain the array of indices for the triangle strip
+/// \return The number of indices required for rendering the buffers (the number of indices stored in the indices array
+///         if it is not NULL ) as a GL_TRIANGLE_STRIP
+//
+int ESUTIL_API esGenSphere ( int numSlices, float radius, GLfloat **vertices, GLfloat **normals,
+                             GLfloat **texCoords, GLuint **indices );
+
+//
+/// \brief Generates geometry for a cube.  Allocates memory for the vertex data and stores
+///        the results in the arrays.  Generate index list for a TRIANGLES
+/// \param scale The size of the cube, use 1.0 for a unit cube.
+/// \param vertices If not NULL, will contain array of float3 positions
+/// \param normals If not NULL, will contain array of float3 normals
+/// \param texCoords If not NULL, will contain array of float2 texCoords
+/// \param indices If not NULL, will contain the array of indices for the triangle strip
+/// \return The number of indices required for rendering the buffers (the number of indices stored in the indices array
+///         if it is not NULL ) as a GL_TRIANGLES
+//
+int ESUTIL_API esGenCube ( float scale, GLfloat **vertices, GLfloat **normals,
+                           GLfloat **texCoords, GLuint **indices );
+
+//
+/// \brief Generates a square grid consisting of triangles.  Allocates memory for the vertex data and stores
+///        the results in the arrays.  Generate index list as TRIANGLES.
+/// \param size create a grid of size by size (number of triangles = (size-1)*(size-1)*2)
+/// \param vertices If not NULL, will contain array of float3 positions
+/// \param indices If not NULL, will contain the array of indices for the triangle strip
+/// \return The number of indices required for rendering the buffers (the number of indices stored in the indices array
+///         if it is not NULL ) as a GL_TRIANGLES
+//
+int ESUTIL_API esGenSquareGrid ( int size, GLfloat **vertices, GLuint **indices );
+
+//
+/// \brief Generates a volume of 3D gradient noise, normalized to the [0, 255] range.  Rows are
+///        evaluated with SIMD and slabs split across the esParallelFor threads.
+/// \param volume Returns size * size * size bytes, x varying fastest
+/// \param size Size of the volume along each axis
+/// \param frequency Number of noise lattice cells across the volume
+/// \return GL_FALSE if the arguments are invalid or memory runs out
+//
+GLboolean ESUTIL_API esGenNoise3D ( GLubyte *volume, int size, float frequency );
+
+//
+/// \brief Create a GL_R8 3D texture from esGenNoise3D, with linear filtering and mirrored repeat.
+///        The volume is kept in the asset cache when it is enabled, see esAssetCacheInit.
+/// \param size Size of the texture along each axis
+/// \param frequency Number of noise lattice cells across the texture
+/// \return The texture object, 0 on failure
+//
+GLuint ESUTIL_API esCreateNoise3DTexture ( int size, float frequency );
+
+//
+/// \brief Loads a 8-bit, 24-bit or 32-bit TGA image from a file into a copy with the bottom row
+///        first, whatever the origin of the file.  Use esLoadTGAImage to avoid the copy.
+/// \param ioContext Context related to IO facility on the platform
+/// \param fileName Name of the file on disk
+/// \param width Width of loaded image in pixels
+/// \param height Height of loaded image in pixels
+///  \return Pointer to loaded image, release with free().  NULL on failure.
+//
+char *ESUTIL_API esLoadTGA ( void *ioContext, const char *fileName, int *width, int *height );
+
+//
+/// \brief Map a whole file read-only into memory (mmap, MapViewOfFile, or the asset buffer on Android)
+/// \param ioContext Context related to IO facility on the platform
+/// \param fileName Name of the file on disk
+/// \param file Receives the mapping
+/// \return GL_TRUE on success
+//
+GLboolean ESUTIL_API esMapFile ( void *ioContext, const char *fileName, ESMappedFile *file );
+
+//
+/// \brief Unmap a file mapped with esMapFile
+//
+void ESUTIL_API esUnmapFile ( ESMappedFile *file );
+
+//
+/// \brief Load an 8-bit, 24-bit or 32-bit TGA image, including RLE and color mapped images.
+///        Uncompressed pixels are not copied: image->pixels points into the mapped file and can
+///        be passed directly to glTexImage2D.  Rows are not reordered, check image->topDown.
+/// \param ioContext Context related to IO facility on the platform
+/// \param fileName Name of the file on disk
+/// \param image Receives the image, release with esFreeImage
+/// \return GL_TRUE on success
+//
+GLboolean ESUTIL_API esLoadTGAImage ( void *ioContext, const char *fileName, ESImage *image );
+
+//
+/// \brief Release an image loaded with esLoadTGAImage
+//
+void ESUTIL_API esFreeImage ( ESImage *image );
+
+//
+/// \brief Build the mip chain of an image down to 1x1, into a single allocation.  Each level is a
+///        box filter of the previous one: 2x2 texels, or 3 along an odd dimension, so non-power-
+///        of-two sizes work.  Linear formats are averaged with integer SIMD, and the rows of each
+///        level are split across the esParallelFor threads.
+/// \param chain Receives the levels, release with esFreeMipChain
+/// \param pixels Level 0, tightly packed rows.  Must stay valid while the chain is used.
+/// \param width Width of level 0 in pixels
+/// \param height Height of level 0 in pixels
+/// \param bytesPerPixel 1 for R8, 3 for RGB8 or 4 for RGBA8
+/// \param flags ES_MIP_SRGB to filter the color channels in linear space, alpha is always linear
+/// \return GL_FALSE if the arguments are invalid or memory runs out
+//
+GLboolean ESUTIL_API esGenMipChain ( ESMipChain *chain, const GLubyte *pixels, int width, int height,
+                                     int bytesPerPixel, GLuint flags );
+
+//
+/// \brief Load every level of a mip chain into the texture bound to target, as GL_R8, GL_RGB8 or
+///        GL_RGBA8, or GL_SRGB8 and GL_SRGB8_ALPHA8 for chains built with ES_MIP_SRGB
+/// \param target GL_TEXTURE_2D or a cube map face
+/// \param chain Mip chain from esGenMipChain
+//
+void ESUTIL_API esTexImageMipChain ( GLenum target, const ESMipChain *chain );
+
+//
+/// \brief Release a mip chain built with esGenMipChain
+//
+void ESUTIL_API esFreeMipChain ( ESMipChain *chain );
+
+//
+/// \brief Load a KTX 1.1 file (2D or cube map) into a new texture.  Every mip level in the file is
+///        uploaded, compressed formats such as ETC2/EAC with glCompressedTexImage2D, straight from
+///        the mapped file.
+/// \param ioContext Context related to IO facility on the platform
+/// \param fileName Name of the file on disk
+/// \param width If not NULL, returns the width of the base level in pixels
+/// \param height If not NULL, returns the height of the base level in pixels
+/// \return New texture object, bound to GL_TEXTURE_2D or GL_TEXTURE_CUBE_MAP.  0 on failure.
+//
+GLuint ESUTIL_API esLoadKTX ( void *ioContext, const char *fileName, int *width, int *height );
+
+//
+///
+/// \brief Load a PVR file, version 2 (legacy PVRTexTool) or 3, into a new texture.  Every mip level
+///        and cube map face is uploaded straight from the mapped file, and compressed formats stay
+///        compressed.  Formats the driver cannot sample, such as PVRTC without
+///        GL_IMG_texture_compression_pvrtc, are reported to the log and fail the load.
+/// \param ioContext Context related to IO facility on the platform
+/// \param fileName Name of the file on disk
+/// \param width If not NULL, returns the width of the base level in pixels
+/// \param height If not NULL, returns the height of the base level in pixels
+/// \return New texture object, bound to GL_TEXTURE_2D or GL_TEXTURE_CUBE_MAP.  0 on failure.
+//
+GLuint ESUTIL_API esLoadPVR ( void *ioContext, const char *fileName, int *width, int *height );
+
+//
+///
+/// \brief Load a POD scene.  Each mesh is uploaded once into a vertex buffer, a 16-bit index buffer
+///        and a vertex array holding the attribute layout.  Nodes, materials and texture names are
+///        read into flat arrays, with the animation keys of all nodes in a single array.
+/// \param ioContext Context related to IO facility on the platform
+/// \param fileName Name of the file on disk
+/// \param scene Receives the scene, release with esFreePOD
+/// \return GL_TRUE on success
+//
+GLboolean ESUTIL_API esLoadPOD ( void *ioContext, const char *fileName, ESPODScene *scene );
+
+//
+///
+/// \brief Release the buffers and arrays of a scene loaded with esLoadPOD
+//
+void ESUTIL_API esFreePOD ( ESPODScene *scene );
+
+//
+///
+/// \brief Compute the transform of a node, including its parents, at a frame of the animation
+/// \param scene Scene loaded with esLoadPOD
+/// \param node Node index
+/// \param frame Frame, keys are interpolated between whole frames
+/// \param result Returned model matrix, in the convention of esMatrixMultiply
+//
+void ESUTIL_API esPODNodeMatrix ( const ESPODScene *scene, int node, float frame, ESMatrix *result );
+
+
+//
+/// \brief Multiply matrix specified by result with a scaling matrix and return new matrix in result
+/// \param result Specifies the input matrix.  Scaled matrix is returned in result.
+/// \param sx, sy, sz Scale factors along the x, y and z axes respectively
+//
+void ESUTIL_API esScale ( ESMatrix *result, GLfloat sx, GLfloat sy, GLfloat sz );
+
+//
+/// \brief Multiply matrix specified by result with a translation matrix and return new matrix in result
+/// \param result Specifies the input matrix.  Translated matrix is returned in result.
+/// \param tx, ty, tz Scale factors along the x, y and z axes respectively
+//
+void ESUTIL_API esTranslate ( ESMatrix *result, GLfloat tx, GLfloat ty, GLfloat tz );
+
+//
+/// \brief Multiply matrix specified by result with a rotation matrix and return new matrix in result
+/// \param result Specifies the input matrix.  Rotated matrix is returned in result.
+/// \param angle Specifies the angle of rotation, in degrees.
+/// \param x, y, z Specify the x, y and z coordinates of a vector, respectively
+//
+void ESUTIL_API esRotate ( ESMatrix *result, GLfloat angle, GLfloat x, GLfloat y, GLfloat z );
+
+//
+/// \brief Multiply matrix specified by result with a perspective matrix and return new matrix in result
+/// \param result Specifies the input matrix.  New matrix is returned in result.
+/// \param left, right Coordinates for the left and right vertical clipping planes
+/// \param bottom, top Coordinates for the bottom and top horizontal clipping planes
+/// \param nearZ, farZ Distances to the near and far depth clipping planes.  Both distances must be positive.
+//
+void ESUTIL_API esFrustum ( ESMatrix *result, float left, float right, float bottom, float top, float nearZ, float farZ );
+
+//
+/// \brief Multiply matrix specified by result with a perspective matrix and return new matrix in result
+/// \param result Specifies the input matrix.  New matrix is returned in result.
+/// \param fovy Field of view y angle in degrees
+/// \param aspect Aspect ratio of screen
+/// \param nearZ Near plane distance
+/// \param farZ Far plane distance
+//
+void ESUTIL_API esPerspective ( ESMatrix *result, float fovy, float aspect, float nearZ, float farZ );
+
+//
+/// \brief Multiply matrix specified by result with a perspective matrix and return new matrix in result
 /// \param result Specifies the input matrix.  New matrix is returned in result.
 /// \param left, right Coordinates for the left and right vertical clipping planes
 /// \param bottom, top Coordinates for the bottom and top horizontal clipping planes
@@ -319,6 +1292,15 @@ void ESUTIL_API esOrtho ( ESMatrix *result, float left, float right, float botto
 //
 void ESUTIL_API esMatrixMultiply ( ESMatrix *result, ESMatrix *srcA, ESMatrix *srcB );
 
+//
+/// \brief Perform result[i] = srcA[i] * srcB[i] for count pairs of matrices.  Uses SSE2, AVX or
+///        NEON when available (selected at runtime).  result may alias srcA or srcB.
+/// \param result Returns count multiplied matrices
+/// \param srcA, srcB Arrays of count input matrices
+/// \param count Number of matrices to multiply
+//
+void ESUTIL_API esMatrixMultiplyBatch ( ESMatrix *result, const ESMatrix *srcA, const ESMatrix *srcB, int count );
+
 //
 //// \brief Return an identity matrix
 //// \param result Returns identity matrix
@@ -338,6 +1320,446 @@ esMatrixLookAt ( ESMatrix *result,
                  float lookAtX, float lookAtY, float lookAtZ,
                  float upX,     float upY,     float upZ );
 
+//
+/// \brief Start a new thread
+/// \param func Function run by the thread
+/// \param arg Argument passed to func
+/// \return Thread handle to pass to esThreadJoin, NULL on failure
+//
+ESThread *ESUTIL_API esThreadCreate ( void ( ESCALLBACK *func ) ( void * ), void *arg );
+
+//
+/// \brief Wait for a thread to finish and free its handle
+/// \param thread Thread handle returned by esThreadCreate
+//
+void ESUTIL_API esThreadJoin ( ESThread *thread );
+
+//
+/// \brief Create, destroy, lock, try to lock and unlock a mutex
+//
+ESMutex *ESUTIL_API esMutexCreate ( void );
+void ESUTIL_API esMutexDestroy ( ESMutex *mutex );
+void ESUTIL_API esMutexLock ( ESMutex *mutex );
+GLboolean ESUTIL_API esMutexTryLock ( ESMutex *mutex );
+void ESUTIL_API esMutexUnlock ( ESMutex *mutex );
+
+//
+/// \brief Create, destroy, wait on and wake a condition variable
+//
+ESCondition *ESUTIL_API esConditionCreate ( void );
+void ESUTIL_API esConditionDestroy ( ESCondition *cond );
+void ESUTIL_API esConditionWait ( ESCondition *cond, ESMutex *mutex );
+void ESUTIL_API esConditionSignal ( ESCondition *cond );
+void ESUTIL_API esConditionBroadcast ( ESCondition *cond );
+
+//
+/// \brief Return the number of online CPU cores
+//
+int ESUTIL_API esGetCPUCount ( void );
+
+//
+/// \brief Run func over [0, count) split into chunks across a shared pool of worker threads,
+///        one per CPU (or ES_NUM_THREADS).  The calling thread takes chunks too.  Runs inline
+///        when count is small or the pool is already busy.
+/// \param count Number of items
+/// \param minChunkSize Smallest number of items worth handing to another thread
+/// \param func Called with userData and a [first, last) item range
+/// \param userData Passed to func
+//
+void ESUTIL_API esParallelFor ( int count, int minChunkSize,
+                                void ( ESCALLBACK *func ) ( void *userData, int first, int last ),
+                                void *userData );
+
+//
+/// \brief Create a buffer ring of ES_BUFFER_RING_REGIONS regions
+/// \param ring Ring to initialize
+/// \param target Buffer target used for mapping (e.g. GL_ARRAY_BUFFER)
+/// \param regionSize Size in bytes of each region
+/// \param usage Usage hint passed to glBufferData
+/// \return GL_TRUE on success
+//
+GLboolean ESUTIL_API esBufferRingInit ( ESBufferRing *ring, GLenum target, GLsizeiptr regionSize, GLenum usage );
+
+//
+/// \brief Map the next region for writing.  Waits only if the GPU is still reading that region.
+/// \param ring Buffer ring
+/// \param offset If not NULL, returns the byte offset of the region in the buffer
+/// \return Pointer to the mapped region, NULL on failure
+//
+void *ESUTIL_API esBufferRingMap ( ESBufferRing *ring, GLintptr *offset );
+
+//
+/// \brief Check without blocking whether the next esBufferRingMap would wait for the GPU
+//
+GLboolean ESUTIL_API esBufferRingReady ( ESBufferRing *ring );
+
+//
+/// \brief Unmap the region mapped by esBufferRingMap
+//
+void ESUTIL_API esBufferRingUnmap ( ESBufferRing *ring );
+
+//
+/// \brief Fence the current region.  Call after the last draw that reads it.
+//
+void ESUTIL_API esBufferRingFence ( ESBufferRing *ring );
+
+//
+/// \brief Delete the buffer and fences of a buffer ring
+//
+void ESUTIL_API esBufferRingDestroy ( ESBufferRing *ring );
+
+//
+/// \brief Create a uniform buffer ring
+/// \param ring Ring to initialize
+/// \param frameSize Bytes of uniform data allocated per frame, rounded up to the offset alignment
+/// \return GL_TRUE on success
+//
+GLboolean ESUTIL_API esUniformRingInit ( ESUniformRing *ring, GLsizeiptr frameSize );
+
+//
+/// \brief Map the region of the next frame.  Waits only if the GPU is still reading it.
+/// \return GL_TRUE if the region was mapped
+//
+GLboolean ESUTIL_API esUniformRingBegin ( ESUniformRing *ring );
+
+//
+/// \brief Allocate uniform data for a draw from the mapped region
+/// \param ring Uniform ring between esUniformRingBegin and esUniformRingEnd
+/// \param size Size in bytes, usually sizeof a struct declared with the ES_STD140 macros
+/// \param offset Returns the byte offset to pass to glBindBufferRange with ring->ring.buffer
+/// \return Pointer to write the data to, NULL if the region is full
+//
+void *ESUTIL_API esUniformRingAlloc ( ESUniformRing *ring, GLsizeiptr size, GLintptr *offset );
+
+//
+/// \brief Unmap the region.  Call before the draws that read it.
+//
+void ESUTIL_API esUniformRingEnd ( ESUniformRing *ring );
+
+//
+/// \brief Fence the region.  Call after the last draw that reads it.
+//
+void ESUTIL_API esUniformRingFence ( ESUniformRing *ring );
+
+//
+/// \brief Delete the buffer and fences of a uniform ring
+//
+void ESUTIL_API esUniformRingDestroy ( ESUniformRing *ring );
+
+//
+/// \brief Create a texture stream.  Worker threads decode the images and esTextureStreamUpdate
+///        uploads them through a ring of pixel unpack buffers.
+/// \param ioContext Context related to IO facility on the platform
+/// \param bytesPerFrame Most bytes esTextureStreamUpdate uploads per call.  Must hold at least one row
+///        of each image.
+/// \param numThreads Number of decode threads, 0 for one per CPU beyond the first
+/// \return New texture stream, NULL on failure
+//
+ESTextureStream *ESUTIL_API esTextureStreamCreate ( void *ioContext, GLsizeiptr bytesPerFrame, int numThreads );
+
+//
+/// \brief Queue a TGA image to be streamed into a new texture.  The texture name is returned at once,
+///        and the texture stays incomplete until the last row has been uploaded.  Only TGA files are
+///        streamed; KTX and PVR files upload straight from their mapping with esLoadKTX and esLoadPVR.
+/// \param stream Texture stream
+/// \param fileName Name of the file on disk
+/// \param format GL_ALPHA, GL_LUMINANCE, GL_LUMINANCE_ALPHA, GL_RGB or GL_RGBA, matching the image
+/// \return New texture name, 0 on failure
+//
+GLuint ESUTIL_API esTextureStreamLoad ( ESTextureStream *stream, const char *fileName, GLenum format );
+
+//
+/// \brief Upload rows of decoded images, within the per-frame byte budget.  Call once per frame on
+///        the thread that owns the context.  Never waits for the GPU or the decode threads.
+/// \param stream Texture stream
+/// \return Number of textures still loading
+//
+int ESUTIL_API esTextureStreamUpdate ( ESTextureStream *stream );
+
+//
+/// \brief Block until every queued texture has been uploaded
+//
+void ESUTIL_API esTextureStreamFinish ( ESTextureStream *stream );
+
+//
+/// \brief Return the number of bytes uploaded by a texture stream so far
+//
+GLuint64 ESUTIL_API esTextureStreamBytesUploaded ( ESTextureStream *stream );
+
+//
+/// \brief Stop the decode threads and free a texture stream.  Textures already returned are kept.
+//
+void ESUTIL_API esTextureStreamDestroy ( ESTextureStream *stream );
+
+//
+/// \brief Create a loader thread with its own EGL context, sharing buffers, textures, programs and
+///        sync objects with the context of esCreateWindow.  Call after esCreateWindow, on the main
+///        thread.  If no shared context can be created and made current on the loader thread, jobs run
+///        when queued.
+/// \param esContext Application context
+/// \return New loader, NULL on failure
+//
+ESLoader *ESUTIL_API esLoaderCreate ( ESContext *esContext );
+
+//
+/// \brief Queue a job that creates GL objects on the loader thread, where the shared context is
+///        current.  Jobs run in order, and each is followed by a fence.  Objects a job creates
+///        must not be used by the main thread before esLoaderReady or esLoaderWait says so, and
+///        must be bound again there to see what the job put in them.
+/// \param loader Loader
+/// \param func Job function, called with userData
+/// \param userData Data passed to the job
+/// \return Job number to pass to esLoaderReady and esLoaderWait, 0 on failure
+//
+int ESUTIL_API esLoaderQueue ( ESLoader *loader, void ( ESCALLBACK *func ) ( void *userData ), void *userData );
+
+//
+/// \brief Check whether a job and the ones queued before it have finished, without waiting.  Once
+///        they have, the current context waits on their fences on the GPU so that the commands
+///        issued next see their results.  Call on the main thread.
+/// \param loader Loader
+/// \param job Job number returned by esLoaderQueue
+/// \return GL_TRUE if the job has finished
+//
+GLboolean ESUTIL_API esLoaderReady ( ESLoader *loader, int job );
+
+//
+/// \brief Block until a job has finished, then wait on its fence like esLoaderReady
+//
+void ESUTIL_API esLoaderWait ( ESLoader *loader, int job );
+
+//
+/// \brief Finish the queued jobs, stop the loader thread and free the loader.  Objects the jobs
+///        created are kept.
+//
+void ESUTIL_API esLoaderDestroy ( ESLoader *loader );
+
+//
+/// \brief Allocate instance transforms.  Instances start at the origin, unrotated, with unit scale.
+/// \param data Instance data to initialize
+/// \param count Number of instances
+/// \return GL_TRUE on success
+//
+GLboolean ESUTIL_API esInstanceDataInit ( ESInstanceData *data, int count );
+
+//
+/// \brief Free instance transforms allocated by esInstanceDataInit
+//
+void ESUTIL_API esInstanceDataFree ( ESInstanceData *data );
+
+//
+/// \brief Compute mvp[i] = scale * rotate * translate * viewProj for every instance, split across
+///        worker threads.  Equivalent to esTranslate, esRotate, esScale and esMatrixMultiply per instance.
+/// \param mvp Returns data->count matrices, may point into a mapped buffer
+/// \param data Instance transforms
+/// \param viewProj View-projection matrix shared by all instances
+//
+void ESUTIL_API esInstanceBuildMVP ( ESMatrix *mvp, const ESInstanceData *data, const ESMatrix *viewProj );
+
+//
+/// \brief Create a CPU particle system.  Particles are kept as structure-of-arrays and updated
+///        with SIMD code, split across worker threads.
+/// \param maxParticles Most particles alive at once
+/// \return New particle system, NULL on failure
+//
+ESParticleSystem *ESUTIL_API esParticleSystemCreate ( int maxParticles );
+
+//
+/// \brief Spawn particles at an emitter, as many as fit
+/// \param system Particle system
+/// \param emitter Where the particles start, their speed and lifetime
+/// \param count Number of particles to spawn
+/// \return Number of particles spawned
+//
+int ESUTIL_API esParticleSystemEmit ( ESParticleSystem *system, const ESParticleEmitter *emitter, int count );
+
+//
+/// \brief Advance the particles by one time step and remove the ones that outlived their lifetime.
+///        Their slots are filled with other live particles, so the order of the particles changes.
+/// \param system Particle system
+/// \param deltaTime Time step in seconds
+/// \param acceleration Acceleration applied to every particle, NULL for none
+/// \return Number of live particles
+//
+int ESUTIL_API esParticleSystemUpdate ( ESParticleSystem *system, float deltaTime, const GLfloat *acceleration );
+
+//
+/// \brief Return the number of live particles
+//
+int ESUTIL_API esParticleSystemCount ( const ESParticleSystem *system );
+
+//
+/// \brief Write the live particles as vertices of four floats: position, then the fraction of the
+///        lifetime left, from 1 down to 0.  Split across worker threads.
+/// \param system Particle system
+/// \param vertices Returns esParticleSystemCount vertices, may point into a mapped buffer
+/// \param time Seconds past the last update to move the particles by, e.g. for interpolation
+/// \return Number of vertices written
+//
+int ESUTIL_API esParticleSystemWrite ( ESParticleSystem *system, GLfloat *vertices, float time );
+
+//
+/// \brief Free a particle system
+//
+void ESUTIL_API esParticleSystemDestroy ( ESParticleSystem *system );
+
+//
+/// \brief Create three buffers of particles for transform feedback.  Particles live in the buffers
+///        only.  Each update records the particles that may still be alive at the start of the next
+///        buffer, so updates and draws only cover those.
+/// \param capacity Most particles alive at once
+/// \param particleSize Bytes per particle recorded by the update program
+/// \param maxLifetime Longest lifetime of a particle, in the units of the update time
+/// \return New particle buffers, NULL on failure
+//
+ESParticleFeedback *ESUTIL_API esParticleFeedbackCreate ( int capacity, GLsizei particleSize, GLfloat maxLifetime );
+
+//
+/// \brief Run the particles emitted less than maxLifetime ago through the current program, then emit
+///        new ones, recording both into the next buffer with transform feedback.  The program must be
+///        linked with interleaved feedback varyings making up one particle, and must be current with
+///        its other uniforms set.  Never waits for the GPU.
+/// \param feedback Particle buffers
+/// \param time Time of this update
+/// \param emitCount Number of particles to emit, as many as fit
+/// \param emitLoc Location of an int uniform set to 1 while emitting and 0 while updating
+/// \param setupAttribs Called with the source buffer bound to GL_ARRAY_BUFFER to set the attribute pointers
+/// \param userData Passed to setupAttribs
+/// \return Number of particles recorded
+//
+int ESUTIL_API esParticleFeedbackUpdate ( ESParticleFeedback *feedback, GLfloat time, int emitCount, GLint emitLoc,
+                                          void ( ESCALLBACK *setupAttribs ) ( void *userData ), void *userData );
+
+//
+/// \brief Draw the particles emitted less than maxLifetime before time as points with the current program
+/// \param feedback Particle buffers
+/// \param time Time drawn, at or after the last update
+/// \param setupAttribs Called with the particle buffer bound to GL_ARRAY_BUFFER to set the attribute pointers
+/// \param userData Passed to setupAttribs
+/// \return Number of particles drawn
+//
+int ESUTIL_API esParticleFeedbackDraw ( ESParticleFeedback *feedback, GLfloat time,
+                                        void ( ESCALLBACK *setupAttribs ) ( void *userData ), void *userData );
+
+//
+/// \brief Return the number of particles the GPU recorded in the latest update whose
+///        GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN query has come back, -1 before the first.  Never waits.
+//
+int ESUTIL_API esParticleFeedbackWritten ( ESParticleFeedback *feedback );
+
+//
+/// \brief Delete particle buffers and their queries
+//
+void ESUTIL_API esParticleFeedbackDestroy ( ESParticleFeedback *feedback );
+
+//
+/// \brief Use program, unless it is current already.  The esState functions below each make the GL
+///        call of the same name only when it changes the value the state cache holds for it, and
+///        count the calls made and dropped per frame (see esStateGetStats).  Each thread has its
+///        own cache, for the context current on it.  Values start out unknown; after plain GL
+///        calls change a cached value, call esStateInvalidate.  Setting ES_STATE_CACHE to 0
+///        makes every call.
+//
+void ESUTIL_API esStateUseProgram ( GLuint program );
+
+//
+/// \brief Bind a vertex array object.  The element array buffer and enabled attribute arrays
+///        are cached for the vertex array bound through here.
+//
+void ESUTIL_API esStateBindVertexArray ( GLuint array );
+
+//
+/// \brief Bind buffer to target, for the targets of OpenGL ES 3.0
+//
+void ESUTIL_API esStateBindBuffer ( GLenum target, GLuint buffer );
+
+//
+/// \brief Bind a range of buffer to an index of GL_UNIFORM_BUFFER or GL_TRANSFORM_FEEDBACK_BUFFER
+//
+void ESUTIL_API esStateBindBufferRange ( GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size );
+
+//
+/// \brief Bind all of buffer to an index of GL_UNIFORM_BUFFER or GL_TRANSFORM_FEEDBACK_BUFFER
+//
+void ESUTIL_API esStateBindBufferBase ( GLenum target, GLuint index, GLuint buffer );
+
+//
+/// \brief Select the active texture unit, GL_TEXTURE0 + unit
+//
+void ESUTIL_API esStateActiveTexture ( GLenum texture );
+
+//
+/// \brief Bind texture to target of the active texture unit
+//
+void ESUTIL_API esStateBindTexture ( GLenum target, GLuint texture );
+
+//
+/// \brief Bind a sampler object to a texture unit
+//
+void ESUTIL_API esStateBindSampler ( GLuint unit, GLuint sampler );
+
+//
+/// \brief Enable a capability such as GL_BLEND, GL_DEPTH_TEST or GL_CULL_FACE
+//
+void ESUTIL_API esStateEnable ( GLenum cap );
+
+//
+/// \brief Disable a capability
+//
+void ESUTIL_API esStateDisable ( GLenum cap );
+
+//
+/// \brief Set the blend factors
+//
+void ESUTIL_API esStateBlendFunc ( GLenum sfactor, GLenum dfactor );
+
+//
+/// \brief Set the depth test function
+//
+void ESUTIL_API esStateDepthFunc ( GLenum func );
+
+//
+/// \brief Enable or disable depth writes
+//
+void ESUTIL_API esStateDepthMask ( GLboolean flag );
+
+//
+/// \brief Select the faces culled
+//
+void ESUTIL_API esStateCullFace ( GLenum mode );
+
+//
+/// \brief Enable or disable writes to each color channel
+//
+void ESUTIL_API esStateColorMask ( GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha );
+
+//
+/// \brief Set the viewport
+//
+void ESUTIL_API esStateViewport ( GLint x, GLint y, GLsizei width, GLsizei height );
+
+//
+/// \brief Enable a vertex attribute array of the bound vertex array
+//
+void ESUTIL_API esStateEnableVertexAttribArray ( GLuint index );
+
+//
+/// \brief Disable a vertex attribute array of the bound vertex array
+//
+void ESUTIL_API esStateDisableVertexAttribArray ( GLuint index );
+
+//
+/// \brief Forget every cached value of the calling thread, so that the next call for each is made
+//
+void ESUTIL_API esStateInvalidate ( void );
+
+//
+/// \brief Return the number of calls made and dropped by the state cache of the drawing thread,
+///        in the last frame of the main loop and in total
+/// \param stats Returned counts
+//
+void ESUTIL_API esStateGetStats ( ESStateStats *stats );
+
 #ifdef __cplusplus
 }
 #endif
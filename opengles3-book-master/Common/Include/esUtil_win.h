@@ -50,6 +50,11 @@ extern "C" {
 //  Macros
 //
 
+// Caches of esCache.c
+#define CACHE_ASSETS     0
+#define CACHE_PROGRAMS   1
+#define CACHE_COUNT      2
+
 ///
 // Types
 //
@@ -58,6 +63,16 @@ extern "C" {
 //  Public Functions
 //
 
+#ifndef __APPLE__
+///
+//  HasEGLExtension()
+//
+//      Check whether an extension is in the EGL extension string of the display,
+//      EGL_NO_DISPLAY for the client extensions
+//
+GLboolean HasEGLExtension ( EGLDisplay eglDisplay, const char *extension );
+#endif
+
 ///
 //  WinCreate()
 //
@@ -65,6 +80,239 @@ extern "C" {
 //
 GLboolean WinCreate ( ESContext *esContext, const char *title );
 
+///
+//  UpdateFrame()
+//
+//      Update for a frame deltaTime seconds after the previous one
+//
+void UpdateFrame ( ESContext *esContext, float deltaTime );
+
+///
+//  RunUpdates()
+//
+//      Call updateFunc for deltaTime seconds of simulation, once or in fixed
+//      time steps, and return the interpolation for drawFunc
+//
+GLfloat RunUpdates ( ESContext *esContext, float deltaTime );
+
+///
+//  PipelineUpdate()
+//
+//      Wait for the update of this frame's state and start the next one
+//
+void PipelineUpdate ( ESContext *esContext, float deltaTime );
+
+///
+//  PipelineShutdown()
+//
+//      Finish the update in flight and stop the update thread
+//
+void PipelineShutdown ( ESContext *esContext );
+
+///
+//  FrameStatsRecord()
+//
+//      Add a frame of the main loop to the history of esContext, times in seconds
+//
+void FrameStatsRecord ( ESContext *esContext, double updateTime, double drawTime, double swapTime );
+
+///
+//  FrameStatsShutdown()
+//
+//      Write the final frame statistics and release the history
+//
+void FrameStatsShutdown ( ESContext *esContext );
+
+///
+//  FrameStatsSetGPUTime()
+//
+//      Set the GPU time, in seconds, of a frame recorded earlier
+//
+void FrameStatsSetGPUTime ( ESContext *esContext, unsigned int frameNumber, double gpuTime );
+
+///
+//  ProfilerEndFrame()
+//
+//      Close the profiler frame of the main loop, once recorded at frameNumber
+//
+void ProfilerEndFrame ( ESContext *esContext, unsigned int frameNumber, const ESFrameTime *frameTime );
+
+///
+//  ProfilerShutdown()
+//
+//      Write the profiler trace and release the profiler
+//
+void ProfilerShutdown ( ESContext *esContext );
+
+///
+//  BenchmarkStart()
+//
+//      Start benchmarking if ES_BENCHMARK is set, initTime is the time esMain
+//      took in seconds
+//
+void BenchmarkStart ( ESContext *esContext, double initTime );
+
+///
+//  BenchmarkTimestep()
+//
+//      Time step the main loop passes to updateFunc, 0 for wall clock time
+//
+float BenchmarkTimestep ( void );
+
+///
+//  BenchmarkRecordFrame()
+//
+//      Add a frame of the main loop to the benchmark results
+//
+void BenchmarkRecordFrame ( const ESFrameTime *frameTime );
+
+///
+//  BenchmarkCountDraws()
+//
+//      Count draw calls, from the GL wrappers of the benchmark targets
+//
+void BenchmarkCountDraws ( int count );
+
+///
+//  BenchmarkCountUpload()
+//
+//      Count bytes uploaded to the GL, from the GL wrappers of the benchmark targets
+//
+void BenchmarkCountUpload ( double bytes );
+
+///
+//  BenchmarkShutdown()
+//
+//      Write the benchmark results, before the frame history is released
+//
+void BenchmarkShutdown ( ESContext *esContext );
+
+///
+//  StateEndFrame()
+//
+//      Move the state cache counts of the frame to its statistics
+//
+void StateEndFrame ( void );
+
+///
+//  StateSetBuffer()
+//
+//      Record in the state cache a buffer bound to target with glBindBuffer
+//
+void StateSetBuffer ( GLenum target, GLuint buffer );
+
+///
+//  StateSetVertexArray()
+//
+//      Record in the state cache a vertex array bound with glBindVertexArray
+//
+void StateSetVertexArray ( GLuint array );
+
+///
+//  StateSetBufferRange()
+//
+//      Record in the state cache a buffer range bound with glBindBufferRange
+//
+void StateSetBufferRange ( GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size );
+
+///
+//  StateSetBufferBase()
+//
+//      Record in the state cache a buffer bound with glBindBufferBase
+//
+void StateSetBufferBase ( GLenum target, GLuint index, GLuint buffer );
+
+///
+//  StateSetTexture()
+//
+//      Record in the state cache a texture bound to the active unit with glBindTexture
+//
+void StateSetTexture ( GLenum target, GLuint texture );
+
+///
+//  StateSetCap()
+//
+//      Record in the state cache a cap set with glEnable or glDisable
+//
+void StateSetCap ( GLenum cap, GLboolean enabled );
+
+///
+//  StateDeleteBuffer()
+//
+//      Record in the state cache a buffer deleted with glDeleteBuffers, which unbinds it
+//
+void StateDeleteBuffer ( GLuint buffer );
+
+///
+//  ProgramInfoReflect()
+//
+//      Query the variables of a linked program, without binding its uniform blocks
+//
+ESProgramInfo *ProgramInfoReflect ( GLuint program );
+
+///
+//  ProgramInfoBind()
+//
+//      Bind the uniform blocks of a program to the binding points of its info
+//
+void ProgramInfoBind ( const ESProgramInfo *info );
+
+///
+//  ProgramInfoSerialize()
+//
+//      Flatten a program info into a new buffer of length bytes, freed with free()
+//
+void *ProgramInfoSerialize ( const ESProgramInfo *info, GLint *length );
+
+///
+//  ProgramInfoDeserialize()
+//
+//      Rebuild the info of program from ProgramInfoSerialize output, NULL if it is not valid
+//
+ESProgramInfo *ProgramInfoDeserialize ( GLuint program, const void *data, GLint length );
+
+///
+//  CacheInit()
+//
+//      Point a cache at a directory, or disable it if directory is NULL
+//
+void CacheInit ( int cacheIndex, const char *directory );
+
+///
+//  CacheEnabled()
+//
+//      Whether a cache has a directory, taken from its environment variable if never initialized
+//
+GLboolean CacheEnabled ( int cacheIndex );
+
+///
+//  CacheMap()
+//
+//      Map the entry for key, whatever its size.  Returns its data and size, NULL if there is none.
+//
+const void *CacheMap ( int cacheIndex, unsigned long long key, ESMappedFile *file, size_t *size );
+
+///
+//  CacheStore()
+//
+//      Write the entry for key, replacing any entry with the same key
+//
+GLboolean CacheStore ( int cacheIndex, unsigned long long key, const void *data, size_t size );
+
+///
+//  CacheCount()
+//
+//      Count a lookup as a hit or a miss, from any thread
+//
+void CacheCount ( int cacheIndex, GLboolean hit );
+
+///
+//  CacheGetStats()
+//
+//      Read the hit and miss counters of a cache
+//
+void CacheGetStats ( int cacheIndex, int *hits, int *misses );
+
 #ifdef __cplusplus
 }
 #endif
@@ -39,8 +39,8 @@
 //
 #include <android/log.h>
 #include <android_native_app_glue.h>
-#include <time.h>
 #include "esUtil.h"
+#include "esUtil_win.h"
 
 #define LOGI(...) ((void)__android_log_print(ANDROID_LOG_INFO, "esUtil", __VA_ARGS__))
 
@@ -51,17 +51,6 @@
 //
 //
 
-///
-// GetCurrentTime()
-//
-static float GetCurrentTime()
-{
-   struct timespec clockRealTime;
-   clock_gettime ( CLOCK_MONOTONIC, &clockRealTime );
-   double curTimeInSeconds = clockRealTime.tv_sec + ( double ) clockRealTime.tv_nsec / 1e9;
-   return ( float ) curTimeInSeconds;
-}
-
 ///
 // HandleCommand()
 //
@@ -93,11 +82,20 @@ static void HandleCommand ( struct android_app *pApp, int32_t cmd )
       case APP_CMD_TERM_WINDOW:
 
          // Cleanup on shutdown
+         PipelineShutdown ( esContext );
+
          if ( esContext->shutdownFunc != NULL )
          {
             esContext->shutdownFunc ( esContext );
          }
 
+         ProfilerShutdown ( esContext );
+
+         FrameStatsShutdown ( esContext );
+
+         // Write out what the shutdown logged before the window goes
+         esLogFlush ( );
+
          if ( esContext->userData != NULL )
          {
             free ( esContext->userData );
@@ -136,7 +134,7 @@ extern int esMain ( ESContext *esContext );
 void android_main ( struct android_app *pApp )
 {
    ESContext esContext;
-   float lastTime;
+   double lastTime;
 
    // Make sure glue isn't stripped.
    app_dummy();
@@ -149,12 +147,13 @@ void android_main ( struct android_app *pApp )
    pApp->onAppCmd = HandleCommand;
    pApp->userData = &esContext;
 
-   lastTime = GetCurrentTime();
+   lastTime = esGetTime ( );
 
    while ( 1 )
    {
       int ident;
       int events;
+      double curTime, updateEnd;
       struct android_poll_source *pSource;
 
       while ( ( ident = ALooper_pollAll ( 0, NULL, &events, ( void ** ) &pSource ) ) >= 0 )
@@ -178,18 +177,21 @@ void android_main ( struct android_app *pApp )
       }
 
       // Call app update function
-      if ( esContext.updateFunc != NULL )
-      {
-         float curTime = GetCurrentTime();
-         float deltaTime =  ( curTime - lastTime );
-         lastTime = curTime;
-         esContext.updateFunc ( &esContext, deltaTime );
-      }
+      curTime = esGetTime ( );
+
+      UpdateFrame ( &esContext, ( float ) ( curTime - lastTime ) );
+
+      lastTime = curTime;
+      updateEnd = esGetTime ( );
 
       if ( esContext.drawFunc != NULL )
       {
+         double drawEnd;
+
          esContext.drawFunc ( &esContext );
+         drawEnd = esGetTime ( );
          eglSwapBuffers ( esContext.eglDisplay, esContext.eglSurface );
+         FrameStatsRecord ( &esContext, updateEnd - curTime, drawEnd - updateEnd, esGetTime ( ) - drawEnd );
       }
    }
 }
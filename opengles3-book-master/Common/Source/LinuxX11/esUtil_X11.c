@@ -20,13 +20,16 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
-#include <sys/time.h>
 #include "esUtil.h"
+#include "esUtil_win.h"
 
 #include  <X11/Xlib.h>
 #include  <X11/Xatom.h>
 #include  <X11/Xutil.h>
 
+// Number of frames rendered offscreen when ES_FRAMES is not set
+#define OFFSCREEN_DEFAULT_FRAMES  100
+
 // X11 related local variables
 static Display *x_display = NULL;
 static Atom s_wmDeleteMessage;
@@ -49,7 +52,7 @@ static Atom s_wmDeleteMessage;
 //
 //      This function initialized the native X11 display and window for EGL
 //
-EGLBoolean WinCreate(ESContext *esContext, const char *title)
+GLboolean WinCreate(ESContext *esContext, const char *title)
 {
     Window root;
     XSetWindowAttributes swa;
@@ -159,24 +162,61 @@ GLboolean userInterrupt(ESContext *esContext)
 //
 void WinLoop ( ESContext *esContext )
 {
-    struct timeval t1, t2;
-    struct timezone tz;
+    double t1, t2, updateEnd, drawEnd;
     float deltatime;
 
-    gettimeofday ( &t1 , &tz );
+    t1 = esGetTime ( );
 
     while(userInterrupt(esContext) == GL_FALSE)
     {
-        gettimeofday(&t2, &tz);
-        deltatime = (float)(t2.tv_sec - t1.tv_sec + (t2.tv_usec - t1.tv_usec) * 1e-6);
+        t2 = esGetTime ( );
+        deltatime = (float)(t2 - t1);
         t1 = t2;
 
-        if (esContext->updateFunc != NULL)
-            esContext->updateFunc(esContext, deltatime);
+        UpdateFrame(esContext, deltatime);
+        updateEnd = esGetTime ( );
         if (esContext->drawFunc != NULL)
             esContext->drawFunc(esContext);
+        drawEnd = esGetTime ( );
 
-        eglSwapBuffers(esContext->eglDisplay, esContext->eglSurface);        
+        eglSwapBuffers(esContext->eglDisplay, esContext->eglSurface);
+        FrameStatsRecord ( esContext, updateEnd - t2, drawEnd - updateEnd, esGetTime ( ) - drawEnd );
+    }
+}
+
+///
+//  WinLoopOffscreen()
+//
+//      Render a fixed number of frames without a window.  There is no X11
+//      connection to poll, so the loop only stops after numFrames.
+//
+void WinLoopOffscreen ( ESContext *esContext, int numFrames )
+{
+    double t1, t2, updateEnd, drawEnd;
+    float deltatime;
+    float timestep = BenchmarkTimestep ( );
+    int frame;
+
+    t1 = esGetTime ( );
+
+    for ( frame = 0; frame < numFrames; frame++ )
+    {
+        t2 = esGetTime ( );
+        deltatime = timestep > 0.0f ? timestep : (float)(t2 - t1);
+        t1 = t2;
+
+        UpdateFrame(esContext, deltatime);
+        updateEnd = esGetTime ( );
+        if (esContext->drawFunc != NULL)
+            esContext->drawFunc(esContext);
+        drawEnd = esGetTime ( );
+
+        // A surfaceless context has nothing to swap
+        if (esContext->eglSurface != EGL_NO_SURFACE)
+            eglSwapBuffers(esContext->eglDisplay, esContext->eglSurface);
+        else
+            glFlush();
+        FrameStatsRecord ( esContext, updateEnd - t2, drawEnd - updateEnd, esGetTime ( ) - drawEnd );
     }
 }
 
@@ -194,18 +234,48 @@ extern int esMain( ESContext *esContext );
 int main ( int argc, char *argv[] )
 {
    ESContext esContext;
+   double initStart;
    
    memset ( &esContext, 0, sizeof( esContext ) );
+   esContext.argc = argc;
+   esContext.argv = argv;
 
+   initStart = esGetTime ( );
 
    if ( esMain ( &esContext ) != GL_TRUE )
       return 1;   
+
+   // Command line tools do all their work in esMain without a window
+   if ( esContext.flags & ES_WINDOW_NONE )
+      return 0;
+
+   if ( esContext.eglDisplay == EGL_NO_DISPLAY )
+   {
+      esLogMessage ( "esMain returned without creating a window\n" );
+      return 1;
+   }
+
+   BenchmarkStart ( &esContext, esGetTime ( ) - initStart );
  
-   WinLoop ( &esContext );
+   if ( esContext.flags & ES_WINDOW_OFFSCREEN )
+   {
+      const char *frames = getenv ( "ES_FRAMES" );
+      WinLoopOffscreen ( &esContext, frames != NULL ? atoi ( frames ) : OFFSCREEN_DEFAULT_FRAMES );
+   }
+   else
+      WinLoop ( &esContext );
+
+   PipelineShutdown ( &esContext );
 
    if ( esContext.shutdownFunc != NULL )
 	   esContext.shutdownFunc ( &esContext );
 
+   ProfilerShutdown ( &esContext );
+
+   BenchmarkShutdown ( &esContext );
+
+   FrameStatsShutdown ( &esContext );
+
    if ( esContext.userData != NULL )
 	   free ( esContext.userData );
 
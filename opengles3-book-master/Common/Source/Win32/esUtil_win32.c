@@ -41,11 +41,19 @@
 #include <windows.h>
 #include <stdlib.h>
 #include "esUtil.h"
+#include "esUtil_win.h"
 
 #ifdef _WIN64
 #define GWL_USERDATA GWLP_USERDATA
 #endif
 
+// Number of frames rendered offscreen when ES_FRAMES is not set
+#define OFFSCREEN_DEFAULT_FRAMES  100
+
+// Time spent in drawFunc and eglSwapBuffers by the last WM_PAINT, in seconds
+static double paintDrawTime;
+static double paintSwapTime;
+
 //////////////////////////////////////////////////////////////////
 //
 //  Private Functions
@@ -72,8 +80,15 @@ LRESULT WINAPI ESWindowProc ( HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam
 
          if ( esContext && esContext->drawFunc )
          {
+            double drawStart = esGetTime ( );
+            double drawEnd;
+
             esContext->drawFunc ( esContext );
+            drawEnd = esGetTime ( );
             eglSwapBuffers ( esContext->eglDisplay, esContext->eglSurface );
+
+            paintDrawTime = drawEnd - drawStart;
+            paintSwapTime = esGetTime ( ) - drawEnd;
          }
 
 
@@ -191,13 +206,13 @@ void WinLoop ( ESContext *esContext )
 {
    MSG msg = { 0 };
    int done = 0;
-   DWORD lastTime = GetTickCount();
+   double lastTime = esGetTime ( );
 
    while ( !done )
    {
       int gotMsg = ( PeekMessage ( &msg, NULL, 0, 0, PM_REMOVE ) != 0 );
-      DWORD curTime = GetTickCount();
-      float deltaTime = ( float ) ( curTime - lastTime ) / 1000.0f;
+      double curTime = esGetTime ( );
+      float deltaTime = ( float ) ( curTime - lastTime );
       lastTime = curTime;
 
       if ( gotMsg )
@@ -214,14 +229,61 @@ void WinLoop ( ESContext *esContext )
       }
       else
       {
+         paintDrawTime = paintSwapTime = 0.0;
          SendMessage ( esContext->eglNativeWindow, WM_PAINT, 0, 0 );
       }
 
-      // Call update function if registered
-      if ( esContext->updateFunc != NULL )
+      UpdateFrame ( esContext, deltaTime );
+
+      // A frame is a pass that painted
+      if ( !gotMsg )
+      {
+         FrameStatsRecord ( esContext, esGetTime ( ) - curTime - paintDrawTime - paintSwapTime,
+                            paintDrawTime, paintSwapTime );
+      }
+   }
+}
+
+///
+//  WinLoopOffscreen()
+//
+//      Render a fixed number of frames without a window or message pump
+//
+void WinLoopOffscreen ( ESContext *esContext, int numFrames )
+{
+   double lastTime = esGetTime ( );
+   float timestep = BenchmarkTimestep ( );
+   int frame;
+
+   for ( frame = 0; frame < numFrames; frame++ )
+   {
+      double curTime = esGetTime ( );
+      double updateEnd, drawEnd;
+      float deltaTime = timestep > 0.0f ? timestep : ( float ) ( curTime - lastTime );
+      lastTime = curTime;
+
+      UpdateFrame ( esContext, deltaTime );
+
+      updateEnd = esGetTime ( );
+
+      if ( esContext->drawFunc != NULL )
+      {
+         esContext->drawFunc ( esContext );
+      }
+
+      drawEnd = esGetTime ( );
+
+      // A surfaceless context has nothing to swap
+      if ( esContext->eglSurface != EGL_NO_SURFACE )
+      {
+         eglSwapBuffers ( esContext->eglDisplay, esContext->eglSurface );
+      }
+      else
       {
-         esContext->updateFunc ( esContext, deltaTime );
+         glFlush ( );
       }
+
+      FrameStatsRecord ( esContext, updateEnd - curTime, drawEnd - updateEnd, esGetTime ( ) - drawEnd );
    }
 }
 
@@ -239,21 +301,55 @@ extern int esMain ( ESContext *esContext );
 int main ( int argc, char *argv[] )
 {
    ESContext esContext;
+   double initStart;
 
    memset ( &esContext, 0, sizeof ( ESContext ) );
+   esContext.argc = argc;
+   esContext.argv = argv;
+   initStart = esGetTime ( );
 
    if ( esMain ( &esContext ) != GL_TRUE )
    {
       return 1;
    }
 
-   WinLoop ( &esContext );
+   // Command line tools do all their work in esMain without a window
+   if ( esContext.flags & ES_WINDOW_NONE )
+   {
+      return 0;
+   }
+
+   if ( esContext.eglDisplay == EGL_NO_DISPLAY )
+   {
+      esLogMessage ( "esMain returned without creating a window\n" );
+      return 1;
+   }
+
+   BenchmarkStart ( &esContext, esGetTime ( ) - initStart );
+
+   if ( esContext.flags & ES_WINDOW_OFFSCREEN )
+   {
+      const char *frames = getenv ( "ES_FRAMES" );
+      WinLoopOffscreen ( &esContext, frames != NULL ? atoi ( frames ) : OFFSCREEN_DEFAULT_FRAMES );
+   }
+   else
+   {
+      WinLoop ( &esContext );
+   }
+
+   PipelineShutdown ( &esContext );
 
    if ( esContext.shutdownFunc != NULL )
    {
       esContext.shutdownFunc ( &esContext );
    }
 
+   ProfilerShutdown ( &esContext );
+
+   BenchmarkShutdown ( &esContext );
+
+   FrameStatsShutdown ( &esContext );
+
    if ( esContext.userData != NULL )
    {
       free ( esContext.userData );
@@ -0,0 +1,337 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// ESBenchmark.c
+//
+//    Benchmark mode of the main loop, enabled by the ES_BENCHMARK
+//    environment variable.  The sample runs headless for ES_FRAMES frames
+//    with a fixed time step, so every run simulates the same frames, and
+//    one line of JSON results is appended to the file ES_BENCHMARK names.
+//    Draw calls and uploaded bytes are only counted in the <sample>_Benchmark
+//    targets, which wrap the GL entry points (see Benchmarks/Samples).
+//    State calls made and dropped by the state cache (see esState.c) are
+//    counted in every target.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include "esUtil_win.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <psapi.h>
+#ifdef _MSC_VER
+#pragma comment ( lib, "psapi.lib" )
+#endif
+#else
+#include <sys/resource.h>
+#endif
+
+///
+//  Macros
+//
+
+// Simulated time of a frame, in seconds
+#define BENCHMARK_TIMESTEP      ( 1.0f / 60.0f )
+
+///
+//  Types
+//
+typedef struct
+{
+   GLboolean     enabled;
+   const char   *fileName;
+
+   // Wall and process CPU time at the start of the first frame and the end
+   // of the last one, in seconds
+   double        start;
+   double        end;
+   double        cpuStart;
+   double        cpuEnd;
+   double        initTime;
+
+   // Sums over the frames, in milliseconds
+   unsigned int  frames;
+   double        update;
+   double        draw;
+   double        swap;
+
+   // Set once the GL entry points are counted
+   GLboolean     counted;
+   double        draws;
+   double        uploadBytes;
+} Benchmark;
+
+static Benchmark benchmark;
+
+///
+// GetCPUTime()
+//
+//    User and system time of the process, in seconds
+//
+static double GetCPUTime ( void )
+{
+#ifdef _WIN32
+   FILETIME creation, exit, kernel, user;
+   ULARGE_INTEGER k, u;
+
+   GetProcessTimes ( GetCurrentProcess ( ), &creation, &exit, &kernel, &user );
+   k.LowPart = kernel.dwLowDateTime;
+   k.HighPart = kernel.dwHighDateTime;
+   u.LowPart = user.dwLowDateTime;
+   u.HighPart = user.dwHighDateTime;
+
+   return ( k.QuadPart + u.QuadPart ) * 1e-7;
+#else
+   struct rusage usage;
+
+   getrusage ( RUSAGE_SELF, &usage );
+
+   return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec * 1e-6 +
+          usage.ru_stime.tv_sec + usage.ru_stime.tv_usec * 1e-6;
+#endif
+}
+
+///
+// GetPeakRSS()
+//
+//    Peak resident set size of the process, in kilobytes
+//
+static long GetPeakRSS ( void )
+{
+#ifdef _WIN32
+   PROCESS_MEMORY_COUNTERS counters;
+
+   if ( !GetProcessMemoryInfo ( GetCurrentProcess ( ), &counters, sizeof ( counters ) ) )
+   {
+      return 0;
+   }
+
+   return ( long ) ( counters.PeakWorkingSetSize / 1024 );
+#else
+   struct rusage usage;
+
+   getrusage ( RUSAGE_SELF, &usage );
+
+   // Kilobytes on Linux, bytes on macOS
+#ifdef __APPLE__
+   return usage.ru_maxrss / 1024;
+#else
+   return usage.ru_maxrss;
+#endif
+#endif
+}
+
+///
+// SampleName()
+//
+//    Executable name without directory and extension
+//
+static void SampleName ( ESContext *esContext, char *name, size_t size )
+{
+   const char *path = esContext->argc > 0 ? esContext->argv[0] : "sample";
+   const char *base = path;
+   char *extension;
+
+   for ( ; *path != '\0'; path++ )
+   {
+      if ( *path == '/' || *path == '\\' )
+      {
+         base = path + 1;
+      }
+   }
+
+   strncpy ( name, base, size - 1 );
+   name[size - 1] = '\0';
+
+   extension = strrchr ( name, '.' );
+
+   if ( extension != NULL )
+   {
+      *extension = '\0';
+   }
+}
+
+///
+//  BenchmarkStart()
+//
+//      Start benchmarking if ES_BENCHMARK is set, initTime is the time esMain
+//      took in seconds
+//
+void BenchmarkStart ( ESContext *esContext, double initTime )
+{
+   const char *fileName = getenv ( "ES_BENCHMARK" );
+
+   ( void ) esContext;
+
+   if ( fileName == NULL )
+   {
+      return;
+   }
+
+   benchmark.enabled = GL_TRUE;
+   benchmark.fileName = fileName[0] != '\0' ? fileName : "-";
+   benchmark.initTime = initTime;
+   benchmark.start = benchmark.end = esGetTime ( );
+   benchmark.cpuStart = benchmark.cpuEnd = GetCPUTime ( );
+}
+
+///
+//  BenchmarkTimestep()
+//
+//      Time step the main loop passes to updateFunc, 0 for wall clock time
+//
+float BenchmarkTimestep ( void )
+{
+   return benchmark.enabled ? BENCHMARK_TIMESTEP : 0.0f;
+}
+
+///
+//  BenchmarkRecordFrame()
+//
+//      Add a frame of the main loop to the results
+//
+void BenchmarkRecordFrame ( const ESFrameTime *frameTime )
+{
+   if ( !benchmark.enabled )
+   {
+      return;
+   }
+
+   benchmark.frames++;
+   benchmark.update += frameTime->update;
+   benchmark.draw += frameTime->draw;
+   benchmark.swap += frameTime->swap;
+   benchmark.end = esGetTime ( );
+   benchmark.cpuEnd = GetCPUTime ( );
+}
+
+///
+//  BenchmarkCountDraws()
+//
+void BenchmarkCountDraws ( int count )
+{
+   benchmark.counted = GL_TRUE;
+   benchmark.draws += count;
+}
+
+///
+//  BenchmarkCountUpload()
+//
+void BenchmarkCountUpload ( double bytes )
+{
+   benchmark.counted = GL_TRUE;
+   benchmark.uploadBytes += bytes;
+}
+
+///
+//  BenchmarkShutdown()
+//
+//      Write the results, before the frame history is released
+//
+void BenchmarkShutdown ( ESContext *esContext )
+{
+   ESFrameStats stats;
+   ESStateStats stateStats;
+   double seconds = benchmark.end - benchmark.start;
+   double frames = benchmark.frames > 0 ? benchmark.frames : 1;
+   char name[64];
+   char counters[256];
+   char results[1024];
+
+   if ( !benchmark.enabled )
+   {
+      return;
+   }
+
+   benchmark.enabled = GL_FALSE;
+
+   if ( seconds <= 0.0 )
+   {
+      seconds = 1e-9;
+   }
+
+   SampleName ( esContext, name, sizeof ( name ) );
+   esGetFrameStats ( esContext, &stats );
+   esStateGetStats ( &stateStats );
+
+   // Counters are null in targets without the GL wrappers
+   if ( benchmark.counted )
+   {
+      sprintf ( counters, "\"draws\":%.0f,\"draws_per_s\":%.1f,\"draws_per_frame\":%.2f,"
+                "\"upload_mb\":%.3f,\"upload_mb_per_s\":%.3f",
+                benchmark.draws, benchmark.draws / seconds, benchmark.draws / frames,
+                benchmark.uploadBytes / ( 1024.0 * 1024.0 ),
+                benchmark.uploadBytes / ( 1024.0 * 1024.0 ) / seconds );
+   }
+   else
+   {
+      sprintf ( counters, "\"draws\":null,\"draws_per_s\":null,\"draws_per_frame\":null,"
+                "\"upload_mb\":null,\"upload_mb_per_s\":null" );
+   }
+
+   sprintf ( results, "{\"sample\":\"%s\",\"frames\":%u,\"timestep_ms\":%.3f,\"width\":%d,\"height\":%d,"
+             "\"init_ms\":%.3f,\"seconds\":%.3f,\"fps\":%.2f,%s,"
+             "\"state_calls_per_frame\":%.2f,\"state_elided_per_frame\":%.2f,"
+             "\"update_ms\":%.3f,\"draw_ms\":%.3f,\"swap_ms\":%.3f,\"cpu_ms\":%.3f,"
+             "\"p50_ms\":%.3f,\"p95_ms\":%.3f,\"p99_ms\":%.3f,\"max_ms\":%.3f,\"peak_rss_kb\":%ld}",
+             name, benchmark.frames, BENCHMARK_TIMESTEP * 1000.0, esContext->width, esContext->height,
+             benchmark.initTime * 1000.0, seconds, benchmark.frames / seconds, counters,
+             stateStats.totalIssued / ( stateStats.frames > 0 ? stateStats.frames : 1 ),
+             stateStats.totalElided / ( stateStats.frames > 0 ? stateStats.frames : 1 ),
+             benchmark.update / frames, benchmark.draw / frames, benchmark.swap / frames,
+             ( benchmark.cpuEnd - benchmark.cpuStart ) * 1000.0 / frames,
+             stats.p50, stats.p95, stats.p99, stats.max, GetPeakRSS ( ) );
+
+   if ( strcmp ( benchmark.fileName, "-" ) == 0 )
+   {
+      esLogMessage ( "%s\n", results );
+   }
+   else
+   {
+      FILE *file = fopen ( benchmark.fileName, "a" );
+
+      if ( file == NULL )
+      {
+         esLogMessage ( "esBenchmark: cannot open { %s }\n", benchmark.fileName );
+         return;
+      }
+
+      fprintf ( file, "%s\n", results );
+      fclose ( file );
+   }
+}
@@ -0,0 +1,174 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// ESBufferRing.c
+//
+//    A buffer object split into several regions that are written in turn.
+//    Each region is mapped unsynchronized and guarded by a fence, so the CPU
+//    can fill one region while the GPU is still reading the others.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include "esUtil_win.h"
+#include <string.h>
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+//
+///
+/// \brief Create a buffer ring of ES_BUFFER_RING_REGIONS regions
+//
+GLboolean ESUTIL_API esBufferRingInit ( ESBufferRing *ring, GLenum target, GLsizeiptr regionSize, GLenum usage )
+{
+   memset ( ring, 0, sizeof ( ESBufferRing ) );
+
+   ring->target = target;
+   ring->regionSize = regionSize;
+   ring->region = ES_BUFFER_RING_REGIONS - 1;
+
+   glGenBuffers ( 1, &ring->buffer );
+   glBindBuffer ( target, ring->buffer );
+   glBufferData ( target, regionSize * ES_BUFFER_RING_REGIONS, NULL, usage );
+   glBindBuffer ( target, 0 );
+   StateSetBuffer ( target, 0 );
+
+   return ring->buffer != 0 ? GL_TRUE : GL_FALSE;
+}
+
+//
+///
+/// \brief Advance to the next region, wait until the GPU has finished reading it, then map it
+///        without any further synchronization.
+//
+void *ESUTIL_API esBufferRingMap ( ESBufferRing *ring, GLintptr *offset )
+{
+   GLsync fence;
+
+   ring->region = ( ring->region + 1 ) % ES_BUFFER_RING_REGIONS;
+   ring->offset = ( GLintptr ) ring->region * ring->regionSize;
+   fence = ring->fences[ring->region];
+
+   if ( fence != 0 )
+   {
+      // Usually already signaled, as the region was last used two frames ago
+      if ( glClientWaitSync ( fence, 0, 0 ) == GL_TIMEOUT_EXPIRED )
+      {
+         ring->stalls++;
+
+         while ( glClientWaitSync ( fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000 ) == GL_TIMEOUT_EXPIRED )
+            ;
+      }
+
+      glDeleteSync ( fence );
+      ring->fences[ring->region] = 0;
+   }
+
+   if ( offset != NULL )
+   {
+      *offset = ring->offset;
+   }
+
+   glBindBuffer ( ring->target, ring->buffer );
+   StateSetBuffer ( ring->target, ring->buffer );
+
+   return glMapBufferRange ( ring->target, ring->offset, ring->regionSize,
+                             GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+                             GL_MAP_UNSYNCHRONIZED_BIT );
+}
+
+//
+///
+/// \brief Check without blocking whether esBufferRingMap would have to wait
+//
+GLboolean ESUTIL_API esBufferRingReady ( ESBufferRing *ring )
+{
+   GLsync fence = ring->fences[( ring->region + 1 ) % ES_BUFFER_RING_REGIONS];
+
+   if ( fence == 0 )
+   {
+      return GL_TRUE;
+   }
+
+   return glClientWaitSync ( fence, 0, 0 ) != GL_TIMEOUT_EXPIRED ? GL_TRUE : GL_FALSE;
+}
+
+//
+///
+/// \brief Unmap the region mapped by esBufferRingMap
+//
+void ESUTIL_API esBufferRingUnmap ( ESBufferRing *ring )
+{
+   glBindBuffer ( ring->target, ring->buffer );
+   StateSetBuffer ( ring->target, ring->buffer );
+   glUnmapBuffer ( ring->target );
+}
+
+//
+///
+/// \brief Insert a fence after the last command reading the current region
+//
+void ESUTIL_API esBufferRingFence ( ESBufferRing *ring )
+{
+   if ( ring->fences[ring->region] != 0 )
+   {
+      glDeleteSync ( ring->fences[ring->region] );
+   }
+
+   ring->fences[ring->region] = glFenceSync ( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+}
+
+//
+///
+/// \brief Delete the buffer and fences of a buffer ring
+//
+void ESUTIL_API esBufferRingDestroy ( ESBufferRing *ring )
+{
+   int i;
+
+   for ( i = 0; i < ES_BUFFER_RING_REGIONS; i++ )
+   {
+      if ( ring->fences[i] != 0 )
+      {
+         glDeleteSync ( ring->fences[i] );
+      }
+   }
+
+   StateDeleteBuffer ( ring->buffer );
+   glDeleteBuffers ( 1, &ring->buffer );
+   memset ( ring, 0, sizeof ( ESBufferRing ) );
+}
@@ -0,0 +1,474 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// ESCache.c
+//
+//    On-disk cache of generated assets and linked program binaries.  Each
+//    entry is a file named after a 64-bit key hashed from everything that
+//    determines its contents, so a change to any input is a different entry
+//    rather than a stale one.  Entries are memory-mapped on later runs, and
+//    their data can go to the GL straight from the mapping.  The asset and
+//    program caches only differ in their directory and counters.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include "esUtil_win.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <direct.h>
+#else
+#include <pthread.h>
+#endif
+
+///
+//  Macros
+//
+#define ASSET_CACHE_MAGIC     0x43415345   // 'ESAC'
+#define ASSET_CACHE_VERSION   1
+#define ASSET_CACHE_PATH_MAX  1024
+
+///
+//  Types
+//
+
+// Header at the start of every cache file, padded so the data after it
+// stays 16-byte aligned in the mapping
+typedef struct
+{
+   GLuint   magic;
+   GLuint   version;
+   GLuint   keyLow;
+   GLuint   keyHigh;
+   GLuint   sizeLow;
+   GLuint   sizeHigh;
+   GLuint   reserved[2];
+} AssetCacheHeader;
+
+typedef struct
+{
+   // Set under the lock
+   GLboolean             initialized;
+   GLboolean             enabled;
+   char                  directory[ASSET_CACHE_PATH_MAX];
+
+   volatile unsigned int hits;
+   volatile unsigned int misses;
+} AssetCache;
+
+static AssetCache s_caches[CACHE_COUNT];
+
+// Environment variable giving the directory of each cache, unless
+// initialized before use
+static const char *const s_cacheVariables[CACHE_COUNT] =
+{
+   "ES_ASSET_CACHE_DIR",
+   "ES_PROGRAM_CACHE_DIR"
+};
+
+// Guards the directory and state of every cache, created once
+static ESMutex *s_cacheLock;
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// FetchAdd()
+//
+static unsigned int FetchAdd ( volatile unsigned int *value, unsigned int add )
+{
+#ifdef _MSC_VER
+   return ( unsigned int ) InterlockedExchangeAdd ( ( volatile LONG * ) value, ( LONG ) add );
+#else
+   return __atomic_fetch_add ( value, add, __ATOMIC_RELAXED );
+#endif
+}
+
+///
+// LoadRelaxed()
+//
+static unsigned int LoadRelaxed ( volatile unsigned int *value )
+{
+#ifdef _MSC_VER
+   return ( unsigned int ) InterlockedCompareExchange ( ( volatile LONG * ) value, 0, 0 );
+#else
+   return __atomic_load_n ( value, __ATOMIC_RELAXED );
+#endif
+}
+
+///
+// CreateCacheLock()
+//
+static void CreateCacheLock ( void )
+{
+   s_cacheLock = esMutexCreate ( );
+}
+
+#ifdef _WIN32
+static BOOL CALLBACK CreateCacheLockOnce ( PINIT_ONCE initOnce, PVOID param, PVOID *context )
+{
+   CreateCacheLock ( );
+   return TRUE;
+}
+#endif
+
+///
+// LockCaches()
+//
+static void LockCaches ( void )
+{
+#ifdef _WIN32
+   static INIT_ONCE initOnce = INIT_ONCE_STATIC_INIT;
+
+   InitOnceExecuteOnce ( &initOnce, CreateCacheLockOnce, NULL, NULL );
+#else
+   static pthread_once_t initOnce = PTHREAD_ONCE_INIT;
+
+   pthread_once ( &initOnce, CreateCacheLock );
+#endif
+
+   esMutexLock ( s_cacheLock );
+}
+
+///
+// InitCache()
+//
+//    Point a cache at directory, or disable it if directory is NULL.  Called
+//    with the lock held.
+//
+static void InitCache ( AssetCache *cache, const char *directory )
+{
+   cache->initialized = GL_TRUE;
+   cache->enabled = GL_FALSE;
+
+   if ( directory == NULL || directory[0] == '\0' ||
+         strlen ( directory ) + 32 >= ASSET_CACHE_PATH_MAX )
+   {
+      return;
+   }
+
+#if defined(ANDROID) || defined(__APPLE__)
+   // esMapFile opens files from the application package on these platforms
+   return;
+#else
+   strcpy ( cache->directory, directory );
+
+   // Create the directory if needed, it is fine if it already exists
+#ifdef _WIN32
+   _mkdir ( directory );
+#else
+   mkdir ( directory, 0755 );
+#endif
+
+   cache->enabled = GL_TRUE;
+#endif
+}
+
+///
+// AssetCachePath()
+//
+//    Path of the entry for key, from the environment variable of the cache if
+//    it was never initialized.  Returns GL_FALSE if the cache is disabled or
+//    the path does not fit.
+//
+static GLboolean AssetCachePath ( int cacheIndex, char *path, unsigned long long key, const char *suffix )
+{
+   AssetCache *cache = &s_caches[cacheIndex];
+   GLboolean found = GL_FALSE;
+
+   LockCaches ( );
+
+   if ( !cache->initialized )
+   {
+      InitCache ( cache, getenv ( s_cacheVariables[cacheIndex] ) );
+   }
+
+   if ( cache->enabled )
+   {
+      int length = snprintf ( path, ASSET_CACHE_PATH_MAX, "%s/%08x%08x%s", cache->directory,
+                              ( unsigned int ) ( key >> 32 ), ( unsigned int ) key, suffix );
+
+      found = length > 0 && length < ASSET_CACHE_PATH_MAX ? GL_TRUE : GL_FALSE;
+   }
+
+   esMutexUnlock ( s_cacheLock );
+
+   return found;
+}
+
+///
+//  CacheEnabled()
+//
+//      Whether a cache has a directory
+//
+GLboolean CacheEnabled ( int cacheIndex )
+{
+   AssetCache *cache = &s_caches[cacheIndex];
+   GLboolean enabled;
+
+   LockCaches ( );
+
+   if ( !cache->initialized )
+   {
+      InitCache ( cache, getenv ( s_cacheVariables[cacheIndex] ) );
+   }
+
+   enabled = cache->enabled;
+   esMutexUnlock ( s_cacheLock );
+
+   return enabled;
+}
+
+///
+//  CacheMap()
+//
+//      Map the entry for key, whatever its size, and return its data.  NULL
+//      if the cache is disabled or has no valid entry.
+//
+const void *CacheMap ( int cacheIndex, unsigned long long key, ESMappedFile *file, size_t *size )
+{
+   char path[ASSET_CACHE_PATH_MAX];
+   const AssetCacheHeader *header;
+
+   memset ( file, 0, sizeof ( ESMappedFile ) );
+   *size = 0;
+
+   if ( !AssetCachePath ( cacheIndex, path, key, ".bin" ) || !esMapFile ( NULL, path, file ) )
+   {
+      return NULL;
+   }
+
+   header = ( const AssetCacheHeader * ) file->data;
+
+   if ( file->size < sizeof ( AssetCacheHeader ) ||
+         header->magic != ASSET_CACHE_MAGIC || header->version != ASSET_CACHE_VERSION ||
+         header->keyLow != ( GLuint ) key || header->keyHigh != ( GLuint ) ( key >> 32 ) ||
+         header->sizeLow != ( GLuint ) ( file->size - sizeof ( AssetCacheHeader ) ) ||
+         header->sizeHigh != ( GLuint ) ( ( unsigned long long ) ( file->size - sizeof ( AssetCacheHeader ) ) >> 32 ) )
+   {
+      esUnmapFile ( file );
+      return NULL;
+   }
+
+   *size = file->size - sizeof ( AssetCacheHeader );
+
+   return file->data + sizeof ( AssetCacheHeader );
+}
+
+///
+//  CacheStore()
+//
+//      Write the entry for key, replacing any entry with the same key
+//
+GLboolean CacheStore ( int cacheIndex, unsigned long long key, const void *data, size_t size )
+{
+   char path[ASSET_CACHE_PATH_MAX];
+   char tempPath[ASSET_CACHE_PATH_MAX];
+   AssetCacheHeader header;
+   GLboolean written;
+   FILE *fp;
+
+   memset ( &header, 0, sizeof ( header ) );
+   header.magic = ASSET_CACHE_MAGIC;
+   header.version = ASSET_CACHE_VERSION;
+   header.keyLow = ( GLuint ) key;
+   header.keyHigh = ( GLuint ) ( key >> 32 );
+   header.sizeLow = ( GLuint ) size;
+   header.sizeHigh = ( GLuint ) ( ( unsigned long long ) size >> 32 );
+
+   // Write to a temporary file and rename it, so a run that reads the entry
+   // meanwhile never maps half a file
+   if ( !AssetCachePath ( cacheIndex, path, key, ".bin" ) || !AssetCachePath ( cacheIndex, tempPath, key, ".tmp" ) )
+   {
+      return GL_FALSE;
+   }
+
+   fp = fopen ( tempPath, "wb" );
+
+   if ( fp == NULL )
+   {
+      esLogMessage ( "esCache: could not write cache file %s\n", tempPath );
+      return GL_FALSE;
+   }
+
+   written = fwrite ( &header, sizeof ( header ), 1, fp ) == 1 &&
+             ( size == 0 || fwrite ( data, size, 1, fp ) == 1 );
+   written = fclose ( fp ) == 0 && written;
+
+   if ( !written || rename ( tempPath, path ) != 0 )
+   {
+      // Another run may have stored the same entry first
+      remove ( tempPath );
+      return GL_FALSE;
+   }
+
+   return GL_TRUE;
+}
+
+///
+//  CacheCount()
+//
+//      Count a lookup of a cache as a hit or a miss, from any thread
+//
+void CacheCount ( int cacheIndex, GLboolean hit )
+{
+   AssetCache *cache = &s_caches[cacheIndex];
+
+   FetchAdd ( hit ? &cache->hits : &cache->misses, 1 );
+}
+
+///
+//  CacheInit()
+//
+//      Point a cache at directory, or disable it if directory is NULL
+//
+void CacheInit ( int cacheIndex, const char *directory )
+{
+   LockCaches ( );
+   InitCache ( &s_caches[cacheIndex], directory );
+   esMutexUnlock ( s_cacheLock );
+}
+
+///
+//  CacheGetStats()
+//
+//      Read the counters of a cache
+//
+void CacheGetStats ( int cacheIndex, int *hits, int *misses )
+{
+   AssetCache *cache = &s_caches[cacheIndex];
+
+   if ( hits != NULL )
+   {
+      *hits = ( int ) LoadRelaxed ( &cache->hits );
+   }
+
+   if ( misses != NULL )
+   {
+      *misses = ( int ) LoadRelaxed ( &cache->misses );
+   }
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+//
+///
+/// \brief Enable the on-disk asset cache
+//
+void ESUTIL_API esAssetCacheInit ( const char *directory )
+{
+   CacheInit ( CACHE_ASSETS, directory );
+}
+
+//
+///
+/// \brief Hash data into an asset cache key
+//
+unsigned long long ESUTIL_API esAssetCacheKey ( unsigned long long hash, const void *data, size_t size )
+{
+   const unsigned char *p = ( const unsigned char * ) data;
+   size_t i;
+
+   // 64-bit FNV-1a
+   if ( hash == 0 )
+   {
+      hash = 0xcbf29ce484222325ULL;
+   }
+
+   for ( i = 0; i < size; i++ )
+   {
+      hash ^= p[i];
+      hash *= 0x100000001b3ULL;
+   }
+
+   return hash;
+}
+
+//
+///
+/// \brief Map a cache entry
+//
+const void *ESUTIL_API esAssetCacheMap ( unsigned long long key, size_t size, ESMappedFile *file )
+{
+   const void *data;
+   size_t entrySize;
+
+   if ( !CacheEnabled ( CACHE_ASSETS ) )
+   {
+      memset ( file, 0, sizeof ( ESMappedFile ) );
+      return NULL;
+   }
+
+   data = CacheMap ( CACHE_ASSETS, key, file, &entrySize );
+
+   if ( data != NULL && entrySize != size )
+   {
+      esUnmapFile ( file );
+      data = NULL;
+   }
+
+   CacheCount ( CACHE_ASSETS, data != NULL ? GL_TRUE : GL_FALSE );
+
+   return data;
+}
+
+//
+///
+/// \brief Store a cache entry
+//
+GLboolean ESUTIL_API esAssetCacheStore ( unsigned long long key, const void *data, size_t size )
+{
+   return CacheStore ( CACHE_ASSETS, key, data, size );
+}
+
+//
+///
+/// \brief Get the asset cache counters
+//
+void ESUTIL_API esAssetCacheGetStats ( int *hits, int *misses )
+{
+   CacheGetStats ( CACHE_ASSETS, hits, misses );
+}
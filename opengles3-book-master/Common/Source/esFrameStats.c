@@ -0,0 +1,483 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// ESFrameStats.c
+//
+//    Timing of the main loop.  Every frame's update, draw and swap times go
+//    into a ring that other threads can read without locks, from which
+//    frame time percentiles are computed and periodically written out.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include "esUtil_win.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+///
+//  Macros
+//
+
+// Frames kept in the history, a power of two
+#define FRAME_HISTORY_SIZE      1024
+
+// Frames between two writes of the statistics, unless ES_FRAME_STATS_INTERVAL
+// says otherwise
+#define DEFAULT_OUTPUT_INTERVAL 300
+
+///
+//  Types
+//
+struct ESFrameHistory
+{
+   ESFrameTime   frames[FRAME_HISTORY_SIZE];
+
+   // Frames recorded so far.  Only the main loop writes it, after the frame
+   // itself, so readers know which slots hold complete frames.
+   volatile unsigned int count;
+
+   // End of the previous frame, in seconds
+   double        lastFrameEnd;
+
+   // Periodic output, NULL to stdout through esLogMessage
+   FILE         *output;
+   GLboolean     outputEnabled;
+   GLboolean     json;
+   int           interval;
+};
+
+///
+// LoadAcquire()
+//
+static unsigned int LoadAcquire ( volatile unsigned int *value )
+{
+#ifdef _MSC_VER
+   return ( unsigned int ) InterlockedCompareExchange ( ( volatile LONG * ) value, 0, 0 );
+#else
+   return __atomic_load_n ( value, __ATOMIC_ACQUIRE );
+#endif
+}
+
+///
+// StoreRelease()
+//
+static void StoreRelease ( volatile unsigned int *value, unsigned int newValue )
+{
+#ifdef _MSC_VER
+   InterlockedExchange ( ( volatile LONG * ) value, ( LONG ) newValue );
+#else
+   __atomic_store_n ( value, newValue, __ATOMIC_RELEASE );
+#endif
+}
+
+///
+// ReadFence()
+//
+//    Keep the reads of the frames before the second read of count
+//
+static void ReadFence ( void )
+{
+#ifdef _MSC_VER
+   MemoryBarrier ( );
+#else
+   __atomic_thread_fence ( __ATOMIC_ACQUIRE );
+#endif
+}
+
+///
+// CompareFloats()
+//
+static int CompareFloats ( const void *a, const void *b )
+{
+   float fa = * ( const float * ) a;
+   float fb = * ( const float * ) b;
+
+   return fa < fb ? -1 : fa > fb ? 1 : 0;
+}
+
+///
+// Percentile()
+//
+//    Nearest-rank percentile of sorted values
+//
+static float Percentile ( const float *sorted, int count, int percent )
+{
+   int rank = ( count * percent + 99 ) / 100;
+
+   return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+///
+// OpenOutput()
+//
+//    "-" writes through esLogMessage, a name ending in .json writes one JSON
+//    object per line, anything else CSV
+//
+static GLboolean OpenOutput ( ESFrameHistory *history, const char *fileName, int interval )
+{
+   size_t length = strlen ( fileName );
+
+   if ( history->output != NULL )
+   {
+      fclose ( history->output );
+      history->output = NULL;
+   }
+
+   history->json = length >= 5 && strcmp ( fileName + length - 5, ".json" ) == 0 ? GL_TRUE : GL_FALSE;
+   history->interval = interval > 0 ? interval : DEFAULT_OUTPUT_INTERVAL;
+   history->outputEnabled = GL_TRUE;
+
+   if ( strcmp ( fileName, "-" ) != 0 )
+   {
+      history->output = fopen ( fileName, "w" );
+
+      if ( history->output == NULL )
+      {
+         esLogMessage ( "esFrameStats: cannot open { %s }\n", fileName );
+         history->outputEnabled = GL_FALSE;
+         return GL_FALSE;
+      }
+
+      if ( !history->json )
+      {
+         fprintf ( history->output, "frame,frames,p50_ms,p95_ms,p99_ms,max_ms,update_ms,draw_ms,swap_ms,gpu_ms\n" );
+      }
+   }
+
+   return GL_TRUE;
+}
+
+///
+// GetHistory()
+//
+//    Create the history on first use, with the output given by ES_FRAME_STATS
+//
+static ESFrameHistory *GetHistory ( ESContext *esContext )
+{
+   if ( esContext->frameHistory == NULL )
+   {
+      const char *fileName = getenv ( "ES_FRAME_STATS" );
+      const char *interval = getenv ( "ES_FRAME_STATS_INTERVAL" );
+
+      esContext->frameHistory = calloc ( 1, sizeof ( ESFrameHistory ) );
+
+      if ( esContext->frameHistory != NULL && fileName != NULL && fileName[0] != '\0' )
+      {
+         OpenOutput ( esContext->frameHistory, fileName, interval != NULL ? atoi ( interval ) : 0 );
+      }
+   }
+
+   return esContext->frameHistory;
+}
+
+///
+// WriteStats()
+//
+static void WriteStats ( ESContext *esContext )
+{
+   ESFrameHistory *history = esContext->frameHistory;
+   ESFrameStats stats;
+
+   if ( !esGetFrameStats ( esContext, &stats ) )
+   {
+      return;
+   }
+
+   if ( history->output == NULL )
+   {
+      esLogMessage ( "frame %u: p50 %.2f ms, p95 %.2f ms, p99 %.2f ms, max %.2f ms "
+                     "(update %.2f ms, draw %.2f ms, swap %.2f ms, GPU %.2f ms)\n",
+                     stats.totalFrames, stats.p50, stats.p95, stats.p99, stats.max,
+                     stats.update, stats.draw, stats.swap, stats.gpu );
+   }
+   else if ( history->json )
+   {
+      fprintf ( history->output, "{\"frame\":%u,\"frames\":%d,\"p50_ms\":%.3f,\"p95_ms\":%.3f,\"p99_ms\":%.3f,"
+                "\"max_ms\":%.3f,\"update_ms\":%.3f,\"draw_ms\":%.3f,\"swap_ms\":%.3f,\"gpu_ms\":%.3f}\n",
+                stats.totalFrames, stats.numFrames, stats.p50, stats.p95, stats.p99, stats.max,
+                stats.update, stats.draw, stats.swap, stats.gpu );
+      fflush ( history->output );
+   }
+   else
+   {
+      fprintf ( history->output, "%u,%d,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n",
+                stats.totalFrames, stats.numFrames, stats.p50, stats.p95, stats.p99, stats.max,
+                stats.update, stats.draw, stats.swap, stats.gpu );
+      fflush ( history->output );
+   }
+}
+
+///
+//  FrameStatsRecord()
+//
+//      Add a frame to the history of esContext, times in seconds
+//
+void FrameStatsRecord ( ESContext *esContext, double updateTime, double drawTime, double swapTime )
+{
+   ESFrameHistory *history = GetHistory ( esContext );
+   double now = esGetTime ( );
+   unsigned int count;
+   ESFrameTime *frame;
+
+   if ( history == NULL )
+   {
+      return;
+   }
+
+   count = history->count;
+   frame = &history->frames[count & ( FRAME_HISTORY_SIZE - 1 )];
+   frame->update = ( float ) ( updateTime * 1000.0 );
+   frame->draw = ( float ) ( drawTime * 1000.0 );
+   frame->swap = ( float ) ( swapTime * 1000.0 );
+   frame->gpu = -1.0f;
+
+   // The first frame has no previous one, count its own phases only
+   frame->total = count > 0 ? ( float ) ( ( now - history->lastFrameEnd ) * 1000.0 ) :
+                  frame->update + frame->draw + frame->swap;
+   history->lastFrameEnd = now;
+
+   StoreRelease ( &history->count, count + 1 );
+   StateEndFrame ( );
+   BenchmarkRecordFrame ( frame );
+
+   // GPU times of earlier frames land in the history from here, so the
+   // statistics are written after
+   ProfilerEndFrame ( esContext, count, frame );
+
+   if ( history->outputEnabled && ( count + 1 ) % history->interval == 0 )
+   {
+      WriteStats ( esContext );
+   }
+}
+
+///
+//  FrameStatsShutdown()
+//
+//      Write the final statistics and release the history
+//
+void FrameStatsShutdown ( ESContext *esContext )
+{
+   ESFrameHistory *history = esContext->frameHistory;
+
+   if ( history == NULL )
+   {
+      return;
+   }
+
+   if ( history->outputEnabled && history->count % history->interval != 0 )
+   {
+      WriteStats ( esContext );
+   }
+
+   if ( history->output != NULL )
+   {
+      fclose ( history->output );
+   }
+
+   free ( history );
+   esContext->frameHistory = NULL;
+}
+
+///
+//  FrameStatsSetGPUTime()
+//
+//      Set the GPU time, in seconds, of a frame recorded earlier
+//
+void FrameStatsSetGPUTime ( ESContext *esContext, unsigned int frameNumber, double gpuTime )
+{
+   ESFrameHistory *history = esContext->frameHistory;
+
+   // Nothing to do once the frame has left the ring
+   if ( history == NULL || history->count - frameNumber > FRAME_HISTORY_SIZE )
+   {
+      return;
+   }
+
+   history->frames[frameNumber & ( FRAME_HISTORY_SIZE - 1 )].gpu = ( float ) ( gpuTime * 1000.0 );
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+//
+///
+/// \brief Monotonic time in seconds
+//
+double ESUTIL_API esGetTime ( void )
+{
+#ifdef _WIN32
+   static LARGE_INTEGER frequency;
+   LARGE_INTEGER counter;
+
+   if ( frequency.QuadPart == 0 )
+   {
+      QueryPerformanceFrequency ( &frequency );
+   }
+
+   QueryPerformanceCounter ( &counter );
+
+   return ( double ) counter.QuadPart / frequency.QuadPart;
+#else
+   struct timespec ts;
+
+   clock_gettime ( CLOCK_MONOTONIC, &ts );
+
+   return ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif
+}
+
+//
+///
+/// \brief Frame time statistics over the most recent frames
+//
+GLboolean ESUTIL_API esGetFrameStats ( ESContext *esContext, ESFrameStats *stats )
+{
+   ESFrameHistory *history = esContext->frameHistory;
+   ESFrameTime *frames;
+   float *totals;
+   unsigned int first, last, overwritten, i;
+   int count = 0;
+   int gpuCount = 0;
+
+   memset ( stats, 0, sizeof ( ESFrameStats ) );
+
+   if ( history == NULL )
+   {
+      return GL_FALSE;
+   }
+
+   frames = malloc ( FRAME_HISTORY_SIZE * sizeof ( ESFrameTime ) );
+   totals = malloc ( FRAME_HISTORY_SIZE * sizeof ( float ) );
+
+   if ( frames == NULL || totals == NULL )
+   {
+      free ( frames );
+      free ( totals );
+      return GL_FALSE;
+   }
+
+   // Copy the ring, then drop the frames the main loop may have overwritten
+   // meanwhile: everything up to one ring behind the slot it is writing now
+   last = LoadAcquire ( &history->count );
+   first = last > FRAME_HISTORY_SIZE ? last - FRAME_HISTORY_SIZE : 0;
+
+   for ( i = first; i != last; i++ )
+   {
+      frames[i - first] = history->frames[i & ( FRAME_HISTORY_SIZE - 1 )];
+   }
+
+   ReadFence ( );
+   overwritten = LoadAcquire ( &history->count ) + 1;
+   overwritten = overwritten > FRAME_HISTORY_SIZE ? overwritten - FRAME_HISTORY_SIZE : 0;
+
+   for ( i = first; i != last; i++ )
+   {
+      const ESFrameTime *frame = &frames[i - first];
+
+      if ( i < overwritten )
+      {
+         continue;
+      }
+
+      totals[count++] = frame->total;
+      stats->update += frame->update;
+      stats->draw += frame->draw;
+      stats->swap += frame->swap;
+
+      if ( frame->gpu >= 0.0f )
+      {
+         stats->gpu += frame->gpu;
+         gpuCount++;
+      }
+   }
+
+   if ( count > 0 )
+   {
+      qsort ( totals, count, sizeof ( float ), CompareFloats );
+
+      stats->numFrames = count;
+      stats->totalFrames = last;
+      stats->p50 = Percentile ( totals, count, 50 );
+      stats->p95 = Percentile ( totals, count, 95 );
+      stats->p99 = Percentile ( totals, count, 99 );
+      stats->max = totals[count - 1];
+      stats->update /= count;
+      stats->draw /= count;
+      stats->swap /= count;
+      stats->gpu = gpuCount > 0 ? stats->gpu / gpuCount : 0.0f;
+   }
+
+   free ( frames );
+   free ( totals );
+
+   return count > 0 ? GL_TRUE : GL_FALSE;
+}
+
+//
+///
+/// \brief Periodically write frame statistics
+//
+GLboolean ESUTIL_API esFrameStatsOutput ( ESContext *esContext, const char *fileName, int interval )
+{
+   ESFrameHistory *history = GetHistory ( esContext );
+
+   if ( history == NULL )
+   {
+      return GL_FALSE;
+   }
+
+   if ( fileName == NULL )
+   {
+      if ( history->output != NULL )
+      {
+         fclose ( history->output );
+         history->output = NULL;
+      }
+
+      history->outputEnabled = GL_FALSE;
+      return GL_TRUE;
+   }
+
+   return OpenOutput ( history, fileName, interval );
+}
@@ -0,0 +1,1220 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// ESImage.c
+//
+//    Read-only file mapping and image loading.  Uncompressed images are
+//    returned as a pointer into the mapped file so they can be handed to
+//    glTexImage2D without an intermediate copy.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include "esUtil_win.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef ANDROID
+#include <android/asset_manager.h>
+#elif defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef __APPLE__
+#include "FileWrapper.h"
+#endif
+
+///
+//  Macros
+//
+#define TGA_HEADER_SIZE         18
+
+// TGA image descriptor bit set when the first row is the top of the image
+#define INVERTED_BIT            (1 << 5)
+
+// KTX 1.1 container
+#define KTX_HEADER_SIZE         64
+#define KTX_ENDIANNESS          0x04030201
+
+// TGA image types
+#define TGA_TYPE_COLORMAPPED    1
+#define TGA_TYPE_TRUECOLOR      2
+#define TGA_TYPE_GRAYSCALE      3
+#define TGA_TYPE_RLE_BIT        8
+
+// PVR containers, version 3 and the legacy version 2
+#define PVR3_MAGIC              0x03525650
+#define PVR3_HEADER_SIZE        52
+#define PVR2_TAG                0x21525650
+#define PVR2_HEADER_SIZE        52
+#define PVR2_FLAG_CUBEMAP       0x1000
+#define PVR2_FLAG_ALPHA         0x8000
+
+// PVR 3 color space and channel type
+#define PVR3_COLORSPACE_SRGB    1
+#define PVR3_UNSIGNED_BYTE_NORM 0
+#define PVR3_UNSIGNED_SHORT_NORM 4
+
+// Extension formats a PVR file may hold
+#ifndef GL_COMPRESSED_RGB_PVRTC_4BPPV1_IMG
+#define GL_COMPRESSED_RGB_PVRTC_4BPPV1_IMG   0x8C00
+#define GL_COMPRESSED_RGB_PVRTC_2BPPV1_IMG   0x8C01
+#define GL_COMPRESSED_RGBA_PVRTC_4BPPV1_IMG  0x8C02
+#define GL_COMPRESSED_RGBA_PVRTC_2BPPV1_IMG  0x8C03
+#endif
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT      0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT3_EXT     0x83F2
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT     0x83F3
+#endif
+
+#ifndef GL_BGRA_EXT
+#define GL_BGRA_EXT                          0x80E1
+#endif
+
+///
+//  Types
+//
+
+// How a PVR pixel format is uploaded
+typedef struct
+{
+   const char *name;
+
+   // Compressed when format is 0
+   GLenum      internalFormat;
+   GLenum      srgbInternalFormat;
+   GLenum      format;
+   GLenum      type;
+
+   // Uncompressed bits per pixel, or compressed block size in pixels and
+   // bytes, with the smallest number of blocks a level can have
+   int         bitsPerPixel;
+   int         blockWidth;
+   int         blockHeight;
+   int         blockBytes;
+   int         minBlocks;
+
+   // Extension needed to upload the format, NULL for core formats
+   const char *extension;
+} PVRFormat;
+
+#define PVR_COMPRESSED(name, internalFormat, srgbFormat, blockWidth, blockHeight, blockBytes, minBlocks, extension) \
+   { name, internalFormat, srgbFormat, 0, 0, 0, blockWidth, blockHeight, blockBytes, minBlocks, extension }
+
+#define PVR_PIXELS(name, internalFormat, srgbFormat, format, type, bitsPerPixel, extension) \
+   { name, internalFormat, srgbFormat, format, type, bitsPerPixel, 1, 1, 0, 1, extension }
+
+#define PVRTC_EXTENSION         "GL_IMG_texture_compression_pvrtc"
+#define S3TC_EXTENSION          "GL_EXT_texture_compression_s3tc"
+#define BGRA_EXTENSION          "GL_EXT_texture_format_BGRA8888"
+
+// Version 3 compressed formats, indexed by pixel format
+static const PVRFormat pvr3CompressedFormats[] =
+{
+   PVR_COMPRESSED ( "PVRTC 2bpp RGB", GL_COMPRESSED_RGB_PVRTC_2BPPV1_IMG, 0, 8, 4, 8, 2, PVRTC_EXTENSION ),
+   PVR_COMPRESSED ( "PVRTC 2bpp RGBA", GL_COMPRESSED_RGBA_PVRTC_2BPPV1_IMG, 0, 8, 4, 8, 2, PVRTC_EXTENSION ),
+   PVR_COMPRESSED ( "PVRTC 4bpp RGB", GL_COMPRESSED_RGB_PVRTC_4BPPV1_IMG, 0, 4, 4, 8, 2, PVRTC_EXTENSION ),
+   PVR_COMPRESSED ( "PVRTC 4bpp RGBA", GL_COMPRESSED_RGBA_PVRTC_4BPPV1_IMG, 0, 4, 4, 8, 2, PVRTC_EXTENSION ),
+   PVR_COMPRESSED ( "PVRTC-II 2bpp", 0, 0, 8, 4, 8, 1, NULL ),
+   PVR_COMPRESSED ( "PVRTC-II 4bpp", 0, 0, 4, 4, 8, 1, NULL ),
+   // ETC1 blocks are valid ETC2 blocks
+   PVR_COMPRESSED ( "ETC1", GL_COMPRESSED_RGB8_ETC2, GL_COMPRESSED_SRGB8_ETC2, 4, 4, 8, 1, NULL ),
+   PVR_COMPRESSED ( "DXT1", GL_COMPRESSED_RGB_S3TC_DXT1_EXT, 0, 4, 4, 8, 1, S3TC_EXTENSION ),
+   PVR_COMPRESSED ( "DXT2", 0, 0, 4, 4, 16, 1, NULL ),
+   PVR_COMPRESSED ( "DXT3", GL_COMPRESSED_RGBA_S3TC_DXT3_EXT, 0, 4, 4, 16, 1, S3TC_EXTENSION ),
+   PVR_COMPRESSED ( "DXT4", 0, 0, 4, 4, 16, 1, NULL ),
+   PVR_COMPRESSED ( "DXT5", GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, 0, 4, 4, 16, 1, S3TC_EXTENSION ),
+   PVR_COMPRESSED ( "BC4", 0, 0, 4, 4, 8, 1, NULL ),
+   PVR_COMPRESSED ( "BC5", 0, 0, 4, 4, 16, 1, NULL ),
+   PVR_COMPRESSED ( "BC6", 0, 0, 4, 4, 16, 1, NULL ),
+   PVR_COMPRESSED ( "BC7", 0, 0, 4, 4, 16, 1, NULL ),
+   PVR_COMPRESSED ( "UYVY", 0, 0, 2, 1, 4, 1, NULL ),
+   PVR_COMPRESSED ( "YUY2", 0, 0, 2, 1, 4, 1, NULL ),
+   PVR_COMPRESSED ( "BW1bpp", 0, 0, 8, 1, 1, 1, NULL ),
+   PVR_COMPRESSED ( "R9G9B9E5", 0, 0, 1, 1, 4, 1, NULL ),
+   PVR_COMPRESSED ( "RGBG8888", 0, 0, 2, 1, 4, 1, NULL ),
+   PVR_COMPRESSED ( "GRGB8888", 0, 0, 2, 1, 4, 1, NULL ),
+   PVR_COMPRESSED ( "ETC2 RGB", GL_COMPRESSED_RGB8_ETC2, GL_COMPRESSED_SRGB8_ETC2, 4, 4, 8, 1, NULL ),
+   PVR_COMPRESSED ( "ETC2 RGBA", GL_COMPRESSED_RGBA8_ETC2_EAC, GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC, 4, 4, 16, 1, NULL ),
+   PVR_COMPRESSED ( "ETC2 RGB A1", GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2,
+                    GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2, 4, 4, 8, 1, NULL ),
+   PVR_COMPRESSED ( "EAC R11", GL_COMPRESSED_R11_EAC, 0, 4, 4, 8, 1, NULL ),
+   PVR_COMPRESSED ( "EAC RG11", GL_COMPRESSED_RG11_EAC, 0, 4, 4, 16, 1, NULL )
+};
+
+// Version 3 uncompressed formats, by channel order and bits per channel
+static const struct
+{
+   const char   *channels;
+   unsigned int  bits;
+   PVRFormat     format;
+} pvr3PixelFormats[] =
+{
+   { "rgba", 0x08080808, PVR_PIXELS ( "RGBA8888", GL_RGBA, GL_SRGB8_ALPHA8, GL_RGBA, GL_UNSIGNED_BYTE, 32, NULL ) },
+   { "rgb",  0x00080808, PVR_PIXELS ( "RGB888", GL_RGB, GL_SRGB8, GL_RGB, GL_UNSIGNED_BYTE, 24, NULL ) },
+   { "bgra", 0x08080808, PVR_PIXELS ( "BGRA8888", GL_BGRA_EXT, 0, GL_BGRA_EXT, GL_UNSIGNED_BYTE, 32, BGRA_EXTENSION ) },
+   { "rgba", 0x04040404, PVR_PIXELS ( "RGBA4444", GL_RGBA, 0, GL_RGBA, GL_UNSIGNED_SHORT_4_4_4_4, 16, NULL ) },
+   { "rgba", 0x01050505, PVR_PIXELS ( "RGBA5551", GL_RGBA, 0, GL_RGBA, GL_UNSIGNED_SHORT_5_5_5_1, 16, NULL ) },
+   { "rgb",  0x00050605, PVR_PIXELS ( "RGB565", GL_RGB, 0, GL_RGB, GL_UNSIGNED_SHORT_5_6_5, 16, NULL ) },
+   { "rg",   0x00000808, PVR_PIXELS ( "RG88", GL_RG8, 0, GL_RG, GL_UNSIGNED_BYTE, 16, NULL ) },
+   { "r",    0x00000008, PVR_PIXELS ( "R8", GL_R8, 0, GL_RED, GL_UNSIGNED_BYTE, 8, NULL ) },
+   { "la",   0x00000808, PVR_PIXELS ( "LA88", GL_LUMINANCE_ALPHA, 0, GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE, 16, NULL ) },
+   { "l",    0x00000008, PVR_PIXELS ( "L8", GL_LUMINANCE, 0, GL_LUMINANCE, GL_UNSIGNED_BYTE, 8, NULL ) },
+   { "a",    0x00000008, PVR_PIXELS ( "A8", GL_ALPHA, 0, GL_ALPHA, GL_UNSIGNED_BYTE, 8, NULL ) }
+};
+
+// Version 2 OpenGL pixel types, starting at 0x10
+#define PVR2_FIRST_GL_TYPE      0x10
+#define PVR2_TYPE_ETC1          0x36
+
+static const PVRFormat pvr2Formats[] =
+{
+   PVR_PIXELS ( "RGBA4444", GL_RGBA, 0, GL_RGBA, GL_UNSIGNED_SHORT_4_4_4_4, 16, NULL ),
+   PVR_PIXELS ( "RGBA5551", GL_RGBA, 0, GL_RGBA, GL_UNSIGNED_SHORT_5_5_5_1, 16, NULL ),
+   PVR_PIXELS ( "RGBA8888", GL_RGBA, 0, GL_RGBA, GL_UNSIGNED_BYTE, 32, NULL ),
+   PVR_PIXELS ( "RGB565", GL_RGB, 0, GL_RGB, GL_UNSIGNED_SHORT_5_6_5, 16, NULL ),
+   PVR_PIXELS ( "RGB555", 0, 0, 0, 0, 16, NULL ),
+   PVR_PIXELS ( "RGB888", GL_RGB, 0, GL_RGB, GL_UNSIGNED_BYTE, 24, NULL ),
+   PVR_PIXELS ( "I8", GL_LUMINANCE, 0, GL_LUMINANCE, GL_UNSIGNED_BYTE, 8, NULL ),
+   PVR_PIXELS ( "AI88", GL_LUMINANCE_ALPHA, 0, GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE, 16, NULL ),
+   // PVRTC entries are the opaque variants, see PVR2_FLAG_ALPHA
+   PVR_COMPRESSED ( "PVRTC 2bpp", GL_COMPRESSED_RGB_PVRTC_2BPPV1_IMG, 0, 8, 4, 8, 2, PVRTC_EXTENSION ),
+   PVR_COMPRESSED ( "PVRTC 4bpp", GL_COMPRESSED_RGB_PVRTC_4BPPV1_IMG, 0, 4, 4, 8, 2, PVRTC_EXTENSION ),
+   PVR_PIXELS ( "BGRA8888", GL_BGRA_EXT, 0, GL_BGRA_EXT, GL_UNSIGNED_BYTE, 32, BGRA_EXTENSION ),
+   PVR_PIXELS ( "A8", GL_ALPHA, 0, GL_ALPHA, GL_UNSIGNED_BYTE, 8, NULL )
+};
+
+static const PVRFormat pvr2ETC1Format =
+   PVR_COMPRESSED ( "ETC1", GL_COMPRESSED_RGB8_ETC2, 0, 4, 4, 8, 1, NULL );
+
+static const PVRFormat pvr2PVRTCAlphaFormats[2] =
+{
+   PVR_COMPRESSED ( "PVRTC 2bpp RGBA", GL_COMPRESSED_RGBA_PVRTC_2BPPV1_IMG, 0, 8, 4, 8, 2, PVRTC_EXTENSION ),
+   PVR_COMPRESSED ( "PVRTC 4bpp RGBA", GL_COMPRESSED_RGBA_PVRTC_4BPPV1_IMG, 0, 4, 4, 8, 2, PVRTC_EXTENSION )
+};
+
+// Layout of the surfaces in a PVR file
+typedef struct
+{
+   const PVRFormat *format;
+   GLenum           internalFormat;
+   int              width;
+   int              height;
+   int              numLevels;
+   int              numFaces;
+
+   // Version 2 stores all levels of a face together, version 3 all faces
+   // of a level
+   GLboolean        faceMajor;
+   size_t           dataOffset;
+} PVRLayout;
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// ReadU16()
+//
+//    Read a little-endian 16-bit value
+//
+static unsigned int ReadU16 ( const unsigned char *data )
+{
+   return data[0] | ( data[1] << 8 );
+}
+
+///
+// DecodeRLE()
+//
+//    Decode TGA run-length packets into numPixels pixels of bpp bytes.
+//    Packets may span rows, so the source is decoded as one stream.
+//
+static GLboolean DecodeRLE ( const unsigned char *src, size_t srcSize,
+                             unsigned char *dst, size_t numPixels, int bpp )
+{
+   const unsigned char *srcEnd = src + srcSize;
+   unsigned char *dstEnd = dst + numPixels * bpp;
+
+   while ( dst < dstEnd )
+   {
+      unsigned char packet;
+      size_t bytes;
+
+      if ( src >= srcEnd )
+      {
+         return GL_FALSE;
+      }
+
+      packet = *src++;
+      bytes = ( size_t ) ( ( packet & 0x7F ) + 1 ) * bpp;
+
+      if ( bytes > ( size_t ) ( dstEnd - dst ) )
+      {
+         return GL_FALSE;
+      }
+
+      if ( packet & 0x80 )
+      {
+         // Run packet: one pixel repeated
+         if ( ( size_t ) ( srcEnd - src ) < ( size_t ) bpp )
+         {
+            return GL_FALSE;
+         }
+
+         if ( bpp == 1 )
+         {
+            memset ( dst, *src, bytes );
+         }
+         else
+         {
+            size_t filled = bpp;
+
+            // Fill by doubling the already written span
+            memcpy ( dst, src, bpp );
+
+            while ( filled < bytes )
+            {
+               size_t n = filled < bytes - filled ? filled : bytes - filled;
+
+               memcpy ( dst + filled, dst, n );
+               filled += n;
+            }
+         }
+
+         src += bpp;
+      }
+      else
+      {
+         // Raw packet: pixels copied as is
+         if ( ( size_t ) ( srcEnd - src ) < bytes )
+         {
+            return GL_FALSE;
+         }
+
+         memcpy ( dst, src, bytes );
+         src += bytes;
+      }
+
+      dst += bytes;
+   }
+
+   return GL_TRUE;
+}
+
+///
+// ExpandColorMap()
+//
+//    Replace 8-bit color map indices with the palette entries they refer to
+//
+static unsigned char *ExpandColorMap ( const unsigned char *indices, size_t numPixels,
+                                       const unsigned char *palette, unsigned int paletteStart,
+                                       unsigned int paletteSize, int bpp )
+{
+   unsigned char *pixels = malloc ( numPixels * bpp );
+   unsigned char *dst = pixels;
+   size_t i;
+
+   if ( pixels == NULL )
+   {
+      return NULL;
+   }
+
+   for ( i = 0; i < numPixels; i++ )
+   {
+      unsigned int entry = indices[i] - paletteStart;
+
+      if ( indices[i] < paletteStart || entry >= paletteSize )
+      {
+         free ( pixels );
+         return NULL;
+      }
+
+      memcpy ( dst, palette + entry * bpp, bpp );
+      dst += bpp;
+   }
+
+   return pixels;
+}
+
+///
+// DecodeTGA()
+//
+//    Parse a TGA file held in memory.  Uncompressed true color and grayscale
+//    images point straight into data, everything else is decoded.
+//
+static GLboolean DecodeTGA ( const unsigned char *data, size_t size, ESImage *image )
+{
+   unsigned int idSize, mapType, imageType, baseType;
+   unsigned int paletteStart, paletteSize, paletteDepth;
+   unsigned int colorDepth, descriptor;
+   const unsigned char *palette = NULL;
+   size_t offset, numPixels, pixelBytes;
+   int srcBpp;
+
+   if ( size < TGA_HEADER_SIZE )
+   {
+      return GL_FALSE;
+   }
+
+   idSize = data[0];
+   mapType = data[1];
+   imageType = data[2];
+   paletteStart = ReadU16 ( data + 3 );
+   paletteSize = ReadU16 ( data + 5 );
+   paletteDepth = data[7];
+   image->width = ReadU16 ( data + 12 );
+   image->height = ReadU16 ( data + 14 );
+   colorDepth = data[16];
+   descriptor = data[17];
+
+   baseType = imageType & ~TGA_TYPE_RLE_BIT;
+   offset = TGA_HEADER_SIZE + idSize;
+
+   if ( mapType == 1 )
+   {
+      palette = data + offset;
+      offset += paletteSize * ( ( paletteDepth + 7 ) / 8 );
+   }
+
+   if ( offset > size || image->width == 0 || image->height == 0 )
+   {
+      return GL_FALSE;
+   }
+
+   if ( baseType == TGA_TYPE_COLORMAPPED )
+   {
+      if ( palette == NULL || colorDepth != 8 || ( paletteDepth != 24 && paletteDepth != 32 ) )
+      {
+         return GL_FALSE;
+      }
+
+      image->bytesPerPixel = paletteDepth / 8;
+   }
+   else if ( ( baseType == TGA_TYPE_TRUECOLOR && ( colorDepth == 24 || colorDepth == 32 ) ) ||
+             ( baseType == TGA_TYPE_GRAYSCALE && colorDepth == 8 ) )
+   {
+      image->bytesPerPixel = colorDepth / 8;
+   }
+   else
+   {
+      return GL_FALSE;
+   }
+
+   image->topDown = ( descriptor & INVERTED_BIT ) ? GL_TRUE : GL_FALSE;
+
+   srcBpp = colorDepth / 8;
+   numPixels = ( size_t ) image->width * image->height;
+   pixelBytes = numPixels * srcBpp;
+   data += offset;
+   size -= offset;
+
+   if ( imageType & TGA_TYPE_RLE_BIT )
+   {
+      image->decoded = malloc ( pixelBytes );
+
+      if ( image->decoded == NULL ||
+            !DecodeRLE ( data, size, image->decoded, numPixels, srcBpp ) )
+      {
+         return GL_FALSE;
+      }
+
+      data = image->decoded;
+   }
+   else if ( size < pixelBytes )
+   {
+      return GL_FALSE;
+   }
+
+   if ( baseType == TGA_TYPE_COLORMAPPED )
+   {
+      unsigned char *expanded = ExpandColorMap ( data, numPixels, palette, paletteStart,
+                                                 paletteSize, image->bytesPerPixel );
+
+      if ( expanded == NULL )
+      {
+         return GL_FALSE;
+      }
+
+      free ( image->decoded );
+      image->decoded = expanded;
+      data = expanded;
+   }
+
+   image->pixels = data;
+
+   return GL_TRUE;
+}
+
+///
+// ReadU32()
+//
+//    Read a 32-bit value, byte swapped if swap is set
+//
+static unsigned int ReadU32 ( const unsigned char *data, GLboolean swap )
+{
+   if ( swap )
+   {
+      return ( data[0] << 24 ) | ( data[1] << 16 ) | ( data[2] << 8 ) | data[3];
+   }
+
+   return data[0] | ( data[1] << 8 ) | ( data[2] << 16 ) | ( ( unsigned int ) data[3] << 24 );
+}
+
+///
+// UploadKTX()
+//
+//    Upload every mip level and cube face of a mapped KTX file to texture
+//
+static GLboolean UploadKTX ( const unsigned char *data, size_t size, GLuint texture, GLenum *target,
+                             int *width, int *height, int *numLevels )
+{
+   static const unsigned char identifier[12] =
+   {
+      0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'
+   };
+   GLboolean swap;
+   GLenum glType, glFormat, glInternalFormat;
+   unsigned int glTypeSize, pixelWidth, pixelHeight, pixelDepth;
+   unsigned int numArrayElements, numFaces, numMipLevels, keyValueBytes;
+   unsigned int level, face;
+   size_t offset;
+
+   if ( size < KTX_HEADER_SIZE || memcmp ( data, identifier, sizeof ( identifier ) ) != 0 )
+   {
+      return GL_FALSE;
+   }
+
+   swap = ReadU32 ( data + 12, GL_FALSE ) != KTX_ENDIANNESS;
+   glType = ReadU32 ( data + 16, swap );
+   glTypeSize = ReadU32 ( data + 20, swap );
+   glFormat = ReadU32 ( data + 24, swap );
+   glInternalFormat = ReadU32 ( data + 28, swap );
+   pixelWidth = ReadU32 ( data + 36, swap );
+   pixelHeight = ReadU32 ( data + 40, swap );
+   pixelDepth = ReadU32 ( data + 44, swap );
+   numArrayElements = ReadU32 ( data + 48, swap );
+   numFaces = ReadU32 ( data + 52, swap );
+   numMipLevels = ReadU32 ( data + 56, swap );
+   keyValueBytes = ReadU32 ( data + 60, swap );
+
+   // Only plain 2D textures and cube maps.  Pixels wider than a byte would
+   // need swapping, which defeats uploading from the mapping.
+   if ( pixelDepth != 0 || numArrayElements != 0 || ( numFaces != 1 && numFaces != 6 ) ||
+         pixelWidth == 0 || ( swap && glTypeSize != 1 ) )
+   {
+      return GL_FALSE;
+   }
+
+   *target = numFaces == 6 ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D;
+   glBindTexture ( *target, texture );
+   StateSetTexture ( *target, texture );
+
+   if ( pixelHeight == 0 )
+   {
+      pixelHeight = 1;
+   }
+
+   // Zero levels asks for the chain to be generated after loading the base
+   // level, which is done below for uncompressed formats
+   *numLevels = numMipLevels == 0 ? 1 : numMipLevels;
+   *width = pixelWidth;
+   *height = pixelHeight;
+
+   offset = KTX_HEADER_SIZE + keyValueBytes;
+
+   for ( level = 0; level < ( unsigned int ) *numLevels; level++ )
+   {
+      GLsizei levelWidth = pixelWidth >> level ? pixelWidth >> level : 1;
+      GLsizei levelHeight = pixelHeight >> level ? pixelHeight >> level : 1;
+      unsigned int imageSize;
+
+      if ( offset + 4 > size )
+      {
+         return GL_FALSE;
+      }
+
+      // Size of one face for cube maps, of the whole level otherwise
+      imageSize = ReadU32 ( data + offset, swap );
+      offset += 4;
+
+      for ( face = 0; face < numFaces; face++ )
+      {
+         GLenum faceTarget = numFaces == 6 ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : GL_TEXTURE_2D;
+
+         if ( offset + imageSize > size )
+         {
+            return GL_FALSE;
+         }
+
+         if ( glType == 0 )
+         {
+            glCompressedTexImage2D ( faceTarget, level, glInternalFormat, levelWidth, levelHeight, 0,
+                                     imageSize, data + offset );
+         }
+         else
+         {
+            glTexImage2D ( faceTarget, level, glInternalFormat, levelWidth, levelHeight, 0,
+                           glFormat, glType, data + offset );
+         }
+
+         // Each face is padded to 4 bytes (cubePadding, then mipPadding)
+         offset += ( imageSize + 3 ) & ~3;
+      }
+   }
+
+   // Compressed formats cannot be filtered down by GL, so they stay at
+   // the one level
+   if ( numMipLevels == 0 && glType != 0 )
+   {
+      unsigned int largest = pixelWidth > pixelHeight ? pixelWidth : pixelHeight;
+
+      glGenerateMipmap ( *target );
+
+      while ( largest >>= 1 )
+      {
+         ( *numLevels )++;
+      }
+   }
+
+   return glGetError ( ) == GL_NO_ERROR ? GL_TRUE : GL_FALSE;
+}
+
+///
+// SetTextureLevels()
+//
+//    Limit sampling to the levels that were loaded, trilinear if there are
+//    several
+//
+static void SetTextureLevels ( GLenum target, int numLevels )
+{
+   glTexParameteri ( target, GL_TEXTURE_MAX_LEVEL, numLevels - 1 );
+   glTexParameteri ( target, GL_TEXTURE_MIN_FILTER, numLevels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR );
+   glTexParameteri ( target, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+}
+
+///
+// HasGLExtension()
+//
+static GLboolean HasGLExtension ( const char *extension )
+{
+   const char *extensions = ( const char * ) glGetString ( GL_EXTENSIONS );
+
+   return extensions != NULL && strstr ( extensions, extension ) != NULL ? GL_TRUE : GL_FALSE;
+}
+
+///
+// ParsePVR3()
+//
+static GLboolean ParsePVR3 ( const unsigned char *data, size_t size, PVRLayout *layout, const char **formatName )
+{
+   unsigned int channels = ReadU32 ( data + 8, GL_FALSE );
+   unsigned int bits = ReadU32 ( data + 12, GL_FALSE );
+   unsigned int colorSpace = ReadU32 ( data + 16, GL_FALSE );
+   unsigned int channelType = ReadU32 ( data + 20, GL_FALSE );
+   unsigned int depth = ReadU32 ( data + 32, GL_FALSE );
+   unsigned int numSurfaces = ReadU32 ( data + 36, GL_FALSE );
+   unsigned int i;
+
+   layout->height = ReadU32 ( data + 24, GL_FALSE );
+   layout->width = ReadU32 ( data + 28, GL_FALSE );
+   layout->numFaces = ReadU32 ( data + 40, GL_FALSE );
+   layout->numLevels = ReadU32 ( data + 44, GL_FALSE );
+   layout->dataOffset = PVR3_HEADER_SIZE + ( size_t ) ReadU32 ( data + 48, GL_FALSE );
+   layout->faceMajor = GL_FALSE;
+
+   // Volume textures and texture arrays are not supported
+   if ( depth != 1 || numSurfaces != 1 )
+   {
+      return GL_FALSE;
+   }
+
+   if ( bits == 0 )
+   {
+      // The low word is a compressed format
+      if ( channels >= sizeof ( pvr3CompressedFormats ) / sizeof ( pvr3CompressedFormats[0] ) )
+      {
+         return GL_FALSE;
+      }
+
+      layout->format = &pvr3CompressedFormats[channels];
+   }
+   else
+   {
+      char order[5];
+
+      // The low word holds the channel names, the high word their bits
+      for ( i = 0; i < 4; i++ )
+      {
+         order[i] = ( char ) ( channels >> ( 8 * i ) );
+      }
+
+      order[4] = '\0';
+      layout->format = NULL;
+
+      for ( i = 0; i < sizeof ( pvr3PixelFormats ) / sizeof ( pvr3PixelFormats[0] ); i++ )
+      {
+         if ( strcmp ( order, pvr3PixelFormats[i].channels ) == 0 && bits == pvr3PixelFormats[i].bits )
+         {
+            layout->format = &pvr3PixelFormats[i].format;
+            break;
+         }
+      }
+
+      if ( layout->format == NULL ||
+            ( channelType != PVR3_UNSIGNED_BYTE_NORM && channelType != PVR3_UNSIGNED_SHORT_NORM ) )
+      {
+         return GL_FALSE;
+      }
+   }
+
+   *formatName = layout->format->name;
+   layout->internalFormat = layout->format->internalFormat;
+
+   if ( colorSpace == PVR3_COLORSPACE_SRGB && layout->format->srgbInternalFormat != 0 )
+   {
+      layout->internalFormat = layout->format->srgbInternalFormat;
+   }
+
+   return layout->dataOffset <= size ? GL_TRUE : GL_FALSE;
+}
+
+///
+// ParsePVR2()
+//
+static GLboolean ParsePVR2 ( const unsigned char *data, size_t size, PVRLayout *layout, const char **formatName )
+{
+   unsigned int headerSize = ReadU32 ( data, GL_FALSE );
+   unsigned int flags = ReadU32 ( data + 16, GL_FALSE );
+   unsigned int pixelType = flags & 0xFF;
+   unsigned int numSurfaces = ReadU32 ( data + 48, GL_FALSE );
+
+   layout->height = ReadU32 ( data + 4, GL_FALSE );
+   layout->width = ReadU32 ( data + 8, GL_FALSE );
+   layout->numLevels = ReadU32 ( data + 12, GL_FALSE ) + 1;
+   layout->numFaces = ( flags & PVR2_FLAG_CUBEMAP ) ? 6 : 1;
+   layout->faceMajor = GL_TRUE;
+   layout->dataOffset = headerSize;
+
+   if ( numSurfaces != ( unsigned int ) layout->numFaces )
+   {
+      return GL_FALSE;
+   }
+
+   if ( pixelType == PVR2_TYPE_ETC1 )
+   {
+      layout->format = &pvr2ETC1Format;
+   }
+   else if ( pixelType >= PVR2_FIRST_GL_TYPE &&
+             pixelType < PVR2_FIRST_GL_TYPE + sizeof ( pvr2Formats ) / sizeof ( pvr2Formats[0] ) )
+   {
+      layout->format = &pvr2Formats[pixelType - PVR2_FIRST_GL_TYPE];
+
+      if ( ( layout->format->internalFormat == GL_COMPRESSED_RGB_PVRTC_2BPPV1_IMG ||
+             layout->format->internalFormat == GL_COMPRESSED_RGB_PVRTC_4BPPV1_IMG ) &&
+           ( flags & PVR2_FLAG_ALPHA ) )
+      {
+         layout->format = &pvr2PVRTCAlphaFormats[layout->format->blockWidth == 8 ? 0 : 1];
+      }
+   }
+   else
+   {
+      return GL_FALSE;
+   }
+
+   *formatName = layout->format->name;
+   layout->internalFormat = layout->format->internalFormat;
+
+   return layout->dataOffset <= size ? GL_TRUE : GL_FALSE;
+}
+
+///
+// PVRLevelSize()
+//
+//    Size in bytes of one face of one level
+//
+static size_t PVRLevelSize ( const PVRFormat *format, int width, int height )
+{
+   size_t blocksX, blocksY;
+
+   if ( format->format != 0 )
+   {
+      return ( ( size_t ) width * height * format->bitsPerPixel + 7 ) / 8;
+   }
+
+   blocksX = ( width + format->blockWidth - 1 ) / format->blockWidth;
+   blocksY = ( height + format->blockHeight - 1 ) / format->blockHeight;
+   blocksX = blocksX < ( size_t ) format->minBlocks ? ( size_t ) format->minBlocks : blocksX;
+   blocksY = blocksY < ( size_t ) format->minBlocks ? ( size_t ) format->minBlocks : blocksY;
+
+   return blocksX * blocksY * format->blockBytes;
+}
+
+///
+// UploadPVR()
+//
+//    Upload every level and face of a PVR file to the bound texture
+//
+static GLboolean UploadPVR ( const unsigned char *data, size_t size, const PVRLayout *layout )
+{
+   size_t offset = layout->dataOffset;
+   int outer, inner;
+   int numOuter = layout->faceMajor ? layout->numFaces : layout->numLevels;
+   int numInner = layout->faceMajor ? layout->numLevels : layout->numFaces;
+
+   for ( outer = 0; outer < numOuter; outer++ )
+   {
+      for ( inner = 0; inner < numInner; inner++ )
+      {
+         int level = layout->faceMajor ? inner : outer;
+         int face = layout->faceMajor ? outer : inner;
+         GLenum target = layout->numFaces == 6 ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : GL_TEXTURE_2D;
+         int width = layout->width >> level ? layout->width >> level : 1;
+         int height = layout->height >> level ? layout->height >> level : 1;
+         size_t levelSize = PVRLevelSize ( layout->format, width, height );
+
+         if ( offset + levelSize > size )
+         {
+            return GL_FALSE;
+         }
+
+         if ( layout->format->format == 0 )
+         {
+            glCompressedTexImage2D ( target, level, layout->internalFormat, width, height, 0,
+                                     ( GLsizei ) levelSize, data + offset );
+         }
+         else
+         {
+            glTexImage2D ( target, level, layout->internalFormat, width, height, 0,
+                           layout->format->format, layout->format->type, data + offset );
+         }
+
+         offset += levelSize;
+      }
+   }
+
+   return glGetError ( ) == GL_NO_ERROR ? GL_TRUE : GL_FALSE;
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+//
+///
+/// \brief Map a whole file read-only into memory
+//
+GLboolean ESUTIL_API esMapFile ( void *ioContext, const char *fileName, ESMappedFile *file )
+{
+   memset ( file, 0, sizeof ( ESMappedFile ) );
+
+#ifdef ANDROID
+   {
+      AAsset *asset;
+
+      if ( ioContext == NULL )
+      {
+         return GL_FALSE;
+      }
+
+      // Assets stored uncompressed in the APK are already mapped by the asset manager
+      asset = AAssetManager_open ( ( AAssetManager * ) ioContext, fileName, AASSET_MODE_BUFFER );
+
+      if ( asset == NULL )
+      {
+         return GL_FALSE;
+      }
+
+      file->data = AAsset_getBuffer ( asset );
+      file->size = AAsset_getLength ( asset );
+
+      if ( file->data == NULL )
+      {
+         AAsset_close ( asset );
+         return GL_FALSE;
+      }
+
+      file->handle = asset;
+   }
+#elif defined(_WIN32)
+   {
+      HANDLE fileHandle;
+      HANDLE mapping;
+      LARGE_INTEGER fileSize;
+
+      fileHandle = CreateFileA ( fileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                                 FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+
+      if ( fileHandle == INVALID_HANDLE_VALUE )
+      {
+         return GL_FALSE;
+      }
+
+      if ( !GetFileSizeEx ( fileHandle, &fileSize ) || fileSize.QuadPart == 0 )
+      {
+         CloseHandle ( fileHandle );
+         return GL_FALSE;
+      }
+
+      mapping = CreateFileMappingA ( fileHandle, NULL, PAGE_READONLY, 0, 0, NULL );
+
+      // The mapping keeps the file open
+      CloseHandle ( fileHandle );
+
+      if ( mapping == NULL )
+      {
+         return GL_FALSE;
+      }
+
+      file->data = MapViewOfFile ( mapping, FILE_MAP_READ, 0, 0, 0 );
+
+      if ( file->data == NULL )
+      {
+         CloseHandle ( mapping );
+         return GL_FALSE;
+      }
+
+      file->size = ( size_t ) fileSize.QuadPart;
+      file->handle = mapping;
+   }
+#else
+   {
+      struct stat fileStat;
+      void *data;
+      int fd;
+
+      ( void ) ioContext;
+
+#ifdef __APPLE__
+      // iOS: Remap the filename to a path that can be opened from the bundle.
+      fileName = GetBundleFileName ( fileName );
+#endif
+
+      fd = open ( fileName, O_RDONLY );
+
+      if ( fd < 0 )
+      {
+         return GL_FALSE;
+      }
+
+      if ( fstat ( fd, &fileStat ) != 0 || fileStat.st_size == 0 )
+      {
+         close ( fd );
+         return GL_FALSE;
+      }
+
+      data = mmap ( NULL, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+
+      // The mapping keeps the file open
+      close ( fd );
+
+      if ( data == MAP_FAILED )
+      {
+         return GL_FALSE;
+      }
+
+#ifdef MADV_SEQUENTIAL
+      madvise ( data, fileStat.st_size, MADV_SEQUENTIAL );
+#endif
+
+      file->data = data;
+      file->size = fileStat.st_size;
+   }
+#endif
+
+   return GL_TRUE;
+}
+
+//
+///
+/// \brief Unmap a file mapped with esMapFile
+//
+void ESUTIL_API esUnmapFile ( ESMappedFile *file )
+{
+   if ( file->data == NULL )
+   {
+      return;
+   }
+
+#ifdef ANDROID
+   AAsset_close ( ( AAsset * ) file->handle );
+#elif defined(_WIN32)
+   UnmapViewOfFile ( file->data );
+   CloseHandle ( ( HANDLE ) file->handle );
+#else
+   munmap ( ( void * ) file->data, file->size );
+#endif
+
+   memset ( file, 0, sizeof ( ESMappedFile ) );
+}
+
+//
+///
+/// \brief Load a TGA image, without copying the pixels when the file is uncompressed
+//
+GLboolean ESUTIL_API esLoadTGAImage ( void *ioContext, const char *fileName, ESImage *image )
+{
+   memset ( image, 0, sizeof ( ESImage ) );
+
+   if ( !esMapFile ( ioContext, fileName, &image->file ) )
+   {
+      esLogMessage ( "esLoadTGAImage FAILED to open : { %s }\n", fileName );
+      return GL_FALSE;
+   }
+
+   if ( !DecodeTGA ( image->file.data, image->file.size, image ) )
+   {
+      esLogMessage ( "esLoadTGAImage FAILED to decode : { %s }\n", fileName );
+      esFreeImage ( image );
+      return GL_FALSE;
+   }
+
+   // Nothing points into the file any more once the pixels have been decoded
+   if ( image->decoded != NULL )
+   {
+      esUnmapFile ( &image->file );
+   }
+
+   return GL_TRUE;
+}
+
+//
+///
+/// \brief Release an image loaded with esLoadTGAImage
+//
+void ESUTIL_API esFreeImage ( ESImage *image )
+{
+   esUnmapFile ( &image->file );
+   free ( image->decoded );
+   memset ( image, 0, sizeof ( ESImage ) );
+}
+
+//
+///
+/// \brief Load a KTX file into a new texture, compressed levels uploaded straight from the mapping
+//
+GLuint ESUTIL_API esLoadKTX ( void *ioContext, const char *fileName, int *width, int *height )
+{
+   ESMappedFile file;
+   GLuint texture;
+   GLenum target;
+   GLint alignment;
+   int levelWidth, levelHeight, numLevels;
+   GLboolean loaded;
+
+   if ( !esMapFile ( ioContext, fileName, &file ) )
+   {
+      esLogMessage ( "esLoadKTX FAILED to open : { %s }\n", fileName );
+      return 0;
+   }
+
+   // Drop any error left from earlier calls, so that UploadKTX sees its own
+   while ( glGetError ( ) != GL_NO_ERROR )
+      ;
+
+   glGenTextures ( 1, &texture );
+
+   // KTX rows are padded to 4 bytes, which is the GL default
+   glGetIntegerv ( GL_UNPACK_ALIGNMENT, &alignment );
+   glPixelStorei ( GL_UNPACK_ALIGNMENT, 4 );
+
+   loaded = UploadKTX ( file.data, file.size, texture, &target, &levelWidth, &levelHeight, &numLevels );
+
+   glPixelStorei ( GL_UNPACK_ALIGNMENT, alignment );
+   esUnmapFile ( &file );
+
+   if ( !loaded )
+   {
+      esLogMessage ( "esLoadKTX FAILED to load : { %s }\n", fileName );
+      glDeleteTextures ( 1, &texture );
+      return 0;
+   }
+
+   SetTextureLevels ( target, numLevels );
+
+   if ( width != NULL )
+   {
+      *width = levelWidth;
+   }
+
+   if ( height != NULL )
+   {
+      *height = levelHeight;
+   }
+
+   return texture;
+}
+
+//
+///
+/// \brief Load a PVR (version 2 or 3) file into a new texture, compressed levels uploaded as is
+//
+GLuint ESUTIL_API esLoadPVR ( void *ioContext, const char *fileName, int *width, int *height )
+{
+   ESMappedFile file;
+   PVRLayout layout;
+   const char *formatName = "an unknown format";
+   GLboolean parsed = GL_FALSE;
+   GLboolean loaded;
+   GLuint texture;
+   GLenum target;
+   GLint alignment;
+
+   if ( !esMapFile ( ioContext, fileName, &file ) )
+   {
+      esLogMessage ( "esLoadPVR FAILED to open : { %s }\n", fileName );
+      return 0;
+   }
+
+   if ( file.size >= PVR3_HEADER_SIZE && ReadU32 ( file.data, GL_FALSE ) == PVR3_MAGIC )
+   {
+      parsed = ParsePVR3 ( file.data, file.size, &layout, &formatName );
+   }
+   else if ( file.size >= PVR2_HEADER_SIZE && ReadU32 ( file.data + 44, GL_FALSE ) == PVR2_TAG )
+   {
+      parsed = ParsePVR2 ( file.data, file.size, &layout, &formatName );
+   }
+
+   if ( !parsed || layout.width <= 0 || layout.height <= 0 || layout.numLevels <= 0 ||
+         ( layout.numFaces != 1 && layout.numFaces != 6 ) )
+   {
+      esLogMessage ( "esLoadPVR FAILED to parse : { %s } (%s)\n", fileName, formatName );
+      esUnmapFile ( &file );
+      return 0;
+   }
+
+   // Report formats this driver cannot sample, rather than fail in GL
+   if ( layout.internalFormat == 0 ||
+         ( layout.format->extension != NULL && !HasGLExtension ( layout.format->extension ) ) )
+   {
+      esLogMessage ( "esLoadPVR: { %s } uses %s, which this driver does not support\n", fileName, formatName );
+      esUnmapFile ( &file );
+      return 0;
+   }
+
+   target = layout.numFaces == 6 ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D;
+
+   while ( glGetError ( ) != GL_NO_ERROR )
+      ;
+
+   glGenTextures ( 1, &texture );
+   glBindTexture ( target, texture );
+   StateSetTexture ( target, texture );
+
+   // PVR rows are tightly packed
+   glGetIntegerv ( GL_UNPACK_ALIGNMENT, &alignment );
+   glPixelStorei ( GL_UNPACK_ALIGNMENT, 1 );
+
+   loaded = UploadPVR ( file.data, file.size, &layout );
+
+   glPixelStorei ( GL_UNPACK_ALIGNMENT, alignment );
+   esUnmapFile ( &file );
+
+   if ( !loaded )
+   {
+      esLogMessage ( "esLoadPVR FAILED to load : { %s } (%s)\n", fileName, formatName );
+      glDeleteTextures ( 1, &texture );
+      return 0;
+   }
+
+   SetTextureLevels ( target, layout.numLevels );
+
+   if ( width != NULL )
+   {
+      *width = layout.width;
+   }
+
+   if ( height != NULL )
+   {
+      *height = layout.height;
+   }
+
+   return texture;
+}
+
+//
+///
+/// \brief Loads a 8-bit, 24-bit or 32-bit TGA image from a file into a bottom-up buffer that the
+///        caller frees
+//
+char *ESUTIL_API esLoadTGA ( void *ioContext, const char *fileName, int *width, int *height )
+{
+   ESImage image;
+   char   *buffer;
+   size_t  rowSize;
+   int     row;
+
+   if ( !esLoadTGAImage ( ioContext, fileName, &image ) )
+   {
+      esLogMessage ( "esLoadTGA FAILED to load : { %s }\n", fileName );
+      return NULL;
+   }
+
+   *width = image.width;
+   *height = image.height;
+
+   rowSize = ( size_t ) image.width * image.bytesPerPixel;
+   buffer = ( char * ) malloc ( rowSize * image.height );
+
+   if ( buffer != NULL )
+   {
+      if ( image.topDown )
+      {
+         // Flip so that the first row is the bottom, as glTexImage2D expects
+         for ( row = 0; row < image.height; row++ )
+         {
+            memcpy ( buffer + rowSize * ( image.height - 1 - row ),
+                     ( const char * ) image.pixels + rowSize * row, rowSize );
+         }
+      }
+      else
+      {
+         memcpy ( buffer, image.pixels, rowSize * image.height );
+      }
+   }
+
+   esFreeImage ( &image );
+
+   return buffer;
+}
@@ -0,0 +1,200 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// ESInstance.c
+//
+//    Builds per-instance model-view-projection matrices from instance
+//    transforms stored as structure-of-arrays, split across worker threads.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+///
+//  Macros
+//
+#define PI 3.1415926535897932384626433832795f
+
+// Fewer instances than this are not worth handing to another thread
+#define MIN_INSTANCES_PER_CHUNK  256
+
+///
+//  Types
+//
+typedef struct
+{
+   ESMatrix             *mvp;
+   const ESInstanceData *data;
+   const ESMatrix       *viewProj;
+} BuildJob;
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// BuildMVPRange()
+//
+//    For each instance, model = scale * rotate * translate, and
+//    mvp = model * viewProj.  The model matrix has a 3x3 upper-left block and
+//    a translation row, so rows 0-2 of the MVP combine three rows of viewProj
+//    and row 3 is the translated origin.  This gives the same result as
+//    esTranslate + esRotate + esScale + esMatrixMultiply with a third of the
+//    arithmetic.
+//
+static void ESCALLBACK BuildMVPRange ( void *userData, int first, int last )
+{
+   const BuildJob       *job = ( const BuildJob * ) userData;
+   const ESInstanceData *data = job->data;
+   const ESMatrix       *vp = job->viewProj;
+   int                   i, j;
+
+   for ( i = first; i < last; i++ )
+   {
+      ESMatrix *out = &job->mvp[i];
+      GLfloat   x = data->axisX[i];
+      GLfloat   y = data->axisY[i];
+      GLfloat   z = data->axisZ[i];
+      GLfloat   s = data->scale[i];
+      GLfloat   sinAngle = sinf ( data->angle[i] * PI / 180.0f );
+      GLfloat   cosAngle = cosf ( data->angle[i] * PI / 180.0f );
+      GLfloat   oneMinusCos = 1.0f - cosAngle;
+      GLfloat   tx = data->posX[i];
+      GLfloat   ty = data->posY[i];
+      GLfloat   tz = data->posZ[i];
+      GLfloat   r[3][3];
+
+      r[0][0] = ( ( oneMinusCos * x * x ) + cosAngle ) * s;
+      r[0][1] = ( ( oneMinusCos * x * y ) - z * sinAngle ) * s;
+      r[0][2] = ( ( oneMinusCos * z * x ) + y * sinAngle ) * s;
+
+      r[1][0] = ( ( oneMinusCos * x * y ) + z * sinAngle ) * s;
+      r[1][1] = ( ( oneMinusCos * y * y ) + cosAngle ) * s;
+      r[1][2] = ( ( oneMinusCos * y * z ) - x * sinAngle ) * s;
+
+      r[2][0] = ( ( oneMinusCos * z * x ) - y * sinAngle ) * s;
+      r[2][1] = ( ( oneMinusCos * y * z ) + x * sinAngle ) * s;
+      r[2][2] = ( ( oneMinusCos * z * z ) + cosAngle ) * s;
+
+      for ( j = 0; j < 4; j++ )
+      {
+         GLfloat c0 = vp->m[0][j];
+         GLfloat c1 = vp->m[1][j];
+         GLfloat c2 = vp->m[2][j];
+
+         out->m[0][j] = r[0][0] * c0 + r[0][1] * c1 + r[0][2] * c2;
+         out->m[1][j] = r[1][0] * c0 + r[1][1] * c1 + r[1][2] * c2;
+         out->m[2][j] = r[2][0] * c0 + r[2][1] * c1 + r[2][2] * c2;
+         out->m[3][j] = tx * c0 + ty * c1 + tz * c2 + vp->m[3][j];
+      }
+   }
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+//
+///
+/// \brief Allocate the arrays for count instances.  Every instance starts at the origin with unit
+///        scale and no rotation about the z axis.
+//
+GLboolean ESUTIL_API esInstanceDataInit ( ESInstanceData *data, int count )
+{
+   GLfloat *arrays;
+   int      i;
+
+   memset ( data, 0, sizeof ( ESInstanceData ) );
+
+   // One allocation holding all eight arrays back to back
+   arrays = ( GLfloat * ) malloc ( sizeof ( GLfloat ) * 8 * ( count > 0 ? count : 1 ) );
+
+   if ( arrays == NULL )
+   {
+      return GL_FALSE;
+   }
+
+   data->count = count;
+   data->posX  = arrays + 0 * count;
+   data->posY  = arrays + 1 * count;
+   data->posZ  = arrays + 2 * count;
+   data->axisX = arrays + 3 * count;
+   data->axisY = arrays + 4 * count;
+   data->axisZ = arrays + 5 * count;
+   data->angle = arrays + 6 * count;
+   data->scale = arrays + 7 * count;
+
+   for ( i = 0; i < count; i++ )
+   {
+      data->posX[i] = data->posY[i] = data->posZ[i] = 0.0f;
+      data->axisX[i] = data->axisY[i] = 0.0f;
+      data->axisZ[i] = 1.0f;
+      data->angle[i] = 0.0f;
+      data->scale[i] = 1.0f;
+   }
+
+   return GL_TRUE;
+}
+
+//
+///
+/// \brief Free instance transforms allocated by esInstanceDataInit
+//
+void ESUTIL_API esInstanceDataFree ( ESInstanceData *data )
+{
+   free ( data->posX );
+   memset ( data, 0, sizeof ( ESInstanceData ) );
+}
+
+//
+///
+/// \brief Compute mvp[i] = scale * rotate * translate * viewProj for every instance, split across
+///        worker threads.  Equivalent to esTranslate, esRotate, esScale and esMatrixMultiply per instance.
+//
+void ESUTIL_API esInstanceBuildMVP ( ESMatrix *mvp, const ESInstanceData *data, const ESMatrix *viewProj )
+{
+   BuildJob job;
+
+   job.mvp = mvp;
+   job.data = data;
+   job.viewProj = viewProj;
+
+   esParallelFor ( data->count, MIN_INSTANCES_PER_CHUNK, BuildMVPRange, &job );
+}
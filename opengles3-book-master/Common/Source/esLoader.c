@@ -0,0 +1,485 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// ESLoader.c
+//
+//    Resource loading thread.  The loader owns a second EGL context sharing
+//    objects with the one of esCreateWindow, and runs queued jobs that
+//    create buffers, textures and programs with it while the main thread
+//    keeps rendering.  Each job ends with a fence, which the main context
+//    waits on before it uses what the job created.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include "esUtil_win.h"
+#include <stdlib.h>
+#include <string.h>
+
+///
+//  Types
+//
+typedef struct LoadJob
+{
+   void ( ESCALLBACK *func ) ( void * );
+   void             *userData;
+   int               id;
+
+   // Signaled once the GL commands of the job have completed
+   GLsync            fence;
+
+   struct LoadJob   *next;
+} LoadJob;
+
+struct ESLoader
+{
+#ifndef __APPLE__
+   EGLDisplay   display;
+   EGLContext   context;
+   EGLSurface   surface;
+#endif
+
+   // NULL to run the jobs on the calling thread
+   ESThread    *thread;
+   ESMutex     *lock;
+   ESCondition *wake;
+   ESCondition *done;
+
+   // Jobs to run, and jobs run whose fence the main context has not waited
+   // on yet, both in order and protected by lock
+   LoadJob     *queue;
+   LoadJob     *queueTail;
+   LoadJob     *finished;
+   LoadJob     *finishedTail;
+   GLboolean    quit;
+
+   // Set by the thread once it has tried to make the shared context current
+   GLboolean    started;
+   GLboolean    current;
+
+   // Last job queued, last job run and last job the main context waited on
+   int          queued;
+   int          completed;
+   int          synced;
+};
+
+///
+// LoaderThread()
+//
+//    Run the queued jobs with the shared context current
+//
+static void ESCALLBACK LoaderThread ( void *arg )
+{
+   ESLoader *loader = arg;
+   GLboolean current = GL_TRUE;
+
+#ifndef __APPLE__
+   if ( !eglMakeCurrent ( loader->display, loader->surface, loader->surface, loader->context ) )
+   {
+      esLogMessage ( "esLoaderCreate: eglMakeCurrent failed (0x%x)\n", eglGetError ( ) );
+      current = GL_FALSE;
+   }
+#endif
+
+   // esLoaderCreate waits for this, and runs the jobs itself without a
+   // current context here
+   esMutexLock ( loader->lock );
+   loader->started = GL_TRUE;
+   loader->current = current;
+   esConditionBroadcast ( loader->done );
+
+   if ( !current )
+   {
+      esMutexUnlock ( loader->lock );
+      return;
+   }
+
+   for ( ;; )
+   {
+      LoadJob *job;
+
+      while ( loader->queue == NULL && !loader->quit )
+      {
+         esConditionWait ( loader->wake, loader->lock );
+      }
+
+      // Queued jobs still run when the loader is destroyed
+      if ( loader->queue == NULL )
+      {
+         break;
+      }
+
+      job = loader->queue;
+      loader->queue = job->next;
+      job->next = NULL;
+      esMutexUnlock ( loader->lock );
+
+      job->func ( job->userData );
+
+      // The flush makes sure the fence gets signaled without this context
+      // ever waiting on it
+      job->fence = glFenceSync ( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+      glFlush ( );
+
+      esMutexLock ( loader->lock );
+
+      if ( loader->finished == NULL )
+      {
+         loader->finished = job;
+      }
+      else
+      {
+         loader->finishedTail->next = job;
+      }
+
+      loader->finishedTail = job;
+      loader->completed = job->id;
+      esConditionBroadcast ( loader->done );
+   }
+
+   esMutexUnlock ( loader->lock );
+
+#ifndef __APPLE__
+   eglMakeCurrent ( loader->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT );
+   eglReleaseThread ( );
+#endif
+}
+
+///
+// SyncJobs()
+//
+//    Make the current context wait on the fences of the jobs up to id
+//
+static void SyncJobs ( ESLoader *loader, int id )
+{
+   LoadJob *jobs, *last = NULL;
+
+   esMutexLock ( loader->lock );
+
+   jobs = loader->finished;
+
+   while ( loader->finished != NULL && loader->finished->id <= id )
+   {
+      last = loader->finished;
+      loader->finished = last->next;
+   }
+
+   esMutexUnlock ( loader->lock );
+
+   if ( last == NULL )
+   {
+      return;
+   }
+
+   last->next = NULL;
+
+   // The wait is on the GPU, commands after it see the job's results
+   while ( jobs != NULL )
+   {
+      LoadJob *next = jobs->next;
+
+      glWaitSync ( jobs->fence, 0, GL_TIMEOUT_IGNORED );
+      glDeleteSync ( jobs->fence );
+      free ( jobs );
+      jobs = next;
+   }
+
+   loader->synced = id;
+}
+
+#ifndef __APPLE__
+///
+// CreateSharedContext()
+//
+//    Create the loader context and the surface it is made current with,
+//    none at all if EGL_KHR_surfaceless_context is there
+//
+static GLboolean CreateSharedContext ( ESLoader *loader, ESContext *esContext )
+{
+   EGLint contextAttribs[] = { EGL_CONTEXT_CLIENT_VERSION, 3, EGL_NONE };
+   EGLint pbufferAttribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+
+   loader->display = esContext->eglDisplay;
+   loader->surface = EGL_NO_SURFACE;
+
+   if ( esContext->eglContext == EGL_NO_CONTEXT )
+   {
+      return GL_FALSE;
+   }
+
+   if ( !HasEGLExtension ( loader->display, "EGL_KHR_surfaceless_context" ) )
+   {
+      loader->surface = eglCreatePbufferSurface ( loader->display, esContext->eglConfig, pbufferAttribs );
+
+      if ( loader->surface == EGL_NO_SURFACE )
+      {
+         return GL_FALSE;
+      }
+   }
+
+   loader->context = eglCreateContext ( loader->display, esContext->eglConfig,
+                                        esContext->eglContext, contextAttribs );
+
+   if ( loader->context == EGL_NO_CONTEXT )
+   {
+      if ( loader->surface != EGL_NO_SURFACE )
+      {
+         eglDestroySurface ( loader->display, loader->surface );
+      }
+
+      return GL_FALSE;
+   }
+
+   return GL_TRUE;
+}
+
+///
+// DestroySharedContext()
+//
+static void DestroySharedContext ( ESLoader *loader )
+{
+   eglDestroyContext ( loader->display, loader->context );
+
+   if ( loader->surface != EGL_NO_SURFACE )
+   {
+      eglDestroySurface ( loader->display, loader->surface );
+   }
+}
+#endif
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+//
+///
+/// \brief Create a loader thread with a context sharing objects with the one of esCreateWindow
+//
+ESLoader *ESUTIL_API esLoaderCreate ( ESContext *esContext )
+{
+   ESLoader *loader = calloc ( 1, sizeof ( ESLoader ) );
+
+   if ( loader == NULL )
+   {
+      return NULL;
+   }
+
+   loader->lock = esMutexCreate ( );
+   loader->wake = esConditionCreate ( );
+   loader->done = esConditionCreate ( );
+
+   if ( loader->lock == NULL || loader->wake == NULL || loader->done == NULL )
+   {
+      esLoaderDestroy ( loader );
+      return NULL;
+   }
+
+#ifndef __APPLE__
+   if ( CreateSharedContext ( loader, esContext ) )
+   {
+      loader->thread = esThreadCreate ( LoaderThread, loader );
+
+      if ( loader->thread != NULL )
+      {
+         esMutexLock ( loader->lock );
+
+         while ( !loader->started )
+         {
+            esConditionWait ( loader->done, loader->lock );
+         }
+
+         esMutexUnlock ( loader->lock );
+
+         if ( !loader->current )
+         {
+            esThreadJoin ( loader->thread );
+            loader->thread = NULL;
+         }
+      }
+
+      if ( loader->thread == NULL )
+      {
+         DestroySharedContext ( loader );
+      }
+   }
+#endif
+
+   if ( loader->thread == NULL )
+   {
+      esLogMessage ( "esLoaderCreate: no shared context, jobs run when queued\n" );
+   }
+
+   return loader;
+}
+
+//
+///
+/// \brief Queue a job for the loader thread
+//
+int ESUTIL_API esLoaderQueue ( ESLoader *loader, void ( ESCALLBACK *func ) ( void *userData ), void *userData )
+{
+   LoadJob *job;
+
+   if ( loader->thread == NULL )
+   {
+      func ( userData );
+      loader->queued++;
+      loader->completed = loader->synced = loader->queued;
+      return loader->queued;
+   }
+
+   job = calloc ( 1, sizeof ( LoadJob ) );
+
+   if ( job == NULL )
+   {
+      return 0;
+   }
+
+   job->func = func;
+   job->userData = userData;
+
+   esMutexLock ( loader->lock );
+
+   job->id = ++loader->queued;
+
+   if ( loader->queue == NULL )
+   {
+      loader->queue = job;
+   }
+   else
+   {
+      loader->queueTail->next = job;
+   }
+
+   loader->queueTail = job;
+   esConditionSignal ( loader->wake );
+
+   esMutexUnlock ( loader->lock );
+
+   return job->id;
+}
+
+//
+///
+/// \brief Check whether a job has finished, without waiting
+//
+GLboolean ESUTIL_API esLoaderReady ( ESLoader *loader, int job )
+{
+   GLboolean ready;
+
+   if ( job <= loader->synced )
+   {
+      return GL_TRUE;
+   }
+
+   esMutexLock ( loader->lock );
+   ready = job <= loader->completed ? GL_TRUE : GL_FALSE;
+   esMutexUnlock ( loader->lock );
+
+   if ( ready )
+   {
+      SyncJobs ( loader, job );
+   }
+
+   return ready;
+}
+
+//
+///
+/// \brief Block until a job has finished
+//
+void ESUTIL_API esLoaderWait ( ESLoader *loader, int job )
+{
+   if ( job <= loader->synced )
+   {
+      return;
+   }
+
+   esMutexLock ( loader->lock );
+
+   while ( loader->completed < job )
+   {
+      esConditionWait ( loader->done, loader->lock );
+   }
+
+   esMutexUnlock ( loader->lock );
+
+   SyncJobs ( loader, job );
+}
+
+//
+///
+/// \brief Run the queued jobs, stop the loader thread and free the loader
+//
+void ESUTIL_API esLoaderDestroy ( ESLoader *loader )
+{
+   if ( loader == NULL )
+   {
+      return;
+   }
+
+   if ( loader->thread != NULL )
+   {
+      esMutexLock ( loader->lock );
+      loader->quit = GL_TRUE;
+      esConditionSignal ( loader->wake );
+      esMutexUnlock ( loader->lock );
+
+      esThreadJoin ( loader->thread );
+
+      SyncJobs ( loader, loader->queued );
+
+#ifndef __APPLE__
+      DestroySharedContext ( loader );
+#endif
+   }
+
+   if ( loader->lock != NULL )
+   {
+      esMutexDestroy ( loader->lock );
+   }
+
+   if ( loader->wake != NULL )
+   {
+      esConditionDestroy ( loader->wake );
+   }
+
+   if ( loader->done != NULL )
+   {
+      esConditionDestroy ( loader->done );
+   }
+
+   free ( loader );
+}
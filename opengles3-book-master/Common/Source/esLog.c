@@ -0,0 +1,771 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// ESLog.c
+//
+//    Asynchronous logging.  Each thread formats its messages into a ring of
+//    fixed-size records of its own, which a flusher thread drains to the
+//    platform's debug output in the order they were logged.  Writing a
+//    message takes no lock and allocates nothing unless the ring is full,
+//    in which case the caller drains the rings itself so that no message
+//    is lost.  A per-thread rate limit can be turned on with the
+//    ES_LOG_RATE_LIMIT environment variable or esLogSetRateLimit.  A
+//    thread's ring is handed back when the thread exits.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+
+#ifdef ANDROID
+#include <android/log.h>
+#endif
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <time.h>
+#endif
+
+///
+//  Macros
+//
+
+// Threads with a ring of their own at once, the others write their
+// messages inline
+#define LOG_THREADS          16
+
+// Records in the ring of a thread, a power of two
+#define LOG_RING_SIZE        64
+
+// Size of a record, messages longer than its text take several records
+#define LOG_RECORD_SIZE      256
+#define LOG_RECORD_TEXT      ( LOG_RECORD_SIZE - 8 )
+
+// Longest message, longer ones are truncated
+#define LOG_MESSAGE_SIZE     4096
+
+// Time the flusher sleeps between two passes over the rings, in milliseconds
+#define LOG_FLUSH_INTERVAL   5
+
+// State of the flusher
+#define LOG_STOPPED          0
+#define LOG_STARTING         1
+#define LOG_RUNNING          2
+#define LOG_INLINE           3
+
+#ifdef _MSC_VER
+#define LOG_THREAD_LOCAL     __declspec ( thread )
+#else
+#define LOG_THREAD_LOCAL     __thread
+#endif
+
+///
+//  Types
+//
+typedef struct
+{
+   unsigned int   sequence;
+   unsigned short length;
+   unsigned char  level;
+
+   // Non-zero when the next record carries on the same message
+   unsigned char  more;
+
+   char           text[LOG_RECORD_TEXT];
+} LogRecord;
+
+typedef struct
+{
+   LogRecord     records[LOG_RING_SIZE];
+
+   // Records written, only the owning thread writes it
+   volatile unsigned int head;
+
+   // Records flushed, only the flusher writes it
+   volatile unsigned int tail;
+
+   // Non-zero while a thread owns the ring
+   volatile unsigned int owned;
+
+   // Messages held back by the rate limit since the flusher last reported them
+   volatile unsigned int limited;
+
+   // Rate limit of the owning thread
+   double        tokens;
+   double        lastRefill;
+} LogRing;
+
+typedef struct
+{
+   LogRing       rings[LOG_THREADS];
+
+   // Order of the messages across all threads
+   volatile unsigned int sequence;
+
+   volatile unsigned int state;
+   volatile unsigned int quit;
+   ESThread     *thread;
+
+   // Held while draining the rings, between the flusher and esLogFlush
+   ESMutex      *drainLock;
+
+   // Message reassembled from its records, under drainLock
+   char          message[LOG_MESSAGE_SIZE];
+} Logger;
+
+static Logger logger;
+
+// Least severe level written, see esLogSetLevel, -1 until ES_LOG_LEVEL is read
+static volatile int logLevel = -1;
+
+// Messages per second, see esLogSetRateLimit, -1 until ES_LOG_RATE_LIMIT is read
+static volatile int rateLimit = -1;
+
+// Hands a thread's ring back when the thread exits
+#ifdef _WIN32
+static DWORD ringKey = FLS_OUT_OF_INDEXES;
+#else
+static pthread_key_t ringKey;
+static GLboolean ringKeyCreated = GL_FALSE;
+#endif
+
+static LOG_THREAD_LOCAL LogRing *threadRing;
+static LOG_THREAD_LOCAL GLboolean threadRingClaimed;
+
+///
+// LoadAcquire()
+//
+static unsigned int LoadAcquire ( volatile unsigned int *value )
+{
+#ifdef _MSC_VER
+   return ( unsigned int ) InterlockedCompareExchange ( ( volatile LONG * ) value, 0, 0 );
+#else
+   return __atomic_load_n ( value, __ATOMIC_ACQUIRE );
+#endif
+}
+
+///
+// StoreRelease()
+//
+static void StoreRelease ( volatile unsigned int *value, unsigned int newValue )
+{
+#ifdef _MSC_VER
+   InterlockedExchange ( ( volatile LONG * ) value, ( LONG ) newValue );
+#else
+   __atomic_store_n ( value, newValue, __ATOMIC_RELEASE );
+#endif
+}
+
+///
+// FetchAdd()
+//
+//    Add to value and return what it held before
+//
+static unsigned int FetchAdd ( volatile unsigned int *value, unsigned int add )
+{
+#ifdef _MSC_VER
+   return ( unsigned int ) InterlockedExchangeAdd ( ( volatile LONG * ) value, ( LONG ) add );
+#else
+   return __atomic_fetch_add ( value, add, __ATOMIC_ACQ_REL );
+#endif
+}
+
+///
+// Exchange()
+//
+static unsigned int Exchange ( volatile unsigned int *value, unsigned int newValue )
+{
+#ifdef _MSC_VER
+   return ( unsigned int ) InterlockedExchange ( ( volatile LONG * ) value, ( LONG ) newValue );
+#else
+   return __atomic_exchange_n ( value, newValue, __ATOMIC_ACQ_REL );
+#endif
+}
+
+///
+// CompareExchange()
+//
+//    Set value to newValue if it holds oldValue, return GL_TRUE if it did
+//
+static GLboolean CompareExchange ( volatile unsigned int *value, unsigned int oldValue, unsigned int newValue )
+{
+#ifdef _MSC_VER
+   return InterlockedCompareExchange ( ( volatile LONG * ) value, ( LONG ) newValue, ( LONG ) oldValue ) == ( LONG ) oldValue;
+#else
+   return __atomic_compare_exchange_n ( value, &oldValue, newValue, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE );
+#endif
+}
+
+///
+// SleepMilliseconds()
+//
+static void SleepMilliseconds ( int milliseconds )
+{
+#ifdef _WIN32
+   Sleep ( milliseconds );
+#else
+   struct timespec duration;
+
+   duration.tv_sec = milliseconds / 1000;
+   duration.tv_nsec = ( milliseconds % 1000 ) * 1000000L;
+   nanosleep ( &duration, NULL );
+#endif
+}
+
+///
+// Output()
+//
+//    Write a message to the debug output for the platform
+//
+static void Output ( int level, const char *text )
+{
+#ifdef ANDROID
+   static const int priorities[] =
+   {
+      ANDROID_LOG_DEBUG, ANDROID_LOG_INFO, ANDROID_LOG_WARN, ANDROID_LOG_ERROR
+   };
+
+   __android_log_print ( priorities[level], "esUtil", "%s", text );
+#else
+   ( void ) level;
+   fputs ( text, stdout );
+#endif
+}
+
+///
+// ParseLevel()
+//
+//    Level named by the ES_LOG_LEVEL environment variable, ES_LOG_LEVEL if unset
+//
+static int ParseLevel ( const char *name )
+{
+   static const char *names[] = { "debug", "info", "warning", "error", "none" };
+   int i;
+
+   if ( name == NULL || name[0] == '\0' )
+   {
+      return ES_LOG_LEVEL;
+   }
+
+   for ( i = 0; i < ( int ) ( sizeof ( names ) / sizeof ( names[0] ) ); i++ )
+   {
+      if ( strcmp ( name, names[i] ) == 0 )
+      {
+         return i;
+      }
+   }
+
+   return atoi ( name );
+}
+
+///
+// ReleaseRing()
+//
+//    Called as a thread with a ring exits.  The records it left are still
+//    drained in order, and the next owner carries on after them.
+//
+#ifdef _WIN32
+static void WINAPI ReleaseRing ( void *ring )
+#else
+static void ReleaseRing ( void *ring )
+#endif
+{
+   if ( ring != NULL )
+   {
+      StoreRelease ( &( ( LogRing * ) ring )->owned, 0 );
+   }
+}
+
+///
+// CreateRingKey()
+//
+#ifdef _WIN32
+static BOOL CALLBACK CreateRingKey ( PINIT_ONCE initOnce, PVOID param, PVOID *context )
+{
+   ringKey = FlsAlloc ( ReleaseRing );
+   return TRUE;
+}
+#else
+static void CreateRingKey ( void )
+{
+   ringKeyCreated = pthread_key_create ( &ringKey, ReleaseRing ) == 0 ? GL_TRUE : GL_FALSE;
+}
+#endif
+
+///
+// ThreadRing()
+//
+//    Ring of the calling thread, NULL if all rings were taken when the
+//    thread first logged
+//
+static LogRing *ThreadRing ( void )
+{
+#ifdef _WIN32
+   static INIT_ONCE keyOnce = INIT_ONCE_STATIC_INIT;
+#else
+   static pthread_once_t keyOnce = PTHREAD_ONCE_INIT;
+#endif
+   int i;
+
+   if ( threadRingClaimed )
+   {
+      return threadRing;
+   }
+
+   threadRingClaimed = GL_TRUE;
+
+#ifdef _WIN32
+   InitOnceExecuteOnce ( &keyOnce, CreateRingKey, NULL, NULL );
+
+   if ( ringKey == FLS_OUT_OF_INDEXES )
+   {
+      return NULL;
+   }
+#else
+   pthread_once ( &keyOnce, CreateRingKey );
+
+   if ( !ringKeyCreated )
+   {
+      return NULL;
+   }
+#endif
+
+   for ( i = 0; i < LOG_THREADS; i++ )
+   {
+      LogRing *ring = &logger.rings[i];
+
+      if ( CompareExchange ( &ring->owned, 0, 1 ) )
+      {
+         ring->tokens = 0.0;
+         ring->lastRefill = 0.0;
+         threadRing = ring;
+
+#ifdef _WIN32
+         FlsSetValue ( ringKey, ring );
+#else
+         pthread_setspecific ( ringKey, ring );
+#endif
+         break;
+      }
+   }
+
+   return threadRing;
+}
+
+///
+// RateLimit()
+//
+//    Take a message off the rate limit of the ring, GL_FALSE if the thread
+//    has logged too much lately.  Errors always go through, and there is
+//    no limit unless one was asked for.
+//
+static GLboolean RateLimit ( LogRing *ring, int level )
+{
+   int limit = rateLimit;
+   double now;
+
+   if ( limit < 0 )
+   {
+      const char *limitEnv = getenv ( "ES_LOG_RATE_LIMIT" );
+
+      limit = rateLimit = limitEnv != NULL ? atoi ( limitEnv ) : 0;
+   }
+
+   if ( limit <= 0 || level >= ES_LOG_ERROR )
+   {
+      return GL_TRUE;
+   }
+
+   // Refill at limit messages per second, up to a second's worth
+   now = esGetTime ( );
+
+   if ( ring->lastRefill == 0.0 )
+   {
+      ring->tokens = limit;
+   }
+   else
+   {
+      ring->tokens += ( now - ring->lastRefill ) * limit;
+
+      if ( ring->tokens > limit )
+      {
+         ring->tokens = limit;
+      }
+   }
+
+   ring->lastRefill = now;
+
+   if ( ring->tokens < 1.0 )
+   {
+      FetchAdd ( &ring->limited, 1 );
+      return GL_FALSE;
+   }
+
+   ring->tokens -= 1.0;
+   return GL_TRUE;
+}
+
+///
+// Drain()
+//
+//    Write out every message in the rings, oldest first.  Called with
+//    drainLock held.
+//
+static void Drain ( void )
+{
+   unsigned int i;
+
+   for ( ;; )
+   {
+      LogRing *next = NULL;
+      unsigned int nextSequence = 0;
+      unsigned int tail;
+      int length = 0;
+      int level;
+      int more;
+
+      // The oldest message at the tail of any ring goes first
+      for ( i = 0; i < LOG_THREADS; i++ )
+      {
+         LogRing *ring = &logger.rings[i];
+
+         if ( ring->tail != LoadAcquire ( &ring->head ) )
+         {
+            unsigned int sequence = ring->records[ring->tail & ( LOG_RING_SIZE - 1 )].sequence;
+
+            if ( next == NULL || ( int ) ( sequence - nextSequence ) < 0 )
+            {
+               next = ring;
+               nextSequence = sequence;
+            }
+         }
+      }
+
+      if ( next == NULL )
+      {
+         break;
+      }
+
+      // A message's records are published together, take them all
+      tail = next->tail;
+
+      do
+      {
+         LogRecord *record = &next->records[tail & ( LOG_RING_SIZE - 1 )];
+
+         memcpy ( logger.message + length, record->text, record->length );
+         length += record->length;
+         level = record->level;
+         more = record->more;
+         tail++;
+      }
+      while ( more );
+
+      StoreRelease ( &next->tail, tail );
+
+      logger.message[length] = '\0';
+      Output ( level, logger.message );
+   }
+
+   for ( i = 0; i < LOG_THREADS; i++ )
+   {
+      unsigned int limited = Exchange ( &logger.rings[i].limited, 0 );
+
+      if ( limited > 0 )
+      {
+         sprintf ( logger.message, "esLog: %u messages rate limited\n", limited );
+         Output ( ES_LOG_WARNING, logger.message );
+      }
+   }
+
+#ifndef ANDROID
+   fflush ( stdout );
+#endif
+}
+
+///
+// FlushThread()
+//
+//    Drain the rings until the logger shuts down
+//
+static void ESCALLBACK FlushThread ( void *arg )
+{
+   ( void ) arg;
+
+   while ( !LoadAcquire ( &logger.quit ) )
+   {
+      SleepMilliseconds ( LOG_FLUSH_INTERVAL );
+
+      esMutexLock ( logger.drainLock );
+      Drain ( );
+      esMutexUnlock ( logger.drainLock );
+   }
+}
+
+///
+// LogShutdown()
+//
+//    Stop the flusher and write out what it left, at exit
+//
+static void LogShutdown ( void )
+{
+   if ( !CompareExchange ( &logger.state, LOG_RUNNING, LOG_STARTING ) )
+   {
+      return;
+   }
+
+   StoreRelease ( &logger.quit, 1 );
+   esThreadJoin ( logger.thread );
+
+   Drain ( );
+
+   esMutexDestroy ( logger.drainLock );
+   logger.drainLock = NULL;
+   logger.thread = NULL;
+
+   StoreRelease ( &logger.state, LOG_STOPPED );
+}
+
+///
+// LogStart()
+//
+//    Start the flusher on the first message, GL_FALSE if messages have to be
+//    written inline, because it could not start or is starting on another thread
+//
+static GLboolean LogStart ( void )
+{
+   static GLboolean registered = GL_FALSE;
+   unsigned int state = LoadAcquire ( &logger.state );
+
+   if ( state == LOG_RUNNING )
+   {
+      return GL_TRUE;
+   }
+
+   if ( state != LOG_STOPPED || !CompareExchange ( &logger.state, LOG_STOPPED, LOG_STARTING ) )
+   {
+      return GL_FALSE;
+   }
+
+   logger.quit = 0;
+   logger.drainLock = esMutexCreate ( );
+   logger.thread = logger.drainLock != NULL ? esThreadCreate ( FlushThread, NULL ) : NULL;
+
+   if ( logger.thread == NULL )
+   {
+      if ( logger.drainLock != NULL )
+      {
+         esMutexDestroy ( logger.drainLock );
+         logger.drainLock = NULL;
+      }
+
+      StoreRelease ( &logger.state, LOG_INLINE );
+      return GL_FALSE;
+   }
+
+   if ( !registered )
+   {
+      atexit ( LogShutdown );
+      registered = GL_TRUE;
+   }
+
+   StoreRelease ( &logger.state, LOG_RUNNING );
+   return GL_TRUE;
+}
+
+///
+// LogWrite()
+//
+//    Format a message into the ring of the calling thread
+//
+static void LogWrite ( int level, const char *formatStr, va_list params )
+{
+   char message[LOG_MESSAGE_SIZE];
+   LogRing *ring;
+   unsigned int head;
+   unsigned int sequence;
+   int length;
+   int offset;
+   int count;
+   int i;
+
+   if ( logLevel < 0 )
+   {
+      logLevel = ParseLevel ( getenv ( "ES_LOG_LEVEL" ) );
+   }
+
+   if ( level < logLevel )
+   {
+      return;
+   }
+
+   length = vsnprintf ( message, sizeof ( message ), formatStr, params );
+
+   if ( length < 0 )
+   {
+      return;
+   }
+
+   if ( length >= LOG_MESSAGE_SIZE )
+   {
+      length = LOG_MESSAGE_SIZE - 1;
+   }
+
+   ring = ThreadRing ( );
+
+   if ( ring == NULL || !LogStart ( ) )
+   {
+      Output ( level, message );
+      return;
+   }
+
+   if ( !RateLimit ( ring, level ) )
+   {
+      return;
+   }
+
+   count = length > 0 ? ( length + LOG_RECORD_TEXT - 1 ) / LOG_RECORD_TEXT : 1;
+   head = ring->head;
+
+   // On a full ring write out what is queued rather than wait for the
+   // flusher, which keeps the order and loses nothing
+   while ( head - LoadAcquire ( &ring->tail ) + count > LOG_RING_SIZE )
+   {
+      esMutexLock ( logger.drainLock );
+      Drain ( );
+      esMutexUnlock ( logger.drainLock );
+   }
+
+   sequence = FetchAdd ( &logger.sequence, 1 );
+
+   for ( i = 0, offset = 0; i < count; i++, offset += LOG_RECORD_TEXT )
+   {
+      LogRecord *record = &ring->records[( head + i ) & ( LOG_RING_SIZE - 1 )];
+      int recordLength = length - offset < LOG_RECORD_TEXT ? length - offset : LOG_RECORD_TEXT;
+
+      record->sequence = sequence;
+      record->length = ( unsigned short ) recordLength;
+      record->level = ( unsigned char ) level;
+      record->more = i + 1 < count;
+      memcpy ( record->text, message + offset, recordLength );
+   }
+
+   // Publish the records once they are complete
+   StoreRelease ( &ring->head, head + count );
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+//
+///
+/// \brief Log a message at a severity level
+/// \param level ES_LOG_DEBUG, ES_LOG_INFO, ES_LOG_WARNING or ES_LOG_ERROR
+/// \param formatStr Format string for the message
+//
+void ESUTIL_API esLog ( int level, const char *formatStr, ... )
+{
+   va_list params;
+
+   if ( level < ES_LOG_LEVEL || level >= ES_LOG_NONE )
+   {
+      return;
+   }
+
+   va_start ( params, formatStr );
+   LogWrite ( level, formatStr, params );
+   va_end ( params );
+}
+
+//
+///
+/// \brief Log a message to the debug output for the platform, at ES_LOG_INFO
+/// \param formatStr Format string for the message
+//
+void ESUTIL_API esLogMessage ( const char *formatStr, ... )
+{
+   va_list params;
+
+   if ( ES_LOG_INFO < ES_LOG_LEVEL )
+   {
+      return;
+   }
+
+   va_start ( params, formatStr );
+   LogWrite ( ES_LOG_INFO, formatStr, params );
+   va_end ( params );
+}
+
+//
+///
+/// \brief Set the least severe level written
+/// \param level Level of the least severe messages to write, ES_LOG_NONE for none
+//
+void ESUTIL_API esLogSetLevel ( int level )
+{
+   logLevel = level;
+}
+
+//
+///
+/// \brief Hold each thread to a number of messages per second
+//
+void ESUTIL_API esLogSetRateLimit ( int messagesPerSecond )
+{
+   rateLimit = messagesPerSecond > 0 ? messagesPerSecond : 0;
+}
+
+//
+///
+/// \brief Write out the messages logged so far
+//
+void ESUTIL_API esLogFlush ( void )
+{
+   if ( LoadAcquire ( &logger.state ) != LOG_RUNNING )
+   {
+      return;
+   }
+
+   esMutexLock ( logger.drainLock );
+   Drain ( );
+   esMutexUnlock ( logger.drainLock );
+}
@@ -0,0 +1,612 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// ESMipMap.c
+//
+//    Mip chain generation on the CPU.  Every level after the first goes
+//    into one allocation.  Each level is a box filter of the previous one,
+//    2x2 texels averaged in integers with SSE2 or NEON, with three texels
+//    along an odd dimension so non-power-of-two sizes lose no texels.  sRGB
+//    colors are averaged in linear space.  Rows of a level are split across
+//    the esParallelFor threads.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 )
+#define ES_SIMD_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define ES_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+///
+//  Macros
+//
+
+// Destination texels worth handing to another thread
+#define MIP_MIN_CHUNK   16384
+
+///
+//  Types
+//
+
+// Filter one level into the next
+typedef struct
+{
+   const GLubyte *src;
+   int            srcWidth;
+   int            srcHeight;
+   GLubyte       *dst;
+   int            dstWidth;
+   int            dstHeight;
+   int            bytesPerPixel;
+   GLboolean      srgb;
+} MipLevel;
+
+// Average 2x2 texels of two rows into count texels of dst, returns the
+// number of texels done, the rest is left to the scalar code
+typedef int ( *MipRowFunc ) ( const GLubyte *row0, const GLubyte *row1, GLubyte *dst, int count );
+
+// sRGB to linear, 16 bits, and 16-bit linear to sRGB
+static unsigned short s_srgbToLinear[256];
+static GLubyte        s_linearToSrgb[65536];
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// BuildSrgbTables()
+//
+//    Fill the sRGB conversion tables, run once
+//
+static void BuildSrgbTables ( void )
+{
+   int i;
+
+   for ( i = 0; i < 256; i++ )
+   {
+      float c = i / 255.0f;
+      float linear = c <= 0.04045f ? c / 12.92f : powf ( ( c + 0.055f ) / 1.055f, 2.4f );
+
+      s_srgbToLinear[i] = ( unsigned short ) ( linear * 65535.0f + 0.5f );
+   }
+
+   for ( i = 0; i < 65536; i++ )
+   {
+      float linear = i / 65535.0f;
+      float c = linear <= 0.0031308f ? linear * 12.92f : 1.055f * powf ( linear, 1.0f / 2.4f ) - 0.055f;
+
+      s_linearToSrgb[i] = ( GLubyte ) ( c * 255.0f + 0.5f );
+   }
+}
+
+#ifdef _WIN32
+static BOOL CALLBACK BuildSrgbTablesOnce ( PINIT_ONCE initOnce, PVOID param, PVOID *context )
+{
+   BuildSrgbTables ( );
+   return TRUE;
+}
+#endif
+
+///
+// InitSrgbTables()
+//
+//    Build the sRGB conversion tables on first use.  Called before the
+//    filtering is handed to other threads, which then only read them.
+//
+static void InitSrgbTables ( void )
+{
+#ifdef _WIN32
+   static INIT_ONCE initOnce = INIT_ONCE_STATIC_INIT;
+
+   InitOnceExecuteOnce ( &initOnce, BuildSrgbTablesOnce, NULL, NULL );
+#else
+   static pthread_once_t initOnce = PTHREAD_ONCE_INIT;
+
+   pthread_once ( &initOnce, BuildSrgbTables );
+#endif
+}
+
+///
+// FilterTexel()
+//
+//    Average the nx by ny source texels at (sx, sy) into dst, any filter
+//    size and format
+//
+static void FilterTexel ( const MipLevel *level, int sx, int nx, int sy, int ny, GLubyte *dst )
+{
+   int bytesPerPixel = level->bytesPerPixel;
+   int count = nx * ny;
+   int c, i, j;
+
+   for ( c = 0; c < bytesPerPixel; c++ )
+   {
+      // Alpha stays linear
+      GLboolean srgb = level->srgb && ( bytesPerPixel < 4 || c < 3 );
+      unsigned int sum = 0;
+
+      for ( j = 0; j < ny; j++ )
+      {
+         const GLubyte *row = level->src + ( size_t ) ( sy + j ) * level->srcWidth * bytesPerPixel;
+
+         for ( i = 0; i < nx; i++ )
+         {
+            GLubyte value = row[ ( sx + i ) * bytesPerPixel + c];
+
+            sum += srgb ? s_srgbToLinear[value] : value;
+         }
+      }
+
+      sum = ( sum + count / 2 ) / count;
+      dst[c] = srgb ? s_linearToSrgb[sum] : ( GLubyte ) sum;
+   }
+}
+
+///
+// MipRowScalar()
+//
+//    Portable 2x2 filter, any format
+//
+static int MipRowScalar ( const GLubyte *row0, const GLubyte *row1, GLubyte *dst,
+                          int count, int bytesPerPixel )
+{
+   int i;
+
+   for ( i = 0; i < count * bytesPerPixel; i++ )
+   {
+      int x = i / bytesPerPixel * 2 * bytesPerPixel + i % bytesPerPixel;
+
+      dst[i] = ( GLubyte ) ( ( row0[x] + row0[x + bytesPerPixel] + row1[x] + row1[x + bytesPerPixel] + 2 ) >> 2 );
+   }
+
+   return count;
+}
+
+#ifdef ES_SIMD_SSE2
+///
+// MipRowSSE2R()
+//
+//    Sixteen one-byte texels at a time: the even and odd bytes of both rows
+//    are summed in 16 bits, rounded and packed back
+//
+static int MipRowSSE2R ( const GLubyte *row0, const GLubyte *row1, GLubyte *dst, int count )
+{
+   __m128i mask = _mm_set1_epi16 ( 0x00FF );
+   __m128i round = _mm_set1_epi16 ( 2 );
+   int x;
+
+   for ( x = 0; x + 16 <= count; x += 16 )
+   {
+      __m128i a0 = _mm_loadu_si128 ( ( const __m128i * ) ( row0 + x * 2 ) );
+      __m128i a1 = _mm_loadu_si128 ( ( const __m128i * ) ( row0 + x * 2 + 16 ) );
+      __m128i b0 = _mm_loadu_si128 ( ( const __m128i * ) ( row1 + x * 2 ) );
+      __m128i b1 = _mm_loadu_si128 ( ( const __m128i * ) ( row1 + x * 2 + 16 ) );
+      __m128i s0, s1;
+
+      s0 = _mm_add_epi16 ( _mm_and_si128 ( a0, mask ), _mm_srli_epi16 ( a0, 8 ) );
+      s0 = _mm_add_epi16 ( s0, _mm_add_epi16 ( _mm_and_si128 ( b0, mask ), _mm_srli_epi16 ( b0, 8 ) ) );
+      s1 = _mm_add_epi16 ( _mm_and_si128 ( a1, mask ), _mm_srli_epi16 ( a1, 8 ) );
+      s1 = _mm_add_epi16 ( s1, _mm_add_epi16 ( _mm_and_si128 ( b1, mask ), _mm_srli_epi16 ( b1, 8 ) ) );
+
+      s0 = _mm_srli_epi16 ( _mm_add_epi16 ( s0, round ), 2 );
+      s1 = _mm_srli_epi16 ( _mm_add_epi16 ( s1, round ), 2 );
+
+      _mm_storeu_si128 ( ( __m128i * ) ( dst + x ), _mm_packus_epi16 ( s0, s1 ) );
+   }
+
+   return x;
+}
+
+///
+// MipRowSSE2RGB()
+//
+//    Four three-byte texels at a time: the 24 bytes of each row are widened
+//    to 16 bits in three registers and summed, each value is added to the
+//    one three places on, the neighbouring texel, and the sums of every
+//    other texel are masked together before packing
+//
+static int MipRowSSE2RGB ( const GLubyte *row0, const GLubyte *row1, GLubyte *dst, int count )
+{
+   __m128i zero = _mm_setzero_si128 ( );
+   __m128i round = _mm_set1_epi16 ( 2 );
+   __m128i mask012 = _mm_setr_epi16 ( -1, -1, -1, 0, 0, 0, 0, 0 );
+   __m128i mask34 = _mm_setr_epi16 ( 0, 0, 0, -1, -1, 0, 0, 0 );
+   __m128i mask5 = _mm_setr_epi16 ( 0, 0, 0, 0, 0, -1, 0, 0 );
+   __m128i mask67 = _mm_setr_epi16 ( 0, 0, 0, 0, 0, 0, -1, -1 );
+   __m128i mask0 = _mm_setr_epi16 ( -1, 0, 0, 0, 0, 0, 0, 0 );
+   __m128i mask123 = _mm_setr_epi16 ( 0, -1, -1, -1, 0, 0, 0, 0 );
+   int x;
+
+   for ( x = 0; x + 4 <= count; x += 4 )
+   {
+      __m128i a0 = _mm_loadu_si128 ( ( const __m128i * ) ( row0 + x * 6 ) );
+      __m128i a1 = _mm_loadu_si128 ( ( const __m128i * ) ( row0 + x * 6 + 8 ) );
+      __m128i b0 = _mm_loadu_si128 ( ( const __m128i * ) ( row1 + x * 6 ) );
+      __m128i b1 = _mm_loadu_si128 ( ( const __m128i * ) ( row1 + x * 6 + 8 ) );
+
+      // Bytes 0-7, 8-15 and 16-23 of the 2x8 block, summed vertically
+      __m128i v0 = _mm_add_epi16 ( _mm_unpacklo_epi8 ( a0, zero ), _mm_unpacklo_epi8 ( b0, zero ) );
+      __m128i v1 = _mm_add_epi16 ( _mm_unpackhi_epi8 ( a0, zero ), _mm_unpackhi_epi8 ( b0, zero ) );
+      __m128i v2 = _mm_add_epi16 ( _mm_unpackhi_epi8 ( a1, zero ), _mm_unpackhi_epi8 ( b1, zero ) );
+
+      // Plus the texel to the right, the sums for texels 0, 2, 4 and 6
+      // start at values 0, 6, 12 and 18
+      __m128i s0 = _mm_add_epi16 ( v0, _mm_or_si128 ( _mm_srli_si128 ( v0, 6 ), _mm_slli_si128 ( v1, 10 ) ) );
+      __m128i s1 = _mm_add_epi16 ( v1, _mm_or_si128 ( _mm_srli_si128 ( v1, 6 ), _mm_slli_si128 ( v2, 10 ) ) );
+      __m128i s2 = _mm_add_epi16 ( v2, _mm_srli_si128 ( v2, 6 ) );
+      __m128i lo, hi;
+      int last;
+
+      lo = _mm_or_si128 ( _mm_and_si128 ( s0, mask012 ), _mm_and_si128 ( _mm_srli_si128 ( s0, 6 ), mask34 ) );
+      lo = _mm_or_si128 ( lo, _mm_and_si128 ( _mm_slli_si128 ( s1, 10 ), mask5 ) );
+      lo = _mm_or_si128 ( lo, _mm_and_si128 ( _mm_slli_si128 ( s1, 4 ), mask67 ) );
+      hi = _mm_or_si128 ( _mm_and_si128 ( _mm_srli_si128 ( s1, 12 ), mask0 ),
+                          _mm_and_si128 ( _mm_srli_si128 ( s2, 2 ), mask123 ) );
+
+      lo = _mm_srli_epi16 ( _mm_add_epi16 ( lo, round ), 2 );
+      hi = _mm_srli_epi16 ( _mm_add_epi16 ( hi, round ), 2 );
+      lo = _mm_packus_epi16 ( lo, hi );
+
+      // Twelve bytes, the store must not run past the row
+      _mm_storel_epi64 ( ( __m128i * ) ( dst + x * 3 ), lo );
+      last = _mm_cvtsi128_si32 ( _mm_srli_si128 ( lo, 8 ) );
+      memcpy ( dst + x * 3 + 8, &last, 4 );
+   }
+
+   return x;
+}
+
+///
+// MipRowSSE2RGBA()
+//
+//    Four four-byte texels at a time: both rows are widened to 16 bits and
+//    summed, then the 64-bit halves holding neighbouring texels are added
+//
+static int MipRowSSE2RGBA ( const GLubyte *row0, const GLubyte *row1, GLubyte *dst, int count )
+{
+   __m128i zero = _mm_setzero_si128 ( );
+   __m128i round = _mm_set1_epi16 ( 2 );
+   int x;
+
+   for ( x = 0; x + 4 <= count; x += 4 )
+   {
+      __m128i a0 = _mm_loadu_si128 ( ( const __m128i * ) ( row0 + x * 8 ) );
+      __m128i a1 = _mm_loadu_si128 ( ( const __m128i * ) ( row0 + x * 8 + 16 ) );
+      __m128i b0 = _mm_loadu_si128 ( ( const __m128i * ) ( row1 + x * 8 ) );
+      __m128i b1 = _mm_loadu_si128 ( ( const __m128i * ) ( row1 + x * 8 + 16 ) );
+
+      // Texels 0-1, 2-3, 4-5 and 6-7 of the 2x8 block, summed vertically
+      __m128i s01 = _mm_add_epi16 ( _mm_unpacklo_epi8 ( a0, zero ), _mm_unpacklo_epi8 ( b0, zero ) );
+      __m128i s23 = _mm_add_epi16 ( _mm_unpackhi_epi8 ( a0, zero ), _mm_unpackhi_epi8 ( b0, zero ) );
+      __m128i s45 = _mm_add_epi16 ( _mm_unpacklo_epi8 ( a1, zero ), _mm_unpacklo_epi8 ( b1, zero ) );
+      __m128i s67 = _mm_add_epi16 ( _mm_unpackhi_epi8 ( a1, zero ), _mm_unpackhi_epi8 ( b1, zero ) );
+      __m128i t0 = _mm_add_epi16 ( _mm_unpacklo_epi64 ( s01, s23 ), _mm_unpackhi_epi64 ( s01, s23 ) );
+      __m128i t1 = _mm_add_epi16 ( _mm_unpacklo_epi64 ( s45, s67 ), _mm_unpackhi_epi64 ( s45, s67 ) );
+
+      t0 = _mm_srli_epi16 ( _mm_add_epi16 ( t0, round ), 2 );
+      t1 = _mm_srli_epi16 ( _mm_add_epi16 ( t1, round ), 2 );
+
+      _mm_storeu_si128 ( ( __m128i * ) ( dst + x * 4 ), _mm_packus_epi16 ( t0, t1 ) );
+   }
+
+   return x;
+}
+#endif // ES_SIMD_SSE2
+
+#ifdef ES_SIMD_NEON
+///
+// MipRowNEONR()
+//
+//    Pairwise widening adds of sixteen bytes, then a rounding narrow
+//
+static int MipRowNEONR ( const GLubyte *row0, const GLubyte *row1, GLubyte *dst, int count )
+{
+   int x;
+
+   for ( x = 0; x + 8 <= count; x += 8 )
+   {
+      uint16x8_t sum = vaddq_u16 ( vpaddlq_u8 ( vld1q_u8 ( row0 + x * 2 ) ),
+                                   vpaddlq_u8 ( vld1q_u8 ( row1 + x * 2 ) ) );
+
+      vst1_u8 ( dst + x, vrshrn_n_u16 ( sum, 2 ) );
+   }
+
+   return x;
+}
+
+///
+// MipRowNEONRGB()
+//
+//    The channels are deinterleaved on load and filtered as in MipRowNEONR
+//
+static int MipRowNEONRGB ( const GLubyte *row0, const GLubyte *row1, GLubyte *dst, int count )
+{
+   int x;
+
+   for ( x = 0; x + 8 <= count; x += 8 )
+   {
+      uint8x16x3_t a = vld3q_u8 ( row0 + x * 6 );
+      uint8x16x3_t b = vld3q_u8 ( row1 + x * 6 );
+      uint8x8x3_t  texels;
+      int          c;
+
+      for ( c = 0; c < 3; c++ )
+      {
+         texels.val[c] = vrshrn_n_u16 ( vaddq_u16 ( vpaddlq_u8 ( a.val[c] ), vpaddlq_u8 ( b.val[c] ) ), 2 );
+      }
+
+      vst3_u8 ( dst + x * 3, texels );
+   }
+
+   return x;
+}
+
+///
+// MipRowNEONRGBA()
+//
+static int MipRowNEONRGBA ( const GLubyte *row0, const GLubyte *row1, GLubyte *dst, int count )
+{
+   int x;
+
+   for ( x = 0; x + 8 <= count; x += 8 )
+   {
+      uint8x16x4_t a = vld4q_u8 ( row0 + x * 8 );
+      uint8x16x4_t b = vld4q_u8 ( row1 + x * 8 );
+      uint8x8x4_t  texels;
+      int          c;
+
+      for ( c = 0; c < 4; c++ )
+      {
+         texels.val[c] = vrshrn_n_u16 ( vaddq_u16 ( vpaddlq_u8 ( a.val[c] ), vpaddlq_u8 ( b.val[c] ) ), 2 );
+      }
+
+      vst4_u8 ( dst + x * 4, texels );
+   }
+
+   return x;
+}
+#endif // ES_SIMD_NEON
+
+///
+// GetMipRow()
+//
+//    SIMD 2x2 filter for a format, NULL if there is none
+//
+static MipRowFunc GetMipRow ( int bytesPerPixel )
+{
+#if defined(ES_SIMD_SSE2)
+   return bytesPerPixel == 1 ? MipRowSSE2R : bytesPerPixel == 3 ? MipRowSSE2RGB : MipRowSSE2RGBA;
+#elif defined(ES_SIMD_NEON)
+   return bytesPerPixel == 1 ? MipRowNEONR : bytesPerPixel == 3 ? MipRowNEONRGB : MipRowNEONRGBA;
+#else
+   ( void ) bytesPerPixel;
+   return NULL;
+#endif
+}
+
+///
+// FilterRows()
+//
+//    Filter rows [first, last) of the next level
+//
+static void ESCALLBACK FilterRows ( void *userData, int first, int last )
+{
+   const MipLevel *level = ( const MipLevel * ) userData;
+   MipRowFunc mipRow = level->srgb ? NULL : GetMipRow ( level->bytesPerPixel );
+   int bytesPerPixel = level->bytesPerPixel;
+   size_t srcPitch = ( size_t ) level->srcWidth * bytesPerPixel;
+   size_t dstPitch = ( size_t ) level->dstWidth * bytesPerPixel;
+
+   // Texels covered by a destination texel: 2 along even dimensions, with the
+   // last one taking 3 along odd ones, and 1 once a dimension is down to 1
+   int nx = level->srcWidth > 1 ? 2 : 1;
+   int pairs = level->srcWidth > 1 ? level->srcWidth / 2 - level->srcWidth % 2 : 0;
+   int y;
+
+   for ( y = first; y < last; y++ )
+   {
+      int sy = level->srcHeight > 1 ? y * 2 : 0;
+      int ny = level->srcHeight == 1 ? 1 : ( y == level->dstHeight - 1 && level->srcHeight % 2 ) ? 3 : 2;
+      const GLubyte *row0 = level->src + sy * srcPitch;
+      GLubyte *dst = level->dst + y * dstPitch;
+      int x = 0;
+
+      if ( ny == 2 && !level->srgb )
+      {
+         if ( mipRow != NULL )
+         {
+            x = mipRow ( row0, row0 + srcPitch, dst, pairs );
+         }
+
+         x += MipRowScalar ( row0 + x * 2 * bytesPerPixel, row0 + srcPitch + x * 2 * bytesPerPixel,
+                             dst + x * bytesPerPixel, pairs - x, bytesPerPixel );
+      }
+
+      for ( ; x < level->dstWidth; x++ )
+      {
+         int sx = x * nx;
+         int n = nx == 2 && x == level->dstWidth - 1 && level->srcWidth % 2 ? 3 : nx;
+
+         FilterTexel ( level, sx, n, sy, ny, dst + x * bytesPerPixel );
+      }
+   }
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+//
+///
+/// \brief Build the mip chain of an image
+//
+GLboolean ESUTIL_API esGenMipChain ( ESMipChain *chain, const GLubyte *pixels, int width, int height,
+                                     int bytesPerPixel, GLuint flags )
+{
+   size_t offset[ES_MAX_MIP_LEVELS];
+   size_t size = 0;
+   int level;
+
+   memset ( chain, 0, sizeof ( ESMipChain ) );
+
+   if ( pixels == NULL || width <= 0 || height <= 0 || width >= ( 1 << ES_MAX_MIP_LEVELS ) ||
+         height >= ( 1 << ES_MAX_MIP_LEVELS ) ||
+         ( bytesPerPixel != 1 && bytesPerPixel != 3 && bytesPerPixel != 4 ) )
+   {
+      return GL_FALSE;
+   }
+
+   chain->bytesPerPixel = bytesPerPixel;
+   chain->srgb = ( flags & ES_MIP_SRGB ) ? GL_TRUE : GL_FALSE;
+   chain->width[0] = width;
+   chain->height[0] = height;
+   chain->pixels[0] = pixels;
+   chain->levels = 1;
+
+   // Lay out every level after the first in one allocation
+   while ( width > 1 || height > 1 )
+   {
+      width = width > 1 ? width / 2 : 1;
+      height = height > 1 ? height / 2 : 1;
+
+      offset[chain->levels] = size;
+      chain->width[chain->levels] = width;
+      chain->height[chain->levels] = height;
+      chain->levels++;
+
+      size += ( size_t ) width * height * bytesPerPixel;
+   }
+
+   if ( size > 0 )
+   {
+      chain->data = ( GLubyte * ) malloc ( size );
+
+      if ( chain->data == NULL )
+      {
+         memset ( chain, 0, sizeof ( ESMipChain ) );
+         return GL_FALSE;
+      }
+   }
+
+   if ( chain->srgb )
+   {
+      InitSrgbTables ( );
+   }
+
+   for ( level = 1; level < chain->levels; level++ )
+   {
+      MipLevel mipLevel;
+      int texels;
+
+      chain->pixels[level] = chain->data + offset[level];
+
+      mipLevel.src = chain->pixels[level - 1];
+      mipLevel.srcWidth = chain->width[level - 1];
+      mipLevel.srcHeight = chain->height[level - 1];
+      mipLevel.dst = chain->data + offset[level];
+      mipLevel.dstWidth = chain->width[level];
+      mipLevel.dstHeight = chain->height[level];
+      mipLevel.bytesPerPixel = bytesPerPixel;
+      mipLevel.srgb = chain->srgb;
+
+      texels = mipLevel.dstWidth * ( chain->srgb ? 4 : 1 );
+      esParallelFor ( mipLevel.dstHeight, MIP_MIN_CHUNK / texels + 1, FilterRows, &mipLevel );
+   }
+
+   return GL_TRUE;
+}
+
+//
+///
+/// \brief Upload every level of a mip chain to the bound texture
+//
+void ESUTIL_API esTexImageMipChain ( GLenum target, const ESMipChain *chain )
+{
+   GLenum format = chain->bytesPerPixel == 1 ? GL_RED : chain->bytesPerPixel == 3 ? GL_RGB : GL_RGBA;
+   GLenum internalFormat;
+   GLint alignment;
+   int level;
+
+   if ( chain->bytesPerPixel == 1 )
+   {
+      internalFormat = GL_R8;
+   }
+   else if ( chain->bytesPerPixel == 3 )
+   {
+      internalFormat = chain->srgb ? GL_SRGB8 : GL_RGB8;
+   }
+   else
+   {
+      internalFormat = chain->srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+   }
+
+   // Rows are tightly packed
+   glGetIntegerv ( GL_UNPACK_ALIGNMENT, &alignment );
+   glPixelStorei ( GL_UNPACK_ALIGNMENT, 1 );
+
+   for ( level = 0; level < chain->levels; level++ )
+   {
+      glTexImage2D ( target, level, internalFormat, chain->width[level], chain->height[level], 0,
+                     format, GL_UNSIGNED_BYTE, chain->pixels[level] );
+   }
+
+   glPixelStorei ( GL_UNPACK_ALIGNMENT, alignment );
+}
+
+//
+///
+/// \brief Release a mip chain built with esGenMipChain
+//
+void ESUTIL_API esFreeMipChain ( ESMipChain *chain )
+{
+   free ( chain->data );
+   memset ( chain, 0, sizeof ( ESMipChain ) );
+}
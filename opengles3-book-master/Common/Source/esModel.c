@@ -0,0 +1,1470 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// ESModel.c
+//
+//    Loader for PowerVR POD scenes.  The file is mapped and its tagged blocks
+//    are walked once, front to back.  Meshes go straight from the mapping into
+//    buffer objects, nodes and their animation keys into flat arrays.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include "esUtil_win.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+///
+//  Macros
+//
+
+// Every block starts with a tag and a length, and is closed by the same tag
+// with the top bit set.  Blocks of length 0 are containers.
+#define POD_END_TAG             0x80000000
+#define POD_BLOCK_HEADER_SIZE   8
+#define POD_VERSION             "AB.POD.2."
+
+// File
+#define POD_TAG_VERSION         1000
+#define POD_TAG_SCENE           1001
+
+// Scene
+#define POD_TAG_BACKGROUND      2000
+#define POD_TAG_AMBIENT         2001
+#define POD_TAG_NUM_CAMERA      2002
+#define POD_TAG_NUM_LIGHT       2003
+#define POD_TAG_NUM_MESH        2004
+#define POD_TAG_NUM_NODE        2005
+#define POD_TAG_NUM_MESH_NODE   2006
+#define POD_TAG_NUM_TEXTURE     2007
+#define POD_TAG_NUM_MATERIAL    2008
+#define POD_TAG_NUM_FRAME       2009
+#define POD_TAG_MESH            2012
+#define POD_TAG_NODE            2013
+#define POD_TAG_TEXTURE         2014
+#define POD_TAG_MATERIAL        2015
+#define POD_TAG_FPS             2017
+
+// Material
+#define POD_TAG_MAT_NAME        3000
+#define POD_TAG_MAT_DIFFUSE_TEX 3001
+#define POD_TAG_MAT_OPACITY     3002
+#define POD_TAG_MAT_AMBIENT     3003
+#define POD_TAG_MAT_DIFFUSE     3004
+#define POD_TAG_MAT_SPECULAR    3005
+#define POD_TAG_MAT_SHININESS   3006
+#define POD_TAG_MAT_BUMP_TEX    3012
+
+// Texture
+#define POD_TAG_TEX_NAME        4000
+
+// Node
+#define POD_TAG_NODE_INDEX      5000
+#define POD_TAG_NODE_NAME       5001
+#define POD_TAG_NODE_MATERIAL   5002
+#define POD_TAG_NODE_PARENT     5003
+#define POD_TAG_NODE_POS        5004
+#define POD_TAG_NODE_ROT        5005
+#define POD_TAG_NODE_SCALE      5006
+#define POD_TAG_NODE_ANIM_POS   5007
+#define POD_TAG_NODE_ANIM_ROT   5008
+#define POD_TAG_NODE_ANIM_SCALE 5009
+#define POD_TAG_NODE_MATRIX     5010
+#define POD_TAG_NODE_ANIM_MATRIX 5011
+#define POD_TAG_NODE_ANIM_FLAGS 5012
+#define POD_TAG_NODE_POS_INDEX  5013
+#define POD_TAG_NODE_ROT_INDEX  5014
+#define POD_TAG_NODE_SCALE_INDEX 5015
+#define POD_TAG_NODE_MATRIX_INDEX 5016
+
+// Mesh
+#define POD_TAG_MESH_NUM_VTX    6000
+#define POD_TAG_MESH_NUM_FACES  6001
+#define POD_TAG_MESH_FACES      6003
+#define POD_TAG_MESH_STRIP_LEN  6004
+#define POD_TAG_MESH_NUM_STRIPS 6005
+#define POD_TAG_MESH_VTX        6006
+#define POD_TAG_MESH_NOR        6007
+#define POD_TAG_MESH_TAN        6008
+#define POD_TAG_MESH_BIN        6009
+#define POD_TAG_MESH_UVW        6010
+#define POD_TAG_MESH_VTX_COL    6011
+#define POD_TAG_MESH_BONE_IDX   6012
+#define POD_TAG_MESH_BONE_WEIGHT 6013
+#define POD_TAG_MESH_INTERLEAVED 6014
+
+// Data block, used for every vertex attribute and the faces
+#define POD_TAG_DATA_TYPE       9000
+#define POD_TAG_DATA_N          9001
+#define POD_TAG_DATA_STRIDE     9002
+#define POD_TAG_DATA_DATA       9003
+
+// Data types that can hold indices
+#define POD_TYPE_INT            2
+#define POD_TYPE_UNSIGNED_SHORT 3
+#define POD_TYPE_UNSIGNED_INT   17
+
+// Floats per key in the file for each track, scale carries a stretch
+// quaternion that is dropped
+#define POD_POS_STRIDE          3
+#define POD_ROT_STRIDE          4
+#define POD_SCALE_STRIDE        7
+#define POD_MATRIX_STRIDE       16
+
+// Tracks of a node, in ESPODNode order
+#define POD_TRACK_POS           0
+#define POD_TRACK_ROT           1
+#define POD_TRACK_SCALE         2
+#define POD_TRACK_MATRIX        3
+#define POD_NUM_TRACKS          4
+
+///
+//  Types
+//
+
+// Walks the blocks of a mapped file
+typedef struct
+{
+   const unsigned char *data;
+   size_t               size;
+   size_t               offset;
+} PODReader;
+
+// A data block as found in the file
+typedef struct
+{
+   unsigned int         type;
+   unsigned int         n;
+   unsigned int         stride;
+
+   // Raw data, or a 4-byte offset into the interleaved data
+   const unsigned char *data;
+   size_t               length;
+} PODData;
+
+// Mesh blocks gathered before the buffers are built
+typedef struct
+{
+   unsigned int         numVertices;
+   unsigned int         numFaces;
+   unsigned int         numStrips;
+   const unsigned char *stripLengths;
+   size_t               stripLengthsSize;
+   const unsigned char *interleaved;
+   size_t               interleavedSize;
+   int                  numUVW;
+   PODData              faces;
+   PODData              attribs[ES_POD_NUM_ATTRIBS];
+} PODMeshData;
+
+// Animation track of a node as found in the file
+typedef struct
+{
+   const unsigned char *data;
+   size_t               length;
+   const unsigned char *index;
+   size_t               indexLength;
+} PODTrackData;
+
+// GL equivalent of each POD data type
+static const struct
+{
+   GLenum      type;
+   GLboolean   normalized;
+
+   // Bytes per component, or per element for packed types
+   int         size;
+   GLboolean   packed;
+} podDataTypes[] =
+{
+   { 0, GL_FALSE, 0, GL_FALSE },                               // none
+   { GL_FLOAT, GL_FALSE, 4, GL_FALSE },                        // float
+   { GL_INT, GL_FALSE, 4, GL_FALSE },                          // int
+   { GL_UNSIGNED_SHORT, GL_FALSE, 2, GL_FALSE },               // unsigned short
+   { GL_UNSIGNED_BYTE, GL_TRUE, 4, GL_TRUE },                  // RGBA
+   { GL_UNSIGNED_BYTE, GL_TRUE, 4, GL_TRUE },                  // ARGB
+   { GL_UNSIGNED_BYTE, GL_TRUE, 4, GL_TRUE },                  // D3DCOLOR
+   { GL_UNSIGNED_BYTE, GL_FALSE, 4, GL_TRUE },                 // UBYTE4
+   { GL_INT_2_10_10_10_REV, GL_TRUE, 4, GL_TRUE },             // DEC3N
+   { GL_FIXED, GL_FALSE, 4, GL_FALSE },                        // 16.16 fixed
+   { GL_UNSIGNED_BYTE, GL_FALSE, 1, GL_FALSE },                // unsigned byte
+   { GL_SHORT, GL_FALSE, 2, GL_FALSE },                        // short
+   { GL_SHORT, GL_TRUE, 2, GL_FALSE },                         // normalized short
+   { GL_BYTE, GL_FALSE, 1, GL_FALSE },                         // byte
+   { GL_BYTE, GL_TRUE, 1, GL_FALSE },                          // normalized byte
+   { GL_UNSIGNED_BYTE, GL_TRUE, 1, GL_FALSE },                 // normalized unsigned byte
+   { GL_UNSIGNED_SHORT, GL_TRUE, 2, GL_FALSE },                // normalized unsigned short
+   { GL_UNSIGNED_INT, GL_FALSE, 4, GL_FALSE }                  // unsigned int
+};
+
+#define POD_NUM_DATA_TYPES      ( sizeof ( podDataTypes ) / sizeof ( podDataTypes[0] ) )
+
+///
+// ReadU32()
+//
+static unsigned int ReadU32 ( const unsigned char *data )
+{
+   return data[0] | ( data[1] << 8 ) | ( data[2] << 16 ) | ( ( unsigned int ) data[3] << 24 );
+}
+
+///
+// ReadInt()
+//
+//    Read a 4-byte block payload, default if the block has another size
+//
+static int ReadInt ( const unsigned char *data, size_t length, int defaultValue )
+{
+   return length == 4 ? ( int ) ReadU32 ( data ) : defaultValue;
+}
+
+///
+// ReadFloats()
+//
+static void ReadFloats ( const unsigned char *data, size_t length, float *result, int count )
+{
+   if ( length == count * sizeof ( float ) )
+   {
+      memcpy ( result, data, length );
+   }
+}
+
+///
+// ReadString()
+//
+static char *ReadString ( const unsigned char *data, size_t length )
+{
+   char *result = malloc ( length + 1 );
+
+   if ( result != NULL )
+   {
+      memcpy ( result, data, length );
+      result[length] = '\0';
+   }
+
+   return result;
+}
+
+///
+// ReadBlock()
+//
+//    Read the next block header, payload points at its data
+//
+static GLboolean ReadBlock ( PODReader *reader, unsigned int *tag, const unsigned char **payload, size_t *length )
+{
+   if ( reader->size - reader->offset < POD_BLOCK_HEADER_SIZE )
+   {
+      return GL_FALSE;
+   }
+
+   *tag = ReadU32 ( reader->data + reader->offset );
+   *length = ReadU32 ( reader->data + reader->offset + 4 );
+   reader->offset += POD_BLOCK_HEADER_SIZE;
+
+   if ( *length > reader->size - reader->offset )
+   {
+      return GL_FALSE;
+   }
+
+   *payload = reader->data + reader->offset;
+   reader->offset += *length;
+
+   return GL_TRUE;
+}
+
+///
+// SkipBlock()
+//
+//    Read up to and including the end tag of a block whose start was just read
+//
+static GLboolean SkipBlock ( PODReader *reader, unsigned int startTag )
+{
+   unsigned int tag;
+   const unsigned char *payload;
+   size_t length;
+
+   while ( ReadBlock ( reader, &tag, &payload, &length ) )
+   {
+      if ( tag == ( startTag | POD_END_TAG ) )
+      {
+         return GL_TRUE;
+      }
+   }
+
+   return GL_FALSE;
+}
+
+///
+// ParseData()
+//
+static GLboolean ParseData ( PODReader *reader, unsigned int blockTag, PODData *data )
+{
+   unsigned int tag;
+   const unsigned char *payload;
+   size_t length;
+
+   memset ( data, 0, sizeof ( PODData ) );
+
+   while ( ReadBlock ( reader, &tag, &payload, &length ) )
+   {
+      // Vertex data has at most 4 components, the bound keeps AttribSize
+      // from overflowing
+      if ( tag == ( blockTag | POD_END_TAG ) )
+      {
+         return data->type < POD_NUM_DATA_TYPES && data->n <= 16 ? GL_TRUE : GL_FALSE;
+      }
+
+      switch ( tag )
+      {
+         case POD_TAG_DATA_TYPE:
+            data->type = ReadInt ( payload, length, 0 );
+            break;
+
+         case POD_TAG_DATA_N:
+            data->n = ReadInt ( payload, length, 0 );
+            break;
+
+         case POD_TAG_DATA_STRIDE:
+            data->stride = ReadInt ( payload, length, 0 );
+            break;
+
+         case POD_TAG_DATA_DATA:
+            data->data = payload;
+            data->length = length;
+            break;
+      }
+
+      if ( !SkipBlock ( reader, tag ) )
+      {
+         return GL_FALSE;
+      }
+   }
+
+   return GL_FALSE;
+}
+
+///
+// AttribSize()
+//
+//    Bytes per vertex of an attribute
+//
+static int AttribSize ( const PODData *data )
+{
+   return data->n * podDataTypes[data->type].size;
+}
+
+///
+// FetchIndex()
+//
+//    Index i of the faces, or i itself for meshes without indices
+//
+static unsigned int FetchIndex ( const PODData *faces, size_t i )
+{
+   if ( faces->data == NULL )
+   {
+      return ( unsigned int ) i;
+   }
+
+   if ( faces->type == POD_TYPE_UNSIGNED_SHORT )
+   {
+      return faces->data[i * 2] | ( faces->data[i * 2 + 1] << 8 );
+   }
+
+   return ReadU32 ( faces->data + i * 4 );
+}
+
+///
+// BuildIndices()
+//
+//    Convert the faces to a 16-bit triangle list.  Returns the indices and
+//    their count, NULL if they are invalid.
+//
+static GLushort *BuildIndices ( const PODMeshData *mesh, GLsizei *numIndices )
+{
+   size_t available, count, strip, i, in = 0, out = 0;
+   GLushort *indices;
+
+   if ( mesh->faces.data == NULL )
+   {
+      available = mesh->numVertices;
+   }
+   else if ( mesh->faces.type == POD_TYPE_UNSIGNED_SHORT )
+   {
+      available = mesh->faces.length / 2;
+   }
+   else if ( mesh->faces.type == POD_TYPE_UNSIGNED_INT || mesh->faces.type == POD_TYPE_INT )
+   {
+      available = mesh->faces.length / 4;
+   }
+   else
+   {
+      return NULL;
+   }
+
+   count = ( size_t ) mesh->numFaces * 3;
+
+   if ( mesh->numStrips == 0 && count > available )
+   {
+      return NULL;
+   }
+
+   indices = malloc ( count * sizeof ( GLushort ) + 1 );
+
+   if ( indices == NULL )
+   {
+      return NULL;
+   }
+
+   if ( mesh->numStrips == 0 )
+   {
+      for ( i = 0; i < count; i++ )
+      {
+         unsigned int index = FetchIndex ( &mesh->faces, i );
+
+         if ( index >= mesh->numVertices )
+         {
+            free ( indices );
+            return NULL;
+         }
+
+         indices[i] = ( GLushort ) index;
+      }
+
+      *numIndices = ( GLsizei ) count;
+      return indices;
+   }
+
+   // Each strip of n triangles holds n + 2 indices, every other triangle
+   // is wound the other way
+   for ( strip = 0; strip < mesh->numStrips && ( strip + 1 ) * 4 <= mesh->stripLengthsSize; strip++ )
+   {
+      size_t numTriangles = ReadU32 ( mesh->stripLengths + strip * 4 );
+
+      if ( in + numTriangles + 2 > available || out + numTriangles * 3 > count )
+      {
+         free ( indices );
+         return NULL;
+      }
+
+      for ( i = 0; i < numTriangles; i++ )
+      {
+         unsigned int a = FetchIndex ( &mesh->faces, in + i );
+         unsigned int b = FetchIndex ( &mesh->faces, in + i + 1 );
+         unsigned int c = FetchIndex ( &mesh->faces, in + i + 2 );
+
+         if ( a >= mesh->numVertices || b >= mesh->numVertices || c >= mesh->numVertices )
+         {
+            free ( indices );
+            return NULL;
+         }
+
+         indices[out++] = ( GLushort ) ( i & 1 ? b : a );
+         indices[out++] = ( GLushort ) ( i & 1 ? a : b );
+         indices[out++] = ( GLushort ) c;
+      }
+
+      in += numTriangles + 2;
+   }
+
+   *numIndices = ( GLsizei ) out;
+   return indices;
+}
+
+///
+// BuildMesh()
+//
+//    Create the vertex array, vertex buffer and index buffer of a mesh
+//
+static GLboolean BuildMesh ( const PODMeshData *data, ESPODMesh *mesh )
+{
+   const unsigned char *vertices = data->interleaved;
+   unsigned char *packed = NULL;
+   GLushort *indices = NULL;
+   GLsizei stride = 0;
+   int i;
+
+   if ( data->numVertices == 0 || data->numVertices > 65536 )
+   {
+      return GL_FALSE;
+   }
+
+   for ( i = 0; i < ES_POD_NUM_ATTRIBS; i++ )
+   {
+      const PODData *attrib = &data->attribs[i];
+
+      if ( attrib->n == 0 || attrib->type == 0 )
+      {
+         continue;
+      }
+
+      mesh->attribs[i].size = podDataTypes[attrib->type].packed ? 4 : ( GLint ) attrib->n;
+      mesh->attribs[i].type = podDataTypes[attrib->type].type;
+      mesh->attribs[i].normalized = podDataTypes[attrib->type].normalized;
+
+      if ( data->interleaved != NULL )
+      {
+         // The attribute holds its offset into the interleaved data
+         // Written so that a large offset cannot wrap around
+         if ( attrib->length != 4 || attrib->stride == 0 ||
+               ( unsigned int ) AttribSize ( attrib ) > attrib->stride ||
+               ReadU32 ( attrib->data ) > attrib->stride - ( unsigned int ) AttribSize ( attrib ) )
+         {
+            return GL_FALSE;
+         }
+
+         mesh->attribs[i].offset = ReadU32 ( attrib->data );
+         stride = attrib->stride;
+      }
+      else
+      {
+         if ( attrib->length < ( size_t ) data->numVertices * attrib->stride ||
+               attrib->stride < ( unsigned int ) AttribSize ( attrib ) )
+         {
+            return GL_FALSE;
+         }
+
+         // Keep every attribute 4-byte aligned
+         mesh->attribs[i].offset = stride;
+         stride += ( AttribSize ( attrib ) + 3 ) & ~3;
+      }
+   }
+
+   if ( stride == 0 ||
+         ( data->interleaved != NULL && data->interleavedSize < ( size_t ) data->numVertices * stride ) )
+   {
+      return GL_FALSE;
+   }
+
+   // Separate attribute arrays are interleaved here
+   if ( data->interleaved == NULL )
+   {
+      unsigned int v;
+
+      packed = calloc ( data->numVertices, stride );
+
+      if ( packed == NULL )
+      {
+         return GL_FALSE;
+      }
+
+      for ( i = 0; i < ES_POD_NUM_ATTRIBS; i++ )
+      {
+         const PODData *attrib = &data->attribs[i];
+
+         if ( mesh->attribs[i].size == 0 )
+         {
+            continue;
+         }
+
+         for ( v = 0; v < data->numVertices; v++ )
+         {
+            memcpy ( packed + v * stride + mesh->attribs[i].offset, attrib->data + v * attrib->stride,
+                     AttribSize ( attrib ) );
+         }
+      }
+
+      vertices = packed;
+   }
+
+   // 16-bit triangle lists are uploaded straight from the mapping
+   if ( data->numStrips == 0 && data->faces.type == POD_TYPE_UNSIGNED_SHORT &&
+         data->faces.length >= ( size_t ) data->numFaces * 6 )
+   {
+      mesh->numIndices = data->numFaces * 3;
+
+      for ( i = 0; i < mesh->numIndices; i++ )
+      {
+         if ( FetchIndex ( &data->faces, i ) >= data->numVertices )
+         {
+            free ( packed );
+            return GL_FALSE;
+         }
+      }
+   }
+   else
+   {
+      indices = BuildIndices ( data, &mesh->numIndices );
+
+      if ( indices == NULL )
+      {
+         free ( packed );
+         return GL_FALSE;
+      }
+   }
+
+   mesh->numVertices = data->numVertices;
+   mesh->stride = stride;
+
+   glGenVertexArrays ( 1, &mesh->vertexArray );
+   glGenBuffers ( 1, &mesh->vertexBuffer );
+   glGenBuffers ( 1, &mesh->indexBuffer );
+
+   glBindVertexArray ( mesh->vertexArray );
+
+   glBindBuffer ( GL_ARRAY_BUFFER, mesh->vertexBuffer );
+   glBufferData ( GL_ARRAY_BUFFER, ( GLsizeiptr ) data->numVertices * stride, vertices, GL_STATIC_DRAW );
+
+   glBindBuffer ( GL_ELEMENT_ARRAY_BUFFER, mesh->indexBuffer );
+   glBufferData ( GL_ELEMENT_ARRAY_BUFFER, mesh->numIndices * sizeof ( GLushort ),
+                  indices != NULL ? ( const void * ) indices : ( const void * ) data->faces.data, GL_STATIC_DRAW );
+
+   for ( i = 0; i < ES_POD_NUM_ATTRIBS; i++ )
+   {
+      if ( mesh->attribs[i].size != 0 )
+      {
+         glEnableVertexAttribArray ( i );
+         glVertexAttribPointer ( i, mesh->attribs[i].size, mesh->attribs[i].type, mesh->attribs[i].normalized,
+                                 stride, ( const void * ) ( size_t ) mesh->attribs[i].offset );
+      }
+   }
+
+   glBindVertexArray ( 0 );
+   glBindBuffer ( GL_ARRAY_BUFFER, 0 );
+   glBindBuffer ( GL_ELEMENT_ARRAY_BUFFER, 0 );
+   StateSetVertexArray ( 0 );
+   StateSetBuffer ( GL_ARRAY_BUFFER, 0 );
+   StateSetBuffer ( GL_ELEMENT_ARRAY_BUFFER, 0 );
+
+   free ( packed );
+   free ( indices );
+
+   return GL_TRUE;
+}
+
+///
+// ParseMesh()
+//
+static GLboolean ParseMesh ( PODReader *reader, ESPODMesh *mesh )
+{
+   PODMeshData data;
+   unsigned int tag;
+   const unsigned char *payload;
+   size_t length;
+
+   memset ( &data, 0, sizeof ( PODMeshData ) );
+
+   while ( ReadBlock ( reader, &tag, &payload, &length ) )
+   {
+      PODData *attrib = NULL;
+      PODData skipped;
+
+      if ( tag == ( POD_TAG_MESH | POD_END_TAG ) )
+      {
+         return BuildMesh ( &data, mesh );
+      }
+
+      switch ( tag )
+      {
+         case POD_TAG_MESH_NUM_VTX:
+            data.numVertices = ReadInt ( payload, length, 0 );
+            break;
+
+         case POD_TAG_MESH_NUM_FACES:
+            data.numFaces = ReadInt ( payload, length, 0 );
+            break;
+
+         case POD_TAG_MESH_NUM_STRIPS:
+            data.numStrips = ReadInt ( payload, length, 0 );
+            break;
+
+         case POD_TAG_MESH_STRIP_LEN:
+            data.stripLengths = payload;
+            data.stripLengthsSize = length;
+            break;
+
+         case POD_TAG_MESH_INTERLEAVED:
+            data.interleaved = payload;
+            data.interleavedSize = length;
+            break;
+
+         case POD_TAG_MESH_FACES:
+            attrib = &data.faces;
+            break;
+
+         case POD_TAG_MESH_VTX:
+            attrib = &data.attribs[ES_POD_ATTRIB_POSITION];
+            break;
+
+         case POD_TAG_MESH_NOR:
+            attrib = &data.attribs[ES_POD_ATTRIB_NORMAL];
+            break;
+
+         case POD_TAG_MESH_TAN:
+            attrib = &data.attribs[ES_POD_ATTRIB_TANGENT];
+            break;
+
+         case POD_TAG_MESH_BIN:
+            attrib = &data.attribs[ES_POD_ATTRIB_BINORMAL];
+            break;
+
+         case POD_TAG_MESH_UVW:
+            // One block per texture coordinate set, sets past the second are skipped
+            attrib = data.numUVW < 2 ? &data.attribs[ES_POD_ATTRIB_TEXCOORD0 + data.numUVW] : &skipped;
+            data.numUVW++;
+            break;
+
+         case POD_TAG_MESH_VTX_COL:
+            attrib = &data.attribs[ES_POD_ATTRIB_COLOR];
+            break;
+
+         case POD_TAG_MESH_BONE_IDX:
+            attrib = &data.attribs[ES_POD_ATTRIB_BONE_INDEX];
+            break;
+
+         case POD_TAG_MESH_BONE_WEIGHT:
+            attrib = &data.attribs[ES_POD_ATTRIB_BONE_WEIGHT];
+            break;
+      }
+
+      if ( attrib != NULL )
+      {
+         if ( !ParseData ( reader, tag, attrib ) )
+         {
+            return GL_FALSE;
+         }
+      }
+      else if ( !SkipBlock ( reader, tag ) )
+      {
+         return GL_FALSE;
+      }
+   }
+
+   return GL_FALSE;
+}
+
+///
+// TrackKeys()
+//
+//    Number of keys of a track, 0 if it is missing or malformed
+//
+static int TrackKeys ( const PODTrackData *track, int stride )
+{
+   size_t numKeys, i;
+
+   if ( track->data == NULL )
+   {
+      return 0;
+   }
+
+   if ( track->index == NULL )
+   {
+      return ( int ) ( track->length / ( stride * sizeof ( float ) ) );
+   }
+
+   // Indexed tracks refer to the data by float offset
+   numKeys = track->indexLength / 4;
+
+   for ( i = 0; i < numKeys; i++ )
+   {
+      if ( ReadU32 ( track->index + i * 4 ) + stride > track->length / sizeof ( float ) )
+      {
+         return 0;
+      }
+   }
+
+   return ( int ) numKeys;
+}
+
+///
+// CopyTrack()
+//
+//    Append the first keyStride floats of each key to the animation data
+//
+static void CopyTrack ( const PODTrackData *track, int numKeys, int stride, int keyStride, float *keys )
+{
+   int i;
+
+   for ( i = 0; i < numKeys; i++ )
+   {
+      size_t first = track->index != NULL ? ReadU32 ( track->index + i * 4 ) : ( size_t ) i * stride;
+
+      memcpy ( keys + i * keyStride, track->data + first * sizeof ( float ), keyStride * sizeof ( float ) );
+   }
+}
+
+///
+// ParseNode()
+//
+//    Animation keys are appended to scene->animation, *animSize floats long
+//    and grown as needed.  Node tracks hold offsets until the whole scene is
+//    read.
+//
+static GLboolean ParseNode ( PODReader *reader, ESPODScene *scene, ESPODNode *node, size_t *animCapacity,
+                             size_t trackOffsets[POD_NUM_TRACKS] )
+{
+   static const int strides[POD_NUM_TRACKS] =
+   { POD_POS_STRIDE, POD_ROT_STRIDE, POD_SCALE_STRIDE, POD_MATRIX_STRIDE };
+   static const int keyStrides[POD_NUM_TRACKS] = { 3, 4, 3, 16 };
+   ESPODTrack *tracks[POD_NUM_TRACKS];
+   PODTrackData data[POD_NUM_TRACKS];
+   unsigned int tag = 0;
+   const unsigned char *payload;
+   size_t length;
+   GLboolean ended = GL_FALSE;
+   int i;
+
+   tracks[POD_TRACK_POS] = &node->position;
+   tracks[POD_TRACK_ROT] = &node->rotation;
+   tracks[POD_TRACK_SCALE] = &node->scale;
+   tracks[POD_TRACK_MATRIX] = &node->matrix;
+
+   memset ( data, 0, sizeof ( data ) );
+   node->object = -1;
+   node->material = -1;
+   node->parent = -1;
+
+   while ( ReadBlock ( reader, &tag, &payload, &length ) )
+   {
+      if ( tag == ( POD_TAG_NODE | POD_END_TAG ) )
+      {
+         ended = GL_TRUE;
+         break;
+      }
+
+      switch ( tag )
+      {
+         case POD_TAG_NODE_INDEX:
+            node->object = ReadInt ( payload, length, -1 );
+            break;
+
+         case POD_TAG_NODE_NAME:
+            free ( node->name );
+            node->name = ReadString ( payload, length );
+            break;
+
+         case POD_TAG_NODE_MATERIAL:
+            node->material = ReadInt ( payload, length, -1 );
+            break;
+
+         case POD_TAG_NODE_PARENT:
+            node->parent = ReadInt ( payload, length, -1 );
+            break;
+
+         case POD_TAG_NODE_ANIM_FLAGS:
+            node->animFlags = ReadInt ( payload, length, 0 );
+            break;
+
+         // Files older than POD 2.0 store a single key in separate blocks
+         case POD_TAG_NODE_POS:
+         case POD_TAG_NODE_ANIM_POS:
+            if ( tag == POD_TAG_NODE_ANIM_POS || data[POD_TRACK_POS].data == NULL )
+            {
+               data[POD_TRACK_POS].data = payload;
+               data[POD_TRACK_POS].length = length;
+            }
+            break;
+
+         case POD_TAG_NODE_ROT:
+         case POD_TAG_NODE_ANIM_ROT:
+            if ( tag == POD_TAG_NODE_ANIM_ROT || data[POD_TRACK_ROT].data == NULL )
+            {
+               data[POD_TRACK_ROT].data = payload;
+               data[POD_TRACK_ROT].length = length;
+            }
+            break;
+
+         case POD_TAG_NODE_SCALE:
+         case POD_TAG_NODE_ANIM_SCALE:
+            if ( tag == POD_TAG_NODE_ANIM_SCALE || data[POD_TRACK_SCALE].data == NULL )
+            {
+               data[POD_TRACK_SCALE].data = payload;
+               data[POD_TRACK_SCALE].length = length;
+            }
+            break;
+
+         case POD_TAG_NODE_MATRIX:
+         case POD_TAG_NODE_ANIM_MATRIX:
+            if ( tag == POD_TAG_NODE_ANIM_MATRIX || data[POD_TRACK_MATRIX].data == NULL )
+            {
+               data[POD_TRACK_MATRIX].data = payload;
+               data[POD_TRACK_MATRIX].length = length;
+            }
+            break;
+
+         case POD_TAG_NODE_POS_INDEX:
+         case POD_TAG_NODE_ROT_INDEX:
+         case POD_TAG_NODE_SCALE_INDEX:
+         case POD_TAG_NODE_MATRIX_INDEX:
+            data[tag - POD_TAG_NODE_POS_INDEX].index = payload;
+            data[tag - POD_TAG_NODE_POS_INDEX].indexLength = length;
+            break;
+      }
+
+      if ( !SkipBlock ( reader, tag ) )
+      {
+         return GL_FALSE;
+      }
+   }
+
+   // Ran out of blocks, or the last one was truncated, before the end tag
+   if ( !ended )
+   {
+      return GL_FALSE;
+   }
+
+   // Only matrix animated nodes use the matrix track
+   if ( !( node->animFlags & ES_POD_ANIM_MATRIX ) )
+   {
+      data[POD_TRACK_MATRIX].data = NULL;
+   }
+
+   for ( i = 0; i < POD_NUM_TRACKS; i++ )
+   {
+      int numKeys = TrackKeys ( &data[i], strides[i] );
+      size_t needed = scene->animationSize + ( size_t ) numKeys * keyStrides[i];
+
+      if ( needed > *animCapacity )
+      {
+         size_t capacity = needed > *animCapacity * 2 ? needed : *animCapacity * 2;
+         float *animation = realloc ( scene->animation, capacity * sizeof ( float ) );
+
+         if ( animation == NULL )
+         {
+            return GL_FALSE;
+         }
+
+         scene->animation = animation;
+         *animCapacity = capacity;
+      }
+
+      CopyTrack ( &data[i], numKeys, strides[i], keyStrides[i], scene->animation + scene->animationSize );
+      tracks[i]->numKeys = numKeys;
+      trackOffsets[i] = scene->animationSize;
+      scene->animationSize = needed;
+   }
+
+   return GL_TRUE;
+}
+
+///
+// ParseMaterial()
+//
+static GLboolean ParseMaterial ( PODReader *reader, ESPODMaterial *material )
+{
+   unsigned int tag;
+   const unsigned char *payload;
+   size_t length;
+
+   material->diffuseTexture = -1;
+   material->bumpTexture = -1;
+   material->opacity = 1.0f;
+
+   while ( ReadBlock ( reader, &tag, &payload, &length ) )
+   {
+      if ( tag == ( POD_TAG_MATERIAL | POD_END_TAG ) )
+      {
+         return GL_TRUE;
+      }
+
+      switch ( tag )
+      {
+         case POD_TAG_MAT_NAME:
+            free ( material->name );
+            material->name = ReadString ( payload, length );
+            break;
+
+         case POD_TAG_MAT_DIFFUSE_TEX:
+            material->diffuseTexture = ReadInt ( payload, length, -1 );
+            break;
+
+         case POD_TAG_MAT_BUMP_TEX:
+            material->bumpTexture = ReadInt ( payload, length, -1 );
+            break;
+
+         case POD_TAG_MAT_OPACITY:
+            ReadFloats ( payload, length, &material->opacity, 1 );
+            break;
+
+         case POD_TAG_MAT_AMBIENT:
+            ReadFloats ( payload, length, material->ambient, 3 );
+            break;
+
+         case POD_TAG_MAT_DIFFUSE:
+            ReadFloats ( payload, length, material->diffuse, 3 );
+            break;
+
+         case POD_TAG_MAT_SPECULAR:
+            ReadFloats ( payload, length, material->specular, 3 );
+            break;
+
+         case POD_TAG_MAT_SHININESS:
+            ReadFloats ( payload, length, &material->shininess, 1 );
+            break;
+      }
+
+      if ( !SkipBlock ( reader, tag ) )
+      {
+         return GL_FALSE;
+      }
+   }
+
+   return GL_FALSE;
+}
+
+///
+// ParseTexture()
+//
+static GLboolean ParseTexture ( PODReader *reader, char **fileName )
+{
+   unsigned int tag;
+   const unsigned char *payload;
+   size_t length;
+
+   while ( ReadBlock ( reader, &tag, &payload, &length ) )
+   {
+      if ( tag == ( POD_TAG_TEXTURE | POD_END_TAG ) )
+      {
+         return GL_TRUE;
+      }
+
+      if ( tag == POD_TAG_TEX_NAME )
+      {
+         free ( *fileName );
+         *fileName = ReadString ( payload, length );
+      }
+
+      if ( !SkipBlock ( reader, tag ) )
+      {
+         return GL_FALSE;
+      }
+   }
+
+   return GL_FALSE;
+}
+
+///
+// AllocateArrays()
+//
+//    Allocate the scene arrays once the counts have been read
+//
+static GLboolean AllocateArrays ( ESPODScene *scene, size_t **trackOffsets )
+{
+   if ( scene->meshes != NULL )
+   {
+      return GL_TRUE;
+   }
+
+   scene->meshes = calloc ( scene->numMeshes + 1, sizeof ( ESPODMesh ) );
+   scene->nodes = calloc ( scene->numNodes + 1, sizeof ( ESPODNode ) );
+   scene->materials = calloc ( scene->numMaterials + 1, sizeof ( ESPODMaterial ) );
+   scene->textures = calloc ( scene->numTextures + 1, sizeof ( char * ) );
+   *trackOffsets = calloc ( ( scene->numNodes + 1 ) * POD_NUM_TRACKS, sizeof ( size_t ) );
+
+   return scene->meshes != NULL && scene->nodes != NULL && scene->materials != NULL &&
+          scene->textures != NULL && *trackOffsets != NULL ? GL_TRUE : GL_FALSE;
+}
+
+///
+// ParseScene()
+//
+static GLboolean ParseScene ( PODReader *reader, ESPODScene *scene )
+{
+   int meshes = 0, nodes = 0, materials = 0, textures = 0;
+   size_t animCapacity = 0;
+   size_t *trackOffsets = NULL;
+   GLboolean result = GL_FALSE;
+   unsigned int tag;
+   const unsigned char *payload;
+   size_t length;
+   int i;
+
+   while ( ReadBlock ( reader, &tag, &payload, &length ) )
+   {
+      GLboolean parsed = GL_TRUE;
+      GLboolean closed = GL_FALSE;
+
+      if ( tag == ( POD_TAG_SCENE | POD_END_TAG ) )
+      {
+         result = meshes == scene->numMeshes && nodes == scene->numNodes &&
+                  materials == scene->numMaterials && textures == scene->numTextures ? GL_TRUE : GL_FALSE;
+         break;
+      }
+
+      switch ( tag )
+      {
+         case POD_TAG_BACKGROUND:
+            ReadFloats ( payload, length, scene->backgroundColor, 3 );
+            break;
+
+         case POD_TAG_AMBIENT:
+            ReadFloats ( payload, length, scene->ambientColor, 3 );
+            break;
+
+         case POD_TAG_NUM_CAMERA:
+            scene->numCameras = ReadInt ( payload, length, 0 );
+            break;
+
+         case POD_TAG_NUM_LIGHT:
+            scene->numLights = ReadInt ( payload, length, 0 );
+            break;
+
+         case POD_TAG_NUM_MESH:
+            scene->numMeshes = ReadInt ( payload, length, 0 );
+            break;
+
+         case POD_TAG_NUM_NODE:
+            scene->numNodes = ReadInt ( payload, length, 0 );
+            break;
+
+         case POD_TAG_NUM_MESH_NODE:
+            scene->numMeshNodes = ReadInt ( payload, length, 0 );
+            break;
+
+         case POD_TAG_NUM_TEXTURE:
+            scene->numTextures = ReadInt ( payload, length, 0 );
+            break;
+
+         case POD_TAG_NUM_MATERIAL:
+            scene->numMaterials = ReadInt ( payload, length, 0 );
+            break;
+
+         case POD_TAG_NUM_FRAME:
+            scene->numFrames = ReadInt ( payload, length, 0 );
+            break;
+
+         case POD_TAG_FPS:
+            scene->fps = ReadInt ( payload, length, scene->fps );
+            break;
+
+         case POD_TAG_MESH:
+            parsed = AllocateArrays ( scene, &trackOffsets ) && meshes < scene->numMeshes &&
+                     ParseMesh ( reader, &scene->meshes[meshes++] );
+            closed = GL_TRUE;
+            break;
+
+         case POD_TAG_NODE:
+            parsed = AllocateArrays ( scene, &trackOffsets ) && nodes < scene->numNodes &&
+                     ParseNode ( reader, scene, &scene->nodes[nodes], &animCapacity,
+                                 trackOffsets + nodes * POD_NUM_TRACKS );
+            closed = GL_TRUE;
+            nodes++;
+            break;
+
+         case POD_TAG_MATERIAL:
+            parsed = AllocateArrays ( scene, &trackOffsets ) && materials < scene->numMaterials &&
+                     ParseMaterial ( reader, &scene->materials[materials++] );
+            closed = GL_TRUE;
+            break;
+
+         case POD_TAG_TEXTURE:
+            parsed = AllocateArrays ( scene, &trackOffsets ) && textures < scene->numTextures &&
+                     ParseTexture ( reader, &scene->textures[textures++] );
+            closed = GL_TRUE;
+            break;
+
+      }
+
+      // Everything but the parsed containers still has its end tag to read
+      if ( !parsed || ( !closed && !SkipBlock ( reader, tag ) ) )
+      {
+         break;
+      }
+   }
+
+   if ( result && AllocateArrays ( scene, &trackOffsets ) )
+   {
+      // The animation data no longer moves, point the tracks at it
+      for ( i = 0; i < scene->numNodes; i++ )
+      {
+         ESPODNode *node = &scene->nodes[i];
+
+         node->position.keys = scene->animation + trackOffsets[i * POD_NUM_TRACKS + POD_TRACK_POS];
+         node->rotation.keys = scene->animation + trackOffsets[i * POD_NUM_TRACKS + POD_TRACK_ROT];
+         node->scale.keys = scene->animation + trackOffsets[i * POD_NUM_TRACKS + POD_TRACK_SCALE];
+         node->matrix.keys = scene->animation + trackOffsets[i * POD_NUM_TRACKS + POD_TRACK_MATRIX];
+
+         if ( node->parent < -1 || node->parent >= scene->numNodes || node->parent == i )
+         {
+            node->parent = -1;
+         }
+      }
+
+      // Exporters leave garbage in the texture slots they do not use
+      for ( i = 0; i < scene->numMaterials; i++ )
+      {
+         ESPODMaterial *material = &scene->materials[i];
+
+         if ( material->diffuseTexture < -1 || material->diffuseTexture >= scene->numTextures )
+         {
+            material->diffuseTexture = -1;
+         }
+
+         if ( material->bumpTexture < -1 || material->bumpTexture >= scene->numTextures )
+         {
+            material->bumpTexture = -1;
+         }
+      }
+   }
+   else
+   {
+      result = GL_FALSE;
+   }
+
+   free ( trackOffsets );
+   return result;
+}
+
+///
+// SampleTrack()
+//
+//    Linear interpolation between the keys around frame
+//
+static void SampleTrack ( const ESPODTrack *track, int keyStride, float frame, float *result )
+{
+   int first = ( int ) floorf ( frame );
+   float t = frame - first;
+   int i;
+
+   if ( first < 0 )
+   {
+      first = 0;
+      t = 0.0f;
+   }
+
+   if ( first >= track->numKeys - 1 )
+   {
+      first = track->numKeys - 1;
+      t = 0.0f;
+   }
+
+   for ( i = 0; i < keyStride; i++ )
+   {
+      const float *a = track->keys + first * keyStride;
+      const float *b = t > 0.0f ? a + keyStride : a;
+
+      result[i] = a[i] + ( b[i] - a[i] ) * t;
+   }
+}
+
+///
+// NodeLocalMatrix()
+//
+//    Scale, then rotate, then translate.  Matrices follow the ESMatrix
+//    convention where esMatrixMultiply ( r, a, b ) applies a first.
+//
+static void NodeLocalMatrix ( const ESPODNode *node, float frame, ESMatrix *result )
+{
+   esMatrixLoadIdentity ( result );
+
+   if ( node->matrix.numKeys > 0 )
+   {
+      int key = ( int ) frame;
+
+      key = key < 0 ? 0 : key >= node->matrix.numKeys ? node->matrix.numKeys - 1 : key;
+      memcpy ( result, node->matrix.keys + key * 16, sizeof ( ESMatrix ) );
+      return;
+   }
+
+   if ( node->scale.numKeys > 0 )
+   {
+      float scale[3];
+
+      SampleTrack ( &node->scale, 3, frame, scale );
+      result->m[0][0] = scale[0];
+      result->m[1][1] = scale[1];
+      result->m[2][2] = scale[2];
+   }
+
+   if ( node->rotation.numKeys > 0 )
+   {
+      ESMatrix rotation;
+      float q[4], length;
+
+      // Interpolated quaternions are renormalized rather than slerped
+      SampleTrack ( &node->rotation, 4, frame, q );
+      length = sqrtf ( q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3] );
+
+      if ( length > 0.0f )
+      {
+         q[0] /= length;
+         q[1] /= length;
+         q[2] /= length;
+         q[3] /= length;
+      }
+
+      // POD stores the rotation of the node's axes, which is the inverse of
+      // the rotation applied to its vertices
+      esMatrixLoadIdentity ( &rotation );
+      rotation.m[0][0] = 1.0f - 2.0f * ( q[1] * q[1] + q[2] * q[2] );
+      rotation.m[0][1] = 2.0f * ( q[0] * q[1] - q[2] * q[3] );
+      rotation.m[0][2] = 2.0f * ( q[0] * q[2] + q[1] * q[3] );
+      rotation.m[1][0] = 2.0f * ( q[0] * q[1] + q[2] * q[3] );
+      rotation.m[1][1] = 1.0f - 2.0f * ( q[0] * q[0] + q[2] * q[2] );
+      rotation.m[1][2] = 2.0f * ( q[1] * q[2] - q[0] * q[3] );
+      rotation.m[2][0] = 2.0f * ( q[0] * q[2] - q[1] * q[3] );
+      rotation.m[2][1] = 2.0f * ( q[1] * q[2] + q[0] * q[3] );
+      rotation.m[2][2] = 1.0f - 2.0f * ( q[0] * q[0] + q[1] * q[1] );
+
+      esMatrixMultiply ( result, result, &rotation );
+   }
+
+   if ( node->position.numKeys > 0 )
+   {
+      float position[3];
+
+      SampleTrack ( &node->position, 3, frame, position );
+      result->m[3][0] += position[0];
+      result->m[3][1] += position[1];
+      result->m[3][2] += position[2];
+   }
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+//
+///
+/// \brief Load a POD scene and upload its meshes into buffer objects
+//
+GLboolean ESUTIL_API esLoadPOD ( void *ioContext, const char *fileName, ESPODScene *scene )
+{
+   ESMappedFile file;
+   PODReader reader;
+   GLboolean result = GL_FALSE;
+   GLboolean versionOk = GL_FALSE;
+   unsigned int tag;
+   const unsigned char *payload;
+   size_t length;
+
+   memset ( scene, 0, sizeof ( ESPODScene ) );
+   scene->fps = 30;
+
+   if ( !esMapFile ( ioContext, fileName, &file ) )
+   {
+      esLogMessage ( "esLoadPOD FAILED to open : { %s }\n", fileName );
+      return GL_FALSE;
+   }
+
+   reader.data = file.data;
+   reader.size = file.size;
+   reader.offset = 0;
+
+   while ( !result && ReadBlock ( &reader, &tag, &payload, &length ) )
+   {
+      if ( tag == POD_TAG_VERSION )
+      {
+         versionOk = length > strlen ( POD_VERSION ) &&
+                     memcmp ( payload, POD_VERSION, strlen ( POD_VERSION ) ) == 0 ? GL_TRUE : GL_FALSE;
+      }
+      else if ( tag == POD_TAG_SCENE && versionOk )
+      {
+         result = ParseScene ( &reader, scene );
+
+         if ( !result )
+         {
+            break;
+         }
+
+         continue;
+      }
+
+      if ( !versionOk || !SkipBlock ( &reader, tag ) )
+      {
+         break;
+      }
+   }
+
+   esUnmapFile ( &file );
+
+   if ( !result )
+   {
+      esLogMessage ( versionOk ? "esLoadPOD FAILED to parse : { %s }\n" :
+                     "esLoadPOD: { %s } is not a little-endian POD 2 file\n", fileName );
+      esFreePOD ( scene );
+      return GL_FALSE;
+   }
+
+   return GL_TRUE;
+}
+
+//
+///
+/// \brief Release a scene loaded with esLoadPOD
+//
+void ESUTIL_API esFreePOD ( ESPODScene *scene )
+{
+   int i;
+
+   for ( i = 0; scene->meshes != NULL && i < scene->numMeshes; i++ )
+   {
+      glDeleteVertexArrays ( 1, &scene->meshes[i].vertexArray );
+      glDeleteBuffers ( 1, &scene->meshes[i].vertexBuffer );
+      glDeleteBuffers ( 1, &scene->meshes[i].indexBuffer );
+   }
+
+   for ( i = 0; scene->nodes != NULL && i < scene->numNodes; i++ )
+   {
+      free ( scene->nodes[i].name );
+   }
+
+   for ( i = 0; scene->materials != NULL && i < scene->numMaterials; i++ )
+   {
+      free ( scene->materials[i].name );
+   }
+
+   for ( i = 0; scene->textures != NULL && i < scene->numTextures; i++ )
+   {
+      free ( scene->textures[i] );
+   }
+
+   free ( scene->meshes );
+   free ( scene->nodes );
+   free ( scene->materials );
+   free ( scene->textures );
+   free ( scene->animation );
+
+   memset ( scene, 0, sizeof ( ESPODScene ) );
+}
+
+//
+///
+/// \brief Compute the world matrix of a node at a frame
+//
+void ESUTIL_API esPODNodeMatrix ( const ESPODScene *scene, int node, float frame, ESMatrix *result )
+{
+   ESMatrix parent;
+   int depth;
+
+   NodeLocalMatrix ( &scene->nodes[node], frame, result );
+
+   // Parents are applied after their children, depth guards against cycles
+   for ( depth = 0, node = scene->nodes[node].parent; node >= 0 && depth < scene->numNodes;
+         depth++, node = scene->nodes[node].parent )
+   {
+      NodeLocalMatrix ( &scene->nodes[node], frame, &parent );
+      esMatrixMultiply ( result, result, &parent );
+   }
+}
@@ -0,0 +1,751 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// ESNoise.c
+//
+//    Gradient noise volumes for 3D noise textures.  Along a row of the
+//    volume only x changes, so the eight lattice gradients of a cell fold
+//    into two linear functions of the x fraction, interpolated by the x
+//    weight.  Rows are evaluated several voxels at a time with SSE2, AVX or
+//    NEON, and slabs of the volume go to the esParallelFor threads.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include "esUtil_win.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 )
+#define ES_SIMD_SSE2
+#include <emmintrin.h>
+#if defined(_MSC_VER)
+#define ES_SIMD_AVX
+#define ES_TARGET_AVX
+#include <intrin.h>
+#include <immintrin.h>
+#elif defined(__GNUC__)
+#define ES_SIMD_AVX
+#define ES_TARGET_AVX __attribute__ ( ( target ( "avx" ) ) )
+#include <immintrin.h>
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define ES_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+///
+//  Macros
+//
+#define NOISE_TABLE_MASK   255
+
+#define smoothstep(t)      ( t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f ) )
+#define lerp(t, a, b)      ( a + t * (b - a) )
+
+#ifdef _WIN32
+#define srandom srand
+#define random rand
+#endif
+
+// Voxels worth handing to another thread
+#define NOISE_MIN_CHUNK    65536
+
+// Bump when the generator output changes, so cached volumes are regenerated
+#define NOISE_VERSION      1
+
+///
+//  Types
+//
+typedef struct
+{
+   GLubyte *volume;
+   int      size;
+
+   // Lattice cell, fraction and smoothstep weight of every coordinate, the
+   // same along all three axes
+   int     *cell;
+   float   *fraction;
+   float   *weight;
+   int      cellCount;
+
+   // Gradients, indexed through permTable
+   float    gradients[256 * 3];
+
+   // Per slab: cell coefficients of the current row, then the range of the
+   // values in the slab
+   float   *coefficients;
+   float   *slabMin;
+   float   *slabMax;
+
+   // Normalization of the values to bytes
+   float    offset;
+   float    scale;
+} NoiseVolume;
+
+typedef void ( *NoiseRowFunc ) ( const NoiseVolume *noise, const float *coefficients,
+                                 float *minMax, GLubyte *out );
+
+// One pass over the slabs, for esParallelFor
+typedef struct
+{
+   NoiseVolume  *noise;
+
+   // Row kernel, picked on the calling thread
+   NoiseRowFunc  noiseRow;
+} NoiseJob;
+
+// permTable describes a random permutatin of 8-bit values from 0 to 255.
+static const unsigned char permTable[256] =
+{
+   0xE1, 0x9B, 0xD2, 0x6C, 0xAF, 0xC7, 0xDD, 0x90, 0xCB, 0x74, 0x46, 0xD5, 0x45, 0x9E, 0x21, 0xFC,
+   0x05, 0x52, 0xAD, 0x85, 0xDE, 0x8B, 0xAE, 0x1B, 0x09, 0x47, 0x5A, 0xF6, 0x4B, 0x82, 0x5B, 0xBF,
+   0xA9, 0x8A, 0x02, 0x97, 0xC2, 0xEB, 0x51, 0x07, 0x19, 0x71, 0xE4, 0x9F, 0xCD, 0xFD, 0x86, 0x8E,
+   0xF8, 0x41, 0xE0, 0xD9, 0x16, 0x79, 0xE5, 0x3F, 0x59, 0x67, 0x60, 0x68, 0x9C, 0x11, 0xC9, 0x81,
+   0x24, 0x08, 0xA5, 0x6E, 0xED, 0x75, 0xE7, 0x38, 0x84, 0xD3, 0x98, 0x14, 0xB5, 0x6F, 0xEF, 0xDA,
+   0xAA, 0xA3, 0x33, 0xAC, 0x9D, 0x2F, 0x50, 0xD4, 0xB0, 0xFA, 0x57, 0x31, 0x63, 0xF2, 0x88, 0xBD,
+   0xA2, 0x73, 0x2C, 0x2B, 0x7C, 0x5E, 0x96, 0x10, 0x8D, 0xF7, 0x20, 0x0A, 0xC6, 0xDF, 0xFF, 0x48,
+   0x35, 0x83, 0x54, 0x39, 0xDC, 0xC5, 0x3A, 0x32, 0xD0, 0x0B, 0xF1, 0x1C, 0x03, 0xC0, 0x3E, 0xCA,
+   0x12, 0xD7, 0x99, 0x18, 0x4C, 0x29, 0x0F, 0xB3, 0x27, 0x2E, 0x37, 0x06, 0x80, 0xA7, 0x17, 0xBC,
+   0x6A, 0x22, 0xBB, 0x8C, 0xA4, 0x49, 0x70, 0xB6, 0xF4, 0xC3, 0xE3, 0x0D, 0x23, 0x4D, 0xC4, 0xB9,
+   0x1A, 0xC8, 0xE2, 0x77, 0x1F, 0x7B, 0xA8, 0x7D, 0xF9, 0x44, 0xB7, 0xE6, 0xB1, 0x87, 0xA0, 0xB4,
+   0x0C, 0x01, 0xF3, 0x94, 0x66, 0xA6, 0x26, 0xEE, 0xFB, 0x25, 0xF0, 0x7E, 0x40, 0x4A, 0xA1, 0x28,
+   0xB8, 0x95, 0xAB, 0xB2, 0x65, 0x42, 0x1D, 0x3B, 0x92, 0x3D, 0xFE, 0x6B, 0x2A, 0x56, 0x9A, 0x04,
+   0xEC, 0xE8, 0x78, 0x15, 0xE9, 0xD1, 0x2D, 0x62, 0xC1, 0x72, 0x4E, 0x13, 0xCE, 0x0E, 0x76, 0x7F,
+   0x30, 0x4F, 0x93, 0x55, 0x1E, 0xCF, 0xDB, 0x36, 0x58, 0xEA, 0xBE, 0x7A, 0x5F, 0x43, 0x8F, 0x6D,
+   0x89, 0xD6, 0x91, 0x5D, 0x5C, 0x64, 0xF5, 0x00, 0xD8, 0xBA, 0x3C, 0x53, 0x69, 0x61, 0xCC, 0x34,
+};
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// InitGradients()
+//
+//    Build the lattice gradients, in permTable order.  Reseeds random(), so
+//    every volume gets the gradients the samples always used.
+//
+static void InitGradients ( float *gradientTable )
+{
+   float gradients[256 * 3];
+   int   i;
+
+   srandom ( 0 );
+
+   for ( i = 0; i < 256; i++ )
+   {
+      float a, x, y, z, r;
+
+      // calculate 1 - 2 * random number
+      a = ( random() % 32768 ) / 32768.0f;
+      z = ( 1.0f - 2.0f * a );
+
+      r = sqrtf ( 1.0f - z * z ); // r is radius of circle
+
+      // The samples always took the angle as a rather than 2 * PI * a
+      a = ( random() % 32768 ) / 32768.0f;
+      x = ( r * cosf ( a ) );
+      y = ( r * sinf ( a ) );
+
+      gradients[i * 3] = x;
+      gradients[i * 3 + 1] = y;
+      gradients[i * 3 + 2] = z;
+   }
+
+   for ( i = 0; i < 256; i++ )
+   {
+      memcpy ( &gradientTable[i * 3], &gradients[permTable[i] * 3], 3 * sizeof ( float ) );
+   }
+}
+
+///
+// RowCoefficients()
+//
+//    Fold the gradients of every cell along row (y, z) into the value at the
+//    x = 0 and x = 1 faces of the cell, interpolated in y and z.  Each face
+//    is linear in the x fraction, stored as { a0, c0, a1, c1 } with
+//    v0 = a0 * fx + c0 and v1 = a1 * ( fx - 1 ) + c1.
+//
+static void RowCoefficients ( const NoiseVolume *noise, int y, int z, float *coefficients )
+{
+   int   iy = noise->cell[y];
+   int   iz = noise->cell[z];
+   float fy = noise->fraction[y];
+   float fz = noise->fraction[z];
+   float wy = noise->weight[y];
+   float wz = noise->weight[z];
+   int   hash[2][2];
+   int   c, dx, dy, dz;
+
+   for ( dy = 0; dy < 2; dy++ )
+   {
+      for ( dz = 0; dz < 2; dz++ )
+      {
+         hash[dy][dz] = permTable[ ( iy + dy + permTable[ ( iz + dz ) & NOISE_TABLE_MASK] ) & NOISE_TABLE_MASK];
+      }
+   }
+
+   for ( c = 0; c < noise->cellCount; c++ )
+   {
+      for ( dx = 0; dx < 2; dx++ )
+      {
+         float a[2][2];
+         float k[2][2];
+         float a0, a1, k0, k1;
+
+         for ( dy = 0; dy < 2; dy++ )
+         {
+            for ( dz = 0; dz < 2; dz++ )
+            {
+               const float *g = &noise->gradients[ ( ( c + dx + hash[dy][dz] ) & NOISE_TABLE_MASK ) * 3];
+
+               a[dy][dz] = g[0];
+               k[dy][dz] = g[1] * ( fy - dy ) + g[2] * ( fz - dz );
+            }
+         }
+
+         a0 = lerp ( wy, a[0][0], a[1][0] );
+         a1 = lerp ( wy, a[0][1], a[1][1] );
+         k0 = lerp ( wy, k[0][0], k[1][0] );
+         k1 = lerp ( wy, k[0][1], k[1][1] );
+
+         coefficients[c * 4 + dx * 2] = lerp ( wz, a0, a1 );
+         coefficients[c * 4 + dx * 2 + 1] = lerp ( wz, k0, k1 );
+      }
+   }
+}
+
+///
+// NoiseRowRange()
+//
+//    Evaluate voxels [first, size) of a row.  With out NULL, widen minMax
+//    to the values, otherwise write the normalized values to out.
+//
+static void NoiseRowRange ( const NoiseVolume *noise, const float *coefficients,
+                            float *minMax, GLubyte *out, int first )
+{
+   int x;
+
+   for ( x = first; x < noise->size; x++ )
+   {
+      const float *k = &coefficients[noise->cell[x] * 4];
+      float fx = noise->fraction[x];
+      float v0 = k[0] * fx + k[1];
+      float v1 = k[2] * ( fx - 1.0f ) + k[3];
+      float value = lerp ( noise->weight[x], v0, v1 );
+
+      if ( out == NULL )
+      {
+         minMax[0] = value < minMax[0] ? value : minMax[0];
+         minMax[1] = value > minMax[1] ? value : minMax[1];
+      }
+      else
+      {
+         out[x] = ( GLubyte ) ( ( value - noise->offset ) * noise->scale );
+      }
+   }
+}
+
+///
+// NoiseRowScalar()
+//
+//    Portable fallback
+//
+static void NoiseRowScalar ( const NoiseVolume *noise, const float *coefficients,
+                             float *minMax, GLubyte *out )
+{
+   NoiseRowRange ( noise, coefficients, minMax, out, 0 );
+}
+
+#ifdef ES_SIMD_SSE2
+///
+// NoiseRowSSE2()
+//
+//    Four voxels at a time.  The coefficients of the four cells are loaded
+//    as rows and transposed into one register per coefficient.
+//
+static void NoiseRowSSE2 ( const NoiseVolume *noise, const float *coefficients,
+                           float *minMax, GLubyte *out )
+{
+   __m128 one = _mm_set1_ps ( 1.0f );
+   __m128 offset = _mm_set1_ps ( noise->offset );
+   __m128 scale = _mm_set1_ps ( noise->scale );
+   __m128 lo = _mm_set1_ps ( minMax[0] );
+   __m128 hi = _mm_set1_ps ( minMax[1] );
+   float  range[8];
+   int    x;
+
+   for ( x = 0; x + 4 <= noise->size; x += 4 )
+   {
+      const int *cell = &noise->cell[x];
+      __m128 k0 = _mm_loadu_ps ( &coefficients[cell[0] * 4] );
+      __m128 k1 = _mm_loadu_ps ( &coefficients[cell[1] * 4] );
+      __m128 k2 = _mm_loadu_ps ( &coefficients[cell[2] * 4] );
+      __m128 k3 = _mm_loadu_ps ( &coefficients[cell[3] * 4] );
+      __m128 fx = _mm_loadu_ps ( &noise->fraction[x] );
+      __m128 wx = _mm_loadu_ps ( &noise->weight[x] );
+      __m128 v0, v1, value;
+
+      _MM_TRANSPOSE4_PS ( k0, k1, k2, k3 );
+
+      v0 = _mm_add_ps ( _mm_mul_ps ( k0, fx ), k1 );
+      v1 = _mm_add_ps ( _mm_mul_ps ( k2, _mm_sub_ps ( fx, one ) ), k3 );
+      value = _mm_add_ps ( v0, _mm_mul_ps ( wx, _mm_sub_ps ( v1, v0 ) ) );
+
+      if ( out == NULL )
+      {
+         lo = _mm_min_ps ( lo, value );
+         hi = _mm_max_ps ( hi, value );
+      }
+      else
+      {
+         __m128i bytes = _mm_cvttps_epi32 ( _mm_mul_ps ( _mm_sub_ps ( value, offset ), scale ) );
+         int     packed;
+
+         bytes = _mm_packs_epi32 ( bytes, bytes );
+         bytes = _mm_packus_epi16 ( bytes, bytes );
+         packed = _mm_cvtsi128_si32 ( bytes );
+         memcpy ( &out[x], &packed, 4 );
+      }
+   }
+
+   if ( out == NULL )
+   {
+      _mm_storeu_ps ( range, lo );
+      _mm_storeu_ps ( range + 4, hi );
+
+      for ( x = 0; x < 4; x++ )
+      {
+         minMax[0] = range[x] < minMax[0] ? range[x] : minMax[0];
+         minMax[1] = range[x + 4] > minMax[1] ? range[x + 4] : minMax[1];
+      }
+   }
+
+   NoiseRowRange ( noise, coefficients, minMax, out, noise->size & ~3 );
+}
+#endif // ES_SIMD_SSE2
+
+#ifdef ES_SIMD_AVX
+///
+// NoiseRowAVX()
+//
+//    Same as the SSE2 kernel, eight voxels at a time.  The two halves of each
+//    coefficient register are transposed separately.
+//
+static ES_TARGET_AVX void NoiseRowAVX ( const NoiseVolume *noise, const float *coefficients,
+                                        float *minMax, GLubyte *out )
+{
+   __m256 one = _mm256_set1_ps ( 1.0f );
+   __m256 offset = _mm256_set1_ps ( noise->offset );
+   __m256 scale = _mm256_set1_ps ( noise->scale );
+   __m256 lo = _mm256_set1_ps ( minMax[0] );
+   __m256 hi = _mm256_set1_ps ( minMax[1] );
+   float  range[16];
+   int    x;
+
+   for ( x = 0; x + 8 <= noise->size; x += 8 )
+   {
+      const int *cell = &noise->cell[x];
+      __m128 k0 = _mm_loadu_ps ( &coefficients[cell[0] * 4] );
+      __m128 k1 = _mm_loadu_ps ( &coefficients[cell[1] * 4] );
+      __m128 k2 = _mm_loadu_ps ( &coefficients[cell[2] * 4] );
+      __m128 k3 = _mm_loadu_ps ( &coefficients[cell[3] * 4] );
+      __m128 k4 = _mm_loadu_ps ( &coefficients[cell[4] * 4] );
+      __m128 k5 = _mm_loadu_ps ( &coefficients[cell[5] * 4] );
+      __m128 k6 = _mm_loadu_ps ( &coefficients[cell[6] * 4] );
+      __m128 k7 = _mm_loadu_ps ( &coefficients[cell[7] * 4] );
+      __m256 fx = _mm256_loadu_ps ( &noise->fraction[x] );
+      __m256 wx = _mm256_loadu_ps ( &noise->weight[x] );
+      __m256 a0, c0, a1, c1, v0, v1, value;
+
+      _MM_TRANSPOSE4_PS ( k0, k1, k2, k3 );
+      _MM_TRANSPOSE4_PS ( k4, k5, k6, k7 );
+
+      a0 = _mm256_insertf128_ps ( _mm256_castps128_ps256 ( k0 ), k4, 1 );
+      c0 = _mm256_insertf128_ps ( _mm256_castps128_ps256 ( k1 ), k5, 1 );
+      a1 = _mm256_insertf128_ps ( _mm256_castps128_ps256 ( k2 ), k6, 1 );
+      c1 = _mm256_insertf128_ps ( _mm256_castps128_ps256 ( k3 ), k7, 1 );
+
+      v0 = _mm256_add_ps ( _mm256_mul_ps ( a0, fx ), c0 );
+      v1 = _mm256_add_ps ( _mm256_mul_ps ( a1, _mm256_sub_ps ( fx, one ) ), c1 );
+      value = _mm256_add_ps ( v0, _mm256_mul_ps ( wx, _mm256_sub_ps ( v1, v0 ) ) );
+
+      if ( out == NULL )
+      {
+         lo = _mm256_min_ps ( lo, value );
+         hi = _mm256_max_ps ( hi, value );
+      }
+      else
+      {
+         __m256i words = _mm256_cvttps_epi32 ( _mm256_mul_ps ( _mm256_sub_ps ( value, offset ), scale ) );
+         __m128i bytes = _mm_packs_epi32 ( _mm256_castsi256_si128 ( words ), _mm256_extractf128_si256 ( words, 1 ) );
+
+         bytes = _mm_packus_epi16 ( bytes, bytes );
+         _mm_storel_epi64 ( ( __m128i * ) &out[x], bytes );
+      }
+   }
+
+   if ( out == NULL )
+   {
+      _mm256_storeu_ps ( range, lo );
+      _mm256_storeu_ps ( range + 8, hi );
+
+      for ( x = 0; x < 8; x++ )
+      {
+         minMax[0] = range[x] < minMax[0] ? range[x] : minMax[0];
+         minMax[1] = range[x + 8] > minMax[1] ? range[x + 8] : minMax[1];
+      }
+   }
+
+   _mm256_zeroupper ( );
+
+   NoiseRowRange ( noise, coefficients, minMax, out, noise->size & ~7 );
+}
+
+///
+// CpuHasAVX()
+//
+//    Check that both the CPU and the OS (saved YMM state) support AVX
+//
+static int CpuHasAVX ( void )
+{
+#ifdef _MSC_VER
+   int info[4];
+
+   __cpuid ( info, 1 );
+
+   // OSXSAVE and AVX
+   if ( ( info[2] & ( 1 << 27 ) ) && ( info[2] & ( 1 << 28 ) ) )
+   {
+      return ( _xgetbv ( 0 ) & 0x6 ) == 0x6;
+   }
+
+   return 0;
+#else
+   __builtin_cpu_init ( );
+   return __builtin_cpu_supports ( "avx" );
+#endif
+}
+#endif // ES_SIMD_AVX
+
+#ifdef ES_SIMD_NEON
+///
+// NoiseRowNEON()
+//
+//    NEON version of the SSE2 kernel
+//
+static void NoiseRowNEON ( const NoiseVolume *noise, const float *coefficients,
+                           float *minMax, GLubyte *out )
+{
+   float32x4_t one = vdupq_n_f32 ( 1.0f );
+   float32x4_t offset = vdupq_n_f32 ( noise->offset );
+   float32x4_t scale = vdupq_n_f32 ( noise->scale );
+   float32x4_t lo = vdupq_n_f32 ( minMax[0] );
+   float32x4_t hi = vdupq_n_f32 ( minMax[1] );
+   float       range[8];
+   int         x;
+
+   for ( x = 0; x + 4 <= noise->size; x += 4 )
+   {
+      const int *cell = &noise->cell[x];
+      float32x4x2_t t01 = vtrnq_f32 ( vld1q_f32 ( &coefficients[cell[0] * 4] ), vld1q_f32 ( &coefficients[cell[1] * 4] ) );
+      float32x4x2_t t23 = vtrnq_f32 ( vld1q_f32 ( &coefficients[cell[2] * 4] ), vld1q_f32 ( &coefficients[cell[3] * 4] ) );
+      float32x4_t a0 = vcombine_f32 ( vget_low_f32 ( t01.val[0] ), vget_low_f32 ( t23.val[0] ) );
+      float32x4_t c0 = vcombine_f32 ( vget_low_f32 ( t01.val[1] ), vget_low_f32 ( t23.val[1] ) );
+      float32x4_t a1 = vcombine_f32 ( vget_high_f32 ( t01.val[0] ), vget_high_f32 ( t23.val[0] ) );
+      float32x4_t c1 = vcombine_f32 ( vget_high_f32 ( t01.val[1] ), vget_high_f32 ( t23.val[1] ) );
+      float32x4_t fx = vld1q_f32 ( &noise->fraction[x] );
+      float32x4_t wx = vld1q_f32 ( &noise->weight[x] );
+      float32x4_t v0 = vmlaq_f32 ( c0, a0, fx );
+      float32x4_t v1 = vmlaq_f32 ( c1, a1, vsubq_f32 ( fx, one ) );
+      float32x4_t value = vmlaq_f32 ( v0, wx, vsubq_f32 ( v1, v0 ) );
+
+      if ( out == NULL )
+      {
+         lo = vminq_f32 ( lo, value );
+         hi = vmaxq_f32 ( hi, value );
+      }
+      else
+      {
+         uint32x4_t words = vcvtq_u32_f32 ( vmulq_f32 ( vsubq_f32 ( value, offset ), scale ) );
+         uint8x8_t bytes = vqmovn_u16 ( vcombine_u16 ( vqmovn_u32 ( words ), vqmovn_u32 ( words ) ) );
+         uint32_t packed = vget_lane_u32 ( vreinterpret_u32_u8 ( bytes ), 0 );
+
+         memcpy ( &out[x], &packed, 4 );
+      }
+   }
+
+   if ( out == NULL )
+   {
+      vst1q_f32 ( range, lo );
+      vst1q_f32 ( range + 4, hi );
+
+      for ( x = 0; x < 4; x++ )
+      {
+         minMax[0] = range[x] < minMax[0] ? range[x] : minMax[0];
+         minMax[1] = range[x + 4] > minMax[1] ? range[x + 4] : minMax[1];
+      }
+   }
+
+   NoiseRowRange ( noise, coefficients, minMax, out, noise->size & ~3 );
+}
+#endif // ES_SIMD_NEON
+
+///
+// GetNoiseRow()
+//
+//    Pick the fastest row kernel for this CPU.  Called once per volume on
+//    the calling thread, which hands the kernel to the workers.
+//
+static NoiseRowFunc GetNoiseRow ( void )
+{
+   NoiseRowFunc func = NoiseRowScalar;
+
+#if defined(ES_SIMD_AVX)
+   func = CpuHasAVX ( ) ? NoiseRowAVX : NoiseRowSSE2;
+#elif defined(ES_SIMD_SSE2)
+   func = NoiseRowSSE2;
+#elif defined(ES_SIMD_NEON)
+   func = NoiseRowNEON;
+#endif
+
+   return func;
+}
+
+///
+// NoiseCacheKey()
+//
+//    Asset cache key of a volume, from everything its contents depend on
+//
+static unsigned long long NoiseCacheKey ( int size, float frequency )
+{
+   static const char name[] = "esNoise3D";
+   int version = NOISE_VERSION;
+   unsigned long long key;
+
+   key = esAssetCacheKey ( 0, name, sizeof ( name ) );
+   key = esAssetCacheKey ( key, &version, sizeof ( version ) );
+   key = esAssetCacheKey ( key, &size, sizeof ( size ) );
+   key = esAssetCacheKey ( key, &frequency, sizeof ( frequency ) );
+   key = esAssetCacheKey ( key, permTable, sizeof ( permTable ) );
+
+   return key;
+}
+
+///
+// NoiseSlabs()
+//
+//    Evaluate slabs [first, last) of the volume, for their range while the
+//    scale is 0 and into the volume after
+//
+static void ESCALLBACK NoiseSlabs ( void *userData, int first, int last )
+{
+   NoiseJob    *job = ( NoiseJob * ) userData;
+   NoiseVolume *noise = job->noise;
+   NoiseRowFunc noiseRow = job->noiseRow;
+   int size = noise->size;
+   int y, z;
+
+   for ( z = first; z < last; z++ )
+   {
+      float *coefficients = &noise->coefficients[z * noise->cellCount * 4];
+      float minMax[2] = { noise->slabMin[z], noise->slabMax[z] };
+
+      for ( y = 0; y < size; y++ )
+      {
+         GLubyte *out = noise->scale != 0.0f ? &noise->volume[ ( z * size + y ) * size] : NULL;
+
+         RowCoefficients ( noise, y, z, coefficients );
+         noiseRow ( noise, coefficients, minMax, out );
+      }
+
+      noise->slabMin[z] = minMax[0];
+      noise->slabMax[z] = minMax[1];
+   }
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+//
+///
+/// \brief Generate a volume of gradient noise normalized to bytes
+/// \param volume Returns size * size * size bytes, x first
+/// \param size Size of the volume along each axis
+/// \param frequency Lattice cells across the volume
+/// \return GL_FALSE if out of memory
+//
+GLboolean ESUTIL_API esGenNoise3D ( GLubyte *volume, int size, float frequency )
+{
+   NoiseVolume noise;
+   NoiseJob job;
+   GLboolean result = GL_FALSE;
+   float min, max;
+   int i;
+
+   memset ( &noise, 0, sizeof ( noise ) );
+
+   if ( volume == NULL || size <= 0 || frequency <= 0.0f )
+   {
+      return GL_FALSE;
+   }
+
+   noise.volume = volume;
+   noise.size = size;
+   noise.cell = ( int * ) malloc ( size * sizeof ( int ) );
+   noise.fraction = ( float * ) malloc ( size * sizeof ( float ) );
+   noise.weight = ( float * ) malloc ( size * sizeof ( float ) );
+   noise.slabMin = ( float * ) malloc ( size * sizeof ( float ) );
+   noise.slabMax = ( float * ) malloc ( size * sizeof ( float ) );
+
+   if ( noise.cell == NULL || noise.fraction == NULL || noise.weight == NULL ||
+        noise.slabMin == NULL || noise.slabMax == NULL )
+   {
+      goto done;
+   }
+
+   // The lattice position of a coordinate is the same along every axis
+   for ( i = 0; i < size; i++ )
+   {
+      float position = ( float ) i / ( float ) size * frequency;
+      float fraction;
+
+      noise.cell[i] = ( int ) position;
+      fraction = position - noise.cell[i];
+      noise.fraction[i] = fraction;
+      noise.weight[i] = smoothstep ( fraction );
+
+      noise.slabMin[i] = 1000.0f;
+      noise.slabMax[i] = -1000.0f;
+   }
+
+   noise.cellCount = noise.cell[size - 1] + 1;
+   noise.coefficients = ( float * ) malloc ( size * noise.cellCount * 4 * sizeof ( float ) );
+
+   if ( noise.coefficients == NULL )
+   {
+      goto done;
+   }
+
+   InitGradients ( noise.gradients );
+
+   job.noise = &noise;
+   job.noiseRow = GetNoiseRow ( );
+
+   // Find the range of the values, then evaluate them again straight into
+   // the normalized bytes rather than keep a volume of floats
+   esParallelFor ( size, NOISE_MIN_CHUNK / ( size * size ) + 1, NoiseSlabs, &job );
+
+   min = noise.slabMin[0];
+   max = noise.slabMax[0];
+
+   for ( i = 1; i < size; i++ )
+   {
+      min = noise.slabMin[i] < min ? noise.slabMin[i] : min;
+      max = noise.slabMax[i] > max ? noise.slabMax[i] : max;
+   }
+
+   noise.offset = min;
+   noise.scale = max > min ? 255.0f / ( max - min ) : 1.0f;
+
+   esParallelFor ( size, NOISE_MIN_CHUNK / ( size * size ) + 1, NoiseSlabs, &job );
+
+   result = GL_TRUE;
+
+done:
+   free ( noise.cell );
+   free ( noise.fraction );
+   free ( noise.weight );
+   free ( noise.slabMin );
+   free ( noise.slabMax );
+   free ( noise.coefficients );
+
+   return result;
+}
+
+//
+///
+/// \brief Create a GL_R8 3D texture of gradient noise, see esGenNoise3D, through the asset cache
+/// \param size Size of the texture along each axis
+/// \param frequency Lattice cells across the texture
+/// \return The texture, with linear filtering and mirrored repeat, 0 on failure
+//
+GLuint ESUTIL_API esCreateNoise3DTexture ( int size, float frequency )
+{
+   size_t count = ( size_t ) size * size * size;
+   unsigned long long key = NoiseCacheKey ( size, frequency );
+   ESMappedFile file;
+   const GLubyte *volume = ( const GLubyte * ) esAssetCacheMap ( key, count, &file );
+   GLubyte *generated = NULL;
+   GLuint textureId = 0;
+
+   // Generate the volume on a cache miss, then keep it for later runs
+   if ( volume == NULL )
+   {
+      generated = ( GLubyte * ) malloc ( count );
+
+      if ( generated == NULL || !esGenNoise3D ( generated, size, frequency ) )
+      {
+         free ( generated );
+         return 0;
+      }
+
+      esAssetCacheStore ( key, generated, count );
+      volume = generated;
+   }
+
+   glGenTextures ( 1, &textureId );
+   glBindTexture ( GL_TEXTURE_3D, textureId );
+   glTexImage3D ( GL_TEXTURE_3D, 0, GL_R8, size, size, size, 0,
+                  GL_RED, GL_UNSIGNED_BYTE, volume );
+
+   glTexParameteri ( GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+   glTexParameteri ( GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+   glTexParameteri ( GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT );
+   glTexParameteri ( GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT );
+   glTexParameteri ( GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_MIRRORED_REPEAT );
+
+   glBindTexture ( GL_TEXTURE_3D, 0 );
+   StateSetTexture ( GL_TEXTURE_3D, 0 );
+
+   esUnmapFile ( &file );
+   free ( generated );
+
+   return textureId;
+}
@@ -0,0 +1,380 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// ESParticleFeedback.c
+//
+//    GPU particles updated with transform feedback.  Particles are kept in
+//    emission order, so the ones that can still be alive form one range
+//    starting after the ones that have outlived the longest lifetime.  Each
+//    update runs only that range through the update program, recording it
+//    at the start of the next buffer, and appends the new particles behind
+//    it in the same transform feedback pass.  Three buffers rotate so that
+//    the buffer written is never one the GPU may still be drawing from.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include "esUtil_win.h"
+#include <stdlib.h>
+#include <string.h>
+
+///
+//  Macros
+//
+
+// Particle buffers: the one drawn, the one being written, and one the GPU
+// may still be reading from the frame before
+#define FEEDBACK_BUFFERS   3
+
+// Updates that emitted particles and may still have live ones.  When full,
+// the newest two are merged, which only keeps particles longer.
+#define FEEDBACK_BATCHES   1024
+
+///
+//  Types
+//
+struct ESParticleFeedback
+{
+   // Most particles, and bytes per particle
+   int          capacity;
+   GLsizei      particleSize;
+
+   // Longest lifetime of a particle
+   GLfloat      maxLifetime;
+
+   // Particle buffers, the current one and the particles recorded in it
+   GLuint       buffers[FEEDBACK_BUFFERS];
+   int          current;
+   int          count;
+
+   // Time and number of particles of each update that emitted, oldest
+   // first, in the same order as the particles in the current buffer
+   GLfloat      batchTime[FEEDBACK_BATCHES];
+   int          batchCount[FEEDBACK_BATCHES];
+   int          firstBatch;
+   int          numBatches;
+
+   // Primitives-written queries, one per buffer, with the count the query
+   // should return, and the last count read back
+   GLuint       queries[FEEDBACK_BUFFERS];
+   GLboolean    queryPending[FEEDBACK_BUFFERS];
+   int          queryExpected[FEEDBACK_BUFFERS];
+   int          written;
+};
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// ExpiredCount()
+//
+//    Number of particles at the start of the current buffer emitted at
+//    least maxLifetime before time
+//
+static int ExpiredCount ( const ESParticleFeedback *feedback, GLfloat time, int *numBatches )
+{
+   int expired = 0;
+   int n;
+
+   for ( n = 0; n < feedback->numBatches; n++ )
+   {
+      int batch = ( feedback->firstBatch + n ) % FEEDBACK_BATCHES;
+
+      if ( time - feedback->batchTime[batch] < feedback->maxLifetime )
+      {
+         break;
+      }
+
+      expired += feedback->batchCount[batch];
+   }
+
+   if ( numBatches != NULL )
+   {
+      *numBatches = n;
+   }
+
+   return expired;
+}
+
+///
+// PollQueries()
+//
+//    Read back the results that have arrived, without waiting for the rest
+//
+static void PollQueries ( ESParticleFeedback *feedback )
+{
+   int i;
+
+   for ( i = 0; i < FEEDBACK_BUFFERS; i++ )
+   {
+      GLuint available = GL_FALSE;
+      GLuint written;
+
+      if ( !feedback->queryPending[i] )
+      {
+         continue;
+      }
+
+      glGetQueryObjectuiv ( feedback->queries[i], GL_QUERY_RESULT_AVAILABLE, &available );
+
+      if ( !available )
+      {
+         continue;
+      }
+
+      glGetQueryObjectuiv ( feedback->queries[i], GL_QUERY_RESULT, &written );
+      feedback->queryPending[i] = GL_FALSE;
+      feedback->written = ( int ) written;
+
+      if ( feedback->written != feedback->queryExpected[i] )
+      {
+         esLogWarning ( "esParticleFeedbackUpdate: %d particles recorded, %d expected\n",
+                        feedback->written, feedback->queryExpected[i] );
+      }
+   }
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+//
+///
+/// \brief Create the buffers for transform feedback particles
+//
+ESParticleFeedback *ESUTIL_API esParticleFeedbackCreate ( int capacity, GLsizei particleSize, GLfloat maxLifetime )
+{
+   ESParticleFeedback *feedback;
+   int                 i;
+
+   if ( capacity <= 0 || particleSize <= 0 )
+   {
+      return NULL;
+   }
+
+   feedback = ( ESParticleFeedback * ) calloc ( 1, sizeof ( ESParticleFeedback ) );
+
+   if ( feedback == NULL )
+   {
+      return NULL;
+   }
+
+   feedback->capacity = capacity;
+   feedback->particleSize = particleSize;
+   feedback->maxLifetime = maxLifetime;
+   feedback->written = -1;
+
+   // Storage only, the first update writes the particles
+   glGenBuffers ( FEEDBACK_BUFFERS, feedback->buffers );
+
+   for ( i = 0; i < FEEDBACK_BUFFERS; i++ )
+   {
+      glBindBuffer ( GL_ARRAY_BUFFER, feedback->buffers[i] );
+      glBufferData ( GL_ARRAY_BUFFER, ( GLsizeiptr ) capacity * particleSize, NULL, GL_DYNAMIC_COPY );
+   }
+
+   glBindBuffer ( GL_ARRAY_BUFFER, 0 );
+   StateSetBuffer ( GL_ARRAY_BUFFER, 0 );
+   glGenQueries ( FEEDBACK_BUFFERS, feedback->queries );
+
+   if ( feedback->buffers[0] == 0 || feedback->queries[0] == 0 )
+   {
+      esParticleFeedbackDestroy ( feedback );
+      return NULL;
+   }
+
+   return feedback;
+}
+
+//
+///
+/// \brief Update the live particles and emit new ones with transform feedback
+//
+int ESUTIL_API esParticleFeedbackUpdate ( ESParticleFeedback *feedback, GLfloat time, int emitCount, GLint emitLoc,
+                                          void ( ESCALLBACK *setupAttribs ) ( void *userData ), void *userData )
+{
+   int    numExpired;
+   int    expired = ExpiredCount ( feedback, time, &numExpired );
+   int    live = feedback->count - expired;
+   int    next = ( feedback->current + 1 ) % FEEDBACK_BUFFERS;
+   GLuint query = 0;
+
+   PollQueries ( feedback );
+
+   // Drop the batches that have expired
+   feedback->firstBatch = ( feedback->firstBatch + numExpired ) % FEEDBACK_BATCHES;
+   feedback->numBatches -= numExpired;
+
+   if ( emitCount > feedback->capacity - live )
+   {
+      emitCount = feedback->capacity - live;
+   }
+
+   if ( emitCount < 0 )
+   {
+      emitCount = 0;
+   }
+
+   // Source particles, in the current buffer
+   glBindBuffer ( GL_ARRAY_BUFFER, feedback->buffers[feedback->current] );
+   StateSetBuffer ( GL_ARRAY_BUFFER, feedback->buffers[feedback->current] );
+   setupAttribs ( userData );
+
+   glBindBufferBase ( GL_TRANSFORM_FEEDBACK_BUFFER, 0, feedback->buffers[next] );
+   glEnable ( GL_RASTERIZER_DISCARD );
+
+   // Count what this update writes, unless the query of the last update
+   // into the same buffer has not come back yet
+   if ( !feedback->queryPending[next] )
+   {
+      query = feedback->queries[next];
+      feedback->queryPending[next] = GL_TRUE;
+      feedback->queryExpected[next] = live + emitCount;
+      glBeginQuery ( GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN, query );
+   }
+
+   glBeginTransformFeedback ( GL_POINTS );
+
+   // The particles that may be alive go to the start of the next buffer
+   if ( live > 0 )
+   {
+      glUniform1i ( emitLoc, 0 );
+      glDrawArrays ( GL_POINTS, expired, live );
+   }
+
+   // New particles after them.  The attributes read are ignored.
+   if ( emitCount > 0 )
+   {
+      glUniform1i ( emitLoc, 1 );
+      glDrawArrays ( GL_POINTS, 0, emitCount );
+   }
+
+   glEndTransformFeedback ( );
+
+   if ( query != 0 )
+   {
+      glEndQuery ( GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN );
+   }
+
+   glDisable ( GL_RASTERIZER_DISCARD );
+   glBindBufferBase ( GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0 );
+   glBindBuffer ( GL_ARRAY_BUFFER, 0 );
+
+   StateSetCap ( GL_RASTERIZER_DISCARD, GL_FALSE );
+   StateSetBufferBase ( GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0 );
+   StateSetBuffer ( GL_ARRAY_BUFFER, 0 );
+
+   feedback->current = next;
+   feedback->count = live + emitCount;
+
+   // Record the new batch, merging the newest two when out of room
+   if ( emitCount > 0 )
+   {
+      int batch;
+
+      if ( feedback->numBatches == FEEDBACK_BATCHES )
+      {
+         feedback->numBatches--;
+         emitCount += feedback->batchCount[( feedback->firstBatch + feedback->numBatches ) % FEEDBACK_BATCHES];
+      }
+
+      batch = ( feedback->firstBatch + feedback->numBatches ) % FEEDBACK_BATCHES;
+      feedback->batchTime[batch] = time;
+      feedback->batchCount[batch] = emitCount;
+      feedback->numBatches++;
+   }
+
+   return feedback->count;
+}
+
+//
+///
+/// \brief Draw the particles that may be alive
+//
+int ESUTIL_API esParticleFeedbackDraw ( ESParticleFeedback *feedback, GLfloat time,
+                                        void ( ESCALLBACK *setupAttribs ) ( void *userData ), void *userData )
+{
+   int expired = ExpiredCount ( feedback, time, NULL );
+   int live = feedback->count - expired;
+
+   if ( live <= 0 )
+   {
+      return 0;
+   }
+
+   glBindBuffer ( GL_ARRAY_BUFFER, feedback->buffers[feedback->current] );
+   StateSetBuffer ( GL_ARRAY_BUFFER, feedback->buffers[feedback->current] );
+   setupAttribs ( userData );
+
+   glDrawArrays ( GL_POINTS, expired, live );
+
+   return live;
+}
+
+//
+///
+/// \brief Return the number of particles the GPU recorded in the last update whose query has come back
+//
+int ESUTIL_API esParticleFeedbackWritten ( ESParticleFeedback *feedback )
+{
+   PollQueries ( feedback );
+   return feedback->written;
+}
+
+//
+///
+/// \brief Delete the buffers and queries of transform feedback particles
+//
+void ESUTIL_API esParticleFeedbackDestroy ( ESParticleFeedback *feedback )
+{
+   int i;
+
+   if ( feedback == NULL )
+   {
+      return;
+   }
+
+   for ( i = 0; i < FEEDBACK_BUFFERS; i++ )
+   {
+      StateDeleteBuffer ( feedback->buffers[i] );
+   }
+
+   glDeleteBuffers ( FEEDBACK_BUFFERS, feedback->buffers );
+   glDeleteQueries ( FEEDBACK_BUFFERS, feedback->queries );
+   free ( feedback );
+}
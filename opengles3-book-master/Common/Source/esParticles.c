@@ -0,0 +1,721 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// ESParticles.c
+//
+//    CPU particle simulation.  Particles are stored as structure-of-arrays
+//    in fixed blocks, each holding its live particles at its start.  The
+//    esParallelFor threads integrate whole blocks with SSE2 or NEON, four
+//    particles at a time, and fill the holes the dead ones leave with live
+//    particles from the end of the same block while it is still in cache.
+//    New particles go into the free space of the blocks, and a prefix sum of
+//    the block counts packs the live particles into a vertex buffer.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 )
+#define ES_SIMD_SSE2
+#include <emmintrin.h>
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define ES_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+///
+//  Macros
+//
+
+// Particles per block, 128 KB of particle data.  A block is the unit of
+// work handed to a thread and keeps its own generator.
+#define PARTICLE_BLOCK     4096
+
+// Particle arrays
+#define STREAM_X           0
+#define STREAM_Y           1
+#define STREAM_Z           2
+#define STREAM_VX          3
+#define STREAM_VY          4
+#define STREAM_VZ          5
+#define STREAM_AGE         6
+#define STREAM_LIFETIME    7
+#define NUM_STREAMS        8
+
+///
+//  Types
+//
+struct ESParticleSystem
+{
+   // Number of particles allocated and alive
+   int          capacity;
+   int          count;
+
+   // Particle arrays, in one allocation
+   GLfloat     *memory;
+   GLfloat     *streams[NUM_STREAMS];
+
+   // Live particles at the start of each block, particles being added to
+   // each block by an emit call, and where each block's vertices go
+   int          numBlocks;
+   int         *blockCount;
+   int         *blockEmit;
+   int         *blockOffset;
+
+   // Number of emit calls, seeds the generators
+   unsigned int emitCount;
+};
+
+// xorshift128 generator
+typedef struct
+{
+   unsigned int x, y, z, w;
+} Random;
+
+typedef struct
+{
+   ESParticleSystem        *system;
+   const ESParticleEmitter *emitter;
+   unsigned int             seed;
+} EmitJob;
+
+typedef struct
+{
+   ESParticleSystem *system;
+   GLfloat           deltaTime;
+   GLfloat           acceleration[3];
+
+   // Without acceleration the velocities are only read
+   GLboolean         accelerate;
+} UpdateJob;
+
+typedef struct
+{
+   const ESParticleSystem *system;
+   GLfloat                *vertices;
+   GLfloat                 time;
+} WriteJob;
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// Hash()
+//
+//    Integer hash used to seed the generators
+//
+static unsigned int Hash ( unsigned int x )
+{
+   x ^= x >> 16;
+   x *= 0x7feb352dU;
+   x ^= x >> 15;
+   x *= 0x846ca68bU;
+   x ^= x >> 16;
+   return x;
+}
+
+///
+// RandomSeed()
+//
+static void RandomSeed ( Random *random, unsigned int seed )
+{
+   random->x = Hash ( seed );
+   random->y = Hash ( random->x ^ 0x9e3779b9U );
+   random->z = Hash ( random->y ^ 0x9e3779b9U );
+   random->w = Hash ( random->z ^ 0x9e3779b9U ) | 1;
+}
+
+///
+// RandomFloat()
+//
+//    Uniform in the open interval (0, 1)
+//
+static GLfloat RandomFloat ( Random *random )
+{
+   unsigned int t = random->x ^ ( random->x << 11 );
+
+   random->x = random->y;
+   random->y = random->z;
+   random->z = random->w;
+   random->w = random->w ^ ( random->w >> 19 ) ^ t ^ ( t >> 8 );
+
+   return ( GLfloat ) ( random->w >> 9 ) * ( 1.0f / 8388608.0f ) + ( 1.0f / 16777216.0f );
+}
+
+///
+// EmitBlocks()
+//
+//    Initialize the new particles of whole blocks.  Each block seeds its own
+//    generator from the emit call and its index, so the particles do not
+//    depend on how the blocks are split across threads.
+//
+static void ESCALLBACK EmitBlocks ( void *userData, int first, int last )
+{
+   const EmitJob           *job = ( const EmitJob * ) userData;
+   const ESParticleEmitter *emitter = job->emitter;
+   ESParticleSystem        *system = job->system;
+   GLfloat *const          *s = system->streams;
+   int                      block;
+
+   for ( block = first; block < last; block++ )
+   {
+      int    start = block * PARTICLE_BLOCK + system->blockCount[block];
+      int    end = start + system->blockEmit[block];
+      Random random;
+      int    i;
+
+      RandomSeed ( &random, job->seed + ( unsigned int ) block );
+
+      for ( i = start; i < end; i++ )
+      {
+         s[STREAM_LIFETIME][i] = emitter->maxLifetime * RandomFloat ( &random );
+
+         s[STREAM_VX][i] = emitter->speed * ( RandomFloat ( &random ) * 2.0f - 1.0f );
+         s[STREAM_VY][i] = emitter->speed * ( RandomFloat ( &random ) * 2.0f - 1.0f );
+         s[STREAM_VZ][i] = emitter->speed * ( RandomFloat ( &random ) * 2.0f - 1.0f );
+
+         s[STREAM_X][i] = emitter->position[0] + emitter->spread * ( RandomFloat ( &random ) * 2.0f - 1.0f );
+         s[STREAM_Y][i] = emitter->position[1] + emitter->spread * ( RandomFloat ( &random ) * 2.0f - 1.0f );
+         s[STREAM_Z][i] = emitter->position[2] + emitter->spread * ( RandomFloat ( &random ) * 2.0f - 1.0f );
+
+         s[STREAM_AGE][i] = 0.0f;
+      }
+
+      system->blockCount[block] += system->blockEmit[block];
+   }
+}
+
+///
+// IntegrateScalar()
+//
+//    Advance particles [first, last), list the ones that died and return
+//    how many did
+//
+static int IntegrateScalar ( const UpdateJob *job, GLfloat *const *s, int first, int last, int *dead )
+{
+   GLfloat dt = job->deltaTime;
+   GLfloat ax = job->acceleration[0] * dt;
+   GLfloat ay = job->acceleration[1] * dt;
+   GLfloat az = job->acceleration[2] * dt;
+   int     numDead = 0;
+   int     i;
+
+   for ( i = first; i < last; i++ )
+   {
+      if ( job->accelerate )
+      {
+         s[STREAM_VX][i] += ax;
+         s[STREAM_VY][i] += ay;
+         s[STREAM_VZ][i] += az;
+      }
+
+      s[STREAM_X][i] += s[STREAM_VX][i] * dt;
+      s[STREAM_Y][i] += s[STREAM_VY][i] * dt;
+      s[STREAM_Z][i] += s[STREAM_VZ][i] * dt;
+      s[STREAM_AGE][i] += dt;
+
+      // Stored every time, but only kept for a dead particle
+      dead[numDead] = i;
+      numDead += !( s[STREAM_AGE][i] < s[STREAM_LIFETIME][i] );
+   }
+
+   return numDead;
+}
+
+///
+// WriteScalar()
+//
+//    Vertices for particles [first, last), starting at vertices
+//
+static void WriteScalar ( GLfloat *const *s, int first, int last, GLfloat *vertices, GLfloat t )
+{
+   int i;
+
+   for ( i = first; i < last; i++ )
+   {
+      GLfloat *v = vertices + ( i - first ) * 4;
+      GLfloat  life = 1.0f - ( s[STREAM_AGE][i] + t ) / s[STREAM_LIFETIME][i];
+
+      v[0] = s[STREAM_X][i] + s[STREAM_VX][i] * t;
+      v[1] = s[STREAM_Y][i] + s[STREAM_VY][i] * t;
+      v[2] = s[STREAM_Z][i] + s[STREAM_VZ][i] * t;
+      v[3] = life < 0.0f ? 0.0f : life > 1.0f ? 1.0f : life;
+   }
+}
+
+#ifdef ES_SIMD_SSE2
+///
+// IntegrateSSE2()
+//
+//    Four particles at a time from first, finding the dead ones in the
+//    sign mask of the age test.  Returns the index it stopped at, the rest
+//    is left to the scalar code.
+//
+static int IntegrateSSE2 ( const UpdateJob *job, GLfloat *const *s, int first, int last, int *dead, int *numDead )
+{
+   __m128 dt = _mm_set1_ps ( job->deltaTime );
+   __m128 ax = _mm_set1_ps ( job->acceleration[0] * job->deltaTime );
+   __m128 ay = _mm_set1_ps ( job->acceleration[1] * job->deltaTime );
+   __m128 az = _mm_set1_ps ( job->acceleration[2] * job->deltaTime );
+   int    count = 0;
+   int    i;
+
+   for ( i = first; i + 4 <= last; i += 4 )
+   {
+      int    mask;
+      __m128 vx = _mm_add_ps ( _mm_loadu_ps ( s[STREAM_VX] + i ), ax );
+      __m128 vy = _mm_add_ps ( _mm_loadu_ps ( s[STREAM_VY] + i ), ay );
+      __m128 vz = _mm_add_ps ( _mm_loadu_ps ( s[STREAM_VZ] + i ), az );
+      __m128 age = _mm_add_ps ( _mm_loadu_ps ( s[STREAM_AGE] + i ), dt );
+
+      if ( job->accelerate )
+      {
+         _mm_storeu_ps ( s[STREAM_VX] + i, vx );
+         _mm_storeu_ps ( s[STREAM_VY] + i, vy );
+         _mm_storeu_ps ( s[STREAM_VZ] + i, vz );
+      }
+
+      _mm_storeu_ps ( s[STREAM_X] + i, _mm_add_ps ( _mm_loadu_ps ( s[STREAM_X] + i ), _mm_mul_ps ( vx, dt ) ) );
+      _mm_storeu_ps ( s[STREAM_Y] + i, _mm_add_ps ( _mm_loadu_ps ( s[STREAM_Y] + i ), _mm_mul_ps ( vy, dt ) ) );
+      _mm_storeu_ps ( s[STREAM_Z] + i, _mm_add_ps ( _mm_loadu_ps ( s[STREAM_Z] + i ), _mm_mul_ps ( vz, dt ) ) );
+      _mm_storeu_ps ( s[STREAM_AGE] + i, age );
+
+      mask = _mm_movemask_ps ( _mm_cmpnlt_ps ( age, _mm_loadu_ps ( s[STREAM_LIFETIME] + i ) ) );
+
+      if ( mask != 0 )
+      {
+         dead[count] = i;
+         count += mask & 1;
+         dead[count] = i + 1;
+         count += ( mask >> 1 ) & 1;
+         dead[count] = i + 2;
+         count += ( mask >> 2 ) & 1;
+         dead[count] = i + 3;
+         count += ( mask >> 3 ) & 1;
+      }
+   }
+
+   *numDead = count;
+   return i;
+}
+
+///
+// WriteSSE2()
+//
+//    Four vertices at a time, transposed from the particle arrays.  Returns
+//    the index it stopped at.
+//
+static int WriteSSE2 ( GLfloat *const *s, int first, int last, GLfloat *vertices, GLfloat time )
+{
+   __m128 t = _mm_set1_ps ( time );
+   __m128 zero = _mm_setzero_ps ( );
+   __m128 one = _mm_set1_ps ( 1.0f );
+   int    i;
+
+   for ( i = first; i + 4 <= last; i += 4 )
+   {
+      GLfloat *v = vertices + ( i - first ) * 4;
+      __m128   x = _mm_add_ps ( _mm_loadu_ps ( s[STREAM_X] + i ), _mm_mul_ps ( _mm_loadu_ps ( s[STREAM_VX] + i ), t ) );
+      __m128   y = _mm_add_ps ( _mm_loadu_ps ( s[STREAM_Y] + i ), _mm_mul_ps ( _mm_loadu_ps ( s[STREAM_VY] + i ), t ) );
+      __m128   z = _mm_add_ps ( _mm_loadu_ps ( s[STREAM_Z] + i ), _mm_mul_ps ( _mm_loadu_ps ( s[STREAM_VZ] + i ), t ) );
+      __m128   life = _mm_div_ps ( _mm_add_ps ( _mm_loadu_ps ( s[STREAM_AGE] + i ), t ),
+                                   _mm_loadu_ps ( s[STREAM_LIFETIME] + i ) );
+
+      life = _mm_min_ps ( _mm_max_ps ( _mm_sub_ps ( one, life ), zero ), one );
+
+      _MM_TRANSPOSE4_PS ( x, y, z, life );
+
+      _mm_storeu_ps ( v, x );
+      _mm_storeu_ps ( v + 4, y );
+      _mm_storeu_ps ( v + 8, z );
+      _mm_storeu_ps ( v + 12, life );
+   }
+
+   return i;
+}
+#endif // ES_SIMD_SSE2
+
+#ifdef ES_SIMD_NEON
+///
+// IntegrateNEON()
+//
+//    As IntegrateSSE2, with the lanes of the age test narrowed to one
+//    64-bit value to check for any dead particle
+//
+static int IntegrateNEON ( const UpdateJob *job, GLfloat *const *s, int first, int last, int *dead, int *numDead )
+{
+   float32x4_t dt = vdupq_n_f32 ( job->deltaTime );
+   float32x4_t ax = vdupq_n_f32 ( job->acceleration[0] * job->deltaTime );
+   float32x4_t ay = vdupq_n_f32 ( job->acceleration[1] * job->deltaTime );
+   float32x4_t az = vdupq_n_f32 ( job->acceleration[2] * job->deltaTime );
+   int         count = 0;
+   int         i;
+
+   for ( i = first; i + 4 <= last; i += 4 )
+   {
+      uint16x4_t  mask;
+      float32x4_t vx = vaddq_f32 ( vld1q_f32 ( s[STREAM_VX] + i ), ax );
+      float32x4_t vy = vaddq_f32 ( vld1q_f32 ( s[STREAM_VY] + i ), ay );
+      float32x4_t vz = vaddq_f32 ( vld1q_f32 ( s[STREAM_VZ] + i ), az );
+      float32x4_t age = vaddq_f32 ( vld1q_f32 ( s[STREAM_AGE] + i ), dt );
+
+      if ( job->accelerate )
+      {
+         vst1q_f32 ( s[STREAM_VX] + i, vx );
+         vst1q_f32 ( s[STREAM_VY] + i, vy );
+         vst1q_f32 ( s[STREAM_VZ] + i, vz );
+      }
+
+      vst1q_f32 ( s[STREAM_X] + i, vmlaq_f32 ( vld1q_f32 ( s[STREAM_X] + i ), vx, dt ) );
+      vst1q_f32 ( s[STREAM_Y] + i, vmlaq_f32 ( vld1q_f32 ( s[STREAM_Y] + i ), vy, dt ) );
+      vst1q_f32 ( s[STREAM_Z] + i, vmlaq_f32 ( vld1q_f32 ( s[STREAM_Z] + i ), vz, dt ) );
+      vst1q_f32 ( s[STREAM_AGE] + i, age );
+
+      mask = vmovn_u32 ( vcgeq_f32 ( age, vld1q_f32 ( s[STREAM_LIFETIME] + i ) ) );
+
+      if ( vget_lane_u64 ( vreinterpret_u64_u16 ( mask ), 0 ) != 0 )
+      {
+         dead[count] = i;
+         count += vget_lane_u16 ( mask, 0 ) & 1;
+         dead[count] = i + 1;
+         count += vget_lane_u16 ( mask, 1 ) & 1;
+         dead[count] = i + 2;
+         count += vget_lane_u16 ( mask, 2 ) & 1;
+         dead[count] = i + 3;
+         count += vget_lane_u16 ( mask, 3 ) & 1;
+      }
+   }
+
+   *numDead = count;
+   return i;
+}
+
+///
+// WriteNEON()
+//
+//    Four vertices at a time, interleaved by the store.  The lifetime
+//    divide uses a refined reciprocal estimate.
+//
+static int WriteNEON ( GLfloat *const *s, int first, int last, GLfloat *vertices, GLfloat time )
+{
+   float32x4_t t = vdupq_n_f32 ( time );
+   float32x4_t zero = vdupq_n_f32 ( 0.0f );
+   float32x4_t one = vdupq_n_f32 ( 1.0f );
+   int         i;
+
+   for ( i = first; i + 4 <= last; i += 4 )
+   {
+      float32x4x4_t v;
+      float32x4_t   lifetime = vld1q_f32 ( s[STREAM_LIFETIME] + i );
+      float32x4_t   rcp = vrecpeq_f32 ( lifetime );
+
+      rcp = vmulq_f32 ( rcp, vrecpsq_f32 ( lifetime, rcp ) );
+      rcp = vmulq_f32 ( rcp, vrecpsq_f32 ( lifetime, rcp ) );
+
+      v.val[0] = vmlaq_f32 ( vld1q_f32 ( s[STREAM_X] + i ), vld1q_f32 ( s[STREAM_VX] + i ), t );
+      v.val[1] = vmlaq_f32 ( vld1q_f32 ( s[STREAM_Y] + i ), vld1q_f32 ( s[STREAM_VY] + i ), t );
+      v.val[2] = vmlaq_f32 ( vld1q_f32 ( s[STREAM_Z] + i ), vld1q_f32 ( s[STREAM_VZ] + i ), t );
+      v.val[3] = vmulq_f32 ( vaddq_f32 ( vld1q_f32 ( s[STREAM_AGE] + i ), t ), rcp );
+      v.val[3] = vminq_f32 ( vmaxq_f32 ( vsubq_f32 ( one, v.val[3] ), zero ), one );
+
+      vst4q_f32 ( vertices + ( i - first ) * 4, v );
+   }
+
+   return i;
+}
+#endif // ES_SIMD_NEON
+
+///
+// UpdateBlocks()
+//
+//    Integrate whole blocks, then move the live particles at the end of
+//    each block into the slots of the dead ones before them.  Dead
+//    particles are listed in increasing order and live ones are taken from
+//    the end down, so each block stays packed at its start.
+//
+static void ESCALLBACK UpdateBlocks ( void *userData, int first, int last )
+{
+   const UpdateJob  *job = ( const UpdateJob * ) userData;
+   ESParticleSystem *system = job->system;
+   GLfloat *const   *s = system->streams;
+   int               dead[PARTICLE_BLOCK];
+   int               block;
+
+   for ( block = first; block < last; block++ )
+   {
+      int start = block * PARTICLE_BLOCK;
+      int end = start + system->blockCount[block];
+      int numDead = 0;
+      int alive;
+      int i = start;
+      int k;
+
+#if defined(ES_SIMD_SSE2)
+      i = IntegrateSSE2 ( job, s, start, end, dead, &numDead );
+#elif defined(ES_SIMD_NEON)
+      i = IntegrateNEON ( job, s, start, end, dead, &numDead );
+#endif
+
+      numDead += IntegrateScalar ( job, s, i, end, dead + numDead );
+      alive = end - numDead;
+
+      for ( k = 0; k < numDead && dead[k] < alive; k++ )
+      {
+         int source;
+         int stream;
+
+         do
+         {
+            source = --end;
+         }
+         while ( !( s[STREAM_AGE][source] < s[STREAM_LIFETIME][source] ) );
+
+         for ( stream = 0; stream < NUM_STREAMS; stream++ )
+         {
+            s[stream][dead[k]] = s[stream][source];
+         }
+      }
+
+      system->blockCount[block] -= numDead;
+   }
+}
+
+///
+// WriteBlocks()
+//
+//    Vertices for the live particles of whole blocks, each at its offset
+//
+static void ESCALLBACK WriteBlocks ( void *userData, int first, int last )
+{
+   const WriteJob         *job = ( const WriteJob * ) userData;
+   const ESParticleSystem *system = job->system;
+   GLfloat *const         *s = system->streams;
+   int                     block;
+
+   for ( block = first; block < last; block++ )
+   {
+      int      start = block * PARTICLE_BLOCK;
+      int      end = start + system->blockCount[block];
+      GLfloat *vertices = job->vertices + ( size_t ) system->blockOffset[block] * 4;
+      int      i = start;
+
+#if defined(ES_SIMD_SSE2)
+      i = WriteSSE2 ( s, start, end, vertices, job->time );
+#elif defined(ES_SIMD_NEON)
+      i = WriteNEON ( s, start, end, vertices, job->time );
+#endif
+
+      WriteScalar ( s, i, end, vertices + ( i - start ) * 4, job->time );
+   }
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+//
+///
+/// \brief Create a CPU particle system
+//
+ESParticleSystem *ESUTIL_API esParticleSystemCreate ( int maxParticles )
+{
+   ESParticleSystem *system;
+   int               i;
+
+   if ( maxParticles <= 0 )
+   {
+      return NULL;
+   }
+
+   system = ( ESParticleSystem * ) calloc ( 1, sizeof ( ESParticleSystem ) );
+
+   if ( system == NULL )
+   {
+      return NULL;
+   }
+
+   system->capacity = maxParticles;
+   system->numBlocks = ( maxParticles + PARTICLE_BLOCK - 1 ) / PARTICLE_BLOCK;
+   system->memory = ( GLfloat * ) malloc ( sizeof ( GLfloat ) * NUM_STREAMS * ( size_t ) maxParticles );
+   system->blockCount = ( int * ) calloc ( system->numBlocks * 3, sizeof ( int ) );
+
+   if ( system->memory == NULL || system->blockCount == NULL )
+   {
+      esParticleSystemDestroy ( system );
+      return NULL;
+   }
+
+   system->blockEmit = system->blockCount + system->numBlocks;
+   system->blockOffset = system->blockEmit + system->numBlocks;
+
+   for ( i = 0; i < NUM_STREAMS; i++ )
+   {
+      system->streams[i] = system->memory + i * ( size_t ) maxParticles;
+   }
+
+   return system;
+}
+
+//
+///
+/// \brief Spawn particles at an emitter
+//
+int ESUTIL_API esParticleSystemEmit ( ESParticleSystem *system, const ESParticleEmitter *emitter, int count )
+{
+   EmitJob job;
+   int     remaining;
+   int     last = 0;
+   int     block;
+
+   if ( count > system->capacity - system->count )
+   {
+      count = system->capacity - system->count;
+   }
+
+   if ( count <= 0 )
+   {
+      return 0;
+   }
+
+   // Share the new particles out over the free space of the blocks, in order
+   remaining = count;
+
+   for ( block = 0; block < system->numBlocks; block++ )
+   {
+      int size = block < system->numBlocks - 1 ? PARTICLE_BLOCK : system->capacity - block * PARTICLE_BLOCK;
+      int space = size - system->blockCount[block];
+
+      system->blockEmit[block] = remaining < space ? remaining : space;
+      remaining -= system->blockEmit[block];
+
+      if ( system->blockEmit[block] > 0 )
+      {
+         last = block + 1;
+      }
+   }
+
+   job.system = system;
+   job.emitter = emitter;
+   job.seed = Hash ( ++system->emitCount );
+
+   esParallelFor ( last, 1, EmitBlocks, &job );
+
+   system->count += count;
+   return count;
+}
+
+//
+///
+/// \brief Advance the particles by one time step and cull the dead ones
+//
+int ESUTIL_API esParticleSystemUpdate ( ESParticleSystem *system, float deltaTime, const GLfloat *acceleration )
+{
+   UpdateJob job;
+   int       block;
+
+   job.system = system;
+   job.deltaTime = deltaTime;
+   job.acceleration[0] = acceleration != NULL ? acceleration[0] : 0.0f;
+   job.acceleration[1] = acceleration != NULL ? acceleration[1] : 0.0f;
+   job.acceleration[2] = acceleration != NULL ? acceleration[2] : 0.0f;
+   job.accelerate = job.acceleration[0] != 0.0f || job.acceleration[1] != 0.0f || job.acceleration[2] != 0.0f;
+
+   esParallelFor ( system->numBlocks, 1, UpdateBlocks, &job );
+
+   system->count = 0;
+
+   for ( block = 0; block < system->numBlocks; block++ )
+   {
+      system->count += system->blockCount[block];
+   }
+
+   return system->count;
+}
+
+//
+///
+/// \brief Return the number of live particles
+//
+int ESUTIL_API esParticleSystemCount ( const ESParticleSystem *system )
+{
+   return system->count;
+}
+
+//
+///
+/// \brief Write the live particles as vertices
+//
+int ESUTIL_API esParticleSystemWrite ( ESParticleSystem *system, GLfloat *vertices, float time )
+{
+   WriteJob job;
+   int      offset = 0;
+   int      block;
+
+   for ( block = 0; block < system->numBlocks; block++ )
+   {
+      system->blockOffset[block] = offset;
+      offset += system->blockCount[block];
+   }
+
+   job.system = system;
+   job.vertices = vertices;
+   job.time = time;
+
+   esParallelFor ( system->numBlocks, 1, WriteBlocks, &job );
+
+   return system->count;
+}
+
+//
+///
+/// \brief Free a particle system
+//
+void ESUTIL_API esParticleSystemDestroy ( ESParticleSystem *system )
+{
+   if ( system == NULL )
+   {
+      return;
+   }
+
+   free ( system->memory );
+   free ( system->blockCount );
+   free ( system );
+}
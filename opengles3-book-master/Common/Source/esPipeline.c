@@ -0,0 +1,310 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// ESPipeline.c
+//
+//    Pipelined main loop: the update for frame N + 1 runs on its own thread
+//    while the main thread draws frame N, each writing and reading its half
+//    of a double-buffered frame state.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include "esUtil_win.h"
+#include <stdlib.h>
+#include <string.h>
+
+///
+//  Types
+//
+struct ESPipeline
+{
+   ESContext   *esContext;
+
+   // Frame states, and the interpolation for drawFunc that came with each
+   void        *states[2];
+   GLfloat      interpolation[2];
+
+   // State the update in flight writes, the other one is drawn
+   int          updateIndex;
+
+   // NULL to run the updates inline
+   ESThread    *thread;
+   ESMutex     *lock;
+   ESCondition *wake;
+   ESCondition *done;
+
+   // Update requested and not finished yet, protected by lock
+   GLboolean    busy;
+   GLboolean    quit;
+   float        deltaTime;
+
+   // Set once the first update has been started
+   GLboolean    started;
+};
+
+///
+// UpdateThread()
+//
+//    Run the updates the main thread asks for
+//
+static void ESCALLBACK UpdateThread ( void *arg )
+{
+   ESPipeline *pipeline = arg;
+
+   esMutexLock ( pipeline->lock );
+
+   for ( ;; )
+   {
+      GLfloat interpolation;
+
+      while ( !pipeline->busy && !pipeline->quit )
+      {
+         esConditionWait ( pipeline->wake, pipeline->lock );
+      }
+
+      if ( pipeline->quit )
+      {
+         break;
+      }
+
+      esMutexUnlock ( pipeline->lock );
+      interpolation = RunUpdates ( pipeline->esContext, pipeline->deltaTime );
+      esMutexLock ( pipeline->lock );
+
+      pipeline->interpolation[pipeline->updateIndex] = interpolation;
+      pipeline->busy = GL_FALSE;
+      esConditionSignal ( pipeline->done );
+   }
+
+   esMutexUnlock ( pipeline->lock );
+}
+
+///
+// StartUpdate()
+//
+static void StartUpdate ( ESPipeline *pipeline, float deltaTime )
+{
+   if ( pipeline->thread == NULL )
+   {
+      pipeline->interpolation[pipeline->updateIndex] = RunUpdates ( pipeline->esContext, deltaTime );
+      return;
+   }
+
+   esMutexLock ( pipeline->lock );
+   pipeline->deltaTime = deltaTime;
+   pipeline->busy = GL_TRUE;
+   esConditionSignal ( pipeline->wake );
+   esMutexUnlock ( pipeline->lock );
+}
+
+///
+// WaitUpdate()
+//
+static void WaitUpdate ( ESPipeline *pipeline )
+{
+   if ( pipeline->thread == NULL )
+   {
+      return;
+   }
+
+   esMutexLock ( pipeline->lock );
+
+   while ( pipeline->busy )
+   {
+      esConditionWait ( pipeline->done, pipeline->lock );
+   }
+
+   esMutexUnlock ( pipeline->lock );
+}
+
+///
+// FreePipeline()
+//
+static void FreePipeline ( ESPipeline *pipeline )
+{
+   if ( pipeline->lock != NULL )
+   {
+      esMutexDestroy ( pipeline->lock );
+   }
+
+   if ( pipeline->wake != NULL )
+   {
+      esConditionDestroy ( pipeline->wake );
+   }
+
+   if ( pipeline->done != NULL )
+   {
+      esConditionDestroy ( pipeline->done );
+   }
+
+   free ( pipeline->states[0] );
+   free ( pipeline->states[1] );
+   free ( pipeline );
+}
+
+///
+//  PipelineUpdate()
+//
+//      Wait for the update of this frame's state and start the next one
+//
+void PipelineUpdate ( ESContext *esContext, float deltaTime )
+{
+   ESPipeline *pipeline = esContext->pipeline;
+
+   // The first frame has nothing in flight, so a zero step fills its state
+   // to draw.  From then on each update uses the time of the frame that
+   // started it, so the first frame's time is simulated only once.
+   if ( !pipeline->started )
+   {
+      StartUpdate ( pipeline, 0.0f );
+      pipeline->started = GL_TRUE;
+   }
+
+   WaitUpdate ( pipeline );
+
+   esContext->interpolation = pipeline->interpolation[pipeline->updateIndex];
+   pipeline->updateIndex ^= 1;
+
+   StartUpdate ( pipeline, deltaTime );
+}
+
+///
+//  PipelineShutdown()
+//
+//      Finish the update in flight and stop the update thread
+//
+void PipelineShutdown ( ESContext *esContext )
+{
+   ESPipeline *pipeline = esContext->pipeline;
+
+   if ( pipeline == NULL )
+   {
+      return;
+   }
+
+   if ( pipeline->thread != NULL )
+   {
+      WaitUpdate ( pipeline );
+
+      esMutexLock ( pipeline->lock );
+      pipeline->quit = GL_TRUE;
+      esConditionSignal ( pipeline->wake );
+      esMutexUnlock ( pipeline->lock );
+
+      esThreadJoin ( pipeline->thread );
+   }
+
+   FreePipeline ( pipeline );
+   esContext->pipeline = NULL;
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+//
+///
+/// \brief Run the update function on its own thread, one frame ahead of the draw function
+//
+GLboolean ESUTIL_API esPipelineEnable ( ESContext *esContext, size_t stateSize )
+{
+   const char *mode = getenv ( "ES_PIPELINE" );
+   ESPipeline *pipeline;
+
+   if ( esContext->pipeline != NULL )
+   {
+      return GL_FALSE;
+   }
+
+   pipeline = calloc ( 1, sizeof ( ESPipeline ) );
+
+   if ( pipeline == NULL )
+   {
+      return GL_FALSE;
+   }
+
+   pipeline->esContext = esContext;
+   pipeline->states[0] = calloc ( 1, stateSize > 0 ? stateSize : 1 );
+   pipeline->states[1] = calloc ( 1, stateSize > 0 ? stateSize : 1 );
+
+   if ( pipeline->states[0] == NULL || pipeline->states[1] == NULL )
+   {
+      FreePipeline ( pipeline );
+      return GL_FALSE;
+   }
+
+   if ( mode == NULL || atoi ( mode ) != 0 )
+   {
+      pipeline->lock = esMutexCreate ( );
+      pipeline->wake = esConditionCreate ( );
+      pipeline->done = esConditionCreate ( );
+
+      if ( pipeline->lock == NULL || pipeline->wake == NULL || pipeline->done == NULL )
+      {
+         FreePipeline ( pipeline );
+         return GL_FALSE;
+      }
+
+      // Without a thread the updates run inline, still one frame ahead
+      pipeline->thread = esThreadCreate ( UpdateThread, pipeline );
+   }
+
+   esContext->pipeline = pipeline;
+
+   return GL_TRUE;
+}
+
+//
+///
+/// \brief Frame state for the update function to write
+//
+void *ESUTIL_API esPipelineUpdateState ( ESContext *esContext )
+{
+   ESPipeline *pipeline = esContext->pipeline;
+
+   return pipeline != NULL ? pipeline->states[pipeline->updateIndex] : NULL;
+}
+
+//
+///
+/// \brief Frame state the last finished update wrote, for the draw function to read
+//
+const void *ESUTIL_API esPipelineDrawState ( ESContext *esContext )
+{
+   ESPipeline *pipeline = esContext->pipeline;
+
+   return pipeline != NULL ? pipeline->states[pipeline->updateIndex ^ 1] : NULL;
+}
@@ -0,0 +1,742 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// ESProfiler.c
+//
+//    CPU and GPU timing of named scopes.  GPU time comes from
+//    GL_EXT_disjoint_timer_query when the driver has it.  Queries are taken
+//    from a pool per frame and read back PROFILER_FRAMES frames later, so
+//    waiting on the GPU never stalls the frame.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include "esUtil_win.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+///
+//  Macros
+//
+
+// Frames whose queries may be in flight at once
+#define PROFILER_FRAMES         4
+
+// Scopes per frame and nesting depth, further scopes are not timed
+#define PROFILER_MAX_SAMPLES    64
+#define PROFILER_MAX_DEPTH      16
+
+// Distinct scope names
+#define PROFILER_MAX_SCOPES     64
+
+// Seconds between two pairings of the GPU and CPU clocks, which drift apart
+#define PROFILER_SYNC_INTERVAL  1.0
+
+// Events kept for the trace, the oldest are dropped first
+#define PROFILER_TRACE_EVENTS   65536
+
+// Chrome trace thread ids of the CPU and GPU timelines
+#define TRACE_CPU_THREAD        1
+#define TRACE_GPU_THREAD        2
+
+// GL_EXT_disjoint_timer_query
+#ifndef GL_TIME_ELAPSED_EXT
+#define GL_QUERY_COUNTER_BITS_EXT     0x8864
+#define GL_TIME_ELAPSED_EXT           0x88BF
+#define GL_TIMESTAMP_EXT              0x8E28
+#define GL_GPU_DISJOINT_EXT           0x8FBB
+#endif
+
+///
+//  Types
+//
+typedef void ( GL_APIENTRY *QueryCounterFunc ) ( GLuint id, GLenum target );
+typedef void ( GL_APIENTRY *GetQueryObjectui64vFunc ) ( GLuint id, GLenum pname, GLuint64 *params );
+
+// One scope instance
+typedef struct
+{
+   const char   *name;
+   int           depth;
+   double        cpuBegin;
+   double        cpuEnd;
+
+   // Timestamps at both ends, or a single elapsed time query in begin.
+   // 0 when the scope has no GPU timing.
+   GLuint        beginQuery;
+   GLuint        endQuery;
+} ProfilerSample;
+
+typedef struct
+{
+   ProfilerSample samples[PROFILER_MAX_SAMPLES];
+   int            numSamples;
+
+   // Index of the frame in the frame history
+   unsigned int   frameNumber;
+
+   // Queries of this frame not read back yet
+   GLboolean      pending;
+
+   // Queries handed out to the samples, from the pool of this frame
+   GLuint         queries[PROFILER_MAX_SAMPLES * 2];
+   int            numQueries;
+
+   // Query issued last, which is not the one handed out last when scopes
+   // nest: the end of an outer scope comes after those of its inner scopes
+   GLuint         lastQuery;
+} ProfilerFrame;
+
+typedef struct
+{
+   const char   *name;
+   int           cat;
+   int           thread;
+   double        begin;
+   double        duration;
+} TraceEvent;
+
+struct ESProfiler
+{
+   ProfilerFrame   frames[PROFILER_FRAMES];
+   int             current;
+
+   // Open scopes of the current frame, -1 for scopes that are not recorded
+   int             stack[PROFILER_MAX_DEPTH];
+   int             depth;
+
+   // Timer query support: timestamps allow nested scopes, elapsed time
+   // queries only time the outermost one
+   GLboolean       timerQueries;
+   GLboolean       timestamps;
+   GLboolean       elapsedActive;
+   QueryCounterFunc        queryCounter;
+   GetQueryObjectui64vFunc getQueryObjectui64v;
+
+   // A GPU timestamp and the CPU time it was taken at, to line both up
+   GLint64         gpuSync;
+   double          cpuSync;
+
+   // Per-scope results
+   ESProfilerScope scopes[PROFILER_MAX_SCOPES];
+   int             numScopes;
+   int             disjoints;
+
+   // Latest events, as a ring
+   TraceEvent     *trace;
+   unsigned int    numTrace;
+   char           *traceFile;
+};
+
+static const char *traceCategories[] = { "cpu", "gpu", "frame" };
+
+///
+// SyncClocks()
+//
+//    Pair the current GPU timestamp with the CPU time
+//
+static void SyncClocks ( ESProfiler *profiler )
+{
+   if ( profiler->timestamps )
+   {
+      glGetInteger64v ( GL_TIMESTAMP_EXT, &profiler->gpuSync );
+      profiler->cpuSync = esGetTime ( );
+   }
+}
+
+///
+// AddTraceEvent()
+//
+static void AddTraceEvent ( ESProfiler *profiler, const char *name, int cat, int thread,
+                            double begin, double duration )
+{
+   TraceEvent *event;
+
+   if ( profiler->trace == NULL )
+   {
+      return;
+   }
+
+   event = &profiler->trace[profiler->numTrace++ % PROFILER_TRACE_EVENTS];
+   event->name = name;
+   event->cat = cat;
+   event->thread = thread;
+   event->begin = begin;
+   event->duration = duration;
+}
+
+///
+// FindScope()
+//
+static ESProfilerScope *FindScope ( ESProfiler *profiler, const char *name, int depth )
+{
+   int i;
+
+   for ( i = 0; i < profiler->numScopes; i++ )
+   {
+      if ( profiler->scopes[i].name == name || strcmp ( profiler->scopes[i].name, name ) == 0 )
+      {
+         return &profiler->scopes[i];
+      }
+   }
+
+   if ( profiler->numScopes == PROFILER_MAX_SCOPES )
+   {
+      return NULL;
+   }
+
+   profiler->scopes[i].name = name;
+   profiler->scopes[i].depth = depth;
+   profiler->scopes[i].gpuLast = -1.0f;
+   profiler->scopes[i].gpuAverage = -1.0f;
+   profiler->numScopes++;
+
+   return &profiler->scopes[i];
+}
+
+///
+// Accumulate()
+//
+//    Running average, weighted towards the last 64 values
+//
+static GLfloat Accumulate ( GLfloat average, GLfloat value, int count )
+{
+   GLfloat weight = count < 64 ? 1.0f / count : 1.0f / 64.0f;
+
+   return average + ( value - average ) * weight;
+}
+
+///
+// QueriesAvailable()
+//
+static GLboolean QueriesAvailable ( const ProfilerFrame *frame )
+{
+   GLuint available = GL_TRUE;
+
+   // Queries complete in the order they were issued, so the last one is enough
+   if ( frame->lastQuery != 0 )
+   {
+      glGetQueryObjectuiv ( frame->lastQuery, GL_QUERY_RESULT_AVAILABLE, &available );
+   }
+
+   return available ? GL_TRUE : GL_FALSE;
+}
+
+///
+// ResolveFrame()
+//
+//    Fold a finished frame into the scope results and the trace.  GPU times
+//    are skipped if gpuValid is false.
+//
+static void ResolveFrame ( ESProfiler *profiler, ESContext *esContext, ProfilerFrame *frame, GLboolean gpuValid )
+{
+   double gpuFrameTime = 0.0;
+   int i;
+
+   for ( i = 0; i < frame->numSamples; i++ )
+   {
+      const ProfilerSample *sample = &frame->samples[i];
+      ESProfilerScope *scope = FindScope ( profiler, sample->name, sample->depth );
+      double gpuBegin = sample->cpuBegin;
+      double gpuTime = -1.0;
+
+      if ( gpuValid && sample->beginQuery != 0 )
+      {
+         GLuint64 begin = 0, end = 0;
+
+         if ( profiler->timestamps )
+         {
+            profiler->getQueryObjectui64v ( sample->beginQuery, GL_QUERY_RESULT, &begin );
+            profiler->getQueryObjectui64v ( sample->endQuery, GL_QUERY_RESULT, &end );
+            gpuBegin = profiler->cpuSync + ( ( GLint64 ) begin - profiler->gpuSync ) * 1e-9;
+         }
+         else
+         {
+            profiler->getQueryObjectui64v ( sample->beginQuery, GL_QUERY_RESULT, &end );
+         }
+
+         gpuTime = ( end - begin ) * 1e-9;
+
+         if ( sample->depth == 0 )
+         {
+            gpuFrameTime += gpuTime;
+         }
+      }
+
+      AddTraceEvent ( profiler, sample->name, 0, TRACE_CPU_THREAD, sample->cpuBegin,
+                      sample->cpuEnd - sample->cpuBegin );
+
+      if ( gpuTime >= 0.0 )
+      {
+         AddTraceEvent ( profiler, sample->name, 1, TRACE_GPU_THREAD, gpuBegin, gpuTime );
+      }
+
+      if ( scope == NULL )
+      {
+         continue;
+      }
+
+      scope->count++;
+      scope->cpuLast = ( GLfloat ) ( ( sample->cpuEnd - sample->cpuBegin ) * 1000.0 );
+      scope->cpuAverage = Accumulate ( scope->cpuAverage, scope->cpuLast, scope->count );
+
+      if ( gpuTime >= 0.0 )
+      {
+         scope->gpuCount++;
+         scope->gpuLast = ( GLfloat ) ( gpuTime * 1000.0 );
+         scope->gpuAverage = scope->gpuCount == 1 ? scope->gpuLast :
+                             Accumulate ( scope->gpuAverage, scope->gpuLast, scope->gpuCount );
+      }
+   }
+
+   if ( gpuValid && profiler->timerQueries && frame->numSamples > 0 )
+   {
+      FrameStatsSetGPUTime ( esContext, frame->frameNumber, gpuFrameTime );
+   }
+
+   frame->pending = GL_FALSE;
+}
+
+///
+// ReadBack()
+//
+//    Resolve every frame whose queries are done, oldest first
+//
+static void ReadBack ( ESProfiler *profiler, ESContext *esContext )
+{
+   GLboolean waiting = GL_FALSE;
+   GLint disjoint = 0;
+   int i;
+
+   // A disjoint event (clock change, context loss...) invalidates every
+   // query in flight
+   if ( profiler->timerQueries )
+   {
+      glGetIntegerv ( GL_GPU_DISJOINT_EXT, &disjoint );
+
+      if ( disjoint )
+      {
+         profiler->disjoints++;
+         SyncClocks ( profiler );
+      }
+   }
+
+   if ( profiler->timestamps && esGetTime ( ) - profiler->cpuSync >= PROFILER_SYNC_INTERVAL )
+   {
+      SyncClocks ( profiler );
+   }
+
+   // The current slot holds the oldest frame, which is about to be reused:
+   // if its queries are still not done it goes without GPU times
+   for ( i = 0; i < PROFILER_FRAMES; i++ )
+   {
+      ProfilerFrame *frame = &profiler->frames[( profiler->current + i ) % PROFILER_FRAMES];
+
+      if ( !frame->pending )
+      {
+         continue;
+      }
+
+      if ( disjoint )
+      {
+         ResolveFrame ( profiler, esContext, frame, GL_FALSE );
+      }
+      else if ( !waiting && QueriesAvailable ( frame ) )
+      {
+         ResolveFrame ( profiler, esContext, frame, GL_TRUE );
+      }
+      else if ( i == 0 )
+      {
+         ResolveFrame ( profiler, esContext, frame, GL_FALSE );
+      }
+      else
+      {
+         waiting = GL_TRUE;
+      }
+   }
+}
+
+///
+// WriteEscaped()
+//
+static void WriteEscaped ( FILE *file, const char *text )
+{
+   for ( ; *text != '\0'; text++ )
+   {
+      if ( *text == '"' || *text == '\\' )
+      {
+         fputc ( '\\', file );
+      }
+
+      if ( ( unsigned char ) *text >= ' ' )
+      {
+         fputc ( *text, file );
+      }
+   }
+}
+
+///
+//  ProfilerEndFrame()
+//
+//      Close the profiler frame of the main loop, called once the frame has
+//      been recorded in the frame history at index frameNumber
+//
+void ProfilerEndFrame ( ESContext *esContext, unsigned int frameNumber, const ESFrameTime *frameTime )
+{
+   ESProfiler *profiler = esContext->profiler;
+   ProfilerFrame *frame;
+   double end = esGetTime ( );
+
+   if ( profiler == NULL )
+   {
+      return;
+   }
+
+   // Scopes left open are closed at the end of the frame
+   while ( profiler->depth > 0 )
+   {
+      esProfilerEnd ( esContext );
+   }
+
+   frame = &profiler->frames[profiler->current];
+   frame->frameNumber = frameNumber;
+   frame->pending = GL_TRUE;
+
+   AddTraceEvent ( profiler, "Frame", 2, TRACE_CPU_THREAD, end - frameTime->total * 1e-3, frameTime->total * 1e-3 );
+   AddTraceEvent ( profiler, "Swap", 2, TRACE_CPU_THREAD, end - frameTime->swap * 1e-3, frameTime->swap * 1e-3 );
+
+   profiler->current = ( profiler->current + 1 ) % PROFILER_FRAMES;
+   ReadBack ( profiler, esContext );
+
+   frame = &profiler->frames[profiler->current];
+   frame->numSamples = 0;
+   frame->numQueries = 0;
+   frame->lastQuery = 0;
+}
+
+///
+//  ProfilerShutdown()
+//
+//      Write the trace, log the scopes and release the profiler
+//
+void ProfilerShutdown ( ESContext *esContext )
+{
+   ESProfiler *profiler = esContext->profiler;
+   int i;
+
+   if ( profiler == NULL )
+   {
+      return;
+   }
+
+   // Whatever is still in flight is waited for
+   glFinish ( );
+   ReadBack ( profiler, esContext );
+
+   if ( profiler->traceFile != NULL )
+   {
+      esProfilerWriteTrace ( esContext, profiler->traceFile );
+   }
+
+   for ( i = 0; i < profiler->numScopes; i++ )
+   {
+      const ESProfilerScope *scope = &profiler->scopes[i];
+
+      if ( scope->gpuCount > 0 )
+      {
+         esLogMessage ( "%*s%s: CPU %.3f ms, GPU %.3f ms\n", scope->depth * 2, "", scope->name,
+                        scope->cpuAverage, scope->gpuAverage );
+      }
+      else
+      {
+         esLogMessage ( "%*s%s: CPU %.3f ms\n", scope->depth * 2, "", scope->name, scope->cpuAverage );
+      }
+   }
+
+   if ( profiler->disjoints > 0 )
+   {
+      esLogMessage ( "esProfiler: %d disjoint GPU timer events, GPU times around them were dropped\n",
+                     profiler->disjoints );
+   }
+
+   for ( i = 0; i < PROFILER_FRAMES; i++ )
+   {
+      glDeleteQueries ( PROFILER_MAX_SAMPLES * 2, profiler->frames[i].queries );
+   }
+
+   free ( profiler->trace );
+   free ( profiler->traceFile );
+   free ( profiler );
+   esContext->profiler = NULL;
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+//
+///
+/// \brief Start profiling scopes, optionally writing a trace at exit
+//
+GLboolean ESUTIL_API esProfilerEnable ( ESContext *esContext, const char *traceFile )
+{
+   ESProfiler *profiler = esContext->profiler;
+   const char *extensions;
+   int i;
+
+   if ( profiler == NULL )
+   {
+      profiler = calloc ( 1, sizeof ( ESProfiler ) );
+
+      if ( profiler == NULL )
+      {
+         return GL_FALSE;
+      }
+
+      extensions = ( const char * ) glGetString ( GL_EXTENSIONS );
+
+#ifndef __APPLE__
+      if ( extensions != NULL && strstr ( extensions, "GL_EXT_disjoint_timer_query" ) != NULL )
+      {
+         profiler->queryCounter = ( QueryCounterFunc ) eglGetProcAddress ( "glQueryCounterEXT" );
+         profiler->getQueryObjectui64v = ( GetQueryObjectui64vFunc ) eglGetProcAddress ( "glGetQueryObjectui64vEXT" );
+      }
+#endif
+
+      profiler->timerQueries = profiler->getQueryObjectui64v != NULL ? GL_TRUE : GL_FALSE;
+
+      if ( profiler->timerQueries && profiler->queryCounter != NULL )
+      {
+         GLint bits = 0;
+
+         glGetQueryiv ( GL_TIMESTAMP_EXT, GL_QUERY_COUNTER_BITS_EXT, &bits );
+         profiler->timestamps = bits > 0 ? GL_TRUE : GL_FALSE;
+      }
+
+      // Clear the disjoint flag and any error from probing the extension
+      if ( profiler->timerQueries )
+      {
+         GLint disjoint;
+
+         glGetIntegerv ( GL_GPU_DISJOINT_EXT, &disjoint );
+
+         for ( i = 0; i < PROFILER_FRAMES; i++ )
+         {
+            glGenQueries ( PROFILER_MAX_SAMPLES * 2, profiler->frames[i].queries );
+         }
+      }
+
+      while ( glGetError ( ) != GL_NO_ERROR )
+         ;
+
+      SyncClocks ( profiler );
+      esContext->profiler = profiler;
+   }
+
+   free ( profiler->traceFile );
+   profiler->traceFile = NULL;
+
+   if ( traceFile != NULL )
+   {
+      if ( profiler->trace == NULL )
+      {
+         profiler->trace = malloc ( PROFILER_TRACE_EVENTS * sizeof ( TraceEvent ) );
+      }
+
+      profiler->traceFile = malloc ( strlen ( traceFile ) + 1 );
+
+      if ( profiler->trace == NULL || profiler->traceFile == NULL )
+      {
+         return GL_FALSE;
+      }
+
+      strcpy ( profiler->traceFile, traceFile );
+   }
+
+   return GL_TRUE;
+}
+
+//
+///
+/// \brief Open a named scope
+//
+void ESUTIL_API esProfilerBegin ( ESContext *esContext, const char *name )
+{
+   ESProfiler *profiler = esContext->profiler;
+   ProfilerFrame *frame;
+   ProfilerSample *sample;
+
+   if ( profiler == NULL || profiler->depth == PROFILER_MAX_DEPTH )
+   {
+      return;
+   }
+
+   frame = &profiler->frames[profiler->current];
+
+   if ( frame->numSamples == PROFILER_MAX_SAMPLES )
+   {
+      profiler->stack[profiler->depth++] = -1;
+      return;
+   }
+
+   sample = &frame->samples[frame->numSamples];
+   sample->name = name;
+   sample->depth = profiler->depth;
+   sample->beginQuery = 0;
+   sample->endQuery = 0;
+
+   if ( profiler->timestamps )
+   {
+      sample->beginQuery = frame->queries[frame->numQueries++];
+      sample->endQuery = frame->queries[frame->numQueries++];
+      profiler->queryCounter ( sample->beginQuery, GL_TIMESTAMP_EXT );
+   }
+   else if ( profiler->timerQueries && !profiler->elapsedActive )
+   {
+      sample->beginQuery = frame->queries[frame->numQueries++];
+      glBeginQuery ( GL_TIME_ELAPSED_EXT, sample->beginQuery );
+      profiler->elapsedActive = GL_TRUE;
+   }
+
+   profiler->stack[profiler->depth++] = frame->numSamples++;
+   sample->cpuBegin = esGetTime ( );
+}
+
+//
+///
+/// \brief Close the scope opened last
+//
+void ESUTIL_API esProfilerEnd ( ESContext *esContext )
+{
+   ESProfiler *profiler = esContext->profiler;
+   ProfilerSample *sample;
+   int index;
+
+   if ( profiler == NULL || profiler->depth == 0 )
+   {
+      return;
+   }
+
+   index = profiler->stack[--profiler->depth];
+
+   if ( index < 0 )
+   {
+      return;
+   }
+
+   sample = &profiler->frames[profiler->current].samples[index];
+   sample->cpuEnd = esGetTime ( );
+
+   if ( profiler->timestamps )
+   {
+      profiler->queryCounter ( sample->endQuery, GL_TIMESTAMP_EXT );
+      profiler->frames[profiler->current].lastQuery = sample->endQuery;
+   }
+   else if ( sample->beginQuery != 0 )
+   {
+      glEndQuery ( GL_TIME_ELAPSED_EXT );
+      profiler->elapsedActive = GL_FALSE;
+      profiler->frames[profiler->current].lastQuery = sample->beginQuery;
+   }
+}
+
+//
+///
+/// \brief Look up the timing of a scope
+//
+GLboolean ESUTIL_API esProfilerGetScope ( ESContext *esContext, const char *name, ESProfilerScope *scope )
+{
+   ESProfiler *profiler = esContext->profiler;
+   int i;
+
+   for ( i = 0; profiler != NULL && i < profiler->numScopes; i++ )
+   {
+      if ( strcmp ( profiler->scopes[i].name, name ) == 0 )
+      {
+         *scope = profiler->scopes[i];
+         return GL_TRUE;
+      }
+   }
+
+   return GL_FALSE;
+}
+
+//
+///
+/// \brief Write the recorded scopes and frames as a Chrome trace
+//
+GLboolean ESUTIL_API esProfilerWriteTrace ( ESContext *esContext, const char *fileName )
+{
+   ESProfiler *profiler = esContext->profiler;
+   unsigned int first, i;
+   FILE *file;
+
+   if ( profiler == NULL || profiler->trace == NULL )
+   {
+      return GL_FALSE;
+   }
+
+   file = fopen ( fileName, "w" );
+
+   if ( file == NULL )
+   {
+      esLogMessage ( "esProfilerWriteTrace: cannot open { %s }\n", fileName );
+      return GL_FALSE;
+   }
+
+   fprintf ( file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n" );
+   fprintf ( file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"CPU\"}},\n",
+             TRACE_CPU_THREAD );
+   fprintf ( file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"GPU\"}}",
+             TRACE_GPU_THREAD );
+
+   first = profiler->numTrace > PROFILER_TRACE_EVENTS ? profiler->numTrace - PROFILER_TRACE_EVENTS : 0;
+
+   for ( i = first; i != profiler->numTrace; i++ )
+   {
+      const TraceEvent *event = &profiler->trace[i % PROFILER_TRACE_EVENTS];
+
+      fprintf ( file, ",\n{\"name\":\"" );
+      WriteEscaped ( file, event->name );
+      fprintf ( file, "\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                traceCategories[event->cat], event->thread, event->begin * 1e6, event->duration * 1e6 );
+   }
+
+   fprintf ( file, "\n]}\n" );
+   fclose ( file );
+
+   return GL_TRUE;
+}
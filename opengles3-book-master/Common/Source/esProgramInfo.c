@@ -0,0 +1,833 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// ESProgramInfo.c
+//
+//    Reflection of linked programs.  The active uniforms, uniform blocks,
+//    attributes and transform feedback varyings are queried once, into a
+//    flat table searched through an open-addressing hash of their names.
+//    Uniform blocks are given binding points in the order they are listed.
+//    The program binary cache stores the table next to the binary (see
+//    esShader.c), so a program loaded from it is described without
+//    querying the GL.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include "esUtil_win.h"
+#include <stdlib.h>
+#include <string.h>
+
+///
+//  Macros
+//
+#define PROGRAM_INFO_KINDS    4
+
+///
+//  Types
+//
+struct ESProgramInfo
+{
+   GLuint             program;
+
+   // Variables of each kind, in order of kind then index
+   int                numVariables;
+   int                first[PROGRAM_INFO_KINDS + 1];
+   ESProgramVariable *variables;
+
+   // Power of two slots holding variable index + 1, 0 when empty
+   int                numSlots;
+   int               *slots;
+
+   // Names, each NUL terminated
+   char              *names;
+   int                namesSize;
+};
+
+// Variable as stored by ProgramInfoSerialize, with the name as an offset
+typedef struct
+{
+   GLint    nameOffset;
+   GLint    values[10];
+} ProgramInfoRecord;
+
+// Building table
+typedef struct
+{
+   ESProgramVariable *variables;
+   int                numVariables;
+   int                maxVariables;
+   char              *names;
+   int                namesSize;
+   int                maxNames;
+} ProgramInfoBuilder;
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// HashName()
+//
+//    32-bit FNV-1a
+//
+static GLuint HashName ( const char *name )
+{
+   const unsigned char *p = ( const unsigned char * ) name;
+   GLuint hash = 2166136261u;
+
+   while ( *p != 0 )
+   {
+      hash ^= *p++;
+      hash *= 16777619u;
+   }
+
+   return hash;
+}
+
+///
+// Slot()
+//
+//    First slot to probe for a name of a kind
+//
+static int Slot ( const ESProgramInfo *info, GLuint hash, GLenum kind )
+{
+   return ( int ) ( ( hash ^ ( kind * 0x9E3779B9u ) ) & ( GLuint ) ( info->numSlots - 1 ) );
+}
+
+///
+// AddVariable()
+//
+//    Append a variable named name to the table being built, NULL when out of memory
+//
+static ESProgramVariable *AddVariable ( ProgramInfoBuilder *builder, GLenum kind, const char *name )
+{
+   ESProgramVariable *variable;
+   size_t length = strlen ( name );
+
+   // GL names arrays of basic types after their first element
+   if ( length > 3 && strcmp ( name + length - 3, "[0]" ) == 0 )
+   {
+      length -= 3;
+   }
+
+   if ( builder->numVariables == builder->maxVariables )
+   {
+      int maxVariables = builder->maxVariables > 0 ? builder->maxVariables * 2 : 16;
+      ESProgramVariable *variables = realloc ( builder->variables, maxVariables * sizeof ( ESProgramVariable ) );
+
+      if ( variables == NULL )
+      {
+         return NULL;
+      }
+
+      builder->variables = variables;
+      builder->maxVariables = maxVariables;
+   }
+
+   if ( builder->namesSize + ( int ) length + 1 > builder->maxNames )
+   {
+      int maxNames = ( builder->maxNames > 0 ? builder->maxNames * 2 : 256 ) + ( int ) length + 1;
+      char *names = realloc ( builder->names, maxNames );
+
+      if ( names == NULL )
+      {
+         return NULL;
+      }
+
+      builder->names = names;
+      builder->maxNames = maxNames;
+   }
+
+   variable = &builder->variables[builder->numVariables++];
+   memset ( variable, 0, sizeof ( ESProgramVariable ) );
+   variable->kind = kind;
+   variable->location = -1;
+   variable->block = -1;
+   variable->offset = -1;
+   variable->arrayStride = -1;
+   variable->matrixStride = -1;
+   variable->dataSize = -1;
+   variable->binding = -1;
+
+   // Names are pointed at once the table is complete, the offset stands in until then
+   variable->name = ( const char * ) ( size_t ) builder->namesSize;
+   memcpy ( builder->names + builder->namesSize, name, length );
+   builder->names[builder->namesSize + length] = '\0';
+   builder->namesSize += ( int ) length + 1;
+
+   return variable;
+}
+
+///
+// CreateInfo()
+//
+//    Copy the variables, ordered by kind, and their names into one block,
+//    with the names given as offsets, and hash them
+//
+static ESProgramInfo *CreateInfo ( GLuint program, const ESProgramVariable *variables, int numVariables,
+                                   const char *names, int namesSize )
+{
+   ESProgramInfo *info;
+   int numSlots = 8;
+   size_t size;
+   int kind;
+   int i;
+   int n = 0;
+
+   while ( numSlots < numVariables * 2 )
+   {
+      numSlots *= 2;
+   }
+
+   size = sizeof ( ESProgramInfo ) + numVariables * sizeof ( ESProgramVariable ) + numSlots * sizeof ( int ) + namesSize;
+   info = calloc ( 1, size );
+
+   if ( info == NULL )
+   {
+      return NULL;
+   }
+
+   info->program = program;
+   info->numVariables = numVariables;
+   info->variables = ( ESProgramVariable * ) ( info + 1 );
+   info->numSlots = numSlots;
+   info->slots = ( int * ) ( info->variables + numVariables );
+   info->names = ( char * ) ( info->slots + numSlots );
+   info->namesSize = namesSize;
+   memcpy ( info->names, names, namesSize );
+
+   for ( kind = 0; kind < PROGRAM_INFO_KINDS; kind++ )
+   {
+      info->first[kind] = n;
+
+      for ( i = 0; i < numVariables; i++ )
+      {
+         if ( variables[i].kind == ( GLenum ) kind )
+         {
+            info->variables[n++] = variables[i];
+         }
+      }
+   }
+
+   info->first[PROGRAM_INFO_KINDS] = n;
+   info->numVariables = n;
+
+   for ( i = 0; i < n; i++ )
+   {
+      ESProgramVariable *variable = &info->variables[i];
+      size_t offset = ( size_t ) variable->name;
+      int slot;
+
+      if ( offset >= ( size_t ) namesSize || memchr ( info->names + offset, '\0', namesSize - offset ) == NULL )
+      {
+         free ( info );
+         return NULL;
+      }
+
+      variable->name = info->names + offset;
+      variable->hash = HashName ( variable->name );
+
+      slot = Slot ( info, variable->hash, variable->kind );
+
+      while ( info->slots[slot] != 0 )
+      {
+         slot = ( slot + 1 ) & ( numSlots - 1 );
+      }
+
+      info->slots[slot] = i + 1;
+   }
+
+   return info;
+}
+
+///
+// ReflectUniforms()
+//
+static GLboolean ReflectUniforms ( ProgramInfoBuilder *builder, GLuint program )
+{
+   GLint count = 0;
+   GLint maxLength = 0;
+   GLuint *indices;
+   GLint *values;
+   char *name;
+   GLboolean ok = GL_TRUE;
+   int first = builder->numVariables;
+   int i;
+   static const GLenum params[4] =
+   {
+      GL_UNIFORM_BLOCK_INDEX, GL_UNIFORM_OFFSET, GL_UNIFORM_ARRAY_STRIDE, GL_UNIFORM_MATRIX_STRIDE
+   };
+
+   glGetProgramiv ( program, GL_ACTIVE_UNIFORMS, &count );
+   glGetProgramiv ( program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength );
+
+   if ( count <= 0 )
+   {
+      return GL_TRUE;
+   }
+
+   indices = malloc ( count * sizeof ( GLuint ) );
+   values = malloc ( count * 4 * sizeof ( GLint ) );
+   name = malloc ( maxLength + 1 );
+
+   if ( indices == NULL || values == NULL || name == NULL )
+   {
+      ok = GL_FALSE;
+      count = 0;
+   }
+
+   for ( i = 0; i < count; i++ )
+   {
+      indices[i] = i;
+   }
+
+   // The block layout of all uniforms in one query per parameter
+   for ( i = 0; i < 4 && count > 0; i++ )
+   {
+      glGetActiveUniformsiv ( program, count, indices, params[i], values + i * count );
+   }
+
+   for ( i = 0; i < count && ok; i++ )
+   {
+      ESProgramVariable *variable;
+      GLint size = 0;
+      GLenum type = 0;
+
+      name[0] = '\0';
+      glGetActiveUniform ( program, i, maxLength + 1, NULL, &size, &type, name );
+      variable = AddVariable ( builder, ES_PROGRAM_UNIFORM, name );
+
+      if ( variable == NULL )
+      {
+         ok = GL_FALSE;
+         break;
+      }
+
+      variable->type = type;
+      variable->size = size;
+      variable->block = values[i];
+
+      if ( variable->block < 0 )
+      {
+         variable->location = glGetUniformLocation ( program, name );
+      }
+      else
+      {
+         variable->offset = values[count + i];
+         variable->arrayStride = values[2 * count + i];
+         variable->matrixStride = values[3 * count + i];
+      }
+   }
+
+   free ( indices );
+   free ( values );
+   free ( name );
+
+   return ok && builder->numVariables - first == count ? GL_TRUE : GL_FALSE;
+}
+
+///
+// ReflectUniformBlocks()
+//
+static GLboolean ReflectUniformBlocks ( ProgramInfoBuilder *builder, GLuint program )
+{
+   GLint count = 0;
+   GLint maxLength = 0;
+   char *name;
+   int i;
+
+   glGetProgramiv ( program, GL_ACTIVE_UNIFORM_BLOCKS, &count );
+   glGetProgramiv ( program, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxLength );
+
+   if ( count <= 0 )
+   {
+      return GL_TRUE;
+   }
+
+   name = malloc ( maxLength + 1 );
+
+   if ( name == NULL )
+   {
+      return GL_FALSE;
+   }
+
+   for ( i = 0; i < count; i++ )
+   {
+      ESProgramVariable *variable;
+
+      name[0] = '\0';
+      glGetActiveUniformBlockName ( program, i, maxLength + 1, NULL, name );
+      variable = AddVariable ( builder, ES_PROGRAM_UNIFORM_BLOCK, name );
+
+      if ( variable == NULL )
+      {
+         free ( name );
+         return GL_FALSE;
+      }
+
+      variable->location = i;
+      variable->binding = i;
+      variable->size = 1;
+      glGetActiveUniformBlockiv ( program, i, GL_UNIFORM_BLOCK_DATA_SIZE, &variable->dataSize );
+   }
+
+   free ( name );
+
+   return GL_TRUE;
+}
+
+///
+// ReflectAttribs()
+//
+static GLboolean ReflectAttribs ( ProgramInfoBuilder *builder, GLuint program )
+{
+   GLint count = 0;
+   GLint maxLength = 0;
+   char *name;
+   int i;
+
+   glGetProgramiv ( program, GL_ACTIVE_ATTRIBUTES, &count );
+   glGetProgramiv ( program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxLength );
+
+   if ( count <= 0 )
+   {
+      return GL_TRUE;
+   }
+
+   name = malloc ( maxLength + 1 );
+
+   if ( name == NULL )
+   {
+      return GL_FALSE;
+   }
+
+   for ( i = 0; i < count; i++ )
+   {
+      ESProgramVariable *variable;
+      GLint size = 0;
+      GLenum type = 0;
+
+      name[0] = '\0';
+      glGetActiveAttrib ( program, i, maxLength + 1, NULL, &size, &type, name );
+      variable = AddVariable ( builder, ES_PROGRAM_ATTRIB, name );
+
+      if ( variable == NULL )
+      {
+         free ( name );
+         return GL_FALSE;
+      }
+
+      variable->type = type;
+      variable->size = size;
+      variable->location = glGetAttribLocation ( program, name );
+   }
+
+   free ( name );
+
+   return GL_TRUE;
+}
+
+///
+// ReflectVaryings()
+//
+static GLboolean ReflectVaryings ( ProgramInfoBuilder *builder, GLuint program )
+{
+   GLint count = 0;
+   GLint maxLength = 0;
+   char *name;
+   int i;
+
+   glGetProgramiv ( program, GL_TRANSFORM_FEEDBACK_VARYINGS, &count );
+   glGetProgramiv ( program, GL_TRANSFORM_FEEDBACK_VARYING_MAX_LENGTH, &maxLength );
+
+   if ( count <= 0 )
+   {
+      return GL_TRUE;
+   }
+
+   name = malloc ( maxLength + 1 );
+
+   if ( name == NULL )
+   {
+      return GL_FALSE;
+   }
+
+   for ( i = 0; i < count; i++ )
+   {
+      ESProgramVariable *variable;
+      GLsizei size = 0;
+      GLenum type = 0;
+
+      name[0] = '\0';
+      glGetTransformFeedbackVarying ( program, i, maxLength + 1, NULL, &size, &type, name );
+      variable = AddVariable ( builder, ES_PROGRAM_VARYING, name );
+
+      if ( variable == NULL )
+      {
+         free ( name );
+         return GL_FALSE;
+      }
+
+      variable->type = type;
+      variable->size = size;
+      variable->location = i;
+   }
+
+   free ( name );
+
+   return GL_TRUE;
+}
+
+///
+//  ProgramInfoSerialize()
+//
+//      Flatten a program info into a new buffer of length bytes, freed with free()
+//
+void *ProgramInfoSerialize ( const ESProgramInfo *info, GLint *length )
+{
+   GLint *data;
+   ProgramInfoRecord *records;
+   int i;
+
+   *length = ( GLint ) ( 2 * sizeof ( GLint ) + info->numVariables * sizeof ( ProgramInfoRecord ) + info->namesSize );
+   data = malloc ( *length );
+
+   if ( data == NULL )
+   {
+      return NULL;
+   }
+
+   data[0] = info->numVariables;
+   data[1] = info->namesSize;
+   records = ( ProgramInfoRecord * ) ( data + 2 );
+
+   for ( i = 0; i < info->numVariables; i++ )
+   {
+      const ESProgramVariable *variable = &info->variables[i];
+      GLint *values = records[i].values;
+
+      records[i].nameOffset = ( GLint ) ( variable->name - info->names );
+      values[0] = ( GLint ) variable->kind;
+      values[1] = ( GLint ) variable->type;
+      values[2] = variable->size;
+      values[3] = variable->location;
+      values[4] = variable->block;
+      values[5] = variable->offset;
+      values[6] = variable->arrayStride;
+      values[7] = variable->matrixStride;
+      values[8] = variable->dataSize;
+      values[9] = variable->binding;
+   }
+
+   memcpy ( records + info->numVariables, info->names, info->namesSize );
+
+   return data;
+}
+
+///
+//  ProgramInfoDeserialize()
+//
+//      Rebuild the info of program from ProgramInfoSerialize output, NULL if
+//      it is not valid
+//
+ESProgramInfo *ProgramInfoDeserialize ( GLuint program, const void *data, GLint length )
+{
+   const GLint *header = data;
+   const ProgramInfoRecord *records;
+   ESProgramVariable *variables;
+   ESProgramInfo *info;
+   int numVariables;
+   int namesSize;
+   int i;
+
+   if ( length < ( GLint ) ( 2 * sizeof ( GLint ) ) )
+   {
+      return NULL;
+   }
+
+   numVariables = header[0];
+   namesSize = header[1];
+
+   if ( numVariables < 0 || namesSize < 0 || numVariables > length || namesSize > length ||
+         ( size_t ) length != 2 * sizeof ( GLint ) + numVariables * sizeof ( ProgramInfoRecord ) + namesSize )
+   {
+      return NULL;
+   }
+
+   records = ( const ProgramInfoRecord * ) ( header + 2 );
+   variables = malloc ( ( numVariables > 0 ? numVariables : 1 ) * sizeof ( ESProgramVariable ) );
+
+   if ( variables == NULL )
+   {
+      return NULL;
+   }
+
+   for ( i = 0; i < numVariables; i++ )
+   {
+      const GLint *values = records[i].values;
+
+      if ( values[0] < 0 || values[0] >= PROGRAM_INFO_KINDS || records[i].nameOffset < 0 )
+      {
+         free ( variables );
+         return NULL;
+      }
+
+      variables[i].name = ( const char * ) ( size_t ) records[i].nameOffset;
+      variables[i].kind = ( GLenum ) values[0];
+      variables[i].type = ( GLenum ) values[1];
+      variables[i].size = values[2];
+      variables[i].location = values[3];
+      variables[i].block = values[4];
+      variables[i].offset = values[5];
+      variables[i].arrayStride = values[6];
+      variables[i].matrixStride = values[7];
+      variables[i].dataSize = values[8];
+      variables[i].binding = values[9];
+   }
+
+   info = CreateInfo ( program, variables, numVariables, ( const char * ) ( records + numVariables ), namesSize );
+   free ( variables );
+
+   return info;
+}
+
+///
+//  ProgramInfoReflect()
+//
+//      Query the variables of a linked program, without binding its uniform blocks
+//
+ESProgramInfo *ProgramInfoReflect ( GLuint program )
+{
+   ProgramInfoBuilder builder;
+   ESProgramInfo *info = NULL;
+
+   memset ( &builder, 0, sizeof ( builder ) );
+
+   if ( ReflectUniforms ( &builder, program ) && ReflectUniformBlocks ( &builder, program ) &&
+         ReflectAttribs ( &builder, program ) && ReflectVaryings ( &builder, program ) )
+   {
+      info = CreateInfo ( program, builder.variables, builder.numVariables, builder.names, builder.namesSize );
+   }
+
+   free ( builder.variables );
+   free ( builder.names );
+
+   if ( info == NULL )
+   {
+      esLogError ( "esProgramReflect: out of memory\n" );
+   }
+
+   return info;
+}
+
+///
+//  ProgramInfoBind()
+//
+//      Bind every uniform block to the binding point in the table, which a
+//      program binary does not keep
+//
+void ProgramInfoBind ( const ESProgramInfo *info )
+{
+   int i;
+
+   for ( i = info->first[ES_PROGRAM_UNIFORM_BLOCK]; i < info->first[ES_PROGRAM_UNIFORM_BLOCK + 1]; i++ )
+   {
+      glUniformBlockBinding ( info->program, info->variables[i].location, info->variables[i].binding );
+   }
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+//
+///
+/// \brief Query the active variables of a linked program into a new table
+//
+ESProgramInfo *ESUTIL_API esProgramReflect ( GLuint programObject )
+{
+   ESProgramInfo *info;
+
+   if ( programObject == 0 )
+   {
+      return NULL;
+   }
+
+   info = ProgramInfoReflect ( programObject );
+
+   if ( info != NULL )
+   {
+      ProgramInfoBind ( info );
+   }
+
+   return info;
+}
+
+//
+///
+/// \brief Return the program object a table describes
+//
+GLuint ESUTIL_API esProgramInfoProgram ( const ESProgramInfo *info )
+{
+   return info != NULL ? info->program : 0;
+}
+
+//
+///
+/// \brief Find an active variable of a kind by name
+//
+const ESProgramVariable *ESUTIL_API esProgramFind ( const ESProgramInfo *info, GLenum kind, const char *name )
+{
+   char baseName[256];
+   size_t length;
+   GLuint hash;
+   int slot;
+
+   if ( info == NULL || name == NULL )
+   {
+      return NULL;
+   }
+
+   hash = HashName ( name );
+
+   for ( slot = Slot ( info, hash, kind ); info->slots[slot] != 0; slot = ( slot + 1 ) & ( info->numSlots - 1 ) )
+   {
+      const ESProgramVariable *variable = &info->variables[info->slots[slot] - 1];
+
+      if ( variable->hash == hash && variable->kind == kind && strcmp ( variable->name, name ) == 0 )
+      {
+         return variable;
+      }
+   }
+
+   // Arrays are stored without the [0] the GL lists them with
+   length = strlen ( name );
+
+   if ( length > 3 && length < sizeof ( baseName ) && strcmp ( name + length - 3, "[0]" ) == 0 )
+   {
+      memcpy ( baseName, name, length - 3 );
+      baseName[length - 3] = '\0';
+      return esProgramFind ( info, kind, baseName );
+   }
+
+   return NULL;
+}
+
+//
+///
+/// \brief Find an active uniform by name
+//
+const ESProgramVariable *ESUTIL_API esProgramUniform ( const ESProgramInfo *info, const char *name )
+{
+   return esProgramFind ( info, ES_PROGRAM_UNIFORM, name );
+}
+
+//
+///
+/// \brief Find an active uniform block by name
+//
+const ESProgramVariable *ESUTIL_API esProgramUniformBlock ( const ESProgramInfo *info, const char *name )
+{
+   return esProgramFind ( info, ES_PROGRAM_UNIFORM_BLOCK, name );
+}
+
+//
+///
+/// \brief Find an active attribute by name
+//
+const ESProgramVariable *ESUTIL_API esProgramAttrib ( const ESProgramInfo *info, const char *name )
+{
+   return esProgramFind ( info, ES_PROGRAM_ATTRIB, name );
+}
+
+//
+///
+/// \brief Find a transform feedback varying by name
+//
+const ESProgramVariable *ESUTIL_API esProgramVarying ( const ESProgramInfo *info, const char *name )
+{
+   return esProgramFind ( info, ES_PROGRAM_VARYING, name );
+}
+
+//
+///
+/// \brief Location of a uniform outside any block, -1 if it is not active
+//
+GLint ESUTIL_API esProgramUniformLocation ( const ESProgramInfo *info, const char *name )
+{
+   const ESProgramVariable *variable = esProgramFind ( info, ES_PROGRAM_UNIFORM, name );
+
+   return variable != NULL ? variable->location : -1;
+}
+
+//
+///
+/// \brief Number of variables of a kind
+//
+int ESUTIL_API esProgramCount ( const ESProgramInfo *info, GLenum kind )
+{
+   if ( info == NULL || kind >= PROGRAM_INFO_KINDS )
+   {
+      return 0;
+   }
+
+   return info->first[kind + 1] - info->first[kind];
+}
+
+//
+///
+/// \brief Variable of a kind by index, in the order the GL lists them
+//
+const ESProgramVariable *ESUTIL_API esProgramGet ( const ESProgramInfo *info, GLenum kind, int index )
+{
+   if ( index < 0 || index >= esProgramCount ( info, kind ) )
+   {
+      return NULL;
+   }
+
+   return &info->variables[info->first[kind] + index];
+}
+
+//
+///
+/// \brief Free a table, the program is left alone
+//
+void ESUTIL_API esProgramInfoFree ( ESProgramInfo *info )
+{
+   free ( info );
+}
@@ -38,7 +38,50 @@
 //  Includes
 //
 #include "esUtil.h"
+#include "esUtil_win.h"
 #include <stdlib.h>
+#include <string.h>
+
+///
+//  Macros
+//
+#define PROGRAM_CACHE_VERSION   3
+
+// KHR_parallel_shader_compile query, missing from older headers
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR  0x91B1
+#endif
+
+///
+//  Types
+//
+
+// Program whose compile and link have been issued but not checked
+struct ESAsyncProgram
+{
+   GLuint             programObject;
+   GLuint             vertexShader;
+   GLuint             fragmentShader;
+   GLboolean          fromCache;
+   GLboolean          useCache;
+   unsigned long long cacheKey;
+   ESProgramInfo     *info;
+};
+
+// Start of the data of every program cache entry (see esCache.c), followed
+// by the binary and then the serialized reflection of the program (see
+// esProgramInfo.c)
+typedef struct
+{
+   GLuint   version;
+   GLenum   binaryFormat;
+   GLint    binaryLength;
+   GLint    infoLength;
+} ProgramCacheHeader;
+
+// KHR_parallel_shader_compile support, checked on first use
+static GLboolean s_parallelCompileChecked = GL_FALSE;
+static GLboolean s_parallelCompile = GL_FALSE;
 
 //////////////////////////////////////////////////////////////////
 //
@@ -46,7 +89,389 @@
 //
 //
 
+///
+// HashString()
+//
+//    Continue a cache key with str.  Includes the terminating NUL so that
+//    ("ab", "c") and ("a", "bc") hash differently.
+//
+static unsigned long long HashString ( unsigned long long hash, const char *str )
+{
+   str = str != NULL ? str : "";
+
+   return esAssetCacheKey ( hash, str, strlen ( str ) + 1 );
+}
+
+///
+// ProgramCacheKey()
+//
+//    Key a program by its sources and the driver that compiled it, since a
+//    binary is only valid for the exact renderer and driver version
+//
+static unsigned long long ProgramCacheKey ( const char *vertShaderSrc, const char *fragShaderSrc,
+                                            GLsizei numVaryings, const char *const *varyings,
+                                            GLenum bufferMode )
+{
+   unsigned long long hash = HashString ( 0, vertShaderSrc );
+   GLsizei i;
+
+   hash = HashString ( hash, fragShaderSrc );
+
+   // Transform feedback varyings change the linked program too
+   for ( i = 0; i < numVaryings; i++ )
+   {
+      hash = HashString ( hash, varyings[i] );
+   }
+
+   hash = esAssetCacheKey ( hash, &bufferMode, sizeof ( bufferMode ) );
+   hash = HashString ( hash, ( const char * ) glGetString ( GL_RENDERER ) );
+   hash = HashString ( hash, ( const char * ) glGetString ( GL_VERSION ) );
+
+   return hash;
+}
+
+///
+// ProgramCacheEnabled()
+//
+//    The cache is off unless esProgramCacheInit was called or the
+//    ES_PROGRAM_CACHE_DIR environment variable is set, and the driver must
+//    support at least one program binary format
+//
+static GLboolean ProgramCacheEnabled ( void )
+{
+   GLint numFormats = 0;
+
+   if ( !CacheEnabled ( CACHE_PROGRAMS ) )
+   {
+      return GL_FALSE;
+   }
+
+   glGetIntegerv ( GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats );
+
+   return numFormats > 0 ? GL_TRUE : GL_FALSE;
+}
+
+///
+// LoadCachedProgram()
+//
+//    Create a program from a cached binary, along with its reflection.
+//    Returns 0 if there is no cache entry or the driver rejects the binary.
+//    info is NULL if the entry holds no valid reflection.
+//
+static GLuint LoadCachedProgram ( unsigned long long key, ESProgramInfo **info )
+{
+   ProgramCacheHeader header;
+   ESMappedFile       file;
+   const GLubyte     *data;
+   size_t             size;
+   GLuint             programObject;
+   GLint              linked = 0;
+
+   *info = NULL;
+   data = ( const GLubyte * ) CacheMap ( CACHE_PROGRAMS, key, &file, &size );
+
+   if ( data == NULL )
+   {
+      return 0;
+   }
+
+   // The header is copied out, the mapping only guarantees 16-byte alignment
+   // of the data as a whole
+   if ( size < sizeof ( header ) )
+   {
+      esUnmapFile ( &file );
+      return 0;
+   }
+
+   memcpy ( &header, data, sizeof ( header ) );
+
+   if ( header.version != PROGRAM_CACHE_VERSION || header.binaryLength <= 0 || header.infoLength < 0 ||
+         size != sizeof ( header ) + ( size_t ) header.binaryLength + ( size_t ) header.infoLength )
+   {
+      esUnmapFile ( &file );
+      return 0;
+   }
+
+   // The binary goes to the driver straight from the mapping
+   programObject = glCreateProgram ( );
+   glProgramBinary ( programObject, header.binaryFormat, data + sizeof ( header ), header.binaryLength );
+   glGetProgramiv ( programObject, GL_LINK_STATUS, &linked );
+
+   // A driver update can invalidate the binary, recompile in that case
+   if ( !linked )
+   {
+      glDeleteProgram ( programObject );
+      programObject = 0;
+   }
+
+   // The reflection is reused as is, the binary came from the same sources
+   if ( programObject != 0 && header.infoLength > 0 )
+   {
+      *info = ProgramInfoDeserialize ( programObject, data + sizeof ( header ) + header.binaryLength,
+                                       header.infoLength );
+   }
+
+   esUnmapFile ( &file );
+
+   return programObject;
+}
+
+///
+// SaveCachedProgram()
+//
+//    Store the binary of a program, followed by its reflection if info is
+//    not NULL
+//
+static void SaveCachedProgram ( GLuint programObject, unsigned long long key, const ESProgramInfo *info )
+{
+   ProgramCacheHeader header;
+   GLubyte           *entry;
+   void              *infoData = NULL;
+   GLint              length = 0;
+
+   glGetProgramiv ( programObject, GL_PROGRAM_BINARY_LENGTH, &length );
+
+   if ( length <= 0 )
+   {
+      return;
+   }
+
+   header.version = PROGRAM_CACHE_VERSION;
+   header.infoLength = 0;
+
+   if ( info != NULL )
+   {
+      infoData = ProgramInfoSerialize ( info, &header.infoLength );
+
+      if ( infoData == NULL )
+      {
+         header.infoLength = 0;
+      }
+   }
+
+   // The binary is read straight into the entry, after the header
+   entry = ( GLubyte * ) malloc ( sizeof ( header ) + length + header.infoLength );
+
+   if ( entry != NULL )
+   {
+      glGetProgramBinary ( programObject, length, &header.binaryLength, &header.binaryFormat,
+                           entry + sizeof ( header ) );
+      memcpy ( entry, &header, sizeof ( header ) );
+
+      if ( header.infoLength > 0 )
+      {
+         memcpy ( entry + sizeof ( header ) + header.binaryLength, infoData, header.infoLength );
+      }
+
+      if ( header.binaryLength > 0 )
+      {
+         CacheStore ( CACHE_PROGRAMS, key, entry, sizeof ( header ) + header.binaryLength + header.infoLength );
+      }
+   }
+
+   free ( entry );
+   free ( infoData );
+}
+
+///
+// LogShaderError()
+//
+//    Print the info log of a shader that failed to compile
+//
+static void LogShaderError ( GLuint shader )
+{
+   GLint infoLen = 0;
+
+   glGetShaderiv ( shader, GL_INFO_LOG_LENGTH, &infoLen );
+
+   if ( infoLen > 1 )
+   {
+      char *infoLog = malloc ( sizeof ( char ) * infoLen );
+
+      glGetShaderInfoLog ( shader, infoLen, NULL, infoLog );
+      esLogMessage ( "Error compiling shader:\n%s\n", infoLog );
+
+      free ( infoLog );
+   }
+}
+
+///
+// LogProgramError()
+//
+//    Print the info log of a program that failed to link
+//
+static void LogProgramError ( GLuint programObject )
+{
+   GLint infoLen = 0;
+
+   glGetProgramiv ( programObject, GL_INFO_LOG_LENGTH, &infoLen );
+
+   if ( infoLen > 1 )
+   {
+      char *infoLog = malloc ( sizeof ( char ) * infoLen );
+
+      glGetProgramInfoLog ( programObject, infoLen, NULL, infoLog );
+      esLogMessage ( "Error linking program:\n%s\n", infoLog );
+
+      free ( infoLog );
+   }
+}
+
+///
+// EnableParallelCompile()
+//
+//    With KHR_parallel_shader_compile, let the driver use as many compiler
+//    threads as it likes and remember that GL_COMPLETION_STATUS_KHR can be
+//    queried without blocking
+//
+static void EnableParallelCompile ( void )
+{
+   const char *extensions;
+
+   if ( s_parallelCompileChecked )
+   {
+      return;
+   }
+
+   s_parallelCompileChecked = GL_TRUE;
+   extensions = ( const char * ) glGetString ( GL_EXTENSIONS );
+
+   if ( extensions != NULL && strstr ( extensions, "GL_KHR_parallel_shader_compile" ) )
+   {
+#ifndef __APPLE__
+      typedef void ( GL_APIENTRY *MaxShaderCompilerThreadsFunc ) ( GLuint count );
+      MaxShaderCompilerThreadsFunc maxShaderCompilerThreads =
+         ( MaxShaderCompilerThreadsFunc ) eglGetProcAddress ( "glMaxShaderCompilerThreadsKHR" );
+
+      if ( maxShaderCompilerThreads != NULL )
+      {
+         maxShaderCompilerThreads ( 0xFFFFFFFF );
+      }
+#endif
+      s_parallelCompile = GL_TRUE;
+   }
+}
+
+///
+// CreateShader()
+//
+//    Create a shader object and start compiling it, without waiting for the result
+//
+static GLuint CreateShader ( GLenum type, const char *shaderSrc )
+{
+   GLuint shader = glCreateShader ( type );
+
+   if ( shader != 0 )
+   {
+      glShaderSource ( shader, 1, &shaderSrc, NULL );
+      glCompileShader ( shader );
+   }
+
+   return shader;
+}
+
+///
+// WaitProgram()
+//
+//    Wait for an asynchronous program, check for errors and free the handle.
+//    If info is not NULL it returns the reflection of the program, taken
+//    from the cache entry when there is one.  Programs going into the cache
+//    are reflected either way, to be saved with their binary.
+//
+static GLuint WaitProgram ( ESAsyncProgram *program, ESProgramInfo **info )
+{
+   GLuint programObject;
+   GLint compiled;
+   GLint linked = GL_FALSE;
+   ESProgramInfo *reflected = NULL;
+
+   if ( program == NULL )
+   {
+      return 0;
+   }
+
+   programObject = program->programObject;
+
+   if ( program->fromCache )
+   {
+      if ( info != NULL )
+      {
+         *info = program->info != NULL ? program->info : ProgramInfoReflect ( programObject );
+      }
+      else
+      {
+         esProgramInfoFree ( program->info );
+      }
+
+      free ( program );
+      return programObject;
+   }
+
+   // Only now query status, which blocks until the driver is done
+   if ( program->vertexShader != 0 )
+   {
+      glGetShaderiv ( program->vertexShader, GL_COMPILE_STATUS, &compiled );
+
+      if ( !compiled )
+      {
+         LogShaderError ( program->vertexShader );
+      }
+   }
+
+   if ( program->fragmentShader != 0 )
+   {
+      glGetShaderiv ( program->fragmentShader, GL_COMPILE_STATUS, &compiled );
+
+      if ( !compiled )
+      {
+         LogShaderError ( program->fragmentShader );
+      }
+   }
+
+   if ( programObject != 0 )
+   {
+      glGetProgramiv ( programObject, GL_LINK_STATUS, &linked );
+   }
+
+   // Free up no longer needed shader resources
+   glDeleteShader ( program->vertexShader );
+   glDeleteShader ( program->fragmentShader );
+
+   if ( !linked )
+   {
+      if ( programObject != 0 )
+      {
+         LogProgramError ( programObject );
+         glDeleteProgram ( programObject );
+      }
+
+      free ( program );
+      return 0;
+   }
+
+   if ( program->useCache || info != NULL )
+   {
+      reflected = ProgramInfoReflect ( programObject );
+   }
+
+   if ( program->useCache )
+   {
+      SaveCachedProgram ( programObject, program->cacheKey, reflected );
+   }
+
+   if ( info != NULL )
+   {
+      *info = reflected;
+   }
+   else
+   {
+      esProgramInfoFree ( reflected );
+   }
+
+   free ( program );
 
+   return programObject;
+}
 
 //////////////////////////////////////////////////////////////////
 //
@@ -85,20 +510,7 @@ GLuint ESUTIL_API esLoadShader ( GLenum type, const char *shaderSrc )
 
    if ( !compiled )
    {
-      GLint infoLen = 0;
-
-      glGetShaderiv ( shader, GL_INFO_LOG_LENGTH, &infoLen );
-
-      if ( infoLen > 1 )
-      {
-         char *infoLog = malloc ( sizeof ( char ) * infoLen );
-
-         glGetShaderInfoLog ( shader, infoLen, NULL, infoLog );
-         esLogMessage ( "Error compiling shader:\n%s\n", infoLog );
-
-         free ( infoLog );
-      }
-
+      LogShaderError ( shader );
       glDeleteShader ( shader );
       return 0;
    }
@@ -118,67 +530,145 @@ GLuint ESUTIL_API esLoadShader ( GLenum type, const char *shaderSrc )
 //
 GLuint ESUTIL_API esLoadProgram ( const char *vertShaderSrc, const char *fragShaderSrc )
 {
-   GLuint vertexShader;
-   GLuint fragmentShader;
-   GLuint programObject;
-   GLint linked;
+   return esProgramWait ( esLoadProgramAsync ( vertShaderSrc, fragShaderSrc ) );
+}
+
+//
+///
+/// \brief Start compiling and linking a program without waiting for the result
+//
+ESAsyncProgram *ESUTIL_API esLoadProgramAsync ( const char *vertShaderSrc, const char *fragShaderSrc )
+{
+   return esLoadProgramFeedbackAsync ( vertShaderSrc, fragShaderSrc, 0, NULL, GL_INTERLEAVED_ATTRIBS );
+}
 
-   // Load the vertex/fragment shaders
-   vertexShader = esLoadShader ( GL_VERTEX_SHADER, vertShaderSrc );
+//
+///
+/// \brief Start compiling and linking a program with transform feedback varyings
+//
+ESAsyncProgram *ESUTIL_API esLoadProgramFeedbackAsync ( const char *vertShaderSrc, const char *fragShaderSrc,
+                                                        GLsizei numVaryings, const char *const *varyings,
+                                                        GLenum bufferMode )
+{
+   ESAsyncProgram *program = ( ESAsyncProgram * ) calloc ( 1, sizeof ( ESAsyncProgram ) );
 
-   if ( vertexShader == 0 )
+   if ( program == NULL )
    {
-      return 0;
+      return NULL;
    }
 
-   fragmentShader = esLoadShader ( GL_FRAGMENT_SHADER, fragShaderSrc );
+   // Try the binary from a previous run first
+   program->useCache = ProgramCacheEnabled ( );
 
-   if ( fragmentShader == 0 )
+   if ( program->useCache )
    {
-      glDeleteShader ( vertexShader );
-      return 0;
+      program->cacheKey = ProgramCacheKey ( vertShaderSrc, fragShaderSrc, numVaryings, varyings, bufferMode );
+      program->programObject = LoadCachedProgram ( program->cacheKey, &program->info );
+
+      CacheCount ( CACHE_PROGRAMS, program->programObject != 0 ? GL_TRUE : GL_FALSE );
+
+      if ( program->programObject != 0 )
+      {
+         program->fromCache = GL_TRUE;
+         return program;
+      }
    }
 
-   // Create the program object
-   programObject = glCreateProgram ( );
+   EnableParallelCompile ( );
 
-   if ( programObject == 0 )
+   // Issue both compiles and the link back to back.  Nothing here queries
+   // status, so the driver is free to compile in the background.
+   program->vertexShader = CreateShader ( GL_VERTEX_SHADER, vertShaderSrc );
+   program->fragmentShader = CreateShader ( GL_FRAGMENT_SHADER, fragShaderSrc );
+   program->programObject = glCreateProgram ( );
+
+   if ( program->vertexShader == 0 || program->fragmentShader == 0 || program->programObject == 0 )
    {
-      return 0;
+      return program;
+   }
+
+   glAttachShader ( program->programObject, program->vertexShader );
+   glAttachShader ( program->programObject, program->fragmentShader );
+
+   if ( numVaryings > 0 )
+   {
+      glTransformFeedbackVaryings ( program->programObject, numVaryings, varyings, bufferMode );
    }
 
-   glAttachShader ( programObject, vertexShader );
-   glAttachShader ( programObject, fragmentShader );
+   if ( program->useCache )
+   {
+      glProgramParameteri ( program->programObject, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE );
+   }
 
-   // Link the program
-   glLinkProgram ( programObject );
+   glLinkProgram ( program->programObject );
 
-   // Check the link status
-   glGetProgramiv ( programObject, GL_LINK_STATUS, &linked );
+   return program;
+}
 
-   if ( !linked )
+//
+///
+/// \brief Check whether an asynchronous program has finished linking
+//
+GLboolean ESUTIL_API esProgramReady ( ESAsyncProgram *program )
+{
+   GLint complete = GL_TRUE;
+
+   if ( program == NULL || program->fromCache || !s_parallelCompile || program->programObject == 0 )
    {
-      GLint infoLen = 0;
+      return GL_TRUE;
+   }
 
-      glGetProgramiv ( programObject, GL_INFO_LOG_LENGTH, &infoLen );
+   glGetProgramiv ( program->programObject, GL_COMPLETION_STATUS_KHR, &complete );
 
-      if ( infoLen > 1 )
-      {
-         char *infoLog = malloc ( sizeof ( char ) * infoLen );
+   return complete ? GL_TRUE : GL_FALSE;
+}
 
-         glGetProgramInfoLog ( programObject, infoLen, NULL, infoLog );
-         esLogMessage ( "Error linking program:\n%s\n", infoLog );
+//
+///
+/// \brief Wait for an asynchronous program, check for errors and free the handle
+//
+GLuint ESUTIL_API esProgramWait ( ESAsyncProgram *program )
+{
+   return WaitProgram ( program, NULL );
+}
 
-         free ( infoLog );
-      }
+//
+///
+/// \brief Wait for an asynchronous program and return the active variables of it
+//
+ESProgramInfo *ESUTIL_API esProgramWaitInfo ( ESAsyncProgram *program )
+{
+   ESProgramInfo *info = NULL;
+   GLuint programObject = WaitProgram ( program, &info );
 
+   if ( programObject != 0 && info == NULL )
+   {
       glDeleteProgram ( programObject );
-      return 0;
+      return NULL;
    }
 
-   // Free up no longer needed shader resources
-   glDeleteShader ( vertexShader );
-   glDeleteShader ( fragmentShader );
+   if ( info != NULL )
+   {
+      ProgramInfoBind ( info );
+   }
 
-   return programObject;
-}
\ No newline at end of file
+   return info;
+}
+
+//
+///
+/// \brief Enable the program binary cache
+//
+void ESUTIL_API esProgramCacheInit ( const char *directory )
+{
+   CacheInit ( CACHE_PROGRAMS, directory );
+}
+
+//
+///
+/// \brief Get the program binary cache counters
+//
+void ESUTIL_API esProgramCacheGetStats ( int *hits, int *misses )
+{
+   CacheGetStats ( CACHE_PROGRAMS, hits, misses );
+}
@@ -0,0 +1,767 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// ESState.c
+//
+//    Cache of the GL state set through it, so that calls setting a value
+//    already in place never reach the driver.  There is one cache per
+//    thread, standing for the context current on it: the window's on the
+//    thread drawing, the loader's shared context on the loader thread.
+//    Values start out unknown, so the first call for each is always made,
+//    and esStateInvalidate forgets them all after plain GL calls have
+//    changed what the cache holds.  Common code binding with plain GL
+//    calls tells the cache of its thread with the State*() functions.
+//    Set ES_STATE_CACHE to 0 to pass every call on, for comparison.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include "esUtil_win.h"
+#include <stdlib.h>
+#include <string.h>
+
+///
+//  Macros
+//
+
+// Marks a cached value as unknown; every field of StateValues is set to it
+#define STATE_UNKNOWN            0xFFFFFFFFu
+
+// Texture units and indexed buffer bindings cached, calls beyond are passed on
+#define STATE_TEXTURE_UNITS      32
+#define STATE_UNIFORM_BINDINGS   24
+#define STATE_FEEDBACK_BINDINGS  4
+#define STATE_VERTEX_ATTRIBS     16
+
+#define STATE_BUFFER_TARGETS     8
+#define STATE_TEXTURE_TARGETS    4
+#define STATE_CAPS               11
+
+#ifdef _MSC_VER
+#define STATE_THREAD_LOCAL       __declspec ( thread )
+#else
+#define STATE_THREAD_LOCAL       __thread
+#endif
+
+///
+//  Types
+//
+typedef struct
+{
+   GLuint       buffer;
+   GLintptr     offset;
+   GLsizeiptr   size;
+} StateBufferRange;
+
+// Everything cached, all bits set while unknown
+typedef struct
+{
+   GLuint            program;
+   GLuint            vertexArray;
+   GLuint            buffers[STATE_BUFFER_TARGETS];
+   StateBufferRange  uniformBuffers[STATE_UNIFORM_BINDINGS];
+   StateBufferRange  feedbackBuffers[STATE_FEEDBACK_BINDINGS];
+
+   // Index of the active texture unit
+   GLuint            activeUnit;
+   GLuint            textures[STATE_TEXTURE_UNITS][STATE_TEXTURE_TARGETS];
+   GLuint            samplers[STATE_TEXTURE_UNITS];
+
+   // Enabled caps and vertex attribute arrays, 0 or 1
+   GLuint            caps[STATE_CAPS];
+   GLuint            attribArrays[STATE_VERTEX_ATTRIBS];
+
+   GLenum            blendFunc[2];
+   GLenum            depthFunc;
+   GLuint            depthMask;
+   GLenum            cullFace;
+   GLuint            colorMask;
+   GLint             viewport[4];
+} StateValues;
+
+typedef struct
+{
+   GLboolean         initialized;
+
+   // Set by ES_STATE_CACHE=0, every call is made
+   GLboolean         disabled;
+
+   StateValues       values;
+
+   // Calls made and dropped in the current frame
+   unsigned int      issued;
+   unsigned int      elided;
+
+   ESStateStats      stats;
+} StateCache;
+
+// Each thread has its own context current, and so its own cache
+static STATE_THREAD_LOCAL StateCache cache;
+
+static const GLenum bufferTargets[STATE_BUFFER_TARGETS] =
+{
+   GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER, GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+   GL_PIXEL_PACK_BUFFER, GL_PIXEL_UNPACK_BUFFER, GL_TRANSFORM_FEEDBACK_BUFFER, GL_UNIFORM_BUFFER
+};
+
+static const GLenum textureTargets[STATE_TEXTURE_TARGETS] =
+{
+   GL_TEXTURE_2D, GL_TEXTURE_3D, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_CUBE_MAP
+};
+
+static const GLenum caps[STATE_CAPS] =
+{
+   GL_BLEND, GL_DEPTH_TEST, GL_CULL_FACE, GL_SCISSOR_TEST, GL_STENCIL_TEST, GL_DITHER,
+   GL_POLYGON_OFFSET_FILL, GL_SAMPLE_ALPHA_TO_COVERAGE, GL_SAMPLE_COVERAGE,
+   GL_RASTERIZER_DISCARD, GL_PRIMITIVE_RESTART_FIXED_INDEX
+};
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// GetCache()
+//
+//    The cache of the calling thread, with every value unknown on first use
+//
+static StateCache *GetCache ( void )
+{
+   if ( !cache.initialized )
+   {
+      const char *enabled = getenv ( "ES_STATE_CACHE" );
+
+      memset ( &cache.values, 0xFF, sizeof ( StateValues ) );
+      cache.disabled = enabled != NULL && strcmp ( enabled, "0" ) == 0 ? GL_TRUE : GL_FALSE;
+      cache.initialized = GL_TRUE;
+   }
+
+   return &cache;
+}
+
+///
+// Index()
+//
+//    Position of value in list, -1 if missing
+//
+static int Index ( const GLenum *list, int count, GLenum value )
+{
+   int i;
+
+   for ( i = 0; i < count; i++ )
+   {
+      if ( list[i] == value )
+      {
+         return i;
+      }
+   }
+
+   return -1;
+}
+
+///
+// Elide()
+//
+//    Count a call, and return GL_TRUE if it only repeats the cached state
+//
+static GLboolean Elide ( StateCache *state, GLboolean same )
+{
+   if ( same && !state->disabled )
+   {
+      state->elided++;
+      return GL_TRUE;
+   }
+
+   state->issued++;
+   return GL_FALSE;
+}
+
+///
+// SetUint()
+//
+//    Count a call setting a single value, and store it.  Return GL_TRUE if
+//    the call has to be made.
+//
+static GLboolean SetUint ( StateCache *state, GLuint *cached, GLuint value )
+{
+   if ( Elide ( state, *cached == value ) )
+   {
+      return GL_FALSE;
+   }
+
+   *cached = value;
+   return GL_TRUE;
+}
+
+///
+// BufferRange()
+//
+//    Cached indexed binding of target, NULL if not cached
+//
+static StateBufferRange *BufferRange ( StateCache *state, GLenum target, GLuint index )
+{
+   if ( target == GL_UNIFORM_BUFFER && index < STATE_UNIFORM_BINDINGS )
+   {
+      return &state->values.uniformBuffers[index];
+   }
+
+   if ( target == GL_TRANSFORM_FEEDBACK_BUFFER && index < STATE_FEEDBACK_BINDINGS )
+   {
+      return &state->values.feedbackBuffers[index];
+   }
+
+   return NULL;
+}
+
+///
+// SetCap()
+//
+static void SetCap ( GLenum cap, GLboolean enabled )
+{
+   StateCache *state = GetCache ( );
+   int i = Index ( caps, STATE_CAPS, cap );
+
+   if ( i >= 0 ? !SetUint ( state, &state->values.caps[i], enabled ? 1 : 0 ) : Elide ( state, GL_FALSE ) )
+   {
+      return;
+   }
+
+   if ( enabled )
+   {
+      glEnable ( cap );
+   }
+   else
+   {
+      glDisable ( cap );
+   }
+}
+
+///
+// SetAttribArray()
+//
+static void SetAttribArray ( GLuint index, GLboolean enabled )
+{
+   StateCache *state = GetCache ( );
+
+   if ( index < STATE_VERTEX_ATTRIBS ? !SetUint ( state, &state->values.attribArrays[index], enabled ? 1 : 0 ) :
+         Elide ( state, GL_FALSE ) )
+   {
+      return;
+   }
+
+   if ( enabled )
+   {
+      glEnableVertexAttribArray ( index );
+   }
+   else
+   {
+      glDisableVertexAttribArray ( index );
+   }
+}
+
+///
+//  StateEndFrame()
+//
+//      Move the counts of the frame to the statistics, on the drawing thread
+//
+void StateEndFrame ( void )
+{
+   cache.stats.issued = cache.issued;
+   cache.stats.elided = cache.elided;
+   cache.stats.totalIssued += cache.issued;
+   cache.stats.totalElided += cache.elided;
+   cache.stats.frames++;
+
+   cache.issued = 0;
+   cache.elided = 0;
+}
+
+///
+//  StateSetBuffer()
+//
+//      Record a buffer bound to target with glBindBuffer
+//
+void StateSetBuffer ( GLenum target, GLuint buffer )
+{
+   StateCache *state = GetCache ( );
+   int i = Index ( bufferTargets, STATE_BUFFER_TARGETS, target );
+
+   if ( i >= 0 )
+   {
+      state->values.buffers[i] = buffer;
+   }
+}
+
+///
+//  StateSetVertexArray()
+//
+//      Record a vertex array bound with glBindVertexArray
+//
+void StateSetVertexArray ( GLuint array )
+{
+   StateCache *state = GetCache ( );
+   int i;
+
+   state->values.vertexArray = array;
+
+   // The element array binding and the enabled arrays belong to the vertex array
+   state->values.buffers[Index ( bufferTargets, STATE_BUFFER_TARGETS, GL_ELEMENT_ARRAY_BUFFER )] = STATE_UNKNOWN;
+
+   for ( i = 0; i < STATE_VERTEX_ATTRIBS; i++ )
+   {
+      state->values.attribArrays[i] = STATE_UNKNOWN;
+   }
+}
+
+///
+//  StateSetBufferRange()
+//
+//      Record a range of buffer bound to an index of target with glBindBufferRange
+//
+void StateSetBufferRange ( GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size )
+{
+   StateCache *state = GetCache ( );
+   StateBufferRange *range = BufferRange ( state, target, index );
+
+   // Also binds the generic binding point
+   StateSetBuffer ( target, buffer );
+
+   if ( range != NULL )
+   {
+      range->buffer = buffer;
+      range->offset = offset;
+      range->size = size;
+   }
+}
+
+///
+//  StateSetBufferBase()
+//
+//      Record a buffer bound to an index of target with glBindBufferBase
+//
+void StateSetBufferBase ( GLenum target, GLuint index, GLuint buffer )
+{
+   StateCache *state = GetCache ( );
+   StateBufferRange *range = BufferRange ( state, target, index );
+
+   StateSetBuffer ( target, buffer );
+
+   if ( range != NULL )
+   {
+      range->buffer = buffer;
+      range->offset = 0;
+      range->size = -1;
+   }
+}
+
+///
+//  StateSetTexture()
+//
+//      Record a texture bound to target of the active unit with glBindTexture
+//
+void StateSetTexture ( GLenum target, GLuint texture )
+{
+   StateCache *state = GetCache ( );
+   int i = Index ( textureTargets, STATE_TEXTURE_TARGETS, target );
+   int unit;
+
+   if ( i < 0 )
+   {
+      return;
+   }
+
+   if ( state->values.activeUnit < STATE_TEXTURE_UNITS )
+   {
+      state->values.textures[state->values.activeUnit][i] = texture;
+      return;
+   }
+
+   // Bound to some unit, which one is not known
+   for ( unit = 0; unit < STATE_TEXTURE_UNITS; unit++ )
+   {
+      state->values.textures[unit][i] = STATE_UNKNOWN;
+   }
+}
+
+///
+//  StateSetCap()
+//
+//      Record a cap set with glEnable or glDisable
+//
+void StateSetCap ( GLenum cap, GLboolean enabled )
+{
+   StateCache *state = GetCache ( );
+   int i = Index ( caps, STATE_CAPS, cap );
+
+   if ( i >= 0 )
+   {
+      state->values.caps[i] = enabled ? 1 : 0;
+   }
+}
+
+///
+//  StateDeleteBuffer()
+//
+//      Record a buffer deleted with glDeleteBuffers, which unbinds it
+//
+void StateDeleteBuffer ( GLuint buffer )
+{
+   StateCache *state = GetCache ( );
+   int i;
+
+   for ( i = 0; i < STATE_BUFFER_TARGETS; i++ )
+   {
+      if ( state->values.buffers[i] == buffer )
+      {
+         state->values.buffers[i] = 0;
+      }
+   }
+
+   for ( i = 0; i < STATE_UNIFORM_BINDINGS; i++ )
+   {
+      if ( state->values.uniformBuffers[i].buffer == buffer )
+      {
+         state->values.uniformBuffers[i].buffer = 0;
+      }
+   }
+
+   for ( i = 0; i < STATE_FEEDBACK_BINDINGS; i++ )
+   {
+      if ( state->values.feedbackBuffers[i].buffer == buffer )
+      {
+         state->values.feedbackBuffers[i].buffer = 0;
+      }
+   }
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+//
+///
+/// \brief glUseProgram, unless program is current
+//
+void ESUTIL_API esStateUseProgram ( GLuint program )
+{
+   StateCache *state = GetCache ( );
+
+   if ( SetUint ( state, &state->values.program, program ) )
+   {
+      glUseProgram ( program );
+   }
+}
+
+//
+///
+/// \brief glBindVertexArray, unless array is bound
+//
+void ESUTIL_API esStateBindVertexArray ( GLuint array )
+{
+   StateCache *state = GetCache ( );
+
+   if ( !SetUint ( state, &state->values.vertexArray, array ) )
+   {
+      return;
+   }
+
+   glBindVertexArray ( array );
+   StateSetVertexArray ( array );
+}
+
+//
+///
+/// \brief glBindBuffer, unless buffer is bound to target
+//
+void ESUTIL_API esStateBindBuffer ( GLenum target, GLuint buffer )
+{
+   StateCache *state = GetCache ( );
+   int i = Index ( bufferTargets, STATE_BUFFER_TARGETS, target );
+
+   if ( i >= 0 ? SetUint ( state, &state->values.buffers[i], buffer ) : !Elide ( state, GL_FALSE ) )
+   {
+      glBindBuffer ( target, buffer );
+   }
+}
+
+//
+///
+/// \brief glBindBufferRange, unless the same range is bound to index of target
+//
+void ESUTIL_API esStateBindBufferRange ( GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size )
+{
+   StateCache *state = GetCache ( );
+   StateBufferRange *range = BufferRange ( state, target, index );
+
+   if ( Elide ( state, range != NULL && range->buffer == buffer && range->offset == offset && range->size == size ) )
+   {
+      return;
+   }
+
+   glBindBufferRange ( target, index, buffer, offset, size );
+   StateSetBufferRange ( target, index, buffer, offset, size );
+}
+
+//
+///
+/// \brief glBindBufferBase, unless buffer is bound whole to index of target
+//
+void ESUTIL_API esStateBindBufferBase ( GLenum target, GLuint index, GLuint buffer )
+{
+   StateCache *state = GetCache ( );
+   StateBufferRange *range = BufferRange ( state, target, index );
+
+   if ( Elide ( state, range != NULL && range->buffer == buffer && range->offset == 0 && range->size == -1 ) )
+   {
+      return;
+   }
+
+   glBindBufferBase ( target, index, buffer );
+   StateSetBufferBase ( target, index, buffer );
+}
+
+//
+///
+/// \brief glActiveTexture, unless texture is the active unit
+//
+void ESUTIL_API esStateActiveTexture ( GLenum texture )
+{
+   StateCache *state = GetCache ( );
+   GLuint unit = texture - GL_TEXTURE0;
+
+   if ( unit >= STATE_TEXTURE_UNITS ? !Elide ( state, GL_FALSE ) : SetUint ( state, &state->values.activeUnit, unit ) )
+   {
+      glActiveTexture ( texture );
+   }
+
+   // Further units are not tracked
+   if ( unit >= STATE_TEXTURE_UNITS )
+   {
+      state->values.activeUnit = STATE_UNKNOWN;
+   }
+}
+
+//
+///
+/// \brief glBindTexture, unless texture is bound to target of the active unit
+//
+void ESUTIL_API esStateBindTexture ( GLenum target, GLuint texture )
+{
+   StateCache *state = GetCache ( );
+   GLuint unit = state->values.activeUnit;
+   int i = Index ( textureTargets, STATE_TEXTURE_TARGETS, target );
+
+   if ( i >= 0 && unit < STATE_TEXTURE_UNITS )
+   {
+      if ( SetUint ( state, &state->values.textures[unit][i], texture ) )
+      {
+         glBindTexture ( target, texture );
+      }
+
+      return;
+   }
+
+   Elide ( state, GL_FALSE );
+   glBindTexture ( target, texture );
+   StateSetTexture ( target, texture );
+}
+
+//
+///
+/// \brief glBindSampler, unless sampler is bound to unit
+//
+void ESUTIL_API esStateBindSampler ( GLuint unit, GLuint sampler )
+{
+   StateCache *state = GetCache ( );
+
+   if ( unit < STATE_TEXTURE_UNITS ? SetUint ( state, &state->values.samplers[unit], sampler ) : !Elide ( state, GL_FALSE ) )
+   {
+      glBindSampler ( unit, sampler );
+   }
+}
+
+//
+///
+/// \brief glEnable, unless cap is enabled
+//
+void ESUTIL_API esStateEnable ( GLenum cap )
+{
+   SetCap ( cap, GL_TRUE );
+}
+
+//
+///
+/// \brief glDisable, unless cap is disabled
+//
+void ESUTIL_API esStateDisable ( GLenum cap )
+{
+   SetCap ( cap, GL_FALSE );
+}
+
+//
+///
+/// \brief glBlendFunc, unless the factors are set
+//
+void ESUTIL_API esStateBlendFunc ( GLenum sfactor, GLenum dfactor )
+{
+   StateCache *state = GetCache ( );
+
+   if ( Elide ( state, state->values.blendFunc[0] == sfactor && state->values.blendFunc[1] == dfactor ) )
+   {
+      return;
+   }
+
+   glBlendFunc ( sfactor, dfactor );
+   state->values.blendFunc[0] = sfactor;
+   state->values.blendFunc[1] = dfactor;
+}
+
+//
+///
+/// \brief glDepthFunc, unless func is set
+//
+void ESUTIL_API esStateDepthFunc ( GLenum func )
+{
+   StateCache *state = GetCache ( );
+
+   if ( SetUint ( state, &state->values.depthFunc, func ) )
+   {
+      glDepthFunc ( func );
+   }
+}
+
+//
+///
+/// \brief glDepthMask, unless flag is set
+//
+void ESUTIL_API esStateDepthMask ( GLboolean flag )
+{
+   StateCache *state = GetCache ( );
+
+   if ( SetUint ( state, &state->values.depthMask, flag ? 1 : 0 ) )
+   {
+      glDepthMask ( flag );
+   }
+}
+
+//
+///
+/// \brief glCullFace, unless mode is set
+//
+void ESUTIL_API esStateCullFace ( GLenum mode )
+{
+   StateCache *state = GetCache ( );
+
+   if ( SetUint ( state, &state->values.cullFace, mode ) )
+   {
+      glCullFace ( mode );
+   }
+}
+
+//
+///
+/// \brief glColorMask, unless the mask is set
+//
+void ESUTIL_API esStateColorMask ( GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha )
+{
+   StateCache *state = GetCache ( );
+   GLuint mask = ( red ? 1 : 0 ) | ( green ? 2 : 0 ) | ( blue ? 4 : 0 ) | ( alpha ? 8 : 0 );
+
+   if ( SetUint ( state, &state->values.colorMask, mask ) )
+   {
+      glColorMask ( red, green, blue, alpha );
+   }
+}
+
+//
+///
+/// \brief glViewport, unless the viewport is set
+//
+void ESUTIL_API esStateViewport ( GLint x, GLint y, GLsizei width, GLsizei height )
+{
+   StateCache *state = GetCache ( );
+   GLint *viewport = state->values.viewport;
+
+   if ( Elide ( state, viewport[0] == x && viewport[1] == y && viewport[2] == width && viewport[3] == height ) )
+   {
+      return;
+   }
+
+   glViewport ( x, y, width, height );
+   viewport[0] = x;
+   viewport[1] = y;
+   viewport[2] = width;
+   viewport[3] = height;
+}
+
+//
+///
+/// \brief glEnableVertexAttribArray, unless the array is enabled in the bound vertex array
+//
+void ESUTIL_API esStateEnableVertexAttribArray ( GLuint index )
+{
+   SetAttribArray ( index, GL_TRUE );
+}
+
+//
+///
+/// \brief glDisableVertexAttribArray, unless the array is disabled in the bound vertex array
+//
+void ESUTIL_API esStateDisableVertexAttribArray ( GLuint index )
+{
+   SetAttribArray ( index, GL_FALSE );
+}
+
+//
+///
+/// \brief Forget the cached state, after it was changed with plain GL calls
+//
+void ESUTIL_API esStateInvalidate ( void )
+{
+   StateCache *state = GetCache ( );
+
+   memset ( &state->values, 0xFF, sizeof ( StateValues ) );
+}
+
+//
+///
+/// \brief Calls made and dropped through the cache
+//
+void ESUTIL_API esStateGetStats ( ESStateStats *stats )
+{
+   *stats = cache.stats;
+}
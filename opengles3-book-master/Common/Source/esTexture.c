@@ -0,0 +1,631 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// ESTexture.c
+//
+//    Asynchronous texture streaming.  Worker threads decode images while
+//    the render thread copies the decoded rows into a ring of pixel unpack
+//    buffers, a bounded number of bytes per frame, so that loading a
+//    texture never blocks drawing.  Only uncompressed TGA images are
+//    streamed: KTX and PVR files hold every level and face ready to upload
+//    and are loaded from their mapping by esImage.c instead.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include "esUtil_win.h"
+#include <stdlib.h>
+#include <string.h>
+
+///
+//  Macros
+//
+#define MAX_STREAM_THREADS      4
+
+// Most glTexSubImage2D calls one esTextureStreamUpdate can issue
+#define MAX_UPLOADS_PER_FRAME   16
+
+// Touching one byte per page moves the page faults of a mapped image from
+// the render thread to the worker that decoded it
+#define PAGE_SIZE_GUESS         4096
+
+///
+//  Types
+//
+typedef struct ESTextureRequest
+{
+   struct ESTextureRequest *next;
+
+   char       *fileName;
+   GLuint      texture;
+   GLenum      format;
+
+   // Written by the worker thread
+   ESImage     image;
+   GLboolean   loaded;
+
+   // Rows already copied to the ring, render thread only
+   int         rowsUploaded;
+} ESTextureRequest;
+
+typedef struct
+{
+   ESTextureRequest *head;
+   ESTextureRequest *tail;
+} RequestQueue;
+
+// Sub-image copied to the ring, issued once the ring is unmapped
+typedef struct
+{
+   GLuint      texture;
+   GLenum      format;
+   int         width;
+   int         yoffset;
+   int         rows;
+   GLintptr    offset;
+} PendingUpload;
+
+struct ESTextureStream
+{
+   void         *ioContext;
+   ESBufferRing  ring;
+
+   ESThread     *threads[MAX_STREAM_THREADS];
+   int           numThreads;
+
+   // Guards everything below
+   ESMutex      *mutex;
+   ESCondition  *workAvailable;
+   ESCondition  *decodeDone;
+   RequestQueue  toDecode;
+   RequestQueue  decoded;
+   GLboolean     quit;
+
+   // Render thread only
+   ESTextureRequest *uploading;
+   int               numLoading;
+   GLuint64          bytesUploaded;
+};
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// QueuePush()
+//
+static void QueuePush ( RequestQueue *queue, ESTextureRequest *request )
+{
+   request->next = NULL;
+
+   if ( queue->tail != NULL )
+   {
+      queue->tail->next = request;
+   }
+   else
+   {
+      queue->head = request;
+   }
+
+   queue->tail = request;
+}
+
+///
+// QueuePop()
+//
+static ESTextureRequest *QueuePop ( RequestQueue *queue )
+{
+   ESTextureRequest *request = queue->head;
+
+   if ( request != NULL )
+   {
+      queue->head = request->next;
+
+      if ( queue->head == NULL )
+      {
+         queue->tail = NULL;
+      }
+   }
+
+   return request;
+}
+
+///
+// FreeRequest()
+//
+static void FreeRequest ( ESTextureRequest *request )
+{
+   esFreeImage ( &request->image );
+   free ( request->fileName );
+   free ( request );
+}
+
+///
+// FormatBytesPerPixel()
+//
+static int FormatBytesPerPixel ( GLenum format )
+{
+   switch ( format )
+   {
+      case GL_ALPHA:
+      case GL_LUMINANCE:
+         return 1;
+
+      case GL_LUMINANCE_ALPHA:
+         return 2;
+
+      case GL_RGB:
+         return 3;
+
+      case GL_RGBA:
+         return 4;
+   }
+
+   return 0;
+}
+
+///
+// StreamWorker()
+//
+//    Decode requested images until the stream is destroyed
+//
+static void ESCALLBACK StreamWorker ( void *arg )
+{
+   ESTextureStream *stream = ( ESTextureStream * ) arg;
+
+   for ( ;; )
+   {
+      ESTextureRequest *request;
+
+      esMutexLock ( stream->mutex );
+
+      while ( !stream->quit && stream->toDecode.head == NULL )
+      {
+         esConditionWait ( stream->workAvailable, stream->mutex );
+      }
+
+      if ( stream->quit )
+      {
+         esMutexUnlock ( stream->mutex );
+         break;
+      }
+
+      request = QueuePop ( &stream->toDecode );
+      esMutexUnlock ( stream->mutex );
+
+      request->loaded = esLoadTGAImage ( stream->ioContext, request->fileName, &request->image );
+
+      if ( request->loaded )
+      {
+         const volatile unsigned char *pixels = request->image.pixels;
+         size_t size = ( size_t ) request->image.width * request->image.height * request->image.bytesPerPixel;
+         size_t i;
+
+         for ( i = 0; i < size; i += PAGE_SIZE_GUESS )
+         {
+            ( void ) pixels[i];
+         }
+      }
+
+      esMutexLock ( stream->mutex );
+      QueuePush ( &stream->decoded, request );
+      esConditionSignal ( stream->decodeDone );
+      esMutexUnlock ( stream->mutex );
+   }
+}
+
+///
+// BeginUpload()
+//
+//    Check a decoded image and allocate the texture storage for it
+//
+static GLboolean BeginUpload ( ESTextureStream *stream, ESTextureRequest *request )
+{
+   const ESImage *image = &request->image;
+
+   if ( !request->loaded )
+   {
+      return GL_FALSE;
+   }
+
+   if ( image->bytesPerPixel != FormatBytesPerPixel ( request->format ) )
+   {
+      esLogMessage ( "esTextureStream: %s has %d bytes per pixel, which does not match the format\n",
+                     request->fileName, image->bytesPerPixel );
+      return GL_FALSE;
+   }
+
+   if ( ( GLsizeiptr ) image->width * image->bytesPerPixel > stream->ring.regionSize )
+   {
+      esLogMessage ( "esTextureStream: a row of %s is larger than the upload budget\n", request->fileName );
+      return GL_FALSE;
+   }
+
+   // The ring may be bound and mapped already, and NULL would then be read
+   // as an offset into it
+   glBindBuffer ( GL_PIXEL_UNPACK_BUFFER, 0 );
+   glBindTexture ( GL_TEXTURE_2D, request->texture );
+   StateSetBuffer ( GL_PIXEL_UNPACK_BUFFER, 0 );
+   StateSetTexture ( GL_TEXTURE_2D, request->texture );
+   glTexImage2D ( GL_TEXTURE_2D, 0, request->format, image->width, image->height, 0,
+                  request->format, GL_UNSIGNED_BYTE, NULL );
+
+   request->rowsUploaded = 0;
+
+   return GL_TRUE;
+}
+
+///
+// CopyRows()
+//
+//    Copy rows of an image to the ring, bottom row first
+//
+static void CopyRows ( unsigned char *dst, const ESImage *image, int firstRow, int numRows )
+{
+   size_t rowSize = ( size_t ) image->width * image->bytesPerPixel;
+   const unsigned char *pixels = image->pixels;
+   int row;
+
+   if ( !image->topDown )
+   {
+      memcpy ( dst, pixels + rowSize * firstRow, rowSize * numRows );
+      return;
+   }
+
+   for ( row = firstRow; row < firstRow + numRows; row++ )
+   {
+      memcpy ( dst, pixels + rowSize * ( image->height - 1 - row ), rowSize );
+      dst += rowSize;
+   }
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+//
+///
+/// \brief Create a texture stream
+//
+ESTextureStream *ESUTIL_API esTextureStreamCreate ( void *ioContext, GLsizeiptr bytesPerFrame, int numThreads )
+{
+   ESTextureStream *stream = ( ESTextureStream * ) calloc ( 1, sizeof ( ESTextureStream ) );
+   int i;
+
+   if ( stream == NULL )
+   {
+      return NULL;
+   }
+
+   stream->ioContext = ioContext;
+   stream->mutex = esMutexCreate ( );
+   stream->workAvailable = esConditionCreate ( );
+   stream->decodeDone = esConditionCreate ( );
+
+   if ( stream->mutex == NULL || stream->workAvailable == NULL || stream->decodeDone == NULL ||
+         !esBufferRingInit ( &stream->ring, GL_PIXEL_UNPACK_BUFFER, bytesPerFrame, GL_STREAM_DRAW ) )
+   {
+      esTextureStreamDestroy ( stream );
+      return NULL;
+   }
+
+   if ( numThreads <= 0 )
+   {
+      // Leave one core to the render thread
+      numThreads = esGetCPUCount ( ) - 1;
+   }
+
+   numThreads = numThreads < 1 ? 1 : numThreads > MAX_STREAM_THREADS ? MAX_STREAM_THREADS : numThreads;
+
+   for ( i = 0; i < numThreads; i++ )
+   {
+      stream->threads[i] = esThreadCreate ( StreamWorker, stream );
+
+      if ( stream->threads[i] == NULL )
+      {
+         break;
+      }
+
+      stream->numThreads++;
+   }
+
+   if ( stream->numThreads == 0 )
+   {
+      esTextureStreamDestroy ( stream );
+      return NULL;
+   }
+
+   return stream;
+}
+
+//
+///
+/// \brief Queue a TGA image to be streamed into a new texture
+//
+GLuint ESUTIL_API esTextureStreamLoad ( ESTextureStream *stream, const char *fileName, GLenum format )
+{
+   ESTextureRequest *request = ( ESTextureRequest * ) calloc ( 1, sizeof ( ESTextureRequest ) );
+
+   if ( request == NULL )
+   {
+      return 0;
+   }
+
+   request->fileName = ( char * ) malloc ( strlen ( fileName ) + 1 );
+
+   if ( request->fileName == NULL )
+   {
+      free ( request );
+      return 0;
+   }
+
+   strcpy ( request->fileName, fileName );
+   request->format = format;
+   glGenTextures ( 1, &request->texture );
+
+   stream->numLoading++;
+
+   esMutexLock ( stream->mutex );
+   QueuePush ( &stream->toDecode, request );
+   esConditionSignal ( stream->workAvailable );
+   esMutexUnlock ( stream->mutex );
+
+   return request->texture;
+}
+
+//
+///
+/// \brief Upload decoded images, at most one ring region worth of bytes
+//
+int ESUTIL_API esTextureStreamUpdate ( ESTextureStream *stream )
+{
+   PendingUpload uploads[MAX_UPLOADS_PER_FRAME];
+   int numUploads = 0;
+   unsigned char *dst = NULL;
+   GLintptr ringOffset = 0;
+   GLsizeiptr used = 0;
+   GLint alignment;
+   int i;
+
+   if ( stream->numLoading == 0 )
+   {
+      return 0;
+   }
+
+   // Never wait for the GPU here, try again next frame instead
+   if ( !esBufferRingReady ( &stream->ring ) )
+   {
+      return stream->numLoading;
+   }
+
+   while ( numUploads < MAX_UPLOADS_PER_FRAME )
+   {
+      ESTextureRequest *request = stream->uploading;
+      const ESImage *image;
+      GLsizeiptr rowSize;
+      int rows;
+
+      if ( request == NULL )
+      {
+         esMutexLock ( stream->mutex );
+         request = QueuePop ( &stream->decoded );
+         esMutexUnlock ( stream->mutex );
+
+         if ( request == NULL )
+         {
+            break;
+         }
+
+         if ( !BeginUpload ( stream, request ) )
+         {
+            // The texture stays incomplete
+            esLogMessage ( "esTextureStream FAILED to load : { %s }\n", request->fileName );
+            FreeRequest ( request );
+            stream->numLoading--;
+            continue;
+         }
+
+         stream->uploading = request;
+      }
+
+      image = &request->image;
+      rowSize = ( GLsizeiptr ) image->width * image->bytesPerPixel;
+      rows = ( int ) ( ( stream->ring.regionSize - used ) / rowSize );
+
+      if ( rows > image->height - request->rowsUploaded )
+      {
+         rows = image->height - request->rowsUploaded;
+      }
+
+      if ( rows == 0 )
+      {
+         // Budget used up for this frame
+         break;
+      }
+
+      if ( dst == NULL )
+      {
+         dst = esBufferRingMap ( &stream->ring, &ringOffset );
+
+         if ( dst == NULL )
+         {
+            break;
+         }
+      }
+
+      CopyRows ( dst + used, image, request->rowsUploaded, rows );
+
+      uploads[numUploads].texture = request->texture;
+      uploads[numUploads].format = request->format;
+      uploads[numUploads].width = image->width;
+      uploads[numUploads].yoffset = request->rowsUploaded;
+      uploads[numUploads].rows = rows;
+      uploads[numUploads].offset = ringOffset + used;
+      numUploads++;
+
+      used += rowSize * rows;
+      request->rowsUploaded += rows;
+
+      if ( request->rowsUploaded == image->height )
+      {
+         // Done with the image, its texture completes with the upload below
+         FreeRequest ( request );
+         stream->uploading = NULL;
+         stream->numLoading--;
+      }
+   }
+
+   if ( dst == NULL )
+   {
+      return stream->numLoading;
+   }
+
+   // A buffer cannot be read while it is mapped, so the uploads are issued
+   // only after every row has been copied
+   esBufferRingUnmap ( &stream->ring );
+
+   glGetIntegerv ( GL_UNPACK_ALIGNMENT, &alignment );
+   glPixelStorei ( GL_UNPACK_ALIGNMENT, 1 );
+
+   for ( i = 0; i < numUploads; i++ )
+   {
+      glBindTexture ( GL_TEXTURE_2D, uploads[i].texture );
+      StateSetTexture ( GL_TEXTURE_2D, uploads[i].texture );
+      glTexSubImage2D ( GL_TEXTURE_2D, 0, 0, uploads[i].yoffset, uploads[i].width, uploads[i].rows,
+                        uploads[i].format, GL_UNSIGNED_BYTE, ( const void * ) uploads[i].offset );
+   }
+
+   esBufferRingFence ( &stream->ring );
+
+   glPixelStorei ( GL_UNPACK_ALIGNMENT, alignment );
+   glBindBuffer ( GL_PIXEL_UNPACK_BUFFER, 0 );
+   StateSetBuffer ( GL_PIXEL_UNPACK_BUFFER, 0 );
+
+   stream->bytesUploaded += used;
+
+   return stream->numLoading;
+}
+
+//
+///
+/// \brief Upload every queued texture, blocking until done
+//
+void ESUTIL_API esTextureStreamFinish ( ESTextureStream *stream )
+{
+   while ( stream->numLoading > 0 )
+   {
+      esMutexLock ( stream->mutex );
+
+      while ( stream->uploading == NULL && stream->decoded.head == NULL )
+      {
+         esConditionWait ( stream->decodeDone, stream->mutex );
+      }
+
+      esMutexUnlock ( stream->mutex );
+
+      // Let the GPU catch up with the ring instead of spinning on its fence
+      if ( !esBufferRingReady ( &stream->ring ) )
+      {
+         glFinish ( );
+      }
+
+      esTextureStreamUpdate ( stream );
+   }
+}
+
+//
+///
+/// \brief Total number of bytes uploaded by a texture stream
+//
+GLuint64 ESUTIL_API esTextureStreamBytesUploaded ( ESTextureStream *stream )
+{
+   return stream->bytesUploaded;
+}
+
+//
+///
+/// \brief Stop the worker threads and free a texture stream
+//
+void ESUTIL_API esTextureStreamDestroy ( ESTextureStream *stream )
+{
+   ESTextureRequest *request;
+   int i;
+
+   if ( stream == NULL )
+   {
+      return;
+   }
+
+   if ( stream->mutex != NULL )
+   {
+      esMutexLock ( stream->mutex );
+      stream->quit = GL_TRUE;
+      esConditionBroadcast ( stream->workAvailable );
+      esMutexUnlock ( stream->mutex );
+   }
+
+   for ( i = 0; i < stream->numThreads; i++ )
+   {
+      esThreadJoin ( stream->threads[i] );
+   }
+
+   // Textures that never finished loading are left incomplete
+   while ( ( request = QueuePop ( &stream->toDecode ) ) != NULL )
+   {
+      FreeRequest ( request );
+   }
+
+   while ( ( request = QueuePop ( &stream->decoded ) ) != NULL )
+   {
+      FreeRequest ( request );
+   }
+
+   if ( stream->uploading != NULL )
+   {
+      FreeRequest ( stream->uploading );
+   }
+
+   if ( stream->ring.buffer != 0 )
+   {
+      esBufferRingDestroy ( &stream->ring );
+   }
+
+   esConditionDestroy ( stream->workAvailable );
+   esConditionDestroy ( stream->decodeDone );
+   esMutexDestroy ( stream->mutex );
+   free ( stream );
+}
@@ -0,0 +1,570 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// ESThread.c
+//
+//    Portable threads, mutexes and condition variables, plus a shared
+//    worker pool for splitting loops across all CPU cores.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+///
+//  Macros
+//
+#define MAX_POOL_THREADS   64
+
+// Number of chunks handed to each thread by esParallelFor, so that uneven
+// chunks balance out
+#define CHUNKS_PER_THREAD  4
+
+///
+//  Types
+//
+struct ESThread
+{
+#ifdef _WIN32
+   HANDLE            handle;
+#else
+   pthread_t         handle;
+#endif
+   void ( ESCALLBACK *func ) ( void * );
+   void             *arg;
+};
+
+struct ESMutex
+{
+#ifdef _WIN32
+   CRITICAL_SECTION  cs;
+#else
+   pthread_mutex_t   mutex;
+#endif
+};
+
+struct ESCondition
+{
+#ifdef _WIN32
+   CONDITION_VARIABLE cv;
+#else
+   pthread_cond_t    cond;
+#endif
+};
+
+typedef struct
+{
+   ESMutex     *lock;
+   ESCondition *wake;
+   ESCondition *done;
+   int          numThreads;
+   ESThread    *threads[MAX_POOL_THREADS];
+
+   // Current job, protected by lock
+   void ( ESCALLBACK *func ) ( void *, int, int );
+   void        *userData;
+   int          count;
+   int          chunkSize;
+   int          next;
+   int          completed;
+   unsigned int generation;
+
+   // Set while a job is running.  Claimed atomically rather than with a
+   // mutex because Win32 critical sections are recursive, which would let a
+   // nested esParallelFor on the owning thread re-enter the pool.
+   volatile unsigned int busy;
+} ThreadPool;
+
+static ThreadPool s_pool;
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// ThreadEntry()
+//
+//    Platform thread entry point, forwards to the user function
+//
+#ifdef _WIN32
+static DWORD WINAPI ThreadEntry ( LPVOID param )
+#else
+static void *ThreadEntry ( void *param )
+#endif
+{
+   ESThread *thread = ( ESThread * ) param;
+
+   thread->func ( thread->arg );
+
+   return 0;
+}
+
+///
+// PoolTryClaim()
+//
+//    Mark the pool busy, return GL_FALSE if it already was
+//
+static GLboolean PoolTryClaim ( ThreadPool *pool )
+{
+#ifdef _MSC_VER
+   return InterlockedCompareExchange ( ( volatile LONG * ) &pool->busy, 1, 0 ) == 0 ? GL_TRUE : GL_FALSE;
+#else
+   unsigned int idle = 0;
+
+   return __atomic_compare_exchange_n ( &pool->busy, &idle, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED ) ? GL_TRUE : GL_FALSE;
+#endif
+}
+
+///
+// PoolRelease()
+//
+static void PoolRelease ( ThreadPool *pool )
+{
+#ifdef _MSC_VER
+   InterlockedExchange ( ( volatile LONG * ) &pool->busy, 0 );
+#else
+   __atomic_store_n ( &pool->busy, 0, __ATOMIC_RELEASE );
+#endif
+}
+
+///
+// RunChunks()
+//
+//    Take chunks of the current job until none are left.  Called with the
+//    pool lock held, returns with it held.
+//
+static void RunChunks ( ThreadPool *pool )
+{
+   while ( pool->next < pool->count )
+   {
+      int first = pool->next;
+      int last = first + pool->chunkSize;
+
+      if ( last > pool->count )
+      {
+         last = pool->count;
+      }
+
+      pool->next = last;
+
+      esMutexUnlock ( pool->lock );
+      pool->func ( pool->userData, first, last );
+      esMutexLock ( pool->lock );
+
+      pool->completed += last - first;
+
+      if ( pool->completed == pool->count )
+      {
+         esConditionBroadcast ( pool->done );
+      }
+   }
+}
+
+///
+// PoolWorker()
+//
+//    Worker thread main loop, sleeps until a new job is published
+//
+static void ESCALLBACK PoolWorker ( void *arg )
+{
+   ThreadPool  *pool = ( ThreadPool * ) arg;
+   unsigned int seen = 0;
+
+   esMutexLock ( pool->lock );
+
+   for ( ;; )
+   {
+      while ( pool->generation == seen )
+      {
+         esConditionWait ( pool->wake, pool->lock );
+      }
+
+      seen = pool->generation;
+      RunChunks ( pool );
+   }
+}
+
+///
+// PoolInit()
+//
+//    Start one worker per CPU, less the calling thread which also takes work.
+//    The ES_NUM_THREADS environment variable overrides the thread count.
+//
+static void PoolInit ( void )
+{
+   const char *numThreadsEnv = getenv ( "ES_NUM_THREADS" );
+   int         numThreads = ( numThreadsEnv != NULL ) ? atoi ( numThreadsEnv ) : esGetCPUCount ( );
+   int         i;
+
+   if ( numThreads < 1 )
+   {
+      numThreads = 1;
+   }
+
+   if ( numThreads > MAX_POOL_THREADS )
+   {
+      numThreads = MAX_POOL_THREADS;
+   }
+
+   s_pool.lock = esMutexCreate ( );
+   s_pool.wake = esConditionCreate ( );
+   s_pool.done = esConditionCreate ( );
+
+   for ( i = 0; i < numThreads - 1; i++ )
+   {
+      s_pool.threads[s_pool.numThreads] = esThreadCreate ( PoolWorker, &s_pool );
+
+      if ( s_pool.threads[s_pool.numThreads] != NULL )
+      {
+         s_pool.numThreads++;
+      }
+   }
+}
+
+#ifdef _WIN32
+static BOOL CALLBACK PoolInitOnce ( PINIT_ONCE initOnce, PVOID param, PVOID *context )
+{
+   PoolInit ( );
+   return TRUE;
+}
+#endif
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+//
+///
+/// \brief Start a new thread
+//
+ESThread *ESUTIL_API esThreadCreate ( void ( ESCALLBACK *func ) ( void * ), void *arg )
+{
+   ESThread *thread = ( ESThread * ) malloc ( sizeof ( ESThread ) );
+
+   if ( thread == NULL )
+   {
+      return NULL;
+   }
+
+   thread->func = func;
+   thread->arg = arg;
+
+#ifdef _WIN32
+   thread->handle = CreateThread ( NULL, 0, ThreadEntry, thread, 0, NULL );
+
+   if ( thread->handle == NULL )
+#else
+   if ( pthread_create ( &thread->handle, NULL, ThreadEntry, thread ) != 0 )
+#endif
+   {
+      free ( thread );
+      return NULL;
+   }
+
+   return thread;
+}
+
+//
+///
+/// \brief Wait for a thread to finish and free its handle
+//
+void ESUTIL_API esThreadJoin ( ESThread *thread )
+{
+   if ( thread == NULL )
+   {
+      return;
+   }
+
+#ifdef _WIN32
+   WaitForSingleObject ( thread->handle, INFINITE );
+   CloseHandle ( thread->handle );
+#else
+   pthread_join ( thread->handle, NULL );
+#endif
+
+   free ( thread );
+}
+
+//
+///
+/// \brief Create a mutex, NULL on failure
+//
+ESMutex *ESUTIL_API esMutexCreate ( void )
+{
+   ESMutex *mutex = ( ESMutex * ) malloc ( sizeof ( ESMutex ) );
+
+   if ( mutex != NULL )
+   {
+#ifdef _WIN32
+      InitializeCriticalSection ( &mutex->cs );
+#else
+      pthread_mutex_init ( &mutex->mutex, NULL );
+#endif
+   }
+
+   return mutex;
+}
+
+//
+///
+/// \brief Destroy a mutex
+//
+void ESUTIL_API esMutexDestroy ( ESMutex *mutex )
+{
+   if ( mutex != NULL )
+   {
+#ifdef _WIN32
+      DeleteCriticalSection ( &mutex->cs );
+#else
+      pthread_mutex_destroy ( &mutex->mutex );
+#endif
+      free ( mutex );
+   }
+}
+
+//
+///
+/// \brief Lock a mutex
+//
+void ESUTIL_API esMutexLock ( ESMutex *mutex )
+{
+#ifdef _WIN32
+   EnterCriticalSection ( &mutex->cs );
+#else
+   pthread_mutex_lock ( &mutex->mutex );
+#endif
+}
+
+//
+///
+/// \brief Lock a mutex if it is free, GL_TRUE if locked
+//
+GLboolean ESUTIL_API esMutexTryLock ( ESMutex *mutex )
+{
+#ifdef _WIN32
+   return TryEnterCriticalSection ( &mutex->cs ) ? GL_TRUE : GL_FALSE;
+#else
+   return pthread_mutex_trylock ( &mutex->mutex ) == 0 ? GL_TRUE : GL_FALSE;
+#endif
+}
+
+//
+///
+/// \brief Unlock a mutex
+//
+void ESUTIL_API esMutexUnlock ( ESMutex *mutex )
+{
+#ifdef _WIN32
+   LeaveCriticalSection ( &mutex->cs );
+#else
+   pthread_mutex_unlock ( &mutex->mutex );
+#endif
+}
+
+//
+///
+/// \brief Create a condition variable, NULL on failure
+//
+ESCondition *ESUTIL_API esConditionCreate ( void )
+{
+   ESCondition *cond = ( ESCondition * ) malloc ( sizeof ( ESCondition ) );
+
+   if ( cond != NULL )
+   {
+#ifdef _WIN32
+      InitializeConditionVariable ( &cond->cv );
+#else
+      pthread_cond_init ( &cond->cond, NULL );
+#endif
+   }
+
+   return cond;
+}
+
+//
+///
+/// \brief Destroy a condition variable
+//
+void ESUTIL_API esConditionDestroy ( ESCondition *cond )
+{
+   if ( cond != NULL )
+   {
+#ifndef _WIN32
+      pthread_cond_destroy ( &cond->cond );
+#endif
+      free ( cond );
+   }
+}
+
+//
+///
+/// \brief Wait on a condition variable, with mutex locked
+//
+void ESUTIL_API esConditionWait ( ESCondition *cond, ESMutex *mutex )
+{
+#ifdef _WIN32
+   SleepConditionVariableCS ( &cond->cv, &mutex->cs, INFINITE );
+#else
+   pthread_cond_wait ( &cond->cond, &mutex->mutex );
+#endif
+}
+
+//
+///
+/// \brief Wake one thread waiting on a condition variable
+//
+void ESUTIL_API esConditionSignal ( ESCondition *cond )
+{
+#ifdef _WIN32
+   WakeConditionVariable ( &cond->cv );
+#else
+   pthread_cond_signal ( &cond->cond );
+#endif
+}
+
+//
+///
+/// \brief Wake every thread waiting on a condition variable
+//
+void ESUTIL_API esConditionBroadcast ( ESCondition *cond )
+{
+#ifdef _WIN32
+   WakeAllConditionVariable ( &cond->cv );
+#else
+   pthread_cond_broadcast ( &cond->cond );
+#endif
+}
+
+//
+///
+/// \brief Return the number of online CPU cores
+//
+int ESUTIL_API esGetCPUCount ( void )
+{
+#ifdef _WIN32
+   SYSTEM_INFO info;
+   GetSystemInfo ( &info );
+   return ( int ) info.dwNumberOfProcessors;
+#else
+   long count = sysconf ( _SC_NPROCESSORS_ONLN );
+   return count > 0 ? ( int ) count : 1;
+#endif
+}
+
+//
+///
+/// \brief Split [0, count) into chunks and run them on the worker pool and the calling
+///        thread.  Returns when every chunk is done.  If the pool is busy (a nested call, or a call
+///        from a second thread) the loop runs inline.
+//
+void ESUTIL_API esParallelFor ( int count, int minChunkSize,
+                                void ( ESCALLBACK *func ) ( void *userData, int first, int last ),
+                                void *userData )
+{
+#ifdef _WIN32
+   static INIT_ONCE initOnce = INIT_ONCE_STATIC_INIT;
+#else
+   static pthread_once_t initOnce = PTHREAD_ONCE_INIT;
+#endif
+   int chunkSize;
+
+   if ( count <= 0 )
+   {
+      return;
+   }
+
+   if ( minChunkSize < 1 )
+   {
+      minChunkSize = 1;
+   }
+
+   if ( count <= minChunkSize )
+   {
+      func ( userData, 0, count );
+      return;
+   }
+
+#ifdef _WIN32
+   InitOnceExecuteOnce ( &initOnce, PoolInitOnce, NULL, NULL );
+#else
+   pthread_once ( &initOnce, PoolInit );
+#endif
+
+   if ( s_pool.numThreads == 0 || !PoolTryClaim ( &s_pool ) )
+   {
+      func ( userData, 0, count );
+      return;
+   }
+
+   chunkSize = count / ( ( s_pool.numThreads + 1 ) * CHUNKS_PER_THREAD );
+
+   if ( chunkSize < minChunkSize )
+   {
+      chunkSize = minChunkSize;
+   }
+
+   esMutexLock ( s_pool.lock );
+
+   s_pool.func = func;
+   s_pool.userData = userData;
+   s_pool.count = count;
+   s_pool.chunkSize = chunkSize;
+   s_pool.next = 0;
+   s_pool.completed = 0;
+   s_pool.generation++;
+   esConditionBroadcast ( s_pool.wake );
+
+   // The calling thread works too, then waits for the stragglers
+   RunChunks ( &s_pool );
+
+   while ( s_pool.completed < s_pool.count )
+   {
+      esConditionWait ( s_pool.done, s_pool.lock );
+   }
+
+   esMutexUnlock ( s_pool.lock );
+   PoolRelease ( &s_pool );
+}
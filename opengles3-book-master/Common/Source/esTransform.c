@@ -43,8 +43,293 @@
 #include <math.h>
 #include <string.h>
 
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 )
+#define ES_SIMD_SSE2
+#include <emmintrin.h>
+#if defined(_MSC_VER)
+#define ES_SIMD_AVX
+#define ES_TARGET_AVX
+#include <intrin.h>
+#include <immintrin.h>
+#elif defined(__GNUC__)
+#define ES_SIMD_AVX
+#define ES_TARGET_AVX __attribute__ ( ( target ( "avx" ) ) )
+#include <immintrin.h>
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define ES_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
 #define PI 3.1415926535897932384626433832795f
 
+///
+//  Types
+//
+typedef void ( *MatrixMultiplyBatchFunc ) ( ESMatrix *result, const ESMatrix *srcA,
+                                            const ESMatrix *srcB, int count );
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// MatrixMultiplyBatchScalar()
+//
+//    Portable fallback.  result[i] = srcA[i] * srcB[i], any of which may alias.
+//
+static void MatrixMultiplyBatchScalar ( ESMatrix *result, const ESMatrix *srcA,
+                                        const ESMatrix *srcB, int count )
+{
+   int n;
+
+   for ( n = 0; n < count; n++ )
+   {
+      const ESMatrix *a = &srcA[n];
+      const ESMatrix *b = &srcB[n];
+      ESMatrix        tmp;
+      int             i;
+
+      for ( i = 0; i < 4; i++ )
+      {
+         tmp.m[i][0] =  ( a->m[i][0] * b->m[0][0] ) +
+                        ( a->m[i][1] * b->m[1][0] ) +
+                        ( a->m[i][2] * b->m[2][0] ) +
+                        ( a->m[i][3] * b->m[3][0] ) ;
+
+         tmp.m[i][1] =  ( a->m[i][0] * b->m[0][1] ) +
+                        ( a->m[i][1] * b->m[1][1] ) +
+                        ( a->m[i][2] * b->m[2][1] ) +
+                        ( a->m[i][3] * b->m[3][1] ) ;
+
+         tmp.m[i][2] =  ( a->m[i][0] * b->m[0][2] ) +
+                        ( a->m[i][1] * b->m[1][2] ) +
+                        ( a->m[i][2] * b->m[2][2] ) +
+                        ( a->m[i][3] * b->m[3][2] ) ;
+
+         tmp.m[i][3] =  ( a->m[i][0] * b->m[0][3] ) +
+                        ( a->m[i][1] * b->m[1][3] ) +
+                        ( a->m[i][2] * b->m[2][3] ) +
+                        ( a->m[i][3] * b->m[3][3] ) ;
+      }
+
+      result[n] = tmp;
+   }
+}
+
+#ifdef ES_SIMD_SSE2
+///
+// MatrixMultiplyBatchSSE2()
+//
+//    Each result row is a linear combination of the rows of srcB weighted by
+//    the matching row of srcA.  All four rows are computed in registers before
+//    being stored, so result may alias either source.
+//
+static void MatrixMultiplyBatchSSE2 ( ESMatrix *result, const ESMatrix *srcA,
+                                      const ESMatrix *srcB, int count )
+{
+   int n;
+
+   for ( n = 0; n < count; n++ )
+   {
+      const float *a = &srcA[n].m[0][0];
+      const float *b = &srcB[n].m[0][0];
+      __m128 b0 = _mm_loadu_ps ( b + 0 );
+      __m128 b1 = _mm_loadu_ps ( b + 4 );
+      __m128 b2 = _mm_loadu_ps ( b + 8 );
+      __m128 b3 = _mm_loadu_ps ( b + 12 );
+      __m128 r[4];
+      int    i;
+
+      for ( i = 0; i < 4; i++ )
+      {
+         __m128 row = _mm_loadu_ps ( a + i * 4 );
+         __m128 acc = _mm_mul_ps ( _mm_shuffle_ps ( row, row, 0x00 ), b0 );
+         acc = _mm_add_ps ( acc, _mm_mul_ps ( _mm_shuffle_ps ( row, row, 0x55 ), b1 ) );
+         acc = _mm_add_ps ( acc, _mm_mul_ps ( _mm_shuffle_ps ( row, row, 0xAA ), b2 ) );
+         acc = _mm_add_ps ( acc, _mm_mul_ps ( _mm_shuffle_ps ( row, row, 0xFF ), b3 ) );
+         r[i] = acc;
+      }
+
+      _mm_storeu_ps ( &result[n].m[0][0], r[0] );
+      _mm_storeu_ps ( &result[n].m[1][0], r[1] );
+      _mm_storeu_ps ( &result[n].m[2][0], r[2] );
+      _mm_storeu_ps ( &result[n].m[3][0], r[3] );
+   }
+}
+#endif // ES_SIMD_SSE2
+
+#ifdef ES_SIMD_AVX
+///
+// MatrixMultiplyBatchAVX()
+//
+//    Same as the SSE2 kernel, but two rows of srcA go through each 256-bit
+//    register.  Every row of srcB is broadcast into both 128-bit lanes, and
+//    _mm256_shuffle_ps splats the srcA elements within each lane.
+//
+static ES_TARGET_AVX void MatrixMultiplyBatchAVX ( ESMatrix *result, const ESMatrix *srcA,
+                                                   const ESMatrix *srcB, int count )
+{
+   int n;
+
+   for ( n = 0; n < count; n++ )
+   {
+      const float *a = &srcA[n].m[0][0];
+      const float *b = &srcB[n].m[0][0];
+      __m256 b0 = _mm256_broadcast_ps ( ( const __m128 * ) ( b + 0 ) );
+      __m256 b1 = _mm256_broadcast_ps ( ( const __m128 * ) ( b + 4 ) );
+      __m256 b2 = _mm256_broadcast_ps ( ( const __m128 * ) ( b + 8 ) );
+      __m256 b3 = _mm256_broadcast_ps ( ( const __m128 * ) ( b + 12 ) );
+      __m256 a01 = _mm256_loadu_ps ( a + 0 );
+      __m256 a23 = _mm256_loadu_ps ( a + 8 );
+      __m256 r01, r23;
+
+      r01 = _mm256_mul_ps ( _mm256_shuffle_ps ( a01, a01, 0x00 ), b0 );
+      r01 = _mm256_add_ps ( r01, _mm256_mul_ps ( _mm256_shuffle_ps ( a01, a01, 0x55 ), b1 ) );
+      r01 = _mm256_add_ps ( r01, _mm256_mul_ps ( _mm256_shuffle_ps ( a01, a01, 0xAA ), b2 ) );
+      r01 = _mm256_add_ps ( r01, _mm256_mul_ps ( _mm256_shuffle_ps ( a01, a01, 0xFF ), b3 ) );
+
+      r23 = _mm256_mul_ps ( _mm256_shuffle_ps ( a23, a23, 0x00 ), b0 );
+      r23 = _mm256_add_ps ( r23, _mm256_mul_ps ( _mm256_shuffle_ps ( a23, a23, 0x55 ), b1 ) );
+      r23 = _mm256_add_ps ( r23, _mm256_mul_ps ( _mm256_shuffle_ps ( a23, a23, 0xAA ), b2 ) );
+      r23 = _mm256_add_ps ( r23, _mm256_mul_ps ( _mm256_shuffle_ps ( a23, a23, 0xFF ), b3 ) );
+
+      _mm256_storeu_ps ( &result[n].m[0][0], r01 );
+      _mm256_storeu_ps ( &result[n].m[2][0], r23 );
+   }
+
+   _mm256_zeroupper ( );
+}
+
+///
+// CpuHasAVX()
+//
+//    Check that both the CPU and the OS (saved YMM state) support AVX
+//
+static int CpuHasAVX ( void )
+{
+#ifdef _MSC_VER
+   int info[4];
+
+   __cpuid ( info, 1 );
+
+   // OSXSAVE and AVX
+   if ( ( info[2] & ( 1 << 27 ) ) && ( info[2] & ( 1 << 28 ) ) )
+   {
+      return ( _xgetbv ( 0 ) & 0x6 ) == 0x6;
+   }
+
+   return 0;
+#else
+   __builtin_cpu_init ( );
+   return __builtin_cpu_supports ( "avx" );
+#endif
+}
+#endif // ES_SIMD_AVX
+
+#ifdef ES_SIMD_NEON
+///
+// MatrixMultiplyBatchNEON()
+//
+//    NEON version of the SSE2 kernel, using lane multiply-accumulate
+//
+static void MatrixMultiplyBatchNEON ( ESMatrix *result, const ESMatrix *srcA,
+                                      const ESMatrix *srcB, int count )
+{
+   int n;
+
+   for ( n = 0; n < count; n++ )
+   {
+      const float *a = &srcA[n].m[0][0];
+      const float *b = &srcB[n].m[0][0];
+      float32x4_t b0 = vld1q_f32 ( b + 0 );
+      float32x4_t b1 = vld1q_f32 ( b + 4 );
+      float32x4_t b2 = vld1q_f32 ( b + 8 );
+      float32x4_t b3 = vld1q_f32 ( b + 12 );
+      float32x4_t r[4];
+      int         i;
+
+      for ( i = 0; i < 4; i++ )
+      {
+         float32x4_t row = vld1q_f32 ( a + i * 4 );
+         float32x4_t acc = vmulq_lane_f32 ( b0, vget_low_f32 ( row ), 0 );
+         acc = vmlaq_lane_f32 ( acc, b1, vget_low_f32 ( row ), 1 );
+         acc = vmlaq_lane_f32 ( acc, b2, vget_high_f32 ( row ), 0 );
+         acc = vmlaq_lane_f32 ( acc, b3, vget_high_f32 ( row ), 1 );
+         r[i] = acc;
+      }
+
+      vst1q_f32 ( &result[n].m[0][0], r[0] );
+      vst1q_f32 ( &result[n].m[1][0], r[1] );
+      vst1q_f32 ( &result[n].m[2][0], r[2] );
+      vst1q_f32 ( &result[n].m[3][0], r[3] );
+   }
+}
+#endif // ES_SIMD_NEON
+
+// Multiply kernel, see GetMatrixMultiplyBatch
+static MatrixMultiplyBatchFunc s_multiplyBatch = MatrixMultiplyBatchScalar;
+
+///
+// SelectMatrixMultiplyBatch()
+//
+//    Pick the fastest multiply kernel for this CPU, run once
+//
+static void SelectMatrixMultiplyBatch ( void )
+{
+#if defined(ES_SIMD_AVX)
+   s_multiplyBatch = CpuHasAVX ( ) ? MatrixMultiplyBatchAVX : MatrixMultiplyBatchSSE2;
+#elif defined(ES_SIMD_SSE2)
+   s_multiplyBatch = MatrixMultiplyBatchSSE2;
+#elif defined(ES_SIMD_NEON)
+   s_multiplyBatch = MatrixMultiplyBatchNEON;
+#endif
+}
+
+#ifdef _WIN32
+static BOOL CALLBACK SelectMatrixMultiplyBatchOnce ( PINIT_ONCE initOnce, PVOID param, PVOID *context )
+{
+   SelectMatrixMultiplyBatch ( );
+   return TRUE;
+}
+#endif
+
+///
+// GetMatrixMultiplyBatch()
+//
+//    Multiply kernel for this CPU, selected on first use by whichever
+//    thread gets there first
+//
+static MatrixMultiplyBatchFunc GetMatrixMultiplyBatch ( void )
+{
+#ifdef _WIN32
+   static INIT_ONCE initOnce = INIT_ONCE_STATIC_INIT;
+
+   InitOnceExecuteOnce ( &initOnce, SelectMatrixMultiplyBatchOnce, NULL, NULL );
+#else
+   static pthread_once_t initOnce = PTHREAD_ONCE_INIT;
+
+   pthread_once ( &initOnce, SelectMatrixMultiplyBatch );
+#endif
+
+   return s_multiplyBatch;
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
 void ESUTIL_API
 esScale ( ESMatrix *result, GLfloat sx, GLfloat sy, GLfloat sz )
 {
@@ -86,7 +371,8 @@ esRotate ( ESMatrix *result, GLfloat angle, GLfloat x, GLfloat y, GLfloat z )
    {
       GLfloat xx, yy, zz, xy, yz, zx, xs, ys, zs;
       GLfloat oneMinusCos;
-      ESMatrix rotMat;
+      GLfloat r00, r01, r02, r10, r11, r12, r20, r21, r22;
+      int     j;
 
       x /= mag;
       y /= mag;
@@ -103,27 +389,30 @@ esRotate ( ESMatrix *result, GLfloat angle, GLfloat x, GLfloat y, GLfloat z )
       zs = z * sinAngle;
       oneMinusCos = 1.0f - cosAngle;
 
-      rotMat.m[0][0] = ( oneMinusCos * xx ) + cosAngle;
-      rotMat.m[0][1] = ( oneMinusCos * xy ) - zs;
-      rotMat.m[0][2] = ( oneMinusCos * zx ) + ys;
-      rotMat.m[0][3] = 0.0F;
-
-      rotMat.m[1][0] = ( oneMinusCos * xy ) + zs;
-      rotMat.m[1][1] = ( oneMinusCos * yy ) + cosAngle;
-      rotMat.m[1][2] = ( oneMinusCos * yz ) - xs;
-      rotMat.m[1][3] = 0.0F;
-
-      rotMat.m[2][0] = ( oneMinusCos * zx ) - ys;
-      rotMat.m[2][1] = ( oneMinusCos * yz ) + xs;
-      rotMat.m[2][2] = ( oneMinusCos * zz ) + cosAngle;
-      rotMat.m[2][3] = 0.0F;
-
-      rotMat.m[3][0] = 0.0F;
-      rotMat.m[3][1] = 0.0F;
-      rotMat.m[3][2] = 0.0F;
-      rotMat.m[3][3] = 1.0F;
-
-      esMatrixMultiply ( result, &rotMat, result );
+      r00 = ( oneMinusCos * xx ) + cosAngle;
+      r01 = ( oneMinusCos * xy ) - zs;
+      r02 = ( oneMinusCos * zx ) + ys;
+
+      r10 = ( oneMinusCos * xy ) + zs;
+      r11 = ( oneMinusCos * yy ) + cosAngle;
+      r12 = ( oneMinusCos * yz ) - xs;
+
+      r20 = ( oneMinusCos * zx ) - ys;
+      r21 = ( oneMinusCos * yz ) + xs;
+      r22 = ( oneMinusCos * zz ) + cosAngle;
+
+      // result = rotMat * result.  The rotation only has a 3x3 upper-left
+      // block, so rows 0-2 of result are recombined and row 3 is unchanged.
+      for ( j = 0; j < 4; j++ )
+      {
+         GLfloat c0 = result->m[0][j];
+         GLfloat c1 = result->m[1][j];
+         GLfloat c2 = result->m[2][j];
+
+         result->m[0][j] = r00 * c0 + r01 * c1 + r02 * c2;
+         result->m[1][j] = r10 * c0 + r11 * c1 + r12 * c2;
+         result->m[2][j] = r20 * c0 + r21 * c1 + r22 * c2;
+      }
    }
 }
 
@@ -133,7 +422,8 @@ esFrustum ( ESMatrix *result, float left, float right, float bottom, float top,
    float       deltaX = right - left;
    float       deltaY = top - bottom;
    float       deltaZ = farZ - nearZ;
-   ESMatrix    frust;
+   float       f00, f11, f20, f21, f22, f32;
+   int         j;
 
    if ( ( nearZ <= 0.0f ) || ( farZ <= 0.0f ) ||
          ( deltaX <= 0.0f ) || ( deltaY <= 0.0f ) || ( deltaZ <= 0.0f ) )
@@ -141,21 +431,26 @@ esFrustum ( ESMatrix *result, float left, float right, float bottom, float top,
       return;
    }
 
-   frust.m[0][0] = 2.0f * nearZ / deltaX;
-   frust.m[0][1] = frust.m[0][2] = frust.m[0][3] = 0.0f;
-
-   frust.m[1][1] = 2.0f * nearZ / deltaY;
-   frust.m[1][0] = frust.m[1][2] = frust.m[1][3] = 0.0f;
-
-   frust.m[2][0] = ( right + left ) / deltaX;
-   frust.m[2][1] = ( top + bottom ) / deltaY;
-   frust.m[2][2] = - ( nearZ + farZ ) / deltaZ;
-   frust.m[2][3] = -1.0f;
+   f00 = 2.0f * nearZ / deltaX;
+   f11 = 2.0f * nearZ / deltaY;
+   f20 = ( right + left ) / deltaX;
+   f21 = ( top + bottom ) / deltaY;
+   f22 = - ( nearZ + farZ ) / deltaZ;
+   f32 = -2.0f * nearZ * farZ / deltaZ;
 
-   frust.m[3][2] = -2.0f * nearZ * farZ / deltaZ;
-   frust.m[3][0] = frust.m[3][1] = frust.m[3][3] = 0.0f;
-
-   esMatrixMultiply ( result, &frust, result );
+   // result = frust * result, skipping the zero entries of the frustum matrix
+   for ( j = 0; j < 4; j++ )
+   {
+      float c0 = result->m[0][j];
+      float c1 = result->m[1][j];
+      float c2 = result->m[2][j];
+      float c3 = result->m[3][j];
+
+      result->m[0][j] = f00 * c0;
+      result->m[1][j] = f11 * c1;
+      result->m[2][j] = f20 * c0 + f21 * c1 + f22 * c2 - c3;
+      result->m[3][j] = f32 * c2;
+   }
 }
 
 
@@ -176,55 +471,51 @@ esOrtho ( ESMatrix *result, float left, float right, float bottom, float top, fl
    float       deltaX = right - left;
    float       deltaY = top - bottom;
    float       deltaZ = farZ - nearZ;
-   ESMatrix    ortho;
+   float       o00, o11, o22, o30, o31, o32;
+   int         j;
 
    if ( ( deltaX == 0.0f ) || ( deltaY == 0.0f ) || ( deltaZ == 0.0f ) )
    {
       return;
    }
 
-   esMatrixLoadIdentity ( &ortho );
-   ortho.m[0][0] = 2.0f / deltaX;
-   ortho.m[3][0] = - ( right + left ) / deltaX;
-   ortho.m[1][1] = 2.0f / deltaY;
-   ortho.m[3][1] = - ( top + bottom ) / deltaY;
-   ortho.m[2][2] = -2.0f / deltaZ;
-   ortho.m[3][2] = - ( nearZ + farZ ) / deltaZ;
+   o00 = 2.0f / deltaX;
+   o30 = - ( right + left ) / deltaX;
+   o11 = 2.0f / deltaY;
+   o31 = - ( top + bottom ) / deltaY;
+   o22 = -2.0f / deltaZ;
+   o32 = - ( nearZ + farZ ) / deltaZ;
 
-   esMatrixMultiply ( result, &ortho, result );
+   // result = ortho * result, skipping the zero entries of the ortho matrix
+   for ( j = 0; j < 4; j++ )
+   {
+      float c0 = result->m[0][j];
+      float c1 = result->m[1][j];
+      float c2 = result->m[2][j];
+      float c3 = result->m[3][j];
+
+      result->m[0][j] = o00 * c0;
+      result->m[1][j] = o11 * c1;
+      result->m[2][j] = o22 * c2;
+      result->m[3][j] = o30 * c0 + o31 * c1 + o32 * c2 + c3;
+   }
 }
 
 
 void ESUTIL_API
 esMatrixMultiply ( ESMatrix *result, ESMatrix *srcA, ESMatrix *srcB )
 {
-   ESMatrix    tmp;
-   int         i;
+   GetMatrixMultiplyBatch ( ) ( result, srcA, srcB, 1 );
+}
 
-   for ( i = 0; i < 4; i++ )
+
+void ESUTIL_API
+esMatrixMultiplyBatch ( ESMatrix *result, const ESMatrix *srcA, const ESMatrix *srcB, int count )
+{
+   if ( count > 0 )
    {
-      tmp.m[i][0] =  ( srcA->m[i][0] * srcB->m[0][0] ) +
-                     ( srcA->m[i][1] * srcB->m[1][0] ) +
-                     ( srcA->m[i][2] * srcB->m[2][0] ) +
-                     ( srcA->m[i][3] * srcB->m[3][0] ) ;
-
-      tmp.m[i][1] =  ( srcA->m[i][0] * srcB->m[0][1] ) +
-                     ( srcA->m[i][1] * srcB->m[1][1] ) +
-                     ( srcA->m[i][2] * srcB->m[2][1] ) +
-                     ( srcA->m[i][3] * srcB->m[3][1] ) ;
-
-      tmp.m[i][2] =  ( srcA->m[i][0] * srcB->m[0][2] ) +
-                     ( srcA->m[i][1] * srcB->m[1][2] ) +
-                     ( srcA->m[i][2] * srcB->m[2][2] ) +
-                     ( srcA->m[i][3] * srcB->m[3][2] ) ;
-
-      tmp.m[i][3] =  ( srcA->m[i][0] * srcB->m[0][3] ) +
-                     ( srcA->m[i][1] * srcB->m[1][3] ) +
-                     ( srcA->m[i][2] * srcB->m[2][3] ) +
-                     ( srcA->m[i][3] * srcB->m[3][3] ) ;
+      GetMatrixMultiplyBatch ( ) ( result, srcA, srcB, count );
    }
-
-   memcpy ( result, &tmp, sizeof ( ESMatrix ) );
 }
 
 
@@ -292,19 +583,20 @@ esMatrixLookAt ( ESMatrix *result,
       axisY[2] /= length;
    }
 
-   memset ( result, 0x0, sizeof ( ESMatrix ) );
-
    result->m[0][0] = -axisX[0];
    result->m[0][1] =  axisY[0];
    result->m[0][2] = -axisZ[0];
+   result->m[0][3] = 0.0f;
 
    result->m[1][0] = -axisX[1];
    result->m[1][1] =  axisY[1];
    result->m[1][2] = -axisZ[1];
+   result->m[1][3] = 0.0f;
 
    result->m[2][0] = -axisX[2];
    result->m[2][1] =  axisY[2];
    result->m[2][2] = -axisZ[2];
+   result->m[2][3] = 0.0f;
 
    // translate (-posX, -posY, -posZ)
    result->m[3][0] =  axisX[0] * posX + axisX[1] * posY + axisX[2] * posZ;
@@ -0,0 +1,158 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// ESUniformRing.c
+//
+//    Uniform data for many draws written into one buffer ring per frame,
+//    rather than set with a glUniform call per value.  Each draw gets an
+//    aligned slice of the mapped region, which the caller binds with
+//    esStateBindBufferRange.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include <string.h>
+
+///
+//  Types
+//
+
+// Nested struct of less than 16 bytes, the member after it starts 16 bytes on
+typedef struct
+{
+   ES_STD140_FLOAT ( x );
+   ES_STD140_FLOAT ( y );
+} Std140Inner;
+
+typedef struct
+{
+   ES_STD140_FLOAT ( first );
+   ES_STD140_STRUCT ( Std140Inner, inner );
+   ES_STD140_FLOAT ( last );
+} Std140Outer;
+
+ES_STD140_CHECK ( Std140Outer, inner, 16 );
+ES_STD140_CHECK ( Std140Outer, last, 32 );
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+//
+///
+/// \brief Create a uniform buffer ring
+//
+GLboolean ESUTIL_API esUniformRingInit ( ESUniformRing *ring, GLsizeiptr frameSize )
+{
+   GLint alignment = 0;
+   GLsizeiptr regionSize;
+
+   memset ( ring, 0, sizeof ( ESUniformRing ) );
+
+   glGetIntegerv ( GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment );
+   ring->alignment = alignment > 0 ? alignment : 256;
+
+   // Every region must start on the alignment too, as allocations are
+   // aligned relative to it
+   regionSize = ( frameSize + ring->alignment - 1 ) / ring->alignment * ring->alignment;
+
+   return esBufferRingInit ( &ring->ring, GL_UNIFORM_BUFFER, regionSize, GL_DYNAMIC_DRAW );
+}
+
+//
+///
+/// \brief Map the region of the next frame.  Waits only if the GPU is still reading it.
+//
+GLboolean ESUTIL_API esUniformRingBegin ( ESUniformRing *ring )
+{
+   ring->mapped = ( GLubyte * ) esBufferRingMap ( &ring->ring, NULL );
+   ring->used = 0;
+
+   return ring->mapped != NULL ? GL_TRUE : GL_FALSE;
+}
+
+//
+///
+/// \brief Bump allocation from the mapped region.  Nothing is freed until the whole region is
+///        recycled, once its fence shows the GPU is done.
+//
+void *ESUTIL_API esUniformRingAlloc ( ESUniformRing *ring, GLsizeiptr size, GLintptr *offset )
+{
+   GLsizeiptr start = ( ring->used + ring->alignment - 1 ) / ring->alignment * ring->alignment;
+
+   if ( ring->mapped == NULL || start + size > ring->ring.regionSize )
+   {
+      ring->overflows++;
+      return NULL;
+   }
+
+   ring->used = start + size;
+   *offset = ring->ring.offset + start;
+
+   return ring->mapped + start;
+}
+
+//
+///
+/// \brief Unmap the region.  Call before the draws that read it.
+//
+void ESUTIL_API esUniformRingEnd ( ESUniformRing *ring )
+{
+   if ( ring->mapped != NULL )
+   {
+      esBufferRingUnmap ( &ring->ring );
+      ring->mapped = NULL;
+   }
+}
+
+//
+///
+/// \brief Fence the region.  Call after the last draw that reads it.
+//
+void ESUTIL_API esUniformRingFence ( ESUniformRing *ring )
+{
+   esBufferRingFence ( &ring->ring );
+}
+
+//
+///
+/// \brief Delete the buffer and fences of a uniform ring
+//
+void ESUTIL_API esUniformRingDestroy ( ESUniformRing *ring )
+{
+   esUniformRingEnd ( ring );
+   esBufferRingDestroy ( &ring->ring );
+   memset ( ring, 0, sizeof ( ESUniformRing ) );
+}
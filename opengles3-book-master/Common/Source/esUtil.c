@@ -41,60 +41,25 @@
 //
 #include <stdio.h>
 #include <stdlib.h>
-#include <stdarg.h>
 #include <string.h>
+#include <math.h>
 #include "esUtil.h"
 #include "esUtil_win.h"
 
 #ifdef ANDROID
-#include <android/log.h>
 #include <android_native_app_glue.h>
 #include <android/asset_manager.h>
-typedef AAsset esFile;
-#else
-typedef FILE esFile;
-#endif
-
-#ifdef __APPLE__
-#include "FileWrapper.h"
 #endif
 
 ///
 //  Macros
 //
-#define INVERTED_BIT            (1 << 5)
-
-///
-//  Types
-//
-#ifndef __APPLE__
-#pragma pack(push,x1)                            // Byte alignment (8-bit)
-#pragma pack(1)
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
 #endif
 
-typedef struct
-#ifdef __APPLE__
-__attribute__ ( ( packed ) )
-#endif
-{
-   unsigned char  IdSize,
-            MapType,
-            ImageType;
-   unsigned short PaletteStart,
-            PaletteSize;
-   unsigned char  PaletteEntryDepth;
-   unsigned short X,
-            Y,
-            Width,
-            Height;
-   unsigned char  ColorDepth,
-            Descriptor;
-
-} TGA_HEADER;
-
-#ifndef __APPLE__
-#pragma pack(pop,x1)
-#endif
+// Most fixed updates in a frame unless esSetFixedTimestep says otherwise
+#define DEFAULT_MAX_UPDATE_STEPS      8
 
 #ifndef __APPLE__
 
@@ -119,6 +84,101 @@ EGLint GetContextRenderableType ( EGLDisplay eglDisplay )
    // extension is not supported
    return EGL_OPENGL_ES2_BIT;
 }
+
+///
+// HasEGLExtension()
+//
+//    Check whether an extension is in the EGL extension string of the display.
+//    Pass EGL_NO_DISPLAY to query the client extensions.
+//
+GLboolean HasEGLExtension ( EGLDisplay eglDisplay, const char *extension )
+{
+   const char *extensions = eglQueryString ( eglDisplay, EGL_EXTENSIONS );
+
+   if ( extensions != NULL && strstr ( extensions, extension ) )
+   {
+      return GL_TRUE;
+   }
+
+   return GL_FALSE;
+}
+
+///
+// GetOffscreenDisplay()
+//
+//    Get an EGL display that does not need a window system.  If the
+//    EGL_MESA_platform_surfaceless extension is available, this works without
+//    an X server.  Otherwise fall back to the default display.
+//
+static EGLDisplay GetOffscreenDisplay ( void )
+{
+#if defined(EGL_EXT_platform_base) && !defined(ANDROID)
+
+   if ( HasEGLExtension ( EGL_NO_DISPLAY, "EGL_MESA_platform_surfaceless" ) )
+   {
+      PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+         ( PFNEGLGETPLATFORMDISPLAYEXTPROC ) eglGetProcAddress ( "eglGetPlatformDisplayEXT" );
+
+      if ( getPlatformDisplay != NULL )
+      {
+         EGLDisplay eglDisplay = getPlatformDisplay ( EGL_PLATFORM_SURFACELESS_MESA,
+                                                      EGL_DEFAULT_DISPLAY, NULL );
+
+         if ( eglDisplay != EGL_NO_DISPLAY )
+         {
+            return eglDisplay;
+         }
+      }
+   }
+
+#endif
+   return eglGetDisplay ( EGL_DEFAULT_DISPLAY );
+}
+
+///
+// CreateOffscreenFramebuffer()
+//
+//    Create a framebuffer object with color, depth and stencil attachments
+//    matching the window flags.  Used in place of the window surface when the
+//    context is made current without any surface (EGL_KHR_surfaceless_context).
+//
+static GLboolean CreateOffscreenFramebuffer ( ESContext *esContext, GLuint flags )
+{
+   GLuint renderbuffers[2] = { 0, 0 };
+   GLenum status;
+
+   glGenFramebuffers ( 1, &esContext->offscreenFramebuffer );
+   glBindFramebuffer ( GL_FRAMEBUFFER, esContext->offscreenFramebuffer );
+
+   glGenRenderbuffers ( 2, renderbuffers );
+
+   glBindRenderbuffer ( GL_RENDERBUFFER, renderbuffers[0] );
+   glRenderbufferStorage ( GL_RENDERBUFFER, ( flags & ES_WINDOW_ALPHA ) ? GL_RGBA8 : GL_RGB8,
+                           esContext->width, esContext->height );
+   glFramebufferRenderbuffer ( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                               GL_RENDERBUFFER, renderbuffers[0] );
+
+   if ( flags & ( ES_WINDOW_DEPTH | ES_WINDOW_STENCIL ) )
+   {
+      glBindRenderbuffer ( GL_RENDERBUFFER, renderbuffers[1] );
+      glRenderbufferStorage ( GL_RENDERBUFFER, GL_DEPTH24_STENCIL8,
+                              esContext->width, esContext->height );
+      glFramebufferRenderbuffer ( GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
+                                  GL_RENDERBUFFER, renderbuffers[1] );
+   }
+
+   glBindRenderbuffer ( GL_RENDERBUFFER, 0 );
+
+   status = glCheckFramebufferStatus ( GL_FRAMEBUFFER );
+
+   if ( status != GL_FRAMEBUFFER_COMPLETE )
+   {
+      esLogMessage ( "esCreateWindow: offscreen framebuffer incomplete (0x%x)\n", status );
+      return GL_FALSE;
+   }
+
+   return GL_TRUE;
+}
 #endif
 
 //////////////////////////////////////////////////////////////////
@@ -138,6 +198,8 @@ EGLint GetContextRenderableType ( EGLDisplay eglDisplay )
 //          ES_WINDOW_DEPTH       - specifies that a depth buffer should be created
 //          ES_WINDOW_STENCIL     - specifies that a stencil buffer should be created
 //          ES_WINDOW_MULTISAMPLE - specifies that a multi-sample buffer should be created
+//          ES_WINDOW_OFFSCREEN   - specifies that rendering should go to a pbuffer, or an FBO
+//                                  on a surfaceless context, rather than a window
 //
 GLboolean ESUTIL_API esCreateWindow ( ESContext *esContext, const char *title, GLint width, GLint height, GLuint flags )
 {
@@ -146,12 +208,20 @@ GLboolean ESUTIL_API esCreateWindow ( ESContext *esContext, const char *title, G
    EGLint majorVersion;
    EGLint minorVersion;
    EGLint contextAttribs[] = { EGL_CONTEXT_CLIENT_VERSION, 3, EGL_NONE };
+   GLboolean surfaceless = GL_FALSE;
 
    if ( esContext == NULL )
    {
       return GL_FALSE;
    }
 
+   if ( getenv ( "ES_OFFSCREEN" ) != NULL || getenv ( "ES_BENCHMARK" ) != NULL )
+   {
+      flags |= ES_WINDOW_OFFSCREEN;
+   }
+
+   esContext->flags = flags;
+
 #ifdef ANDROID
    // For Android, get the width/height from the window rather than what the
    // application requested.
@@ -162,12 +232,22 @@ GLboolean ESUTIL_API esCreateWindow ( ESContext *esContext, const char *title, G
    esContext->height = height;
 #endif
 
-   if ( !WinCreate ( esContext, title ) )
+   if ( flags & ES_WINDOW_OFFSCREEN )
    {
-      return GL_FALSE;
+      // No native window, the display must not depend on a window system
+      esContext->eglNativeDisplay = EGL_DEFAULT_DISPLAY;
+      esContext->eglDisplay = GetOffscreenDisplay ( );
+   }
+   else
+   {
+      if ( !WinCreate ( esContext, title ) )
+      {
+         return GL_FALSE;
+      }
+
+      esContext->eglDisplay = eglGetDisplay( esContext->eglNativeDisplay );
    }
 
-   esContext->eglDisplay = eglGetDisplay( esContext->eglNativeDisplay );
    if ( esContext->eglDisplay == EGL_NO_DISPLAY )
    {
       return GL_FALSE;
@@ -193,6 +273,7 @@ GLboolean ESUTIL_API esCreateWindow ( ESContext *esContext, const char *title, G
          // if EGL_KHR_create_context extension is supported, then we will use
          // EGL_OPENGL_ES3_BIT_KHR instead of EGL_OPENGL_ES2_BIT in the attribute list
          EGL_RENDERABLE_TYPE, GetContextRenderableType ( esContext->eglDisplay ),
+         EGL_SURFACE_TYPE,   ( flags & ES_WINDOW_OFFSCREEN ) ? EGL_PBUFFER_BIT : EGL_WINDOW_BIT,
          EGL_NONE
       };
 
@@ -202,6 +283,20 @@ GLboolean ESUTIL_API esCreateWindow ( ESContext *esContext, const char *title, G
          return GL_FALSE;
       }
 
+      // No pbuffer configs, accept any config if the context can be
+      // made current without a surface
+      if ( numConfigs < 1 && ( flags & ES_WINDOW_OFFSCREEN ) &&
+            HasEGLExtension ( esContext->eglDisplay, "EGL_KHR_surfaceless_context" ) )
+      {
+         attribList[ sizeof ( attribList ) / sizeof ( attribList[0] ) - 2 ] = 0;
+         surfaceless = GL_TRUE;
+
+         if ( !eglChooseConfig ( esContext->eglDisplay, attribList, &config, 1, &numConfigs ) )
+         {
+            return GL_FALSE;
+         }
+      }
+
       if ( numConfigs < 1 )
       {
          return GL_FALSE;
@@ -221,10 +316,28 @@ GLboolean ESUTIL_API esCreateWindow ( ESContext *esContext, const char *title, G
 #endif // ANDROID
 
    // Create a surface
-   esContext->eglSurface = eglCreateWindowSurface ( esContext->eglDisplay, config, 
-                                                    esContext->eglNativeWindow, NULL );
+   if ( surfaceless )
+   {
+      esContext->eglSurface = EGL_NO_SURFACE;
+   }
+   else if ( flags & ES_WINDOW_OFFSCREEN )
+   {
+      EGLint pbufferAttribs[] =
+      {
+         EGL_WIDTH,  esContext->width,
+         EGL_HEIGHT, esContext->height,
+         EGL_NONE
+      };
 
-   if ( esContext->eglSurface == EGL_NO_SURFACE )
+      esContext->eglSurface = eglCreatePbufferSurface ( esContext->eglDisplay, config, pbufferAttribs );
+   }
+   else
+   {
+      esContext->eglSurface = eglCreateWindowSurface ( esContext->eglDisplay, config,
+                                                       esContext->eglNativeWindow, NULL );
+   }
+
+   if ( esContext->eglSurface == EGL_NO_SURFACE && !surfaceless )
    {
       return GL_FALSE;
    }
@@ -245,8 +358,28 @@ GLboolean ESUTIL_API esCreateWindow ( ESContext *esContext, const char *title, G
       return GL_FALSE;
    }
 
+   // Without any surface, render into a framebuffer object instead
+   if ( surfaceless && !CreateOffscreenFramebuffer ( esContext, flags ) )
+   {
+      return GL_FALSE;
+   }
+
 #endif // #ifndef __APPLE__
 
+   // ES_UPDATE_RATE switches to fixed updates, that many per second
+   if ( getenv ( "ES_UPDATE_RATE" ) != NULL && atof ( getenv ( "ES_UPDATE_RATE" ) ) > 0.0 )
+   {
+      esSetFixedTimestep ( esContext, ( GLfloat ) ( 1.0 / atof ( getenv ( "ES_UPDATE_RATE" ) ) ), 0 );
+   }
+
+   // ES_PROFILE names the trace file, or is empty for logged averages only
+   if ( getenv ( "ES_PROFILE" ) != NULL )
+   {
+      const char *traceFile = getenv ( "ES_PROFILE" );
+
+      esProfilerEnable ( esContext, traceFile[0] != '\0' ? traceFile : NULL );
+   }
+
    return GL_TRUE;
 }
 
@@ -274,152 +407,81 @@ void ESUTIL_API esRegisterUpdateFunc ( ESContext *esContext, void ( ESCALLBACK *
    esContext->updateFunc = updateFunc;
 }
 
-
 ///
-//  esRegisterKeyFunc()
+//  esSetFixedTimestep()
 //
-void ESUTIL_API esRegisterKeyFunc ( ESContext *esContext,
-                                    void ( ESCALLBACK *keyFunc ) ( ESContext *, unsigned char, int, int ) )
+void ESUTIL_API esSetFixedTimestep ( ESContext *esContext, GLfloat timestep, int maxSteps )
 {
-   esContext->keyFunc = keyFunc;
+   esContext->fixedTimestep = timestep > 0.0f ? timestep : 0.0f;
+   esContext->maxUpdateSteps = maxSteps > 0 ? maxSteps : DEFAULT_MAX_UPDATE_STEPS;
+   esContext->updateAccumulator = 0.0f;
+   esContext->interpolation = 0.0f;
 }
 
-
 ///
-// esLogMessage()
+//  RunUpdates()
 //
-//    Log an error message to the debug output for the platform
+//      Call updateFunc for deltaTime seconds of simulation, once or in fixed
+//      time steps, and return the interpolation for drawFunc
 //
-void ESUTIL_API esLogMessage ( const char *formatStr, ... )
+GLfloat RunUpdates ( ESContext *esContext, float deltaTime )
 {
-   va_list params;
-   char buf[BUFSIZ];
-
-   va_start ( params, formatStr );
-   vsprintf ( buf, formatStr, params );
-
-#ifdef ANDROID
-   __android_log_print ( ANDROID_LOG_INFO, "esUtil" , "%s", buf );
-#else
-   printf ( "%s", buf );
-#endif
-
-   va_end ( params );
-}
+   GLfloat timestep = esContext->fixedTimestep;
+   int steps = 0;
 
-///
-// esFileRead()
-//
-//    Wrapper for platform specific File open
-//
-static esFile *esFileOpen ( void *ioContext, const char *fileName )
-{
-   esFile *pFile = NULL;
-
-#ifdef ANDROID
-
-   if ( ioContext != NULL )
+   if ( esContext->updateFunc == NULL )
    {
-      AAssetManager *assetManager = ( AAssetManager * ) ioContext;
-      pFile = AAssetManager_open ( assetManager, fileName, AASSET_MODE_BUFFER );
+      return 0.0f;
    }
 
-#else
-#ifdef __APPLE__
-   // iOS: Remap the filename to a path that can be opened from the bundle.
-   fileName = GetBundleFileName ( fileName );
-#endif
-
-   pFile = fopen ( fileName, "rb" );
-#endif
-
-   return pFile;
-}
-
-///
-// esFileRead()
-//
-//    Wrapper for platform specific File close
-//
-static void esFileClose ( esFile *pFile )
-{
-   if ( pFile != NULL )
+   if ( timestep <= 0.0f )
    {
-#ifdef ANDROID
-      AAsset_close ( pFile );
-#else
-      fclose ( pFile );
-      pFile = NULL;
-#endif
+      esContext->updateFunc ( esContext, deltaTime );
+      return 0.0f;
    }
-}
 
-///
-// esFileRead()
-//
-//    Wrapper for platform specific File read
-//
-static int esFileRead ( esFile *pFile, int bytesToRead, void *buffer )
-{
-   int bytesRead = 0;
+   esContext->updateAccumulator += deltaTime;
 
-   if ( pFile == NULL )
+   while ( esContext->updateAccumulator >= timestep && steps < esContext->maxUpdateSteps )
    {
-      return bytesRead;
+      esContext->updateFunc ( esContext, timestep );
+      esContext->updateAccumulator -= timestep;
+      steps++;
    }
 
-#ifdef ANDROID
-   bytesRead = AAsset_read ( pFile, buffer, bytesToRead );
-#else
-   bytesRead = fread ( buffer, bytesToRead, 1, pFile );
-#endif
+   // A frame longer than maxUpdateSteps steps would need ever more updates
+   // to catch up with: the simulation drops that time instead
+   if ( esContext->updateAccumulator >= timestep )
+   {
+      esContext->updateAccumulator = fmodf ( esContext->updateAccumulator, timestep );
+   }
 
-   return bytesRead;
+   return esContext->updateAccumulator / timestep;
 }
 
 ///
-// esLoadTGA()
+//  UpdateFrame()
 //
-//    Loads a 8-bit, 24-bit or 32-bit TGA image from a file
+//      Update for a frame deltaTime seconds after the previous one
 //
-char *ESUTIL_API esLoadTGA ( void *ioContext, const char *fileName, int *width, int *height )
+void UpdateFrame ( ESContext *esContext, float deltaTime )
 {
-   char        *buffer;
-   esFile      *fp;
-   TGA_HEADER   Header;
-   int          bytesRead;
-
-   // Open the file for reading
-   fp = esFileOpen ( ioContext, fileName );
-
-   if ( fp == NULL )
+   if ( esContext->pipeline != NULL )
    {
-      // Log error as 'error in opening the input file from apk'
-      esLogMessage ( "esLoadTGA FAILED to load : { %s }\n", fileName );
-      return NULL;
+      PipelineUpdate ( esContext, deltaTime );
    }
-
-   bytesRead = esFileRead ( fp, sizeof ( TGA_HEADER ), &Header );
-
-   *width = Header.Width;
-   *height = Header.Height;
-
-   if ( Header.ColorDepth == 8 ||
-         Header.ColorDepth == 24 || Header.ColorDepth == 32 )
+   else
    {
-      int bytesToRead = sizeof ( char ) * ( *width ) * ( *height ) * Header.ColorDepth / 8;
-
-      // Allocate the image data buffer
-      buffer = ( char * ) malloc ( bytesToRead );
-
-      if ( buffer )
-      {
-         bytesRead = esFileRead ( fp, bytesToRead, buffer );
-         esFileClose ( fp );
-
-         return ( buffer );
-      }
+      esContext->interpolation = RunUpdates ( esContext, deltaTime );
    }
+}
+
 
-   return ( NULL );
+///
+//  esRegisterKeyFunc()
+//
+void ESUTIL_API esRegisterKeyFunc ( ESContext *esContext,
+                                    void ( ESCALLBACK *keyFunc ) ( ESContext *, unsigned char, int, int ) )
+{
+   esContext->keyFunc = keyFunc;
 }
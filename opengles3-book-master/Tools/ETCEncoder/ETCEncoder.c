@@ -0,0 +1,935 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// ETCEncoder.c
+//
+//    Offline ETC2/EAC encoder.  Converts a TGA image to a KTX file in
+//    GL_COMPRESSED_RGB8_ETC2, GL_COMPRESSED_RGBA8_ETC2_EAC or
+//    GL_COMPRESSED_R11_EAC, optionally with a full mip chain, for
+//    esLoadKTX.  Blocks are encoded in parallel with esParallelFor
+//    (ES_NUM_THREADS sets the number of threads).
+//
+//    Usage: ETCEncoder [-mips] [-format rgb8|rgba8|r11] input.tga output.ktx
+//
+//    RGB blocks try the ETC1 individual and differential modes plus the
+//    ETC2 planar mode; the T and H modes are not searched.
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include <time.h>
+#include "esUtil.h"
+
+#define BLOCK_ROWS_PER_CHUNK  1
+
+#define KTX_ENDIANNESS        0x04030201
+
+typedef enum
+{
+   FORMAT_AUTO,
+   FORMAT_RGB8,
+   FORMAT_RGBA8,
+   FORMAT_R11
+} Format;
+
+// One mip level, RGBA with the bottom row first as glTexImage2D expects
+typedef struct
+{
+   int            width;
+   int            height;
+   unsigned char *rgba;
+} Level;
+
+// Work shared by the encode threads
+typedef struct
+{
+   const Level   *level;
+   Format         format;
+   int            blockBytes;
+   int            blocksX;
+   unsigned char *output;
+
+   // Squared error summed per block row, to report PSNR
+   double        *rowError;
+} EncodeJob;
+
+// ETC1 intensity modifier tables, the large and small modifier of each
+static const int etcModifiers[8][2] =
+{
+   { 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 }, { 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 }
+};
+
+// EAC modifier tables
+static const int eacModifiers[16][8] =
+{
+   { -3, -6,  -9, -15, 2, 5, 8, 14 },
+   { -3, -7, -10, -13, 2, 6, 9, 12 },
+   { -2, -5,  -8, -13, 1, 4, 7, 12 },
+   { -2, -4,  -6, -13, 1, 3, 5, 12 },
+   { -3, -6,  -8, -12, 2, 5, 7, 11 },
+   { -3, -7,  -9, -11, 2, 6, 8, 10 },
+   { -4, -7,  -8, -11, 3, 6, 7, 10 },
+   { -3, -5,  -8, -11, 2, 4, 7, 10 },
+   { -2, -6,  -8, -10, 1, 5, 7,  9 },
+   { -2, -5,  -8, -10, 1, 4, 7,  9 },
+   { -2, -4,  -8, -10, 1, 3, 7,  9 },
+   { -2, -5,  -7, -10, 1, 4, 6,  9 },
+   { -3, -4,  -7, -10, 2, 3, 6,  9 },
+   { -1, -2,  -3, -10, 0, 1, 2,  9 },
+   { -4, -6,  -8,  -9, 3, 5, 7,  8 },
+   { -3, -5,  -7,  -9, 2, 4, 6,  8 }
+};
+
+static int Clamp ( int value, int low, int high )
+{
+   return value < low ? low : value > high ? high : value;
+}
+
+///
+// WriteBigEndian()
+//
+//    Store a 64-bit block, most significant byte first
+//
+static void WriteBigEndian ( unsigned char *out, unsigned long long bits )
+{
+   int i;
+
+   for ( i = 0; i < 8; i++ )
+   {
+      out[i] = ( unsigned char ) ( bits >> ( 56 - 8 * i ) );
+   }
+}
+
+///
+// FitSubblock()
+//
+//    Find the modifier table and per-pixel modifiers that best fit eight
+//    pixels around a base color.  Returns the squared error.
+//
+static int FitSubblock ( const unsigned char *pixels[8], const int base[3], int *table, int indices[8] )
+{
+   int bestError = INT_MAX;
+   int t, p, m;
+
+   for ( t = 0; t < 8; t++ )
+   {
+      // Index order of the ETC1 pixel codes: +a, +b, -a, -b
+      int modifiers[4];
+      int tableIndices[8];
+      int error = 0;
+
+      modifiers[0] = etcModifiers[t][0];
+      modifiers[1] = etcModifiers[t][1];
+      modifiers[2] = -etcModifiers[t][0];
+      modifiers[3] = -etcModifiers[t][1];
+
+      for ( p = 0; p < 8 && error < bestError; p++ )
+      {
+         int bestPixel = INT_MAX;
+
+         for ( m = 0; m < 4; m++ )
+         {
+            int dr = Clamp ( base[0] + modifiers[m], 0, 255 ) - pixels[p][0];
+            int dg = Clamp ( base[1] + modifiers[m], 0, 255 ) - pixels[p][1];
+            int db = Clamp ( base[2] + modifiers[m], 0, 255 ) - pixels[p][2];
+            int e = dr * dr + dg * dg + db * db;
+
+            if ( e < bestPixel )
+            {
+               bestPixel = e;
+               tableIndices[p] = m;
+            }
+         }
+
+         error += bestPixel;
+      }
+
+      if ( error < bestError )
+      {
+         bestError = error;
+         *table = t;
+         memcpy ( indices, tableIndices, sizeof ( tableIndices ) );
+      }
+   }
+
+   return bestError;
+}
+
+///
+// Expand4() / Expand5()
+//
+static int Expand4 ( int c )
+{
+   return ( c << 4 ) | c;
+}
+
+static int Expand5 ( int c )
+{
+   return ( c << 3 ) | ( c >> 2 );
+}
+
+// Best fit of one subblock for one quantized base color
+typedef struct
+{
+   int color[3];
+   int table;
+   int indices[8];
+   int error;
+} SubblockFit;
+
+#define NUM_CANDIDATES  3
+
+///
+// FitCandidates()
+//
+//    Fit a subblock with its average color quantized to bits per channel,
+//    and with that color one step darker and lighter, since the modifiers
+//    move all channels together
+//
+static void FitCandidates ( const unsigned char *pixels[8], int bits, SubblockFit fits[NUM_CANDIDATES] )
+{
+   int maxValue = ( 1 << bits ) - 1;
+   int sum[3] = { 0, 0, 0 };
+   int quantized[3];
+   int c, i;
+
+   for ( i = 0; i < 8; i++ )
+   {
+      for ( c = 0; c < 3; c++ )
+      {
+         sum[c] += pixels[i][c];
+      }
+   }
+
+   for ( c = 0; c < 3; c++ )
+   {
+      quantized[c] = ( sum[c] * maxValue + 8 * 255 / 2 ) / ( 8 * 255 );
+   }
+
+   for ( i = 0; i < NUM_CANDIDATES; i++ )
+   {
+      int base[3];
+
+      for ( c = 0; c < 3; c++ )
+      {
+         fits[i].color[c] = Clamp ( quantized[c] + i - 1, 0, maxValue );
+         base[c] = bits == 4 ? Expand4 ( fits[i].color[c] ) : Expand5 ( fits[i].color[c] );
+      }
+
+      fits[i].error = FitSubblock ( pixels, base, &fits[i].table, fits[i].indices );
+   }
+}
+
+///
+// PackETC1()
+//
+//    Pack an individual (diff = 0) or differential (diff = 1) mode block
+//
+static unsigned long long PackETC1 ( int diff, int flip, const SubblockFit *fit0, const SubblockFit *fit1,
+                                     const int subblockPixel[2][8] )
+{
+   unsigned long long bits = 0;
+   int c, i;
+
+   for ( c = 0; c < 3; c++ )
+   {
+      if ( diff )
+      {
+         bits |= ( unsigned long long ) fit0->color[c] << ( 59 - 8 * c );
+         bits |= ( unsigned long long ) ( ( fit1->color[c] - fit0->color[c] ) & 7 ) << ( 56 - 8 * c );
+      }
+      else
+      {
+         bits |= ( unsigned long long ) fit0->color[c] << ( 60 - 8 * c );
+         bits |= ( unsigned long long ) fit1->color[c] << ( 56 - 8 * c );
+      }
+   }
+
+   bits |= ( unsigned long long ) fit0->table << 37;
+   bits |= ( unsigned long long ) fit1->table << 34;
+   bits |= ( unsigned long long ) diff << 33;
+   bits |= ( unsigned long long ) flip << 32;
+
+   for ( i = 0; i < 8; i++ )
+   {
+      int p0 = subblockPixel[0][i];
+      int p1 = subblockPixel[1][i];
+
+      bits |= ( unsigned long long ) ( fit0->indices[i] >> 1 ) << ( p0 + 16 );
+      bits |= ( unsigned long long ) ( fit0->indices[i] & 1 ) << p0;
+      bits |= ( unsigned long long ) ( fit1->indices[i] >> 1 ) << ( p1 + 16 );
+      bits |= ( unsigned long long ) ( fit1->indices[i] & 1 ) << p1;
+   }
+
+   return bits;
+}
+
+///
+// EncodePlanar()
+//
+//    Fit the ETC2 planar mode, a color gradient over the block, by least
+//    squares.  Returns the squared error.
+//
+static int EncodePlanar ( const unsigned char *block[16], unsigned long long *result )
+{
+   static const int channelBits[3] = { 6, 7, 6 };
+   int origin[3], horizontal[3], vertical[3];
+   unsigned long long bits;
+   int error = 0;
+   int c, i, stuffing;
+
+   for ( c = 0; c < 3; c++ )
+   {
+      int maxValue = ( 1 << channelBits[c] ) - 1;
+      double mean = 0.0, dx = 0.0, dy = 0.0;
+      double slopeX, slopeY, o, h, v;
+
+      // Pixel i is at x = i / 4, y = i % 4
+      for ( i = 0; i < 16; i++ )
+      {
+         mean += block[i][c];
+         dx += ( i / 4 - 1.5 ) * block[i][c];
+         dy += ( i % 4 - 1.5 ) * block[i][c];
+      }
+
+      // Variance of x and of y over the block is 1.25 per pixel
+      mean /= 16.0;
+      slopeX = dx / 20.0;
+      slopeY = dy / 20.0;
+
+      o = mean - 1.5 * slopeX - 1.5 * slopeY;
+      h = o + 4.0 * slopeX;
+      v = o + 4.0 * slopeY;
+
+      origin[c] = Clamp ( ( int ) floor ( o * maxValue / 255.0 + 0.5 ), 0, maxValue );
+      horizontal[c] = Clamp ( ( int ) floor ( h * maxValue / 255.0 + 0.5 ), 0, maxValue );
+      vertical[c] = Clamp ( ( int ) floor ( v * maxValue / 255.0 + 0.5 ), 0, maxValue );
+   }
+
+   for ( i = 0; i < 16; i++ )
+   {
+      int x = i / 4, y = i % 4;
+
+      for ( c = 0; c < 3; c++ )
+      {
+         int shift = 8 - channelBits[c];
+         int o = ( origin[c] << shift ) | ( origin[c] >> ( channelBits[c] - shift ) );
+         int h = ( horizontal[c] << shift ) | ( horizontal[c] >> ( channelBits[c] - shift ) );
+         int v = ( vertical[c] << shift ) | ( vertical[c] >> ( channelBits[c] - shift ) );
+         int d = Clamp ( ( x * ( h - o ) + y * ( v - o ) + 4 * o + 2 ) >> 2, 0, 255 ) - block[i][c];
+
+         error += d * d;
+      }
+   }
+
+   bits = ( unsigned long long ) origin[0] << 57;
+   bits |= ( unsigned long long ) ( origin[1] >> 6 ) << 56;
+   bits |= ( unsigned long long ) ( origin[1] & 0x3F ) << 49;
+   bits |= ( unsigned long long ) ( origin[2] >> 5 ) << 48;
+   bits |= ( unsigned long long ) ( ( origin[2] >> 3 ) & 3 ) << 43;
+   bits |= ( unsigned long long ) ( origin[2] & 7 ) << 39;
+   bits |= ( unsigned long long ) ( horizontal[0] >> 1 ) << 34;
+   bits |= 1ULL << 33;
+   bits |= ( unsigned long long ) ( horizontal[0] & 1 ) << 32;
+   bits |= ( unsigned long long ) horizontal[1] << 25;
+   bits |= ( unsigned long long ) horizontal[2] << 19;
+   bits |= ( unsigned long long ) vertical[0] << 13;
+   bits |= ( unsigned long long ) vertical[1] << 6;
+   bits |= ( unsigned long long ) vertical[2];
+
+   // Planar mode is signalled by the red and green differential colors
+   // staying in range while blue overflows.  Bits 63, 55, 47-45 and 42 are
+   // free, so pick any setting of them that does that.
+   for ( stuffing = 0; stuffing < 64; stuffing++ )
+   {
+      unsigned long long candidate = bits;
+      int base[3], delta[3];
+
+      candidate |= ( unsigned long long ) ( stuffing & 1 ) << 63;
+      candidate |= ( unsigned long long ) ( ( stuffing >> 1 ) & 1 ) << 55;
+      candidate |= ( unsigned long long ) ( ( stuffing >> 2 ) & 7 ) << 45;
+      candidate |= ( unsigned long long ) ( ( stuffing >> 5 ) & 1 ) << 42;
+
+      for ( c = 0; c < 3; c++ )
+      {
+         base[c] = ( int ) ( candidate >> ( 59 - 8 * c ) ) & 0x1F;
+         delta[c] = ( int ) ( candidate >> ( 56 - 8 * c ) ) & 7;
+         delta[c] = delta[c] >= 4 ? delta[c] - 8 : delta[c];
+      }
+
+      if ( base[0] + delta[0] >= 0 && base[0] + delta[0] <= 31 &&
+            base[1] + delta[1] >= 0 && base[1] + delta[1] <= 31 &&
+            ( base[2] + delta[2] < 0 || base[2] + delta[2] > 31 ) )
+      {
+         *result = candidate;
+         return error;
+      }
+   }
+
+   return INT_MAX;
+}
+
+///
+// EncodeETC2Block()
+//
+//    Encode a 4x4 RGB block, pixel i at x = i / 4, y = i % 4.  Returns the
+//    squared error.
+//
+static int EncodeETC2Block ( const unsigned char *block[16], unsigned char out[8] )
+{
+   unsigned long long bestBits = 0;
+   int bestError = INT_MAX;
+   unsigned long long planarBits;
+   int planarError;
+   int flip;
+
+   for ( flip = 0; flip < 2; flip++ )
+   {
+      const unsigned char *pixels[2][8];
+      int subblockPixel[2][8];
+      SubblockFit individual[2][NUM_CANDIDATES];
+      SubblockFit differential[2][NUM_CANDIDATES];
+      const SubblockFit *best0 = NULL, *best1 = NULL;
+      int count[2] = { 0, 0 };
+      int i, j, c;
+
+      // flip = 0 splits into left and right halves, flip = 1 into bottom and top
+      for ( i = 0; i < 16; i++ )
+      {
+         int s = flip ? ( i % 4 ) >= 2 : ( i / 4 ) >= 2;
+
+         subblockPixel[s][count[s]] = i;
+         pixels[s][count[s]++] = block[i];
+      }
+
+      for ( i = 0; i < 2; i++ )
+      {
+         FitCandidates ( pixels[i], 4, individual[i] );
+         FitCandidates ( pixels[i], 5, differential[i] );
+      }
+
+      // Individual mode: the two halves are independent
+      for ( i = 0; i < NUM_CANDIDATES; i++ )
+      {
+         if ( best0 == NULL || individual[0][i].error < best0->error )
+         {
+            best0 = &individual[0][i];
+         }
+
+         if ( best1 == NULL || individual[1][i].error < best1->error )
+         {
+            best1 = &individual[1][i];
+         }
+      }
+
+      if ( best0->error + best1->error < bestError )
+      {
+         bestError = best0->error + best1->error;
+         bestBits = PackETC1 ( 0, flip, best0, best1, ( const int ( * )[8] ) subblockPixel );
+      }
+
+      // Differential mode: the second color must be within -4..3 of the first
+      for ( i = 0; i < NUM_CANDIDATES; i++ )
+      {
+         for ( j = 0; j < NUM_CANDIDATES; j++ )
+         {
+            const SubblockFit *fit0 = &differential[0][i];
+            const SubblockFit *fit1 = &differential[1][j];
+            int valid = 1;
+
+            for ( c = 0; c < 3; c++ )
+            {
+               int delta = fit1->color[c] - fit0->color[c];
+
+               valid &= delta >= -4 && delta <= 3;
+            }
+
+            if ( valid && fit0->error + fit1->error < bestError )
+            {
+               bestError = fit0->error + fit1->error;
+               bestBits = PackETC1 ( 1, flip, fit0, fit1, ( const int ( * )[8] ) subblockPixel );
+            }
+         }
+      }
+   }
+
+   planarError = EncodePlanar ( block, &planarBits );
+
+   if ( planarError < bestError )
+   {
+      bestError = planarError;
+      bestBits = planarBits;
+   }
+
+   WriteBigEndian ( out, bestBits );
+
+   return bestError;
+}
+
+///
+// EncodeEACBlock()
+//
+//    Encode 16 8-bit values, pixel i at x = i / 4, y = i % 4, as an EAC
+//    block: 11-bit R11 when r11 is set, otherwise the 8-bit alpha of
+//    RGBA8 ETC2/EAC.  Returns the squared error in 8-bit units.
+//
+static double EncodeEACBlock ( const unsigned char values[16], int r11, unsigned char out[8] )
+{
+   // Work in the decoded scale: 0..2047 for R11, 0..255 for alpha
+   int scale = r11 ? 8 : 1;
+   int maxValue = r11 ? 2047 : 255;
+   int target[16];
+   int low = INT_MAX, high = INT_MIN;
+   long long bestError = LLONG_MAX;
+   unsigned long long bestBits = 0;
+   int t, i;
+
+   for ( i = 0; i < 16; i++ )
+   {
+      target[i] = r11 ? ( values[i] * 2047 + 127 ) / 255 : values[i];
+      low = target[i] < low ? target[i] : low;
+      high = target[i] > high ? target[i] : high;
+   }
+
+   for ( t = 0; t < 16; t++ )
+   {
+      const int *modifiers = eacModifiers[t];
+      int span = modifiers[7] - modifiers[3];
+      int multiplier = ( high - low + span * scale / 2 ) / ( span * scale );
+      int m;
+
+      for ( m = multiplier - 1; m <= multiplier + 1; m++ )
+      {
+         int mult = Clamp ( m, 1, 15 );
+         int center = ( ( low - modifiers[3] * mult * scale ) + ( high - modifiers[7] * mult * scale ) ) / 2;
+         int b;
+
+         center = ( center - ( r11 ? 4 : 0 ) ) / scale;
+
+         for ( b = center - 1; b <= center + 1; b++ )
+         {
+            int base = Clamp ( b, 0, 255 );
+            unsigned long long bits;
+            long long error = 0;
+
+            bits = ( unsigned long long ) base << 56;
+            bits |= ( unsigned long long ) mult << 52;
+            bits |= ( unsigned long long ) t << 48;
+
+            for ( i = 0; i < 16 && error < bestError; i++ )
+            {
+               int bestPixel = INT_MAX;
+               int bestIndex = 0;
+               int k;
+
+               for ( k = 0; k < 8; k++ )
+               {
+                  int decoded = r11 ? base * 8 + 4 + modifiers[k] * mult * 8 : base + modifiers[k] * mult;
+                  int d = Clamp ( decoded, 0, maxValue ) - target[i];
+
+                  if ( d * d < bestPixel )
+                  {
+                     bestPixel = d * d;
+                     bestIndex = k;
+                  }
+               }
+
+               error += bestPixel;
+               bits |= ( unsigned long long ) bestIndex << ( 45 - 3 * i );
+            }
+
+            if ( error < bestError )
+            {
+               bestError = error;
+               bestBits = bits;
+            }
+         }
+      }
+   }
+
+   WriteBigEndian ( out, bestBits );
+
+   return r11 ? bestError * ( 255.0 * 255.0 ) / ( 2047.0 * 2047.0 ) : ( double ) bestError;
+}
+
+///
+// EncodeBlockRows()
+//
+//    esParallelFor callback, encode block rows [first, last)
+//
+static void ESCALLBACK EncodeBlockRows ( void *userData, int first, int last )
+{
+   EncodeJob *job = ( EncodeJob * ) userData;
+   const Level *level = job->level;
+   int by, bx, i;
+
+   for ( by = first; by < last; by++ )
+   {
+      double rowError = 0.0;
+
+      for ( bx = 0; bx < job->blocksX; bx++ )
+      {
+         unsigned char *out = job->output + ( ( size_t ) by * job->blocksX + bx ) * job->blockBytes;
+         const unsigned char *block[16];
+         unsigned char channel[16];
+
+         // Edge blocks repeat the last row and column
+         for ( i = 0; i < 16; i++ )
+         {
+            int x = Clamp ( bx * 4 + i / 4, 0, level->width - 1 );
+            int y = Clamp ( by * 4 + i % 4, 0, level->height - 1 );
+
+            block[i] = level->rgba + ( ( size_t ) y * level->width + x ) * 4;
+         }
+
+         if ( job->format == FORMAT_R11 )
+         {
+            for ( i = 0; i < 16; i++ )
+            {
+               channel[i] = block[i][0];
+            }
+
+            rowError += EncodeEACBlock ( channel, 1, out );
+         }
+         else if ( job->format == FORMAT_RGBA8 )
+         {
+            for ( i = 0; i < 16; i++ )
+            {
+               channel[i] = block[i][3];
+            }
+
+            rowError += EncodeEACBlock ( channel, 0, out );
+            rowError += EncodeETC2Block ( block, out + 8 );
+         }
+         else
+         {
+            rowError += EncodeETC2Block ( block, out );
+         }
+      }
+
+      job->rowError[by] = rowError;
+   }
+}
+
+///
+// LoadLevel()
+//
+//    Load a TGA into RGBA, swapping it from BGR and flipping it bottom-up
+//
+static int LoadLevel ( const char *fileName, Level *level, int *bytesPerPixel )
+{
+   ESImage image;
+   int x, y;
+
+   if ( !esLoadTGAImage ( NULL, fileName, &image ) )
+   {
+      return 0;
+   }
+
+   level->width = image.width;
+   level->height = image.height;
+   level->rgba = malloc ( ( size_t ) image.width * image.height * 4 );
+   *bytesPerPixel = image.bytesPerPixel;
+
+   if ( level->rgba == NULL )
+   {
+      esFreeImage ( &image );
+      return 0;
+   }
+
+   for ( y = 0; y < image.height; y++ )
+   {
+      int srcRow = image.topDown ? image.height - 1 - y : y;
+      const unsigned char *src = ( const unsigned char * ) image.pixels +
+                                 ( size_t ) srcRow * image.width * image.bytesPerPixel;
+      unsigned char *dst = level->rgba + ( size_t ) y * image.width * 4;
+
+      for ( x = 0; x < image.width; x++, src += image.bytesPerPixel, dst += 4 )
+      {
+         if ( image.bytesPerPixel == 1 )
+         {
+            dst[0] = dst[1] = dst[2] = src[0];
+            dst[3] = 255;
+         }
+         else
+         {
+            dst[0] = src[2];
+            dst[1] = src[1];
+            dst[2] = src[0];
+            dst[3] = image.bytesPerPixel == 4 ? src[3] : 255;
+         }
+      }
+   }
+
+   esFreeImage ( &image );
+
+   return 1;
+}
+
+///
+// Downsample()
+//
+//    Box filter a level to half size, rounding odd sizes down
+//
+static int Downsample ( const Level *src, Level *dst )
+{
+   int x, y, c;
+
+   dst->width = src->width > 1 ? src->width / 2 : 1;
+   dst->height = src->height > 1 ? src->height / 2 : 1;
+   dst->rgba = malloc ( ( size_t ) dst->width * dst->height * 4 );
+
+   if ( dst->rgba == NULL )
+   {
+      return 0;
+   }
+
+   for ( y = 0; y < dst->height; y++ )
+   {
+      int y0 = Clamp ( y * 2, 0, src->height - 1 );
+      int y1 = Clamp ( y * 2 + 1, 0, src->height - 1 );
+
+      for ( x = 0; x < dst->width; x++ )
+      {
+         int x0 = Clamp ( x * 2, 0, src->width - 1 );
+         int x1 = Clamp ( x * 2 + 1, 0, src->width - 1 );
+
+         for ( c = 0; c < 4; c++ )
+         {
+            int sum = src->rgba[ ( ( size_t ) y0 * src->width + x0 ) * 4 + c ] +
+                      src->rgba[ ( ( size_t ) y0 * src->width + x1 ) * 4 + c ] +
+                      src->rgba[ ( ( size_t ) y1 * src->width + x0 ) * 4 + c ] +
+                      src->rgba[ ( ( size_t ) y1 * src->width + x1 ) * 4 + c ];
+
+            dst->rgba[ ( ( size_t ) y * dst->width + x ) * 4 + c ] = ( unsigned char ) ( ( sum + 2 ) / 4 );
+         }
+      }
+   }
+
+   return 1;
+}
+
+///
+// WriteU32()
+//
+static void WriteU32 ( FILE *fp, unsigned int value )
+{
+   fwrite ( &value, sizeof ( value ), 1, fp );
+}
+
+///
+// Encode the image named on the command line
+//
+int esMain ( ESContext *esContext )
+{
+   static const unsigned char identifier[12] =
+   {
+      0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n'
+   };
+   const char *inputName = NULL;
+   const char *outputName = NULL;
+   Format format = FORMAT_AUTO;
+   int mips = 0;
+   int bytesPerPixel;
+   int numLevels = 1;
+   GLenum internalFormat, baseFormat;
+   int blockBytes;
+   Level level;
+   FILE *fp;
+   clock_t start = clock ( );
+   int i;
+
+   // Everything happens in esMain, there is no window or main loop
+   esContext->flags = ES_WINDOW_NONE;
+
+   for ( i = 1; i < esContext->argc; i++ )
+   {
+      const char *arg = esContext->argv[i];
+
+      if ( strcmp ( arg, "-mips" ) == 0 )
+      {
+         mips = 1;
+      }
+      else if ( strcmp ( arg, "-format" ) == 0 && i + 1 < esContext->argc )
+      {
+         arg = esContext->argv[++i];
+         format = strcmp ( arg, "rgb8" ) == 0 ? FORMAT_RGB8 :
+                  strcmp ( arg, "rgba8" ) == 0 ? FORMAT_RGBA8 :
+                  strcmp ( arg, "r11" ) == 0 ? FORMAT_R11 : FORMAT_AUTO;
+
+         if ( format == FORMAT_AUTO )
+         {
+            esLogMessage ( "Unknown format %s\n", arg );
+            return GL_FALSE;
+         }
+      }
+      else if ( inputName == NULL )
+      {
+         inputName = arg;
+      }
+      else
+      {
+         outputName = arg;
+      }
+   }
+
+   if ( inputName == NULL || outputName == NULL )
+   {
+      esLogMessage ( "Usage: ETCEncoder [-mips] [-format rgb8|rgba8|r11] input.tga output.ktx\n" );
+      return GL_FALSE;
+   }
+
+   if ( !LoadLevel ( inputName, &level, &bytesPerPixel ) )
+   {
+      esLogMessage ( "Error loading (%s) image.\n", inputName );
+      return GL_FALSE;
+   }
+
+   if ( format == FORMAT_AUTO )
+   {
+      format = bytesPerPixel == 1 ? FORMAT_R11 : bytesPerPixel == 4 ? FORMAT_RGBA8 : FORMAT_RGB8;
+   }
+
+   internalFormat = format == FORMAT_R11 ? GL_COMPRESSED_R11_EAC :
+                    format == FORMAT_RGBA8 ? GL_COMPRESSED_RGBA8_ETC2_EAC : GL_COMPRESSED_RGB8_ETC2;
+   baseFormat = format == FORMAT_R11 ? GL_RED : format == FORMAT_RGBA8 ? GL_RGBA : GL_RGB;
+   blockBytes = format == FORMAT_RGBA8 ? 16 : 8;
+
+   if ( mips )
+   {
+      int size = level.width > level.height ? level.width : level.height;
+
+      while ( size > 1 )
+      {
+         size /= 2;
+         numLevels++;
+      }
+   }
+
+   fp = fopen ( outputName, "wb" );
+
+   if ( fp == NULL )
+   {
+      esLogMessage ( "Error opening (%s) for writing.\n", outputName );
+      free ( level.rgba );
+      return GL_FALSE;
+   }
+
+   fwrite ( identifier, sizeof ( identifier ), 1, fp );
+   WriteU32 ( fp, KTX_ENDIANNESS );
+   WriteU32 ( fp, 0 );              // glType
+   WriteU32 ( fp, 1 );              // glTypeSize
+   WriteU32 ( fp, 0 );              // glFormat
+   WriteU32 ( fp, internalFormat );
+   WriteU32 ( fp, baseFormat );
+   WriteU32 ( fp, level.width );
+   WriteU32 ( fp, level.height );
+   WriteU32 ( fp, 0 );              // pixelDepth
+   WriteU32 ( fp, 0 );              // numberOfArrayElements
+   WriteU32 ( fp, 1 );              // numberOfFaces
+   WriteU32 ( fp, numLevels );
+   WriteU32 ( fp, 0 );              // bytesOfKeyValueData
+
+   for ( i = 0; i < numLevels; i++ )
+   {
+      EncodeJob job;
+      int blocksY = ( level.height + 3 ) / 4;
+      size_t size;
+      double error = 0.0;
+      int y;
+
+      job.level = &level;
+      job.format = format;
+      job.blockBytes = blockBytes;
+      job.blocksX = ( level.width + 3 ) / 4;
+      size = ( size_t ) job.blocksX * blocksY * blockBytes;
+      job.output = malloc ( size );
+      job.rowError = malloc ( blocksY * sizeof ( double ) );
+
+      if ( job.output == NULL || job.rowError == NULL )
+      {
+         free ( job.output );
+         free ( job.rowError );
+         break;
+      }
+
+      esParallelFor ( blocksY, BLOCK_ROWS_PER_CHUNK, EncodeBlockRows, &job );
+
+      // Block data is a multiple of 8 bytes, so no mip padding is needed
+      WriteU32 ( fp, ( unsigned int ) size );
+      fwrite ( job.output, size, 1, fp );
+
+      for ( y = 0; y < blocksY; y++ )
+      {
+         error += job.rowError[y];
+      }
+
+      if ( i == 0 )
+      {
+         // Includes the padding of edge blocks
+         double channels = format == FORMAT_R11 ? 1.0 : format == FORMAT_RGBA8 ? 4.0 : 3.0;
+         double mse = error / ( ( double ) job.blocksX * blocksY * 16 * channels );
+
+         esLogMessage ( "%s: %dx%d, %d mip levels, base level PSNR %.2f dB\n", outputName, level.width, level.height,
+                        numLevels, mse > 0.0 ? 10.0 * log10 ( 255.0 * 255.0 / mse ) : 99.0 );
+      }
+
+      free ( job.output );
+      free ( job.rowError );
+
+      if ( i + 1 < numLevels )
+      {
+         Level next;
+
+         if ( !Downsample ( &level, &next ) )
+         {
+            break;
+         }
+
+         free ( level.rgba );
+         level = next;
+      }
+   }
+
+   free ( level.rgba );
+
+   if ( fclose ( fp ) != 0 || i < numLevels )
+   {
+      esLogMessage ( "Error writing (%s).\n", outputName );
+      return GL_FALSE;
+   }
+
+   esLogMessage ( "Encoded in %.2f s of CPU time\n", ( double ) ( clock ( ) - start ) / CLOCKS_PER_SEC );
+
+   return GL_TRUE;
+}